@@ -31,4 +31,22 @@ OF_DIRECT_MEMBERS
 		 mutationsPtr: (nullable unsigned long *)mutationsPtr;
 @end
 
+#if defined(OF_HAVE_BLOCKS) && defined(OF_HAVE_THREADS)
+# ifdef __cplusplus
+extern "C" {
+# endif
+/*
+ * Calls the block for all indexes below count on the thread pool. The calling
+ * thread processes indexes as well and only waits for the indexes that are
+ * already being processed by others, so that this also works when called from
+ * within a job of the same thread pool. The first exception thrown by the
+ * block is rethrown.
+ */
+extern void OFArrayApplyConcurrently(OFThreadPool *threadPool, size_t count,
+    void (^block)(size_t idx));
+# ifdef __cplusplus
+}
+# endif
+#endif
+
 OF_ASSUME_NONNULL_END
@@ -33,7 +33,11 @@ OF_ASSUME_NONNULL_BEGIN
 
 /** @file */
 
+@class OFStream;
 @class OFString;
+#ifdef OF_HAVE_THREADS
+@class OFThreadPool;
+#endif
 
 /**
  * @brief Options for joining the objects of an array.
@@ -52,7 +56,9 @@ typedef enum {
  */
 typedef enum {
 	/** Sort the array descending */
-	OFArraySortDescending = 1
+	OFArraySortDescending = 1,
+	/** Keep objects that compare equal in their original order */
+	OFArraySortStable = 2
 } OFArraySortOptions;
 
 #ifdef OF_HAVE_BLOCKS
@@ -445,6 +451,34 @@ typedef id _Nullable (^OFArrayFoldBlock)(id _Nullable left, id right);
  */
 - (OFArray OF_GENERIC(ObjectType) *)arrayByRemovingObject: (ObjectType)object;
 
+/**
+ * @brief Writes the JSON representation of the array to the specified
+ *	  stream.
+ *
+ * Unlike @ref JSONRepresentationWithOptions:, this does not create an
+ * intermediate string for each contained object, but writes everything
+ * directly to the stream. For best performance, the stream should have
+ * @ref OFStream#buffersWrites enabled.
+ *
+ * @param stream The stream to write the JSON representation to
+ * @param options The options to use when creating the JSON representation
+ */
+- (void)writeJSONToStream: (OFStream *)stream
+		  options: (OFJSONRepresentationOptions)options;
+
+/**
+ * @brief Writes the MessagePack representation of the array to the
+ *	  specified stream.
+ *
+ * Unlike @ref messagePackRepresentation, this does not create an intermediate
+ * OFData for each contained object, but writes everything directly to the
+ * stream. For best performance, the stream should have
+ * @ref OFStream#buffersWrites enabled.
+ *
+ * @param stream The stream to write the MessagePack representation to
+ */
+- (void)writeMessagePackToStream: (OFStream *)stream;
+
 #ifdef OF_HAVE_BLOCKS
 /**
  * @brief Executes a block for each object.
@@ -489,6 +523,76 @@ typedef id _Nullable (^OFArrayFoldBlock)(id _Nullable left, id right);
  * @return The array folded to a single object
  */
 - (nullable id)foldUsingBlock: (OFArrayFoldBlock)block;
+
+# ifdef OF_HAVE_THREADS
+/**
+ * @brief Executes a block for each object, using the specified thread pool to
+ *	  process several objects concurrently.
+ *
+ * The array is split into consecutive ranges which are processed concurrently
+ * by the threads of the thread pool and the calling thread. The block is
+ * called for the objects of each range in order, but there is no order between
+ * objects of different ranges. Setting `stop` to true stops all ranges, but
+ * objects that are already being processed are still finished.
+ *
+ * This can also be called from within a job of the thread pool.
+ *
+ * @warning The array must not be mutated during the enumeration.
+ *
+ * @param threadPool The thread pool to use
+ * @param block The block to execute for each object
+ */
+- (void)
+    enumerateObjectsConcurrentlyOnThreadPool: (OFThreadPool *)threadPool
+				  usingBlock: (OFArrayEnumerationBlock)block;
+
+/**
+ * @brief Creates a new array, mapping each object using the specified block,
+ *	  using the specified thread pool to map several objects concurrently.
+ *
+ * The objects in the new array are in the same order as in the original
+ * array.
+ *
+ * @param threadPool The thread pool to use
+ * @param block A block which maps an object for each object
+ * @return A new, autoreleased OFArray
+ */
+- (OFArray *)mappedArrayConcurrentlyOnThreadPool: (OFThreadPool *)threadPool
+				      usingBlock: (OFArrayMapBlock)block;
+
+/**
+ * @brief Creates a new array, only containing the objects for which the block
+ *	  returns true, using the specified thread pool to filter several
+ *	  objects concurrently.
+ *
+ * The objects in the new array are in the same order as in the original
+ * array.
+ *
+ * @param threadPool The thread pool to use
+ * @param block A block which determines if the object should be in the new
+ *		array
+ * @return A new, autoreleased OFArray
+ */
+- (OFArray OF_GENERIC(ObjectType) *)
+    filteredArrayConcurrentlyOnThreadPool: (OFThreadPool *)threadPool
+			       usingBlock: (OFArrayFilterBlock)block;
+
+/**
+ * @brief Folds the array to a single object using the specified block, using
+ *	  the specified thread pool to fold several ranges of the array
+ *	  concurrently.
+ *
+ * Each range is folded from left to right and the results of the ranges are
+ * then folded in order. This gives the same result as @ref foldUsingBlock:
+ * only if the block is associative.
+ *
+ * @param threadPool The thread pool to use
+ * @param block A block which folds two objects into one
+ * @return The array folded to a single object
+ */
+- (nullable id)foldConcurrentlyOnThreadPool: (OFThreadPool *)threadPool
+				 usingBlock: (OFArrayFoldBlock)block;
+# endif
 #endif
 #if !defined(OF_HAVE_GENERICS) && !defined(DOXYGEN)
 # undef ObjectType
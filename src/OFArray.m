@@ -17,6 +17,7 @@
 
 #include <stdarg.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <assert.h>
 
@@ -24,9 +25,15 @@
 #import "OFArray+Private.h"
 #import "OFAdjacentArray.h"
 #import "OFData.h"
+#import "OFMessagePackWriting.h"
 #import "OFNull.h"
+#import "OFStream.h"
 #import "OFString.h"
 #import "OFSubarray.h"
+#ifdef OF_HAVE_THREADS
+# import "OFCondition.h"
+# import "OFThreadPool.h"
+#endif
 #import "OFXMLElement.h"
 
 #import "OFEnumerationMutationException.h"
@@ -41,11 +48,101 @@ static struct {
 - (OFString *)
     of_JSONRepresentationWithOptions: (OFJSONRepresentationOptions)options
 			       depth: (size_t)depth;
+- (void)of_writeJSONToStream: (OFStream *)stream
+		     options: (OFJSONRepresentationOptions)options
+		       depth: (size_t)depth;
 @end
 
 @interface OFPlaceholderArray: OFArray
 @end
 
+#if defined(OF_HAVE_BLOCKS) && defined(OF_HAVE_THREADS)
+static size_t
+concurrentRangesCount(OFThreadPool *threadPool, size_t count)
+{
+	/* Use more ranges than threads so that the load is balanced. */
+	size_t rangesCount = (threadPool.size + 1) * 4;
+
+	return (rangesCount < count ? rangesCount : count);
+}
+
+static OFRange
+concurrentRange(size_t idx, size_t rangesCount, size_t count)
+{
+	size_t length = count / rangesCount, remainder = count % rangesCount;
+
+	if (idx < remainder)
+		return OFRangeMake(idx * (length + 1), length + 1);
+
+	return OFRangeMake(idx * length + remainder, length);
+}
+
+void
+OFArrayApplyConcurrently(OFThreadPool *threadPool, size_t count,
+    void (^block)(size_t idx))
+{
+	OFCondition *condition = [OFCondition condition];
+	__block size_t nextIndex = 0, doneCount = 0;
+	__block id exception = nil;
+	size_t helpersCount;
+	void (^worker)(void) = ^ {
+		for (;;) {
+			void *pool;
+			size_t idx;
+			id e = nil;
+
+			[condition lock];
+			idx = nextIndex;
+			if (idx < count)
+				nextIndex++;
+			[condition unlock];
+
+			if (idx >= count)
+				return;
+
+			pool = objc_autoreleasePoolPush();
+			@try {
+				block(idx);
+			} @catch (id e2) {
+				e = [e2 retain];
+			}
+			objc_autoreleasePoolPop(pool);
+
+			[condition lock];
+			if (e != nil) {
+				if (exception == nil)
+					exception = e;
+				else
+					[e release];
+			}
+			if (++doneCount == count)
+				[condition signal];
+			[condition unlock];
+		}
+	};
+
+	helpersCount = threadPool.size;
+	if (helpersCount >= count)
+		helpersCount = (count > 0 ? count - 1 : 0);
+
+	for (size_t i = 0; i < helpersCount; i++)
+		[threadPool dispatchWithBlock: worker];
+
+	worker();
+
+	[condition lock];
+	@try {
+		while (doneCount < count)
+			[condition wait];
+	} @finally {
+		[condition unlock];
+	}
+
+	if (exception != nil)
+		@throw [exception autorelease];
+}
+#endif
+
 @implementation OFPlaceholderArray
 - (instancetype)init
 {
@@ -647,32 +744,66 @@ static struct {
 	return JSON;
 }
 
+- (void)writeJSONToStream: (OFStream *)stream
+		  options: (OFJSONRepresentationOptions)options
+{
+	[self of_writeJSONToStream: stream options: options depth: 0];
+}
+
+- (void)of_writeJSONToStream: (OFStream *)stream
+		     options: (OFJSONRepresentationOptions)options
+		       depth: (size_t)depth
+{
+	size_t i, count = self.count;
+
+	[stream writeBuffer: "[" length: 1];
+
+	if (options & OFJSONRepresentationOptionPretty) {
+		[stream writeBuffer: "\n" length: 1];
+
+		i = 0;
+		for (id object in self) {
+			for (size_t j = 0; j <= depth; j++)
+				[stream writeBuffer: "\t" length: 1];
+
+			[object of_writeJSONToStream: stream
+					     options: options
+					       depth: depth + 1];
+
+			if (++i < count)
+				[stream writeBuffer: ",\n" length: 2];
+			else
+				[stream writeBuffer: "\n" length: 1];
+		}
+
+		for (size_t j = 0; j < depth; j++)
+			[stream writeBuffer: "\t" length: 1];
+	} else {
+		i = 0;
+		for (id object in self) {
+			[object of_writeJSONToStream: stream
+					     options: options
+					       depth: depth + 1];
+
+			if (++i < count)
+				[stream writeBuffer: "," length: 1];
+		}
+	}
+
+	[stream writeBuffer: "]" length: 1];
+}
+
 - (OFData *)messagePackRepresentation
 {
 	OFMutableData *data;
 	size_t i, count;
+	uint8_t header[5];
 	void *pool;
 
-	data = [OFMutableData data];
 	count = self.count;
 
-	if (count <= 15) {
-		uint8_t tmp = 0x90 | ((uint8_t)count & 0xF);
-		[data addItem: &tmp];
-	} else if (count <= UINT16_MAX) {
-		uint8_t type = 0xDC;
-		uint16_t tmp = OFToBigEndian16((uint16_t)count);
-
-		[data addItem: &type];
-		[data addItems: &tmp count: sizeof(tmp)];
-	} else if (count <= UINT32_MAX) {
-		uint8_t type = 0xDD;
-		uint32_t tmp = OFToBigEndian32((uint32_t)count);
-
-		[data addItem: &type];
-		[data addItems: &tmp count: sizeof(tmp)];
-	} else
-		@throw [OFOutOfRangeException exception];
+	data = [OFMutableData data];
+	[data addItems: header count: OFMessagePackArrayHeader(count, header)];
 
 	pool = objc_autoreleasePoolPush();
 
@@ -698,6 +829,24 @@ static struct {
 	return data;
 }
 
+- (void)writeMessagePackToStream: (OFStream *)stream
+{
+	size_t i, count;
+	uint8_t header[5];
+
+	count = self.count;
+	[stream writeBuffer: header
+		     length: OFMessagePackArrayHeader(count, header)];
+
+	i = 0;
+	for (id object in self) {
+		i++;
+		OFMessagePackWriteObject(object, stream);
+	}
+
+	assert(i == count);
+}
+
 - (void)makeObjectsPerformSelector: (SEL)selector
 {
 	for (id object in self)
@@ -896,6 +1045,193 @@ static struct {
 
 	return [current autorelease];
 }
+
+# ifdef OF_HAVE_THREADS
+- (void)
+    enumerateObjectsConcurrentlyOnThreadPool: (OFThreadPool *)threadPool
+				  usingBlock: (OFArrayEnumerationBlock)block
+{
+	void *pool = objc_autoreleasePoolPush();
+	const id *objects = self.objects;
+	size_t count = self.count;
+	size_t rangesCount = concurrentRangesCount(threadPool, count);
+	__block bool stopped = false;
+
+	OFArrayApplyConcurrently(threadPool, rangesCount, ^ (size_t idx) {
+		OFRange range = concurrentRange(idx, rangesCount, count);
+
+		for (size_t i = range.location;
+		    i < range.location + range.length && !stopped; i++) {
+			bool stop = false;
+
+			block(objects[i], i, &stop);
+
+			if (stop)
+				stopped = true;
+		}
+	});
+
+	objc_autoreleasePoolPop(pool);
+}
+
+- (OFArray *)mappedArrayConcurrentlyOnThreadPool: (OFThreadPool *)threadPool
+				      usingBlock: (OFArrayMapBlock)block
+{
+	OFArray *ret;
+	size_t count = self.count;
+	id *tmp = OFAllocZeroedMemory(count, sizeof(id));
+
+	@try {
+		void *pool = objc_autoreleasePoolPush();
+		const id *objects = self.objects;
+		size_t rangesCount = concurrentRangesCount(threadPool, count);
+
+		OFArrayApplyConcurrently(threadPool, rangesCount,
+		    ^ (size_t idx) {
+			OFRange range =
+			    concurrentRange(idx, rangesCount, count);
+
+			/*
+			 * The results need to be retained, as each range has
+			 * its own autorelease pool.
+			 */
+			for (size_t i = range.location;
+			    i < range.location + range.length; i++)
+				tmp[i] = [block(objects[i], i) retain];
+		});
+
+		objc_autoreleasePoolPop(pool);
+
+		ret = [OFArray arrayWithObjects: tmp count: count];
+	} @finally {
+		for (size_t i = 0; i < count; i++)
+			[tmp[i] release];
+
+		OFFreeMemory(tmp);
+	}
+
+	return ret;
+}
+
+- (OFArray *)filteredArrayConcurrentlyOnThreadPool: (OFThreadPool *)threadPool
+					usingBlock: (OFArrayFilterBlock)block
+{
+	OFArray *ret;
+	void *pool = objc_autoreleasePoolPush();
+	const id *objects = self.objects;
+	size_t count = self.count;
+	size_t rangesCount = concurrentRangesCount(threadPool, count);
+	id *tmp = OFAllocMemory(count, sizeof(id));
+	size_t *counts = NULL;
+
+	@try {
+		size_t i = 0;
+
+		counts = OFAllocMemory(rangesCount, sizeof(size_t));
+
+		/* Each range stores the objects it keeps at its own start. */
+		OFArrayApplyConcurrently(threadPool, rangesCount,
+		    ^ (size_t idx) {
+			OFRange range =
+			    concurrentRange(idx, rangesCount, count);
+			size_t kept = 0;
+
+			for (size_t j = range.location;
+			    j < range.location + range.length; j++)
+				if (block(objects[j], j))
+					tmp[range.location + kept++] =
+					    objects[j];
+
+			counts[idx] = kept;
+		});
+
+		for (size_t idx = 0; idx < rangesCount; idx++) {
+			OFRange range =
+			    concurrentRange(idx, rangesCount, count);
+
+			memmove(tmp + i, tmp + range.location,
+			    counts[idx] * sizeof(id));
+			i += counts[idx];
+		}
+
+		ret = [[OFArray alloc] initWithObjects: tmp count: i];
+	} @finally {
+		OFFreeMemory(tmp);
+		OFFreeMemory(counts);
+	}
+
+	objc_autoreleasePoolPop(pool);
+
+	return [ret autorelease];
+}
+
+- (id)foldConcurrentlyOnThreadPool: (OFThreadPool *)threadPool
+			usingBlock: (OFArrayFoldBlock)block
+{
+	void *pool;
+	const id *objects;
+	size_t count = self.count, rangesCount;
+	id *results;
+	id current = nil;
+
+	if (count == 0)
+		return nil;
+	if (count == 1)
+		return [[[self objectAtIndex: 0] retain] autorelease];
+
+	pool = objc_autoreleasePoolPush();
+	objects = self.objects;
+	rangesCount = concurrentRangesCount(threadPool, count);
+	results = OFAllocZeroedMemory(rangesCount, sizeof(id));
+
+	@try {
+		OFArrayApplyConcurrently(threadPool, rangesCount,
+		    ^ (size_t idx) {
+			OFRange range =
+			    concurrentRange(idx, rangesCount, count);
+			id result = [objects[range.location] retain];
+
+			for (size_t i = range.location + 1;
+			    i < range.location + range.length; i++) {
+				id new;
+
+				@try {
+					new = [block(result, objects[i])
+					    retain];
+				} @finally {
+					[result release];
+				}
+				result = new;
+			}
+
+			results[idx] = result;
+		});
+
+		current = results[0];
+		results[0] = nil;
+
+		for (size_t idx = 1; idx < rangesCount; idx++) {
+			id new;
+
+			@try {
+				new = [block(current, results[idx]) retain];
+			} @finally {
+				[current release];
+			}
+			current = new;
+		}
+	} @finally {
+		for (size_t idx = 0; idx < rangesCount; idx++)
+			[results[idx] release];
+
+		OFFreeMemory(results);
+	}
+
+	objc_autoreleasePoolPop(pool);
+
+	return [current autorelease];
+}
+# endif
 #endif
 @end
 
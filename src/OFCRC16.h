@@ -27,6 +27,18 @@ extern "C" {
 #endif
 extern uint16_t OFCRC16(uint16_t crc, const void *_Nonnull bytes,
     size_t length);
+
+/**
+ * @brief Combines the CRC16 checksums of two consecutive pieces of data.
+ *
+ * Both checksums need to be calculated starting with 0.
+ *
+ * @param crc1 The checksum of the first piece
+ * @param crc2 The checksum of the second piece
+ * @param length2 The length of the second piece
+ * @return The checksum of both pieces concatenated
+ */
+extern uint16_t OFCRC16Combine(uint16_t crc1, uint16_t crc2, size_t length2);
 #ifdef __cplusplus
 }
 #endif
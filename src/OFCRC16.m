@@ -16,20 +16,89 @@
 #include "config.h"
 
 #import "OFCRC16.h"
+#import "OFOnce.h"
 
 static const uint16_t CRC16Magic = 0xA001;
 
+/* table[k][i] is the CRC of byte i followed by k zero bytes. */
+static uint16_t table[8][256];
+
+static void
+initTable(void)
+{
+	for (uint16_t i = 0; i < 256; i++) {
+		uint16_t CRC = i;
+
+		for (uint8_t j = 0; j < 8; j++)
+			CRC = (CRC >> 1) ^ (CRC16Magic & (~(CRC & 1) + 1));
+
+		table[0][i] = CRC;
+	}
+
+	for (uint16_t i = 0; i < 256; i++)
+		for (uint8_t k = 1; k < 8; k++)
+			table[k][i] = (table[k - 1][i] >> 8) ^
+			    table[0][table[k - 1][i] & 0xFF];
+}
+
 uint16_t
 OFCRC16(uint16_t CRC, const void *bytes_, size_t length)
 {
+	static OFOnceControl onceControl = OFOnceControlInitValue;
 	const unsigned char *bytes = bytes_;
 
-	for (size_t i = 0; i < length; i++) {
-		CRC ^= bytes[i];
+	OFOnce(&onceControl, initTable);
 
-		for (uint8_t j = 0; j < 8; j++)
-			CRC = (CRC >> 1) ^ (CRC16Magic & (~(CRC & 1) + 1));
+	/* Slicing-by-8: Process 8 bytes with independent table lookups. */
+	while (length >= 8) {
+		uint16_t low = CRC ^ (bytes[0] | (bytes[1] << 8));
+
+		CRC = table[7][low & 0xFF] ^ table[6][low >> 8] ^
+		    table[5][bytes[2]] ^ table[4][bytes[3]] ^
+		    table[3][bytes[4]] ^ table[2][bytes[5]] ^
+		    table[1][bytes[6]] ^ table[0][bytes[7]];
+
+		bytes += 8;
+		length -= 8;
 	}
 
+	while (length-- > 0)
+		CRC = (CRC >> 8) ^ table[0][(CRC ^ *bytes++) & 0xFF];
+
 	return CRC;
 }
+
+/* Multiplies two polynomials modulo the CRC polynomial. */
+static uint16_t
+multiplyModulo(uint16_t a, uint16_t b)
+{
+	uint16_t product = 0;
+
+	for (uint16_t bit = 1u << 15; bit != 0; bit >>= 1) {
+		if (a & bit)
+			product ^= b;
+
+		b = (b >> 1) ^ (CRC16Magic & (~(b & 1) + 1));
+	}
+
+	return product;
+}
+
+uint16_t
+OFCRC16Combine(uint16_t CRC1, uint16_t CRC2, size_t length2)
+{
+	/* x^0 in the bit reversed representation */
+	uint16_t shift = 1u << 15;
+	/* x^8, for appending one zero byte */
+	uint16_t power = 1u << 7;
+
+	/* Calculate x^(8 * length2) by squaring. */
+	for (; length2 > 0; length2 >>= 1) {
+		if (length2 & 1)
+			shift = multiplyModulo(power, shift);
+
+		power = multiplyModulo(power, power);
+	}
+
+	return multiplyModulo(shift, CRC1) ^ CRC2;
+}
@@ -27,6 +27,20 @@ extern "C" {
 #endif
 extern uint32_t OFCRC32(uint32_t crc, const void *_Nonnull bytes,
     size_t length);
+
+/**
+ * @brief Combines the CRC32 checksums of two consecutive pieces of data.
+ *
+ * Both checksums need to be finished checksums, i.e. calculated starting with
+ * `~0` and inverted afterwards. This allows checksumming the pieces of a large
+ * buffer in parallel.
+ *
+ * @param crc1 The checksum of the first piece
+ * @param crc2 The checksum of the second piece
+ * @param length2 The length of the second piece
+ * @return The checksum of both pieces concatenated
+ */
+extern uint32_t OFCRC32Combine(uint32_t crc1, uint32_t crc2, size_t length2);
 #ifdef __cplusplus
 }
 #endif
@@ -15,21 +15,208 @@
 
 #include "config.h"
 
+#ifdef HAVE_PCLMUL_INTRINSICS
+# include <immintrin.h>
+#endif
+
 #import "OFCRC32.h"
+#import "OFOnce.h"
+#ifdef HAVE_PCLMUL_INTRINSICS
+# import "OFSystemInfo.h"
+#endif
 
 static const uint32_t CRC32Magic = 0xEDB88320;
 
+/* table[k][i] is the CRC of byte i followed by k zero bytes. */
+static uint32_t table[8][256];
+
+static void
+initTable(void)
+{
+	for (uint16_t i = 0; i < 256; i++) {
+		uint32_t CRC = i;
+
+		for (uint8_t j = 0; j < 8; j++)
+			CRC = (CRC >> 1) ^ (CRC32Magic & (~(CRC & 1) + 1));
+
+		table[0][i] = CRC;
+	}
+
+	for (uint16_t i = 0; i < 256; i++)
+		for (uint8_t k = 1; k < 8; k++)
+			table[k][i] = (table[k - 1][i] >> 8) ^
+			    table[0][table[k - 1][i] & 0xFF];
+}
+
+#ifdef HAVE_PCLMUL_INTRINSICS
+static signed char PCLMULSupported = -1;
+
+static OF_INLINE bool
+usePCLMUL(void)
+{
+	if OF_UNLIKELY (PCLMULSupported == -1)
+		PCLMULSupported = ([OFSystemInfo supportsPCLMULQDQ] &&
+		    [OFSystemInfo supportsSSE41]);
+
+	return PCLMULSupported;
+}
+
+/*
+ * Folds 64 bytes at a time using carry-less multiplication, as described in
+ * Intel's "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ
+ * Instruction". The length needs to be a multiple of 16 and at least 64.
+ */
+static __attribute__((__target__("pclmul,sse4.1"))) uint32_t
+CRC32PCLMUL(uint32_t CRC, const unsigned char *bytes, size_t length)
+{
+	const __m128i k1k2 = _mm_set_epi64x(0x01C6E41596, 0x0154442BD4);
+	const __m128i k3k4 = _mm_set_epi64x(0x00CCAA009E, 0x01751997D0);
+	const __m128i k5k0 = _mm_set_epi64x(0, 0x0163CD6124);
+	const __m128i poly = _mm_set_epi64x(0x01F7011641, 0x01DB710641);
+	const __m128i mask = _mm_setr_epi32(~0, 0, ~0, 0);
+	__m128i x0, x1, x2, x3, x4;
+
+	x1 = _mm_loadu_si128((const __m128i *)(const void *)bytes);
+	x2 = _mm_loadu_si128((const __m128i *)(const void *)(bytes + 16));
+	x3 = _mm_loadu_si128((const __m128i *)(const void *)(bytes + 32));
+	x4 = _mm_loadu_si128((const __m128i *)(const void *)(bytes + 48));
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)CRC));
+	bytes += 64;
+	length -= 64;
+
+	while (length >= 64) {
+		__m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+		__m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+		__m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+		__m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+
+		x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(
+		    (const __m128i *)(const void *)bytes));
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128(
+		    (const __m128i *)(const void *)(bytes + 16)));
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128(
+		    (const __m128i *)(const void *)(bytes + 32)));
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128(
+		    (const __m128i *)(const void *)(bytes + 48)));
+
+		bytes += 64;
+		length -= 64;
+	}
+
+	/* Fold the four lanes into one. */
+	x0 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x0);
+	x0 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x0);
+	x0 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x0);
+
+	while (length >= 16) {
+		x0 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x0), _mm_loadu_si128(
+		    (const __m128i *)(const void *)bytes));
+
+		bytes += 16;
+		length -= 16;
+	}
+
+	/* Fold 128 bits to 64 bits. */
+	x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+	x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, mask);
+	x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	/* Barrett reduction to 32 bits */
+	x2 = _mm_and_si128(x1, mask);
+	x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+	x2 = _mm_and_si128(x2, mask);
+	x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	return (uint32_t)_mm_extract_epi32(x1, 1);
+}
+#endif
+
 uint32_t
 OFCRC32(uint32_t CRC, const void *bytes_, size_t length)
 {
+	static OFOnceControl onceControl = OFOnceControlInitValue;
 	const unsigned char *bytes = bytes_;
 
-	for (size_t i = 0; i < length; i++) {
-		CRC ^= bytes[i];
+#ifdef HAVE_PCLMUL_INTRINSICS
+	if (length >= 64 && usePCLMUL()) {
+		size_t folded = length & ~(size_t)15;
 
-		for (uint8_t j = 0; j < 8; j++)
-			CRC = (CRC >> 1) ^ (CRC32Magic & (~(CRC & 1) + 1));
+		CRC = CRC32PCLMUL(CRC, bytes, folded);
+		bytes += folded;
+		length -= folded;
 	}
+#endif
+
+	OFOnce(&onceControl, initTable);
+
+	/* Slicing-by-8: Process 8 bytes with independent table lookups. */
+	while (length >= 8) {
+		uint32_t low = CRC ^ (bytes[0] | (bytes[1] << 8) |
+		    (bytes[2] << 16) | ((uint32_t)bytes[3] << 24));
+
+		CRC = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^
+		    table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24] ^
+		    table[3][bytes[4]] ^ table[2][bytes[5]] ^
+		    table[1][bytes[6]] ^ table[0][bytes[7]];
+
+		bytes += 8;
+		length -= 8;
+	}
+
+	while (length-- > 0)
+		CRC = (CRC >> 8) ^ table[0][(CRC ^ *bytes++) & 0xFF];
 
 	return CRC;
 }
+
+/* Multiplies two polynomials modulo the CRC polynomial. */
+static uint32_t
+multiplyModulo(uint32_t a, uint32_t b)
+{
+	uint32_t product = 0;
+
+	for (uint32_t bit = 1u << 31; bit != 0; bit >>= 1) {
+		if (a & bit)
+			product ^= b;
+
+		b = (b >> 1) ^ (CRC32Magic & (~(b & 1) + 1));
+	}
+
+	return product;
+}
+
+uint32_t
+OFCRC32Combine(uint32_t CRC1, uint32_t CRC2, size_t length2)
+{
+	/* x^0 in the bit reversed representation */
+	uint32_t shift = 1u << 31;
+	/* x^8, for appending one zero byte */
+	uint32_t power = 1u << 23;
+
+	/* Calculate x^(8 * length2) by squaring. */
+	for (; length2 > 0; length2 >>= 1) {
+		if (length2 & 1)
+			shift = multiplyModulo(power, shift);
+
+		power = multiplyModulo(power, power);
+	}
+
+	return multiplyModulo(shift, CRC1) ^ CRC2;
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#import "OFObject.h"
+
+OF_ASSUME_NONNULL_BEGIN
+
+/** @file */
+
+@class OFCondition;
+@class OFDate;
+@class OFMutex;
+@class OFMutableArray OF_GENERIC(ObjectType);
+
+#ifdef OF_HAVE_BLOCKS
+/**
+ * @brief A block which is called when an object was received asynchronously
+ *	  from a channel.
+ *
+ * @param object The object that has been received or `nil` if the channel has
+ *		 been closed and all objects have been received
+ * @return A bool whether the same block should be used for the next object
+ */
+typedef bool (^OFChannelAsyncReceiveBlock)(id _Nullable object);
+#endif
+
+/**
+ * @class OFChannel OFChannel.h ObjFW/OFChannel.h
+ *
+ * @brief A bounded queue to pass objects between threads.
+ *
+ * Any number of threads can send objects into the channel and receive objects
+ * from it at the same time. Sending and receiving do not take a lock unless
+ * the channel is full or empty and the thread needs to wait.
+ *
+ * Objects are received in the order they were sent. Each object is only
+ * received once, by whichever receiver gets to it first.
+ */
+OF_SUBCLASSING_RESTRICTED
+@interface OFChannel OF_GENERIC(ObjectType): OFObject
+{
+	struct OFChannelCell *_cells;
+	unsigned int _capacity;
+	volatile int _sendPosition, _receivePosition;
+	volatile bool _closing, _closed;
+	volatile int _sendingCount;
+	OFCondition *_notFullCondition, *_notEmptyCondition;
+	volatile int _waitingSendersCount, _waitingReceiversCount;
+	OFMutableArray *_asyncReceives;
+	volatile int _asyncReceivesCount;
+#ifndef OF_HAVE_ATOMIC_OPS
+	OFMutex *_mutex;
+#endif
+}
+#if !defined(OF_HAVE_GENERICS) && !defined(DOXYGEN)
+# define ObjectType id
+#endif
+
+/**
+ * @brief The maximum number of objects the channel can hold.
+ *
+ * This is the capacity the channel was created with, rounded up to the next
+ * power of 2 and at least 2.
+ */
+@property (readonly, nonatomic) size_t capacity;
+
+/**
+ * @brief The number of objects currently in the channel.
+ *
+ * If other threads are using the channel, this is only a snapshot.
+ */
+@property (readonly, nonatomic) size_t count;
+
+/**
+ * @brief Whether the channel has been closed.
+ */
+@property (readonly, nonatomic, getter=isClosed) bool closed;
+
+/**
+ * @brief Creates a new channel with the specified capacity.
+ *
+ * @param capacity The maximum number of objects the channel can hold
+ * @return A new, autoreleased OFChannel
+ */
++ (instancetype)channelWithCapacity: (size_t)capacity;
+
+- (instancetype)init OF_UNAVAILABLE;
+
+/**
+ * @brief Initializes an already allocated channel with the specified capacity.
+ *
+ * @param capacity The maximum number of objects the channel can hold
+ * @return An initialized OFChannel
+ */
+- (instancetype)initWithCapacity: (size_t)capacity OF_DESIGNATED_INITIALIZER;
+
+/**
+ * @brief Sends the specified object, waiting until there is room in the
+ *	  channel if it is full.
+ *
+ * @param object The object to send
+ * @throw OFNotOpenException The channel has been closed
+ */
+- (void)sendObject: (ObjectType)object;
+
+/**
+ * @brief Sends the specified object if there is room in the channel.
+ *
+ * @param object The object to send
+ * @return Whether the object has been sent
+ * @throw OFNotOpenException The channel has been closed
+ */
+- (bool)trySendObject: (ObjectType)object;
+
+/**
+ * @brief Sends the specified object, waiting until there is room in the
+ *	  channel or the specified date is reached.
+ *
+ * @param object The object to send
+ * @param date The date after which to give up
+ * @return Whether the object has been sent
+ * @throw OFNotOpenException The channel has been closed
+ */
+- (bool)sendObject: (ObjectType)object beforeDate: (OFDate *)date;
+
+/**
+ * @brief Receives the next object, waiting until one has been sent if the
+ *	  channel is empty.
+ *
+ * @return The next object or `nil` if the channel has been closed and all
+ *	   objects have been received
+ */
+- (nullable ObjectType)receiveObject;
+
+/**
+ * @brief Receives the next object if the channel is not empty.
+ *
+ * @return The next object or `nil` if the channel is empty
+ */
+- (nullable ObjectType)tryReceiveObject;
+
+/**
+ * @brief Receives the next object, waiting until one has been sent or the
+ *	  specified date is reached.
+ *
+ * @param date The date after which to give up
+ * @return The next object or `nil` if no object has been received before the
+ *	   date or the channel has been closed and all objects have been
+ *	   received
+ */
+- (nullable ObjectType)receiveObjectBeforeDate: (OFDate *)date;
+
+#ifdef OF_HAVE_BLOCKS
+/**
+ * @brief Asynchronously receives objects using the run loop of the current
+ *	  thread.
+ *
+ * The block is called from the run loop in @ref OFDefaultRunLoopMode whenever
+ * an object has been sent, so that a run loop can consume objects from other
+ * threads without polling the channel.
+ *
+ * @param block The block to call when an object has been received.
+ *		If the block returns true, it will be called again with the
+ *		next object. It is called with `nil` once the channel has been
+ *		closed and all objects have been received.
+ */
+- (void)asyncReceiveWithBlock: (OFChannelAsyncReceiveBlock)block;
+#endif
+
+/**
+ * @brief Closes the channel.
+ *
+ * Objects that are still in the channel can still be received, but no more
+ * objects can be sent. Threads waiting to send or receive are woken up.
+ *
+ * Sends that are in progress in other threads either finish before this
+ * method returns or throw an @ref OFNotOpenException.
+ */
+- (void)close;
+#if !defined(OF_HAVE_GENERICS) && !defined(DOXYGEN)
+# undef ObjectType
+#endif
+@end
+
+OF_ASSUME_NONNULL_END
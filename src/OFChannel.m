@@ -0,0 +1,630 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#include "config.h"
+
+#include <limits.h>
+
+#import "OFChannel.h"
+#import "OFArray.h"
+#import "OFCondition.h"
+#import "OFDate.h"
+#import "OFRunLoop.h"
+#import "OFRunLoop+Private.h"
+#ifdef OF_HAVE_ATOMIC_OPS
+# import "OFAtomic.h"
+# import "OFPlainMutex.h"
+#endif
+
+#import "OFInvalidArgumentException.h"
+#import "OFNotOpenException.h"
+#import "OFOutOfRangeException.h"
+
+/*
+ * Each cell has a sequence number that tells whether it is ready to be written
+ * or read at a given position, as in Dmitry Vyukov's bounded MPMC queue. A
+ * cell at position p is free if its sequence is p and filled if it is p + 1.
+ * The positions wrap around and are only ever compared by their distance.
+ */
+struct OFChannelCell {
+	volatile int sequence;
+	id volatile object;
+};
+
+#ifdef OF_HAVE_BLOCKS
+OF_DIRECT_MEMBERS
+@interface OFChannelAsyncReceive: OFObject
+{
+@public
+	OFRunLoop *_runLoop;
+	OFChannelAsyncReceiveBlock _block;
+	bool _scheduled, _removed;
+}
+@end
+
+@interface OFChannel ()
+- (void)of_performAsyncReceive: (OFChannelAsyncReceive *)asyncReceive;
+@end
+#endif
+
+OF_DIRECT_MEMBERS
+@interface OFChannel ()
+- (bool)of_sendObject: (id)object beforeDate: (nullable OFDate *)date;
+- (nullable id)of_receiveObjectBeforeDate: (nullable OFDate *)date;
+#ifdef OF_HAVE_BLOCKS
+- (void)of_removeAsyncReceive: (OFChannelAsyncReceive *)asyncReceive;
+#endif
+@end
+
+/*
+ * Senders count themselves as sending before checking whether the channel is
+ * being closed, and -[close] waits until there are no more senders before
+ * marking the channel as closed. So once receivers see it as closed, all
+ * objects that will ever be sent are in the channel.
+ */
+static bool
+enqueue(OFChannel *self, id object)
+{
+	unsigned int mask = self->_capacity - 1;
+	struct OFChannelCell *cell;
+	unsigned int position;
+
+#ifdef OF_HAVE_ATOMIC_OPS
+	OFAtomicIntIncrease(&self->_sendingCount);
+	OFMemoryBarrier();
+
+	if (self->_closing) {
+		OFAtomicIntDecrease(&self->_sendingCount);
+		@throw [OFNotOpenException exceptionWithObject: self];
+	}
+
+	position = (unsigned int)self->_sendPosition;
+
+	for (;;) {
+		int difference;
+
+		cell = &self->_cells[position & mask];
+		difference = (int)((unsigned int)cell->sequence - position);
+		OFAcquireMemoryBarrier();
+
+		if (difference == 0) {
+			if (OFAtomicIntCompareAndSwap(&self->_sendPosition,
+			    (int)position, (int)(position + 1)))
+				break;
+		} else if (difference < 0) {
+			OFAtomicIntDecrease(&self->_sendingCount);
+			return false;
+		}
+
+		position = (unsigned int)self->_sendPosition;
+	}
+
+	OFMemoryBarrier();
+	cell->object = [object retain];
+	OFReleaseMemoryBarrier();
+	cell->sequence = (int)(position + 1);
+
+	OFAtomicIntDecrease(&self->_sendingCount);
+#else
+	[self->_mutex lock];
+	@try {
+		if (self->_closing)
+			@throw [OFNotOpenException exceptionWithObject: self];
+
+		position = (unsigned int)self->_sendPosition;
+		cell = &self->_cells[position & mask];
+
+		if (cell->sequence != (int)position)
+			return false;
+
+		cell->object = [object retain];
+		cell->sequence = (int)(position + 1);
+		self->_sendPosition = (int)(position + 1);
+	} @finally {
+		[self->_mutex unlock];
+	}
+#endif
+
+	return true;
+}
+
+static id
+dequeue(OFChannel *self)
+{
+	unsigned int mask = self->_capacity - 1;
+	struct OFChannelCell *cell;
+	unsigned int position;
+	id object;
+
+#ifdef OF_HAVE_ATOMIC_OPS
+	position = (unsigned int)self->_receivePosition;
+
+	for (;;) {
+		int difference;
+
+		cell = &self->_cells[position & mask];
+		difference =
+		    (int)((unsigned int)cell->sequence - (position + 1));
+		OFAcquireMemoryBarrier();
+
+		if (difference == 0) {
+			if (OFAtomicIntCompareAndSwap(&self->_receivePosition,
+			    (int)position, (int)(position + 1)))
+				break;
+		} else if (difference < 0)
+			return nil;
+
+		position = (unsigned int)self->_receivePosition;
+	}
+
+	OFMemoryBarrier();
+	object = cell->object;
+	cell->object = nil;
+	OFReleaseMemoryBarrier();
+	cell->sequence = (int)(position + mask + 1);
+#else
+	[self->_mutex lock];
+	@try {
+		position = (unsigned int)self->_receivePosition;
+		cell = &self->_cells[position & mask];
+
+		if (cell->sequence != (int)(position + 1))
+			return nil;
+
+		object = cell->object;
+		cell->object = nil;
+		cell->sequence = (int)(position + mask + 1);
+		self->_receivePosition = (int)(position + 1);
+	} @finally {
+		[self->_mutex unlock];
+	}
+#endif
+
+	return [object autorelease];
+}
+
+#ifdef OF_HAVE_BLOCKS
+/* Needs to be called with _notEmptyCondition locked. */
+static void
+scheduleAsyncReceive(OFChannel *self, OFChannelAsyncReceive *asyncReceive)
+{
+	id object = asyncReceive;
+
+	if (asyncReceive->_scheduled)
+		return;
+
+	asyncReceive->_scheduled = true;
+	[asyncReceive->_runLoop
+	    of_performSelector: @selector(of_performAsyncReceive:)
+			target: self
+		       objects: &object
+			 count: 1
+		 waitUntilDone: false];
+}
+
+static void
+scheduleAsyncReceives(OFChannel *self)
+{
+	[self->_notEmptyCondition lock];
+	@try {
+		for (OFChannelAsyncReceive *asyncReceive in
+		    self->_asyncReceives)
+			scheduleAsyncReceive(self, asyncReceive);
+	} @finally {
+		[self->_notEmptyCondition unlock];
+	}
+}
+#endif
+
+/*
+ * Wakes up threads waiting for the condition. The waiting threads increase the
+ * counter before checking the channel again, so either they see the change to
+ * the channel or we see them waiting.
+ */
+static void
+wakeUp(OFCondition *condition, volatile int *waitingCount)
+{
+#ifdef OF_HAVE_ATOMIC_OPS
+	OFMemoryBarrier();
+
+	if (*waitingCount == 0)
+		return;
+#endif
+
+	[condition lock];
+	[condition broadcast];
+	[condition unlock];
+}
+
+/*
+ * Needs to be called without holding any of the locks, as the waiting senders
+ * and receivers hold theirs while sending or receiving.
+ */
+static void
+didSend(OFChannel *self)
+{
+	wakeUp(self->_notEmptyCondition, &self->_waitingReceiversCount);
+
+#ifdef OF_HAVE_BLOCKS
+# ifdef OF_HAVE_ATOMIC_OPS
+	if (self->_asyncReceivesCount > 0)
+# endif
+		scheduleAsyncReceives(self);
+#endif
+}
+
+static void
+didReceive(OFChannel *self)
+{
+	wakeUp(self->_notFullCondition, &self->_waitingSendersCount);
+}
+
+#ifdef OF_HAVE_BLOCKS
+@implementation OFChannelAsyncReceive
+- (void)dealloc
+{
+	[_runLoop release];
+	[_block release];
+
+	[super dealloc];
+}
+@end
+#endif
+
+@implementation OFChannel
++ (instancetype)channelWithCapacity: (size_t)capacity
+{
+	return [[[self alloc] initWithCapacity: capacity] autorelease];
+}
+
+- (instancetype)init
+{
+	OF_INVALID_INIT_METHOD
+}
+
+- (instancetype)initWithCapacity: (size_t)capacity
+{
+	self = [super init];
+
+	@try {
+		if (capacity == 0)
+			@throw [OFInvalidArgumentException exception];
+
+		if (capacity > INT_MAX / 2)
+			@throw [OFOutOfRangeException exception];
+
+		/* The sequence numbers need at least 2 cells to work. */
+		_capacity = 2;
+		while (_capacity < capacity)
+			_capacity <<= 1;
+
+		_cells = OFAllocZeroedMemory(_capacity, sizeof(*_cells));
+		for (unsigned int i = 0; i < _capacity; i++)
+			_cells[i].sequence = (int)i;
+
+		_notFullCondition = [[OFCondition alloc] init];
+		_notEmptyCondition = [[OFCondition alloc] init];
+		_asyncReceives = [[OFMutableArray alloc] init];
+#ifndef OF_HAVE_ATOMIC_OPS
+		_mutex = [[OFMutex alloc] init];
+#endif
+	} @catch (id e) {
+		[self release];
+		@throw e;
+	}
+
+	return self;
+}
+
+- (void)dealloc
+{
+	if (_cells != NULL)
+		for (unsigned int i = 0; i < _capacity; i++)
+			[_cells[i].object release];
+
+	OFFreeMemory(_cells);
+	[_notFullCondition release];
+	[_notEmptyCondition release];
+	[_asyncReceives release];
+#ifndef OF_HAVE_ATOMIC_OPS
+	[_mutex release];
+#endif
+
+	[super dealloc];
+}
+
+- (size_t)capacity
+{
+	return _capacity;
+}
+
+- (size_t)count
+{
+	unsigned int receivePosition = (unsigned int)_receivePosition;
+	unsigned int count = (unsigned int)_sendPosition - receivePosition;
+
+	/* Positions can be claimed before the cell has been written or read. */
+	if (count > _capacity)
+		return _capacity;
+
+	return count;
+}
+
+- (bool)isClosed
+{
+	return _closed;
+}
+
+- (bool)trySendObject: (id)object
+{
+	if (object == nil)
+		@throw [OFInvalidArgumentException exception];
+
+	if (!enqueue(self, object))
+		return false;
+
+	didSend(self);
+
+	return true;
+}
+
+- (bool)of_sendObject: (id)object beforeDate: (OFDate *)date
+{
+	bool sent;
+
+	if ([self trySendObject: object])
+		return true;
+
+	[_notFullCondition lock];
+	_waitingSendersCount++;
+	@try {
+		for (;;) {
+#ifdef OF_HAVE_ATOMIC_OPS
+			OFMemoryBarrier();
+#endif
+
+			if ((sent = enqueue(self, object)))
+				break;
+
+			if (date == nil)
+				[_notFullCondition wait];
+			else if (![_notFullCondition waitUntilDate: date]) {
+				sent = enqueue(self, object);
+				break;
+			}
+		}
+	} @finally {
+		_waitingSendersCount--;
+		[_notFullCondition unlock];
+	}
+
+	if (sent)
+		didSend(self);
+
+	return sent;
+}
+
+- (void)sendObject: (id)object
+{
+	[self of_sendObject: object beforeDate: nil];
+}
+
+- (bool)sendObject: (id)object beforeDate: (OFDate *)date
+{
+	if (date == nil)
+		@throw [OFInvalidArgumentException exception];
+
+	return [self of_sendObject: object beforeDate: date];
+}
+
+- (id)tryReceiveObject
+{
+	id object = dequeue(self);
+
+	if (object != nil)
+		didReceive(self);
+
+	return object;
+}
+
+- (id)of_receiveObjectBeforeDate: (OFDate *)date
+{
+	id object;
+
+	if ((object = [self tryReceiveObject]) != nil)
+		return object;
+
+	[_notEmptyCondition lock];
+	_waitingReceiversCount++;
+	@try {
+		for (;;) {
+			bool closed;
+
+#ifdef OF_HAVE_ATOMIC_OPS
+			OFMemoryBarrier();
+#endif
+			/*
+			 * Nothing can be sent anymore once the channel is
+			 * closed, see enqueue().
+			 */
+			closed = _closed;
+
+			if ((object = dequeue(self)) != nil || closed)
+				break;
+
+			if (date == nil)
+				[_notEmptyCondition wait];
+			else if (![_notEmptyCondition waitUntilDate: date]) {
+				object = dequeue(self);
+				break;
+			}
+		}
+	} @finally {
+		_waitingReceiversCount--;
+		[_notEmptyCondition unlock];
+	}
+
+	if (object != nil)
+		didReceive(self);
+
+	return object;
+}
+
+- (id)receiveObject
+{
+	return [self of_receiveObjectBeforeDate: nil];
+}
+
+- (id)receiveObjectBeforeDate: (OFDate *)date
+{
+	if (date == nil)
+		@throw [OFInvalidArgumentException exception];
+
+	return [self of_receiveObjectBeforeDate: date];
+}
+
+#ifdef OF_HAVE_BLOCKS
+- (void)asyncReceiveWithBlock: (OFChannelAsyncReceiveBlock)block
+{
+	OFChannelAsyncReceive *asyncReceive =
+	    [[[OFChannelAsyncReceive alloc] init] autorelease];
+
+	asyncReceive->_runLoop = [[OFRunLoop currentRunLoop] retain];
+	asyncReceive->_block = [block copy];
+
+	[_notEmptyCondition lock];
+	@try {
+		[_asyncReceives addObject: asyncReceive];
+		_asyncReceivesCount = (int)_asyncReceives.count;
+
+		/* Objects might have been sent before. */
+		scheduleAsyncReceive(self, asyncReceive);
+	} @finally {
+		[_notEmptyCondition unlock];
+	}
+}
+
+- (void)of_removeAsyncReceive: (OFChannelAsyncReceive *)asyncReceive
+{
+	[_notEmptyCondition lock];
+	@try {
+		asyncReceive->_removed = true;
+		[_asyncReceives removeObjectIdenticalTo: asyncReceive];
+		_asyncReceivesCount = (int)_asyncReceives.count;
+	} @finally {
+		[_notEmptyCondition unlock];
+	}
+}
+
+- (void)of_performAsyncReceive: (OFChannelAsyncReceive *)asyncReceive
+{
+	/*
+	 * Receive at most as many objects as fit into the channel before
+	 * giving other sources of the run loop a chance.
+	 */
+	for (unsigned int i = 0; i < _capacity; i++) {
+		void *pool = objc_autoreleasePoolPush();
+		id object;
+
+		if (asyncReceive->_removed) {
+			objc_autoreleasePoolPop(pool);
+			return;
+		}
+
+		if ((object = [self tryReceiveObject]) == nil) {
+			bool closed;
+
+			[_notEmptyCondition lock];
+			asyncReceive->_scheduled = false;
+			[_notEmptyCondition unlock];
+
+			/*
+			 * A sender that still saw us as scheduled did not
+			 * schedule us again, so check once more.
+			 */
+			closed = _closed;
+			if ((object = [self tryReceiveObject]) == nil) {
+				if (closed) {
+					[self of_removeAsyncReceive:
+					    asyncReceive];
+					asyncReceive->_block(nil);
+				}
+
+				objc_autoreleasePoolPop(pool);
+				return;
+			}
+
+			[_notEmptyCondition lock];
+			asyncReceive->_scheduled = true;
+			[_notEmptyCondition unlock];
+		}
+
+		if (!asyncReceive->_block(object))
+			[self of_removeAsyncReceive: asyncReceive];
+
+		objc_autoreleasePoolPop(pool);
+	}
+
+	[_notEmptyCondition lock];
+	@try {
+		if (!asyncReceive->_removed) {
+			asyncReceive->_scheduled = false;
+			scheduleAsyncReceive(self, asyncReceive);
+		}
+	} @finally {
+		[_notEmptyCondition unlock];
+	}
+}
+#endif
+
+- (void)close
+{
+#ifdef OF_HAVE_ATOMIC_OPS
+	_closing = true;
+	OFMemoryBarrier();
+#else
+	[_mutex lock];
+	_closing = true;
+	[_mutex unlock];
+#endif
+
+	[_notFullCondition lock];
+	[_notFullCondition broadcast];
+	[_notFullCondition unlock];
+
+#ifdef OF_HAVE_ATOMIC_OPS
+	/* Wait for senders that did not see _closing yet. */
+	while (_sendingCount > 0)
+		OFYieldThread();
+
+	OFMemoryBarrier();
+#endif
+	_closed = true;
+#ifdef OF_HAVE_ATOMIC_OPS
+	OFMemoryBarrier();
+#endif
+
+	[_notEmptyCondition lock];
+	@try {
+		[_notEmptyCondition broadcast];
+#ifdef OF_HAVE_BLOCKS
+		for (OFChannelAsyncReceive *asyncReceive in _asyncReceives)
+			scheduleAsyncReceive(self, asyncReceive);
+#endif
+	} @finally {
+		[_notEmptyCondition unlock];
+	}
+}
+@end
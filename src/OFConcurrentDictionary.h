@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#import "OFMutableDictionary.h"
+
+OF_ASSUME_NONNULL_BEGIN
+
+@class OFConcurrentMapTable;
+
+/**
+ * @class OFConcurrentDictionary OFConcurrentDictionary.h
+ *	  ObjFW/OFConcurrentDictionary.h
+ *
+ * @brief A mutable dictionary that can be used by multiple threads at the same
+ *	  time without additional locking.
+ *
+ * Lookups only block while another thread modifies a key that is in the same
+ * segment, see @ref OFConcurrentMapTable. Objects returned by lookups are
+ * retained and autoreleased, so they stay valid even if another thread removes
+ * them.
+ *
+ * Enumerating is weakly consistent and never throws because of concurrent
+ * mutations.
+ */
+OF_SUBCLASSING_RESTRICTED
+@interface OFConcurrentDictionary OF_GENERIC(KeyType, ObjectType):
+    OFMutableDictionary OF_GENERIC(KeyType, ObjectType)
+{
+	OFConcurrentMapTable *_mapTable;
+}
+#if !defined(OF_HAVE_GENERICS) && !defined(DOXYGEN)
+# define KeyType id
+# define ObjectType id
+#endif
+
+/**
+ * @brief Returns the object for the given key, first setting it to the
+ *	  specified object if the key was not found.
+ *
+ * Looking up the key and setting the object happen atomically.
+ *
+ * @param key The key whose object should be returned
+ * @param object The object to set if the key was not found
+ * @return The object for the given key
+ */
+- (ObjectType)objectForKey: (KeyType)key orSetObject: (ObjectType)object;
+
+#ifdef OF_HAVE_BLOCKS
+/**
+ * @brief Returns the object for the given key, first setting it to the object
+ *	  returned by the specified block if the key was not found.
+ *
+ * Looking up the key, calling the block and setting the object happen
+ * atomically. The block is called while other threads are prevented from
+ * accessing part of the dictionary, so it must not access the dictionary
+ * itself.
+ *
+ * @param key The key whose object should be returned
+ * @param block The block to create the object if the key was not found
+ * @return The object for the given key
+ */
+- (ObjectType)objectForKey: (KeyType)key
+     orSetObjectUsingBlock: (ObjectType (^)(KeyType key))block;
+#endif
+#if !defined(OF_HAVE_GENERICS) && !defined(DOXYGEN)
+# undef KeyType
+# undef ObjectType
+#endif
+@end
+
+OF_ASSUME_NONNULL_END
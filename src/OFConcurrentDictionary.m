@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#include "config.h"
+
+#import "OFConcurrentDictionary.h"
+#import "OFArray.h"
+#import "OFConcurrentMapTable.h"
+
+#import "OFInvalidArgumentException.h"
+
+static void *
+copy(void *object)
+{
+	return [(id)object copy];
+}
+
+static void *
+retain(void *object)
+{
+	return [(id)object retain];
+}
+
+static void
+release(void *object)
+{
+	[(id)object release];
+}
+
+static unsigned long
+hash(void *object)
+{
+	return [(id)object hash];
+}
+
+static bool
+equal(void *object1, void *object2)
+{
+	return [(id)object1 isEqual: (id)object2];
+}
+
+static const OFMapTableFunctions keyFunctions = {
+	.retain = copy,
+	.release = release,
+	.hash = hash,
+	.equal = equal
+};
+static const OFMapTableFunctions objectFunctions = {
+	.retain = retain,
+	.release = release,
+	.hash = hash,
+	.equal = equal
+};
+
+@implementation OFConcurrentDictionary
+- (instancetype)init
+{
+	return [self initWithCapacity: 0];
+}
+
+- (instancetype)initWithCapacity: (size_t)capacity
+{
+	self = [super init];
+
+	@try {
+		_mapTable = [[OFConcurrentMapTable alloc]
+		    initWithKeyFunctions: keyFunctions
+			 objectFunctions: objectFunctions
+				capacity: capacity];
+	} @catch (id e) {
+		[self release];
+		@throw e;
+	}
+
+	return self;
+}
+
+- (instancetype)initWithDictionary: (OFDictionary *)dictionary
+{
+	self = [self initWithCapacity: dictionary.count];
+
+	@try {
+		void *pool = objc_autoreleasePoolPush();
+
+		for (id key in dictionary)
+			[_mapTable setObject: [dictionary objectForKey: key]
+				      forKey: key];
+
+		objc_autoreleasePoolPop(pool);
+	} @catch (id e) {
+		[self release];
+		@throw e;
+	}
+
+	return self;
+}
+
+- (instancetype)initWithObjects: (id const *)objects
+			forKeys: (id const *)keys
+			  count: (size_t)count
+{
+	self = [self initWithCapacity: count];
+
+	@try {
+		for (size_t i = 0; i < count; i++)
+			[_mapTable setObject: objects[i] forKey: keys[i]];
+	} @catch (id e) {
+		[self release];
+		@throw e;
+	}
+
+	return self;
+}
+
+- (instancetype)initWithKey: (id)firstKey arguments: (va_list)arguments
+{
+	self = [self init];
+
+	@try {
+		id key = firstKey, object;
+
+		if (key == nil)
+			@throw [OFInvalidArgumentException exception];
+
+		do {
+			if ((object = va_arg(arguments, id)) == nil)
+				@throw [OFInvalidArgumentException exception];
+
+			[_mapTable setObject: object forKey: key];
+		} while ((key = va_arg(arguments, id)) != nil);
+	} @catch (id e) {
+		[self release];
+		@throw e;
+	}
+
+	return self;
+}
+
+- (void)dealloc
+{
+	[_mapTable release];
+
+	[super dealloc];
+}
+
+- (id)objectForKey: (id)key
+{
+	return [(id)[_mapTable retainedObjectForKey: key] autorelease];
+}
+
+- (id)objectForKey: (id)key orSetObject: (id)object
+{
+	return [(id)[_mapTable retainedObjectForKey: key
+					orSetObject: object] autorelease];
+}
+
+#ifdef OF_HAVE_BLOCKS
+- (id)objectForKey: (id)key orSetObjectUsingBlock: (id (^)(id key))block
+{
+	return [(id)[_mapTable retainedObjectForKey: key
+			      orSetObjectUsingBlock: ^ void * (void *key_) {
+		return (void *)block(key_);
+	}] autorelease];
+}
+#endif
+
+- (size_t)count
+{
+	return _mapTable.count;
+}
+
+- (void)setObject: (id)object forKey: (id)key
+{
+	[_mapTable setObject: object forKey: key];
+}
+
+- (void)removeObjectForKey: (id)key
+{
+	[_mapTable removeObjectForKey: key];
+}
+
+- (void)removeAllObjects
+{
+	[_mapTable removeAllObjects];
+}
+
+- (OFArray *)allKeys
+{
+	OFMutableArray *keys = [OFMutableArray array];
+	void *pool = objc_autoreleasePoolPush();
+	OFConcurrentMapTableEnumerator *enumerator = [_mapTable keyEnumerator];
+	void **keyPtr;
+
+	while ((keyPtr = [enumerator nextObject]) != NULL)
+		[keys addObject: (id)*keyPtr];
+
+	objc_autoreleasePoolPop(pool);
+
+	[keys makeImmutable];
+
+	return keys;
+}
+
+- (OFArray *)allObjects
+{
+	OFMutableArray *objects = [OFMutableArray array];
+	void *pool = objc_autoreleasePoolPush();
+	OFConcurrentMapTableEnumerator *enumerator =
+	    [_mapTable objectEnumerator];
+	void **objectPtr;
+
+	while ((objectPtr = [enumerator nextObject]) != NULL)
+		[objects addObject: (id)*objectPtr];
+
+	objc_autoreleasePoolPop(pool);
+
+	[objects makeImmutable];
+
+	return objects;
+}
+
+- (OFEnumerator *)keyEnumerator
+{
+	return [self.allKeys objectEnumerator];
+}
+
+- (OFEnumerator *)objectEnumerator
+{
+	return [self.allObjects objectEnumerator];
+}
+
+#ifdef OF_HAVE_BLOCKS
+- (void)enumerateKeysAndObjectsUsingBlock: (OFDictionaryEnumerationBlock)block
+{
+	[_mapTable enumerateKeysAndObjectsUsingBlock:
+	    ^ (void *key, void *object, bool *stop) {
+		block(key, object, stop);
+	}];
+}
+#endif
+@end
@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#import "OFObject.h"
+#import "OFMapTable.h"
+
+OF_ASSUME_NONNULL_BEGIN
+
+/** @file */
+
+#ifdef OF_HAVE_BLOCKS
+/**
+ * @brief A block which creates an object for a key that is not in an
+ *	  OFConcurrentMapTable yet.
+ *
+ * @param key The key for which an object needs to be created
+ * @return The object to set for the key
+ */
+typedef void *_Nullable (^OFConcurrentMapTableObjectBlock)(void *key);
+#endif
+
+@class OFConcurrentMapTableEnumerator;
+
+/**
+ * @class OFConcurrentMapTable OFConcurrentMapTable.h
+ *	  ObjFW/OFConcurrentMapTable.h
+ *
+ * @brief A map table that can be used by multiple threads at the same time.
+ *
+ * The keys are distributed over several segments, each with its own lock and
+ * its own map table that is resized independently. Threads accessing
+ * different segments do not block each other, and readers never block each
+ * other.
+ *
+ * Enumerating is weakly consistent: It never throws because of concurrent
+ * mutations and enumerates each segment as it was at some point during the
+ * enumeration, but changes to other segments may or may not be seen.
+ */
+OF_SUBCLASSING_RESTRICTED
+@interface OFConcurrentMapTable: OFObject
+{
+	OFMapTableFunctions _keyFunctions, _objectFunctions;
+	struct OFConcurrentMapTableSegment *_segments;
+	size_t _segmentsCount;
+	unsigned int _segmentShift;
+}
+
+/**
+ * @brief The key functions used by the map table.
+ */
+@property (readonly, nonatomic) OFMapTableFunctions keyFunctions;
+
+/**
+ * @brief The object functions used by the map table.
+ */
+@property (readonly, nonatomic) OFMapTableFunctions objectFunctions;
+
+/**
+ * @brief The number of objects in the map table.
+ *
+ * If other threads modify the map table at the same time, this is only an
+ * approximation.
+ */
+@property (readonly, nonatomic) size_t count;
+
+/**
+ * @brief Creates a new OFConcurrentMapTable with the specified key and object
+ *	  functions.
+ *
+ * @param keyFunctions A structure of functions for handling keys
+ * @param objectFunctions A structure of functions for handling objects
+ * @return A new autoreleased OFConcurrentMapTable
+ */
++ (instancetype)mapTableWithKeyFunctions: (OFMapTableFunctions)keyFunctions
+			 objectFunctions: (OFMapTableFunctions)objectFunctions;
+
+/**
+ * @brief Creates a new OFConcurrentMapTable with the specified key functions,
+ *	  object functions and capacity.
+ *
+ * @param keyFunctions A structure of functions for handling keys
+ * @param objectFunctions A structure of functions for handling objects
+ * @param capacity A hint about the count of elements expected to be in the map
+ *	  table
+ * @return A new autoreleased OFConcurrentMapTable
+ */
++ (instancetype)mapTableWithKeyFunctions: (OFMapTableFunctions)keyFunctions
+			 objectFunctions: (OFMapTableFunctions)objectFunctions
+				capacity: (size_t)capacity;
+
+- (instancetype)init OF_UNAVAILABLE;
+
+/**
+ * @brief Initializes an already allocated OFConcurrentMapTable with the
+ *	  specified key and object functions.
+ *
+ * @param keyFunctions A structure of functions for handling keys
+ * @param objectFunctions A structure of functions for handling objects
+ * @return An initialized OFConcurrentMapTable
+ */
+- (instancetype)initWithKeyFunctions: (OFMapTableFunctions)keyFunctions
+		     objectFunctions: (OFMapTableFunctions)objectFunctions;
+
+/**
+ * @brief Initializes an already allocated OFConcurrentMapTable with the
+ *	  specified key functions, object functions and capacity.
+ *
+ * @param keyFunctions A structure of functions for handling keys
+ * @param objectFunctions A structure of functions for handling objects
+ * @param capacity A hint about the count of elements expected to be in the map
+ *	  table
+ * @return An initialized OFConcurrentMapTable
+ */
+- (instancetype)initWithKeyFunctions: (OFMapTableFunctions)keyFunctions
+		     objectFunctions: (OFMapTableFunctions)objectFunctions
+			    capacity: (size_t)capacity
+    OF_DESIGNATED_INITIALIZER;
+
+/**
+ * @brief Returns the object for the given key or NULL if the key was not found.
+ *
+ * @warning Another thread might remove the object and thereby release it at
+ *	    any time. Use @ref retainedObjectForKey: unless the object is
+ *	    guaranteed to stay alive otherwise.
+ *
+ * @param key The key whose object should be returned
+ * @return The object for the given key or NULL if the key was not found
+ */
+- (nullable void *)objectForKey: (void *)key;
+
+/**
+ * @brief Returns the object for the given key, retained using the retain
+ *	  function of the object functions, or NULL if the key was not found.
+ *
+ * @param key The key whose object should be returned
+ * @return The object for the given key, which needs to be released by the
+ *	   caller, or NULL if the key was not found
+ */
+- (nullable void *)retainedObjectForKey: (void *)key;
+
+/**
+ * @brief Returns the object for the given key, first setting it to the
+ *	  specified object if the key was not found.
+ *
+ * Looking up the key and setting the object happen atomically.
+ *
+ * @param key The key whose object should be returned
+ * @param object The object to set if the key was not found
+ * @return The object for the given key, retained using the retain function of
+ *	   the object functions, which needs to be released by the caller
+ */
+- (nullable void *)retainedObjectForKey: (void *)key
+			    orSetObject: (void *)object;
+
+#ifdef OF_HAVE_BLOCKS
+/**
+ * @brief Returns the object for the given key, first setting it to the object
+ *	  returned by the specified block if the key was not found.
+ *
+ * Looking up the key, calling the block and setting the object happen
+ * atomically. The block is called while other threads are prevented from
+ * accessing part of the map table, so it must not access the map table itself.
+ *
+ * @param key The key whose object should be returned
+ * @param block The block to create the object if the key was not found
+ * @return The object for the given key, retained using the retain function of
+ *	   the object functions, which needs to be released by the caller
+ */
+- (nullable void *)
+    retainedObjectForKey: (void *)key
+   orSetObjectUsingBlock: (OFConcurrentMapTableObjectBlock)block;
+#endif
+
+/**
+ * @brief Sets an object for a key.
+ *
+ * @param key The key to set
+ * @param object The object to set the key to
+ */
+- (void)setObject: (nullable void *)object forKey: (nullable void *)key;
+
+/**
+ * @brief Removes the object for the specified key from the map table.
+ *
+ * @param key The key whose object should be removed
+ */
+- (void)removeObjectForKey: (nullable void *)key;
+
+/**
+ * @brief Removes all objects.
+ */
+- (void)removeAllObjects;
+
+/**
+ * @brief Returns an OFConcurrentMapTableEnumerator to enumerate through the
+ *	  map table's keys.
+ *
+ * @return An OFConcurrentMapTableEnumerator to enumerate through the map
+ *	   table's keys
+ */
+- (OFConcurrentMapTableEnumerator *)keyEnumerator;
+
+/**
+ * @brief Returns an OFConcurrentMapTableEnumerator to enumerate through the
+ *	  map table's objects.
+ *
+ * @return An OFConcurrentMapTableEnumerator to enumerate through the map
+ *	   table's objects
+ */
+- (OFConcurrentMapTableEnumerator *)objectEnumerator;
+
+#ifdef OF_HAVE_BLOCKS
+/**
+ * @brief Executes a block for each key / object pair.
+ *
+ * The block is called without holding any lock, so it may access the map
+ * table.
+ *
+ * @param block The block to execute for each key / object pair.
+ */
+- (void)enumerateKeysAndObjectsUsingBlock: (OFMapTableEnumerationBlock)block;
+#endif
+@end
+
+/**
+ * @class OFConcurrentMapTableEnumerator OFConcurrentMapTable.h
+ *	  ObjFW/OFConcurrentMapTable.h
+ *
+ * @brief A class which provides methods to enumerate through an
+ *	  OFConcurrentMapTable's keys or objects.
+ *
+ * Each segment is copied when the enumerator reaches it, keeping its keys and
+ * objects alive until the enumerator moves on.
+ */
+OF_SUBCLASSING_RESTRICTED
+@interface OFConcurrentMapTableEnumerator: OFObject
+{
+	OFConcurrentMapTable *_mapTable;
+	bool _enumeratesKeys;
+	size_t _segment;
+	void *_Nullable *_Nullable _keys, *_Nullable *_Nullable _objects;
+	size_t _count, _position;
+}
+
+- (instancetype)init OF_UNAVAILABLE;
+
+/**
+ * @brief Returns a pointer to the next key or object, or NULL if the
+ *	  enumeration finished.
+ *
+ * @return The next key or object
+ */
+- (void *_Nullable *_Nullable)nextObject;
+@end
+
+OF_ASSUME_NONNULL_END
@@ -0,0 +1,458 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#include "config.h"
+
+#import "OFConcurrentMapTable.h"
+#import "OFReadWriteLock.h"
+#import "OFSystemInfo.h"
+
+#import "OFInvalidArgumentException.h"
+
+struct OFConcurrentMapTableSegment {
+	OFReadWriteLock *lock;
+	OFMapTable *mapTable;
+};
+
+static const size_t minSegmentsCount = 4, maxSegmentsCount = 64;
+
+OF_DIRECT_MEMBERS
+@interface OFConcurrentMapTableEnumerator ()
+- (instancetype)of_initWithMapTable: (OFConcurrentMapTable *)mapTable
+		     enumeratesKeys: (bool)enumeratesKeys
+    OF_METHOD_FAMILY(init);
+@end
+
+@implementation OFConcurrentMapTable
+@synthesize keyFunctions = _keyFunctions, objectFunctions = _objectFunctions;
+
++ (instancetype)mapTableWithKeyFunctions: (OFMapTableFunctions)keyFunctions
+			 objectFunctions: (OFMapTableFunctions)objectFunctions
+{
+	return [[[self alloc]
+	    initWithKeyFunctions: keyFunctions
+		  objectFunctions: objectFunctions] autorelease];
+}
+
++ (instancetype)mapTableWithKeyFunctions: (OFMapTableFunctions)keyFunctions
+			 objectFunctions: (OFMapTableFunctions)objectFunctions
+				capacity: (size_t)capacity
+{
+	return [[[self alloc]
+	    initWithKeyFunctions: keyFunctions
+		 objectFunctions: objectFunctions
+			capacity: capacity] autorelease];
+}
+
+- (instancetype)init
+{
+	OF_INVALID_INIT_METHOD
+}
+
+- (instancetype)initWithKeyFunctions: (OFMapTableFunctions)keyFunctions
+		     objectFunctions: (OFMapTableFunctions)objectFunctions
+{
+	return [self initWithKeyFunctions: keyFunctions
+			  objectFunctions: objectFunctions
+				 capacity: 0];
+}
+
+- (instancetype)initWithKeyFunctions: (OFMapTableFunctions)keyFunctions
+		     objectFunctions: (OFMapTableFunctions)objectFunctions
+			    capacity: (size_t)capacity
+{
+	self = [super init];
+
+	@try {
+		size_t CPUs = [OFSystemInfo numberOfCPUs];
+
+		/* Use more segments than CPUs to make collisions unlikely. */
+		_segmentsCount = minSegmentsCount;
+		_segmentShift = 32 - 2;
+		while (_segmentsCount < 4 * CPUs &&
+		    _segmentsCount < maxSegmentsCount) {
+			_segmentsCount *= 2;
+			_segmentShift--;
+		}
+
+		_segments = OFAllocZeroedMemory(_segmentsCount,
+		    sizeof(*_segments));
+
+		for (size_t i = 0; i < _segmentsCount; i++) {
+			_segments[i].lock = [[OFReadWriteLock alloc] init];
+			_segments[i].mapTable = [[OFMapTable alloc]
+			    initWithKeyFunctions: keyFunctions
+				 objectFunctions: objectFunctions
+					capacity: capacity / _segmentsCount];
+		}
+
+		/* The map table replaced NULL functions with the defaults. */
+		_keyFunctions = _segments[0].mapTable.keyFunctions;
+		_objectFunctions = _segments[0].mapTable.objectFunctions;
+	} @catch (id e) {
+		[self release];
+		@throw e;
+	}
+
+	return self;
+}
+
+- (void)dealloc
+{
+	if (_segments != NULL) {
+		for (size_t i = 0; i < _segmentsCount; i++) {
+			[_segments[i].lock release];
+			[_segments[i].mapTable release];
+		}
+
+		OFFreeMemory(_segments);
+	}
+
+	[super dealloc];
+}
+
+static OF_INLINE struct OFConcurrentMapTableSegment *
+segmentForKey(OFConcurrentMapTable *self, void *key)
+{
+	/*
+	 * Use the upper bits of a Fibonacci hash, as the segment's map table
+	 * uses the lower bits of the hash.
+	 */
+	uint32_t hash = (uint32_t)self->_keyFunctions.hash(key) *
+	    UINT32_C(0x9E3779B1);
+
+	return &self->_segments[hash >> self->_segmentShift];
+}
+
+/*
+ * Copies the keys and objects of the specified segment, retaining them, so
+ * that they can be used without holding the lock of the segment.
+ */
+static bool
+copySegment(OFConcurrentMapTable *self, size_t index, void ***keys,
+    void ***objects, size_t *count)
+{
+	struct OFConcurrentMapTableSegment *segment;
+
+	if (index >= self->_segmentsCount)
+		return false;
+
+	segment = &self->_segments[index];
+	*keys = *objects = NULL;
+	*count = 0;
+
+	[segment->lock readLock];
+	@try {
+		void *pool = objc_autoreleasePoolPush();
+		size_t capacity = segment->mapTable.count;
+		OFMapTableEnumerator *keyEnumerator, *objectEnumerator;
+		void **keyPtr, **objectPtr;
+
+		if (capacity > 0) {
+			*keys = OFAllocMemory(capacity, sizeof(**keys));
+			*objects = OFAllocMemory(capacity, sizeof(**objects));
+		}
+
+		keyEnumerator = [segment->mapTable keyEnumerator];
+		objectEnumerator = [segment->mapTable objectEnumerator];
+
+		while (*count < capacity &&
+		    (keyPtr = [keyEnumerator nextObject]) != NULL &&
+		    (objectPtr = [objectEnumerator nextObject]) != NULL) {
+			(*keys)[*count] = self->_keyFunctions.retain(*keyPtr);
+			(*objects)[*count] =
+			    self->_objectFunctions.retain(*objectPtr);
+			(*count)++;
+		}
+
+		objc_autoreleasePoolPop(pool);
+	} @catch (id e) {
+		for (size_t i = 0; i < *count; i++) {
+			self->_keyFunctions.release((*keys)[i]);
+			self->_objectFunctions.release((*objects)[i]);
+		}
+
+		OFFreeMemory(*keys);
+		OFFreeMemory(*objects);
+		*keys = *objects = NULL;
+		*count = 0;
+
+		@throw e;
+	} @finally {
+		[segment->lock unlock];
+	}
+
+	return true;
+}
+
+static void
+releaseSegmentCopy(OFConcurrentMapTable *self, void **keys, void **objects,
+    size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		self->_keyFunctions.release(keys[i]);
+		self->_objectFunctions.release(objects[i]);
+	}
+
+	OFFreeMemory(keys);
+	OFFreeMemory(objects);
+}
+
+- (size_t)count
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i < _segmentsCount; i++) {
+		[_segments[i].lock readLock];
+		count += _segments[i].mapTable.count;
+		[_segments[i].lock unlock];
+	}
+
+	return count;
+}
+
+- (void *)objectForKey: (void *)key
+{
+	struct OFConcurrentMapTableSegment *segment;
+	void *object;
+
+	if (key == NULL)
+		@throw [OFInvalidArgumentException exception];
+
+	segment = segmentForKey(self, key);
+
+	[segment->lock readLock];
+	@try {
+		object = [segment->mapTable objectForKey: key];
+	} @finally {
+		[segment->lock unlock];
+	}
+
+	return object;
+}
+
+- (void *)retainedObjectForKey: (void *)key
+{
+	struct OFConcurrentMapTableSegment *segment;
+	void *object;
+
+	if (key == NULL)
+		@throw [OFInvalidArgumentException exception];
+
+	segment = segmentForKey(self, key);
+
+	[segment->lock readLock];
+	@try {
+		object = [segment->mapTable objectForKey: key];
+
+		if (object != NULL)
+			object = _objectFunctions.retain(object);
+	} @finally {
+		[segment->lock unlock];
+	}
+
+	return object;
+}
+
+- (void *)retainedObjectForKey: (void *)key orSetObject: (void *)object
+{
+	struct OFConcurrentMapTableSegment *segment;
+	void *ret;
+
+	if (key == NULL || object == NULL)
+		@throw [OFInvalidArgumentException exception];
+
+	/* Usually, the key exists, so try without the write lock first. */
+	if ((ret = [self retainedObjectForKey: key]) != NULL)
+		return ret;
+
+	segment = segmentForKey(self, key);
+
+	[segment->lock lock];
+	@try {
+		ret = [segment->mapTable objectForKey: key];
+
+		if (ret == NULL) {
+			[segment->mapTable setObject: object forKey: key];
+			ret = [segment->mapTable objectForKey: key];
+		}
+
+		ret = _objectFunctions.retain(ret);
+	} @finally {
+		[segment->lock unlock];
+	}
+
+	return ret;
+}
+
+#ifdef OF_HAVE_BLOCKS
+- (void *)retainedObjectForKey: (void *)key
+	 orSetObjectUsingBlock: (OFConcurrentMapTableObjectBlock)block
+{
+	struct OFConcurrentMapTableSegment *segment;
+	void *ret;
+
+	if (key == NULL)
+		@throw [OFInvalidArgumentException exception];
+
+	/* Usually, the key exists, so try without the write lock first. */
+	if ((ret = [self retainedObjectForKey: key]) != NULL)
+		return ret;
+
+	segment = segmentForKey(self, key);
+
+	[segment->lock lock];
+	@try {
+		ret = [segment->mapTable objectForKey: key];
+
+		if (ret == NULL) {
+			[segment->mapTable setObject: block(key) forKey: key];
+			ret = [segment->mapTable objectForKey: key];
+		}
+
+		ret = _objectFunctions.retain(ret);
+	} @finally {
+		[segment->lock unlock];
+	}
+
+	return ret;
+}
+#endif
+
+- (void)setObject: (void *)object forKey: (void *)key
+{
+	struct OFConcurrentMapTableSegment *segment;
+
+	if (key == NULL || object == NULL)
+		@throw [OFInvalidArgumentException exception];
+
+	segment = segmentForKey(self, key);
+
+	[segment->lock lock];
+	@try {
+		[segment->mapTable setObject: object forKey: key];
+	} @finally {
+		[segment->lock unlock];
+	}
+}
+
+- (void)removeObjectForKey: (void *)key
+{
+	struct OFConcurrentMapTableSegment *segment;
+
+	if (key == NULL)
+		@throw [OFInvalidArgumentException exception];
+
+	segment = segmentForKey(self, key);
+
+	[segment->lock lock];
+	@try {
+		[segment->mapTable removeObjectForKey: key];
+	} @finally {
+		[segment->lock unlock];
+	}
+}
+
+- (void)removeAllObjects
+{
+	for (size_t i = 0; i < _segmentsCount; i++) {
+		[_segments[i].lock lock];
+		@try {
+			[_segments[i].mapTable removeAllObjects];
+		} @finally {
+			[_segments[i].lock unlock];
+		}
+	}
+}
+
+- (OFConcurrentMapTableEnumerator *)keyEnumerator
+{
+	return [[[OFConcurrentMapTableEnumerator alloc]
+	    of_initWithMapTable: self
+		 enumeratesKeys: true] autorelease];
+}
+
+- (OFConcurrentMapTableEnumerator *)objectEnumerator
+{
+	return [[[OFConcurrentMapTableEnumerator alloc]
+	    of_initWithMapTable: self
+		 enumeratesKeys: false] autorelease];
+}
+
+#ifdef OF_HAVE_BLOCKS
+- (void)enumerateKeysAndObjectsUsingBlock: (OFMapTableEnumerationBlock)block
+{
+	void **keys, **objects;
+	size_t count;
+	bool stop = false;
+
+	for (size_t i = 0; !stop && copySegment(self, i, &keys, &objects,
+	    &count); i++) {
+		@try {
+			for (size_t j = 0; !stop && j < count; j++)
+				block(keys[j], objects[j], &stop);
+		} @finally {
+			releaseSegmentCopy(self, keys, objects, count);
+		}
+	}
+}
+#endif
+@end
+
+@implementation OFConcurrentMapTableEnumerator
+- (instancetype)init
+{
+	OF_INVALID_INIT_METHOD
+}
+
+- (instancetype)of_initWithMapTable: (OFConcurrentMapTable *)mapTable
+		     enumeratesKeys: (bool)enumeratesKeys
+{
+	self = [super init];
+
+	_mapTable = [mapTable retain];
+	_enumeratesKeys = enumeratesKeys;
+
+	return self;
+}
+
+- (void)dealloc
+{
+	releaseSegmentCopy(_mapTable, _keys, _objects, _count);
+	[_mapTable release];
+
+	[super dealloc];
+}
+
+- (void **)nextObject
+{
+	while (_position >= _count) {
+		releaseSegmentCopy(_mapTable, _keys, _objects, _count);
+		_keys = _objects = NULL;
+		_count = _position = 0;
+
+		if (!copySegment(_mapTable, _segment, &_keys, &_objects,
+		    &_count))
+			return NULL;
+
+		_segment++;
+	}
+
+	if (_enumeratesKeys)
+		return &_keys[_position++];
+	else
+		return &_objects[_position++];
+}
+@end
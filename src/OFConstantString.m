@@ -284,6 +284,19 @@ struct {
 	return [self rangeOfString: string options: options range: range];
 }
 
+- (OFRange)rangeOfStringSearch: (OFStringSearch *)search
+{
+	[self finishInitialization];
+	return [self rangeOfStringSearch: search];
+}
+
+- (OFRange)rangeOfStringSearch: (OFStringSearch *)search
+			 range: (OFRange)range
+{
+	[self finishInitialization];
+	return [self rangeOfStringSearch: search range: range];
+}
+
 - (size_t)indexOfCharacterFromSet: (OFCharacterSet *)characterSet
 {
 	[self finishInitialization];
@@ -113,6 +113,26 @@ OF_ASSUME_NONNULL_BEGIN
  *	    it yourself before calling @ref reset!
  */
 - (void)reset;
+
+@optional
+/**
+ * @brief Hashes many independent buffers at once.
+ *
+ * This is considerably faster than using a new instance for each buffer when
+ * hashing many small buffers, as at most one object is created for all
+ * buffers and, if supported by the CPU, several buffers are hashed in parallel
+ * using SIMD.
+ *
+ * @param buffers The buffers to hash
+ * @param lengths The lengths of the buffers
+ * @param count The number of buffers
+ * @param digests A buffer of `count * digestSize` bytes into which the digests
+ *		  are written in the order of the buffers
+ */
++ (void)hashBuffers: (const void *_Nonnull const *_Nonnull)buffers
+	    lengths: (const size_t *)lengths
+	      count: (size_t)count
+	    digests: (unsigned char *)digests;
 @end
 
 OF_ASSUME_NONNULL_END
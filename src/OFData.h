@@ -21,6 +21,7 @@
 
 OF_ASSUME_NONNULL_BEGIN
 
+@class OFStream;
 @class OFString;
 @class OFURL;
 
@@ -342,6 +343,17 @@ typedef enum {
  * @param URL The URL to write to
  */
 - (void)writeToURL: (OFURL *)URL;
+
+/**
+ * @brief Writes the MessagePack representation of the data to the specified
+ *	  stream.
+ *
+ * This produces the same output as @ref messagePackRepresentation without
+ * creating an intermediate OFData.
+ *
+ * @param stream The stream to write the MessagePack representation to
+ */
+- (void)writeMessagePackToStream: (OFStream *)stream;
 @end
 
 OF_ASSUME_NONNULL_END
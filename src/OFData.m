@@ -26,6 +26,7 @@
 # import "OFFile.h"
 # import "OFFileManager.h"
 #endif
+#import "OFMessagePackWriting.h"
 #import "OFStream.h"
 #import "OFString.h"
 #import "OFSystemInfo.h"
@@ -632,40 +633,34 @@ _references_to_categories_of_OFData(void)
 	return [element autorelease];
 }
 
-- (OFData *)messagePackRepresentation
+- (size_t)of_getMessagePackHeader: (uint8_t *)header
 {
-	OFMutableData *data;
-
 	if (_itemSize != 1)
 		@throw [OFInvalidArgumentException exception];
 
-	if (_count <= UINT8_MAX) {
-		uint8_t type = 0xC4;
-		uint8_t tmp = (uint8_t)_count;
-
-		data = [OFMutableData dataWithCapacity: _count + 2];
-		[data addItem: &type];
-		[data addItem: &tmp];
-	} else if (_count <= UINT16_MAX) {
-		uint8_t type = 0xC5;
-		uint16_t tmp = OFToBigEndian16((uint16_t)_count);
-
-		data = [OFMutableData dataWithCapacity: _count + 3];
-		[data addItem: &type];
-		[data addItems: &tmp count: sizeof(tmp)];
-	} else if (_count <= UINT32_MAX) {
-		uint8_t type = 0xC6;
-		uint32_t tmp = OFToBigEndian32((uint32_t)_count);
-
-		data = [OFMutableData dataWithCapacity: _count + 5];
-		[data addItem: &type];
-		[data addItems: &tmp count: sizeof(tmp)];
-	} else
-		@throw [OFOutOfRangeException exception];
+	return OFMessagePackBinaryHeader(_count, header);
+}
 
+- (OFData *)messagePackRepresentation
+{
+	OFMutableData *data;
+	uint8_t header[5];
+	size_t headerLength = [self of_getMessagePackHeader: header];
+
+	data = [OFMutableData dataWithCapacity: headerLength + _count];
+	[data addItems: header count: headerLength];
 	[data addItems: _items count: _count];
 	[data makeImmutable];
 
 	return data;
 }
+
+- (void)writeMessagePackToStream: (OFStream *)stream
+{
+	uint8_t header[5];
+	size_t headerLength = [self of_getMessagePackHeader: header];
+
+	[stream writeBuffer: header length: headerLength];
+	[stream writeBuffer: _items length: _count];
+}
 @end
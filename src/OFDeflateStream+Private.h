@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#import "OFDeflateStream.h"
+
+OF_ASSUME_NONNULL_BEGIN
+
+@interface OFDeflateStream ()
+/*
+ * Primes the window with data preceding the data to compress, so that it can
+ * be referenced by matches. Needs to be called before any data is written.
+ */
+- (void)of_setDictionary: (const void *)dictionary
+		  length: (size_t)length OF_DIRECT;
+
+/*
+ * Like close, but ends with an empty stored block instead of a final block,
+ * so that the output ends on a byte boundary and another Deflate stream can be
+ * appended to it.
+ */
+- (void)of_closeWithoutFinalBlock OF_DIRECT;
+@end
+
+OF_ASSUME_NONNULL_END
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#import "OFStream.h"
+
+OF_ASSUME_NONNULL_BEGIN
+
+/**
+ * @brief The compression level used by OFDeflateStream if none is specified.
+ */
+#define OFDeflateStreamDefaultCompressionLevel 6
+
+#define OFDeflateStreamBufferSize 4096
+
+/**
+ * @class OFDeflateStream OFDeflateStream.h ObjFW/OFDeflateStream.h
+ *
+ * @brief A class that handles Deflate compression transparently for an
+ *	  underlying stream.
+ *
+ * Data written to the OFDeflateStream is compressed and written to the
+ * underlying stream. The compressed data is only complete once the
+ * OFDeflateStream has been closed. Closing the OFDeflateStream does not close
+ * the underlying stream.
+ */
+OF_SUBCLASSING_RESTRICTED
+@interface OFDeflateStream: OFStream
+{
+	OFStream *_stream;
+	unsigned int _compressionLevel;
+	unsigned char *_window;
+	uint16_t *_head, *_previous;
+	uint32_t _windowLength, _position;
+	int32_t _blockStart;
+	uint32_t _blockLength;
+	uint16_t _matchLength, _matchStart;
+	bool _matchAvailable;
+	uint16_t *_tokenDistances;
+	uint8_t *_tokenValues;
+	uint16_t _tokensCount;
+	uint32_t _litLenFrequencies[286], _distFrequencies[30];
+	unsigned char _buffer[OFDeflateStreamBufferSize];
+	uint16_t _bufferLength;
+	uint64_t _bitBuffer;
+	uint8_t _bitBufferLength;
+}
+
+/**
+ * @brief The compression level of the stream, from 0 (no compression) to 9
+ *	  (best compression).
+ */
+@property (readonly, nonatomic) unsigned int compressionLevel;
+
+/**
+ * @brief Creates a new OFDeflateStream with the specified underlying stream
+ *	  and the default compression level.
+ *
+ * @param stream The underlying stream to which compressed data is written
+ * @return A new, autoreleased OFDeflateStream
+ */
++ (instancetype)streamWithStream: (OFStream *)stream;
+
+/**
+ * @brief Creates a new OFDeflateStream with the specified underlying stream
+ *	  and compression level.
+ *
+ * @param stream The underlying stream to which compressed data is written
+ * @param compressionLevel The compression level, from 0 (no compression) to 9
+ *			   (best compression). Lower levels are faster.
+ * @return A new, autoreleased OFDeflateStream
+ */
++ (instancetype)streamWithStream: (OFStream *)stream
+		compressionLevel: (unsigned int)compressionLevel;
+
+- (instancetype)init OF_UNAVAILABLE;
+
+/**
+ * @brief Initializes an already allocated OFDeflateStream with the specified
+ *	  underlying stream and the default compression level.
+ *
+ * @param stream The underlying stream to which compressed data is written
+ * @return An initialized OFDeflateStream
+ */
+- (instancetype)initWithStream: (OFStream *)stream;
+
+/**
+ * @brief Initializes an already allocated OFDeflateStream with the specified
+ *	  underlying stream and compression level.
+ *
+ * @param stream The underlying stream to which compressed data is written
+ * @param compressionLevel The compression level, from 0 (no compression) to 9
+ *			   (best compression). Lower levels are faster.
+ * @return An initialized OFDeflateStream
+ */
+- (instancetype)initWithStream: (OFStream *)stream
+	      compressionLevel: (unsigned int)compressionLevel
+    OF_DESIGNATED_INITIALIZER;
+@end
+
+OF_ASSUME_NONNULL_END
@@ -0,0 +1,990 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#import "OFDeflateStream.h"
+#import "OFDeflateStream+Private.h"
+
+#import "OFInvalidArgumentException.h"
+#import "OFNotOpenException.h"
+
+static const uint8_t lengthCodes[29] = {
+	/* indices are -257, values -3 */
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 10, 12, 14, 16, 20, 24, 28, 32, 40, 48, 56,
+	64, 80, 96, 112, 128, 160, 192, 224, 255
+};
+static const uint8_t lengthExtraBits[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4,
+	5, 5, 5, 5, 0
+};
+static const uint16_t distanceCodes[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385,
+	513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t distanceExtraBits[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10,
+	10, 11, 11, 12, 12, 13, 13
+};
+static const uint8_t codeLengthsOrder[19] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+static const uint32_t windowSize = 32768;
+static const uint32_t windowMask = 32767;
+static const uint8_t hashBits = 15;
+static const uint16_t minMatch = 3;
+static const uint16_t maxMatch = 258;
+/* Enough lookahead to find a match of maximal length plus the next hash */
+static const uint32_t minLookahead = 258 + 3 + 1;
+static const uint32_t maxDistance = 32768 - (258 + 3 + 1);
+/* Matches of minimal length that are further away cost more than literals */
+static const uint32_t tooFar = 4096;
+static const uint16_t maxTokens = 16384;
+
+/*
+ * The parameters for each compression level. Levels 1 to 3 take the longest
+ * match at each position, levels 4 to 9 first check whether the next position
+ * has an even longer match. For the former, lazyLength is the maximum length
+ * of a match for which all strings inside the match are added to the hash
+ * chains.
+ */
+static const struct {
+	uint16_t goodLength, lazyLength, niceLength, maxChain;
+	bool lazy;
+} levels[10] = {
+	{  0,   0,   0,    0, false },
+	{  4,   4,   8,    4, false },
+	{  4,   5,  16,    8, false },
+	{  4,   6,  32,   32, false },
+	{  4,   4,  16,   16, true },
+	{  8,  16,  32,   32, true },
+	{  8,  16, 128,  128, true },
+	{  8,  32, 128,  256, true },
+	{ 32, 128, 258, 1024, true },
+	{ 32, 258, 258, 4096, true }
+};
+
+static uint8_t lengthCodeTable[256], distanceCodeTable[512];
+static uint8_t fixedLitLenLengths[286], fixedDistLengths[30];
+static uint16_t fixedLitLenCodes[286], fixedDistCodes[30];
+
+/*
+ * Calculates the lengths of an optimal prefix code in place, using the
+ * algorithm by Moffat and Katajainen. The frequencies need to be sorted in
+ * ascending order and are replaced by the code lengths.
+ */
+static void
+calculateCodeLengths(uint32_t *A, int n)
+{
+	int root, leaf, next, available, used, depth;
+
+	if (n == 0)
+		return;
+
+	if (n == 1) {
+		A[0] = 1;
+		return;
+	}
+
+	A[0] += A[1];
+	root = 0;
+	leaf = 2;
+
+	for (next = 1; next < n - 1; next++) {
+		if (leaf >= n || A[root] < A[leaf]) {
+			A[next] = A[root];
+			A[root++] = next;
+		} else
+			A[next] = A[leaf++];
+
+		if (leaf >= n || (root < next && A[root] < A[leaf])) {
+			A[next] += A[root];
+			A[root++] = next;
+		} else
+			A[next] += A[leaf++];
+	}
+
+	A[n - 2] = 0;
+	for (next = n - 3; next >= 0; next--)
+		A[next] = A[A[next]] + 1;
+
+	available = 1;
+	used = depth = 0;
+	root = n - 2;
+	next = n - 1;
+	while (available > 0) {
+		while (root >= 0 && (int)A[root] == depth) {
+			used++;
+			root--;
+		}
+
+		while (available > used) {
+			A[next--] = depth;
+			available--;
+		}
+
+		available = 2 * used;
+		depth++;
+		used = 0;
+	}
+}
+
+static void
+buildLengths(const uint32_t *frequencies, uint8_t *lengths, uint16_t count,
+    uint8_t maxLength)
+{
+	uint16_t symbols[286], lengthCounts[16] = { 0 };
+	uint32_t sorted[286], total;
+	uint16_t symbolsCount = 0, i;
+
+	for (i = 0; i < count; i++) {
+		lengths[i] = 0;
+
+		if (frequencies[i] > 0) {
+			uint16_t j = symbolsCount++;
+
+			/* Insertion sort, stable for equal frequencies */
+			while (j > 0 && frequencies[symbols[j - 1]] >
+			    frequencies[i]) {
+				symbols[j] = symbols[j - 1];
+				j--;
+			}
+
+			symbols[j] = i;
+		}
+	}
+
+	if (symbolsCount == 0)
+		return;
+
+	for (i = 0; i < symbolsCount; i++)
+		sorted[i] = frequencies[symbols[i]];
+
+	calculateCodeLengths(sorted, symbolsCount);
+
+	for (i = 0; i < symbolsCount; i++)
+		lengthCounts[sorted[i] < maxLength ? sorted[i] : maxLength]++;
+
+	/*
+	 * Clamping lengths to the maximum makes the code oversubscribed.
+	 * Lengthen shorter codes until it is complete again.
+	 */
+	if (symbolsCount > 1) {
+		total = 0;
+		for (i = 1; i <= maxLength; i++)
+			total += (uint32_t)lengthCounts[i] << (maxLength - i);
+
+		while (total != (1u << maxLength)) {
+			lengthCounts[maxLength]--;
+
+			for (i = maxLength - 1; i > 0; i--) {
+				if (lengthCounts[i] > 0) {
+					lengthCounts[i]--;
+					lengthCounts[i + 1] += 2;
+					break;
+				}
+			}
+
+			total--;
+		}
+	}
+
+	/* The least frequent symbols get the longest codes. */
+	i = 0;
+	for (uint8_t length = maxLength; length > 0; length--)
+		for (uint16_t j = lengthCounts[length]; j > 0; j--)
+			lengths[symbols[i++]] = length;
+}
+
+static void
+buildCodes(const uint8_t *lengths, uint16_t *codes, uint16_t count)
+{
+	uint16_t lengthCounts[16] = { 0 }, nextCode[16], code = 0;
+
+	for (uint16_t i = 0; i < count; i++)
+		lengthCounts[lengths[i]]++;
+
+	lengthCounts[0] = 0;
+	for (uint8_t i = 1; i < 16; i++) {
+		code = (code + lengthCounts[i - 1]) << 1;
+		nextCode[i] = code;
+	}
+
+	for (uint16_t i = 0; i < count; i++) {
+		uint16_t reversed = 0;
+
+		if (lengths[i] == 0)
+			continue;
+
+		/* Codes are written starting with the most significant bit. */
+		code = nextCode[lengths[i]]++;
+		for (uint8_t j = 0; j < lengths[i]; j++)
+			reversed |= ((code >> j) & 1) << (lengths[i] - 1 - j);
+
+		codes[i] = reversed;
+	}
+}
+
+static void
+flushBuffer(OFDeflateStream *stream)
+{
+	if (stream->_bufferLength == 0)
+		return;
+
+	[stream->_stream writeBuffer: stream->_buffer
+			      length: stream->_bufferLength];
+	stream->_bufferLength = 0;
+}
+
+static OF_INLINE void
+writeBits(OFDeflateStream *stream, uint32_t bits, uint8_t count)
+{
+	stream->_bitBuffer |= (uint64_t)bits << stream->_bitBufferLength;
+	stream->_bitBufferLength += count;
+
+	if (stream->_bitBufferLength >= 32) {
+		if (stream->_bufferLength > OFDeflateStreamBufferSize - 4)
+			flushBuffer(stream);
+
+		for (uint8_t i = 0; i < 4; i++) {
+			stream->_buffer[stream->_bufferLength++] =
+			    (unsigned char)stream->_bitBuffer;
+			stream->_bitBuffer >>= 8;
+		}
+
+		stream->_bitBufferLength -= 32;
+	}
+}
+
+static void
+alignToByte(OFDeflateStream *stream)
+{
+	while (stream->_bitBufferLength > 0) {
+		if (stream->_bufferLength == OFDeflateStreamBufferSize)
+			flushBuffer(stream);
+
+		stream->_buffer[stream->_bufferLength++] =
+		    (unsigned char)stream->_bitBuffer;
+		stream->_bitBuffer >>= 8;
+		stream->_bitBufferLength = (stream->_bitBufferLength > 8
+		    ? stream->_bitBufferLength - 8 : 0);
+	}
+
+	stream->_bitBuffer = 0;
+}
+
+static void
+writeBytes(OFDeflateStream *stream, const unsigned char *bytes, size_t length)
+{
+	if (length >= OFDeflateStreamBufferSize) {
+		flushBuffer(stream);
+		[stream->_stream writeBuffer: bytes length: length];
+		return;
+	}
+
+	if (length > OFDeflateStreamBufferSize - stream->_bufferLength)
+		flushBuffer(stream);
+
+	memcpy(stream->_buffer + stream->_bufferLength, bytes, length);
+	stream->_bufferLength += length;
+}
+
+static OF_INLINE uint8_t
+distanceCode(uint16_t distance)
+{
+	distance--;
+
+	return (distance < 256
+	    ? distanceCodeTable[distance]
+	    : distanceCodeTable[256 + (distance >> 7)]);
+}
+
+static OF_INLINE void
+tallyLiteral(OFDeflateStream *stream, unsigned char literal)
+{
+	stream->_tokenDistances[stream->_tokensCount] = 0;
+	stream->_tokenValues[stream->_tokensCount++] = literal;
+	stream->_litLenFrequencies[literal]++;
+	stream->_blockLength++;
+}
+
+static OF_INLINE void
+tallyMatch(OFDeflateStream *stream, uint16_t distance, uint16_t length)
+{
+	stream->_tokenDistances[stream->_tokensCount] = distance;
+	stream->_tokenValues[stream->_tokensCount++] = length - minMatch;
+	stream->_litLenFrequencies[257 + lengthCodeTable[length - minMatch]]++;
+	stream->_distFrequencies[distanceCode(distance)]++;
+	stream->_blockLength += length;
+}
+
+static void
+writeTokens(OFDeflateStream *stream, const uint16_t *litLenCodes,
+    const uint8_t *litLenLengths, const uint16_t *distCodes,
+    const uint8_t *distLengths)
+{
+	for (uint16_t i = 0; i < stream->_tokensCount; i++) {
+		uint16_t distance = stream->_tokenDistances[i];
+		uint8_t value = stream->_tokenValues[i], code;
+
+		if (distance == 0) {
+			writeBits(stream, litLenCodes[value],
+			    litLenLengths[value]);
+			continue;
+		}
+
+		code = lengthCodeTable[value];
+		writeBits(stream, litLenCodes[257 + code],
+		    litLenLengths[257 + code]);
+		if (lengthExtraBits[code] > 0)
+			writeBits(stream, value - lengthCodes[code],
+			    lengthExtraBits[code]);
+
+		code = distanceCode(distance);
+		writeBits(stream, distCodes[code], distLengths[code]);
+		if (distanceExtraBits[code] > 0)
+			writeBits(stream, distance - distanceCodes[code],
+			    distanceExtraBits[code]);
+	}
+
+	writeBits(stream, litLenCodes[256], litLenLengths[256]);
+}
+
+static void
+writeStoredBlock(OFDeflateStream *stream, bool last)
+{
+	const unsigned char *data = stream->_window + stream->_blockStart;
+	uint32_t length = stream->_blockLength;
+
+	do {
+		uint16_t chunkLength = (length > 65535 ? 65535 : length);
+		unsigned char header[4];
+
+		length -= chunkLength;
+
+		writeBits(stream, (last && length == 0), 3);
+		alignToByte(stream);
+
+		header[0] = chunkLength & 0xFF;
+		header[1] = chunkLength >> 8;
+		header[2] = ~chunkLength & 0xFF;
+		header[3] = (uint16_t)~chunkLength >> 8;
+		writeBytes(stream, header, 4);
+		writeBytes(stream, data, chunkLength);
+
+		data += chunkLength;
+	} while (length > 0);
+}
+
+/*
+ * Run-length encodes the code lengths of both trees using the repeat codes
+ * 16 to 18 and returns the number of symbols.
+ */
+static uint16_t
+encodeCodeLengths(const uint8_t *lengths, uint16_t count, uint8_t *symbols,
+    uint8_t *extra)
+{
+	uint16_t symbolsCount = 0, i = 0;
+
+	while (i < count) {
+		uint8_t length = lengths[i];
+		uint16_t run = 1;
+
+		while (i + run < count && lengths[i + run] == length)
+			run++;
+
+		i += run;
+
+		if (length == 0) {
+			while (run >= 11) {
+				uint16_t repeat = (run > 138 ? 138 : run);
+
+				symbols[symbolsCount] = 18;
+				extra[symbolsCount++] = repeat - 11;
+				run -= repeat;
+			}
+
+			if (run >= 3) {
+				symbols[symbolsCount] = 17;
+				extra[symbolsCount++] = run - 3;
+				run = 0;
+			}
+		} else {
+			symbols[symbolsCount] = length;
+			extra[symbolsCount++] = 0;
+			run--;
+
+			while (run >= 3) {
+				uint16_t repeat = (run > 6 ? 6 : run);
+
+				symbols[symbolsCount] = 16;
+				extra[symbolsCount++] = repeat - 3;
+				run -= repeat;
+			}
+		}
+
+		while (run-- > 0) {
+			symbols[symbolsCount] = length;
+			extra[symbolsCount++] = 0;
+		}
+	}
+
+	return symbolsCount;
+}
+
+/*
+ * Writes the current block as a stored, fixed Huffman or dynamic Huffman
+ * block, whichever is the smallest.
+ */
+static void
+writeBlock(OFDeflateStream *stream, bool last)
+{
+	uint8_t litLenLengths[286], distLengths[30], codeLenLengths[19];
+	uint16_t litLenCodes[286], distCodes[30], codeLenCodes[19];
+	uint8_t lengths[286 + 30], symbols[286 + 30], extra[286 + 30];
+	uint32_t codeLenFrequencies[19] = { 0 };
+	uint16_t litLenCount, distCount, codeLenCount, symbolsCount;
+	uint64_t extraBits = 0, dataBits = 0, fixedBits, dynamicBits;
+	uint64_t storedBits = UINT64_MAX;
+
+	if (stream->_compressionLevel == 0) {
+		writeStoredBlock(stream, last);
+		goto reset;
+	}
+
+	stream->_litLenFrequencies[256] = 1;
+
+	/* An unused distance tree still needs one code. */
+	distCount = 0;
+	for (uint8_t i = 0; i < 30; i++)
+		if (stream->_distFrequencies[i] > 0)
+			distCount++;
+	if (distCount == 0)
+		stream->_distFrequencies[0] = 1;
+
+	buildLengths(stream->_litLenFrequencies, litLenLengths, 286, 15);
+	buildLengths(stream->_distFrequencies, distLengths, 30, 15);
+
+	for (litLenCount = 286;
+	    litLenCount > 257 && litLenLengths[litLenCount - 1] == 0;
+	    litLenCount--);
+	for (distCount = 30;
+	    distCount > 1 && distLengths[distCount - 1] == 0; distCount--);
+
+	memcpy(lengths, litLenLengths, litLenCount);
+	memcpy(lengths + litLenCount, distLengths, distCount);
+	symbolsCount = encodeCodeLengths(lengths, litLenCount + distCount,
+	    symbols, extra);
+
+	for (uint16_t i = 0; i < symbolsCount; i++)
+		codeLenFrequencies[symbols[i]]++;
+
+	buildLengths(codeLenFrequencies, codeLenLengths, 19, 7);
+
+	for (codeLenCount = 19; codeLenCount > 4 &&
+	    codeLenLengths[codeLengthsOrder[codeLenCount - 1]] == 0;
+	    codeLenCount--);
+
+	for (uint8_t i = 0; i < 29; i++)
+		extraBits += (uint64_t)stream->_litLenFrequencies[257 + i] *
+		    lengthExtraBits[i];
+	for (uint8_t i = 0; i < 30; i++)
+		extraBits += (uint64_t)stream->_distFrequencies[i] *
+		    distanceExtraBits[i];
+
+	fixedBits = 3 + extraBits;
+	dynamicBits = 3 + 5 + 5 + 4 + 3 * codeLenCount + extraBits +
+	    2 * codeLenFrequencies[16] + 3 * codeLenFrequencies[17] +
+	    7 * codeLenFrequencies[18];
+	for (uint16_t i = 0; i < 286; i++) {
+		fixedBits += (uint64_t)stream->_litLenFrequencies[i] *
+		    fixedLitLenLengths[i];
+		dataBits += (uint64_t)stream->_litLenFrequencies[i] *
+		    litLenLengths[i];
+	}
+	for (uint8_t i = 0; i < 30; i++) {
+		fixedBits += (uint64_t)stream->_distFrequencies[i] *
+		    fixedDistLengths[i];
+		dataBits += (uint64_t)stream->_distFrequencies[i] *
+		    distLengths[i];
+	}
+	for (uint8_t i = 0; i < 19; i++)
+		dataBits += (uint64_t)codeLenFrequencies[i] * codeLenLengths[i];
+	dynamicBits += dataBits;
+
+	/*
+	 * A stored block is only possible if the block's data is still in the
+	 * window. Each chunk costs at most 3 header bits, 7 padding bits and
+	 * 32 bits for the length.
+	 */
+	if (stream->_blockStart >= 0)
+		storedBits = (stream->_blockLength / 65535 + 1) * 42 +
+		    (uint64_t)stream->_blockLength * 8;
+
+	if (storedBits <= fixedBits && storedBits <= dynamicBits)
+		writeStoredBlock(stream, last);
+	else if (fixedBits <= dynamicBits) {
+		writeBits(stream, last | (1 << 1), 3);
+		writeTokens(stream, fixedLitLenCodes, fixedLitLenLengths,
+		    fixedDistCodes, fixedDistLengths);
+	} else {
+		buildCodes(litLenLengths, litLenCodes, 286);
+		buildCodes(distLengths, distCodes, 30);
+		buildCodes(codeLenLengths, codeLenCodes, 19);
+
+		writeBits(stream, last | (2 << 1), 3);
+		writeBits(stream, litLenCount - 257, 5);
+		writeBits(stream, distCount - 1, 5);
+		writeBits(stream, codeLenCount - 4, 4);
+
+		for (uint8_t i = 0; i < codeLenCount; i++)
+			writeBits(stream,
+			    codeLenLengths[codeLengthsOrder[i]], 3);
+
+		for (uint16_t i = 0; i < symbolsCount; i++) {
+			writeBits(stream, codeLenCodes[symbols[i]],
+			    codeLenLengths[symbols[i]]);
+
+			if (symbols[i] == 16)
+				writeBits(stream, extra[i], 2);
+			else if (symbols[i] == 17)
+				writeBits(stream, extra[i], 3);
+			else if (symbols[i] == 18)
+				writeBits(stream, extra[i], 7);
+		}
+
+		writeTokens(stream, litLenCodes, litLenLengths, distCodes,
+		    distLengths);
+	}
+
+reset:
+	memset(stream->_litLenFrequencies, 0,
+	    sizeof(stream->_litLenFrequencies));
+	memset(stream->_distFrequencies, 0, sizeof(stream->_distFrequencies));
+	stream->_tokensCount = 0;
+	stream->_blockStart += stream->_blockLength;
+	stream->_blockLength = 0;
+}
+
+static OF_INLINE uint16_t
+insertString(OFDeflateStream *stream, uint32_t position)
+{
+	const unsigned char *bytes = stream->_window + position;
+	uint32_t hash = (((uint32_t)bytes[0] << 16) | (bytes[1] << 8) |
+	    bytes[2]) * 0x9E3779B1u >> (32 - hashBits);
+	uint16_t head = stream->_head[hash];
+
+	stream->_previous[position & windowMask] = head;
+	stream->_head[hash] = (uint16_t)position;
+
+	return head;
+}
+
+/*
+ * Follows the hash chain starting at the specified position and returns the
+ * length of the longest match that is longer than the specified length.
+ */
+static uint16_t
+longestMatch(OFDeflateStream *stream, uint16_t current,
+    uint16_t previousLength)
+{
+	const unsigned char *scan = stream->_window + stream->_position;
+	uint32_t lookahead = stream->_windowLength - stream->_position;
+	uint32_t limit = (stream->_position > maxDistance
+	    ? stream->_position - maxDistance : 0);
+	unsigned int chainLength = levels[stream->_compressionLevel].maxChain;
+	uint16_t niceLength = levels[stream->_compressionLevel].niceLength;
+	uint16_t bestLength = previousLength, maxLength = maxMatch;
+
+	if (previousLength >= levels[stream->_compressionLevel].goodLength)
+		chainLength >>= 2;
+	if (niceLength > lookahead)
+		niceLength = lookahead;
+	if (maxLength > lookahead)
+		maxLength = lookahead;
+
+	do {
+		const unsigned char *match = stream->_window + current;
+		uint16_t length;
+
+		/*
+		 * Only a match that differs from the best match at its end can
+		 * be longer.
+		 */
+		if (match[bestLength] != scan[bestLength] ||
+		    match[bestLength - 1] != scan[bestLength - 1] ||
+		    match[0] != scan[0] || match[1] != scan[1])
+			continue;
+
+		for (length = 2;
+		    length < maxLength && match[length] == scan[length];
+		    length++);
+
+		if (length > bestLength) {
+			stream->_matchStart = current;
+			bestLength = length;
+
+			if (length >= niceLength)
+				break;
+		}
+	} while ((current = stream->_previous[current & windowMask]) > limit &&
+	    --chainLength > 0);
+
+	return (bestLength <= lookahead ? bestLength : lookahead);
+}
+
+static void
+compressFast(OFDeflateStream *stream, uint32_t minimumLookahead)
+{
+	uint16_t lazyLength = levels[stream->_compressionLevel].lazyLength;
+
+	while (stream->_windowLength - stream->_position >= minimumLookahead) {
+		uint32_t lookahead = stream->_windowLength - stream->_position;
+		uint16_t head = 0, length = 0;
+
+		if (lookahead >= minMatch)
+			head = insertString(stream, stream->_position);
+
+		if (head != 0 && stream->_position - head <= maxDistance)
+			length = longestMatch(stream, head, minMatch - 1);
+
+		if (length >= minMatch) {
+			tallyMatch(stream, stream->_position -
+			    stream->_matchStart, length);
+
+			if (length <= lazyLength &&
+			    lookahead - length >= minMatch)
+				for (uint16_t i = 1; i < length; i++)
+					insertString(stream,
+					    stream->_position + i);
+
+			stream->_position += length;
+		} else
+			tallyLiteral(stream,
+			    stream->_window[stream->_position++]);
+
+		if (stream->_tokensCount == maxTokens)
+			writeBlock(stream, false);
+	}
+}
+
+static void
+compressLazy(OFDeflateStream *stream, uint32_t minimumLookahead)
+{
+	uint16_t lazyLength = levels[stream->_compressionLevel].lazyLength;
+
+	while (stream->_windowLength - stream->_position >= minimumLookahead) {
+		uint32_t lookahead = stream->_windowLength - stream->_position;
+		uint16_t head = 0, previousLength = stream->_matchLength;
+		uint16_t previousStart = stream->_matchStart;
+
+		if (lookahead >= minMatch)
+			head = insertString(stream, stream->_position);
+
+		stream->_matchLength = minMatch - 1;
+
+		if (head != 0 && previousLength < lazyLength &&
+		    stream->_position - head <= maxDistance) {
+			stream->_matchLength = longestMatch(stream, head,
+			    previousLength);
+
+			if (stream->_matchLength == minMatch &&
+			    stream->_position - stream->_matchStart > tooFar)
+				stream->_matchLength = minMatch - 1;
+		}
+
+		if (previousLength >= minMatch &&
+		    stream->_matchLength <= previousLength) {
+			/*
+			 * The match at the previous position is at least as
+			 * long, so use that one.
+			 */
+			uint32_t end = stream->_position - 1 + previousLength;
+			uint32_t maxInsert = stream->_windowLength - minMatch;
+
+			tallyMatch(stream,
+			    stream->_position - 1 - previousStart,
+			    previousLength);
+
+			for (uint32_t i = stream->_position + 1;
+			    i < end && i <= maxInsert; i++)
+				insertString(stream, i);
+
+			stream->_position = end;
+			stream->_matchAvailable = false;
+			stream->_matchLength = minMatch - 1;
+		} else if (stream->_matchAvailable) {
+			tallyLiteral(stream,
+			    stream->_window[stream->_position - 1]);
+			stream->_position++;
+		} else {
+			stream->_matchAvailable = true;
+			stream->_position++;
+		}
+
+		if (stream->_tokensCount == maxTokens)
+			writeBlock(stream, false);
+	}
+}
+
+/*
+ * Tokenizes the data in the window. Unless flushing, enough data is left to
+ * find a match of maximal length at the current position.
+ */
+static void
+compress(OFDeflateStream *stream, bool flush)
+{
+	uint32_t minimumLookahead = (flush ? 1 : minLookahead);
+
+	if (stream->_compressionLevel == 0) {
+		stream->_blockLength += stream->_windowLength -
+		    stream->_position;
+		stream->_position = stream->_windowLength;
+	} else if (levels[stream->_compressionLevel].lazy) {
+		compressLazy(stream, minimumLookahead);
+
+		if (flush && stream->_matchAvailable) {
+			tallyLiteral(stream,
+			    stream->_window[stream->_position - 1]);
+			stream->_matchAvailable = false;
+		}
+	} else
+		compressFast(stream, minimumLookahead);
+}
+
+static void
+slideWindow(OFDeflateStream *stream)
+{
+	/* Stored blocks need their data in the window. */
+	if (stream->_compressionLevel == 0)
+		writeBlock(stream, false);
+
+	memcpy(stream->_window, stream->_window + windowSize, windowSize);
+	stream->_windowLength -= windowSize;
+	stream->_position -= windowSize;
+	stream->_blockStart -= windowSize;
+	stream->_matchStart = (stream->_matchStart >= windowSize
+	    ? stream->_matchStart - windowSize : 0);
+
+	for (uint32_t i = 0; i < (1u << hashBits); i++)
+		stream->_head[i] = (stream->_head[i] >= windowSize
+		    ? stream->_head[i] - windowSize : 0);
+	for (uint32_t i = 0; i < windowSize; i++)
+		stream->_previous[i] = (stream->_previous[i] >= windowSize
+		    ? stream->_previous[i] - windowSize : 0);
+}
+
+@implementation OFDeflateStream
+@synthesize compressionLevel = _compressionLevel;
+
++ (void)initialize
+{
+	if (self != [OFDeflateStream class])
+		return;
+
+	for (uint8_t i = 0; i < 28; i++)
+		for (uint16_t j = 0; j < (1u << lengthExtraBits[i]); j++)
+			lengthCodeTable[lengthCodes[i] + j] = i;
+	/* A length of 258 has its own code. */
+	lengthCodeTable[255] = 28;
+
+	for (uint8_t i = 0; i < 30; i++) {
+		uint16_t start = distanceCodes[i] - 1;
+
+		if (start < 256)
+			for (uint16_t j = 0;
+			    j < (1u << distanceExtraBits[i]); j++)
+				distanceCodeTable[start + j] = i;
+		else
+			for (uint16_t j = 0;
+			    j < (1u << (distanceExtraBits[i] - 7)); j++)
+				distanceCodeTable[256 + (start >> 7) + j] = i;
+	}
+
+	for (uint16_t i = 0; i <= 143; i++)
+		fixedLitLenLengths[i] = 8;
+	for (uint16_t i = 144; i <= 255; i++)
+		fixedLitLenLengths[i] = 9;
+	for (uint16_t i = 256; i <= 279; i++)
+		fixedLitLenLengths[i] = 7;
+	for (uint16_t i = 280; i < 286; i++)
+		fixedLitLenLengths[i] = 8;
+	for (uint8_t i = 0; i < 30; i++)
+		fixedDistLengths[i] = 5;
+
+	buildCodes(fixedLitLenLengths, fixedLitLenCodes, 286);
+	buildCodes(fixedDistLengths, fixedDistCodes, 30);
+}
+
++ (instancetype)streamWithStream: (OFStream *)stream
+{
+	return [[[self alloc] initWithStream: stream] autorelease];
+}
+
++ (instancetype)streamWithStream: (OFStream *)stream
+		compressionLevel: (unsigned int)compressionLevel
+{
+	return [[[self alloc] initWithStream: stream
+			    compressionLevel: compressionLevel] autorelease];
+}
+
+- (instancetype)init
+{
+	OF_INVALID_INIT_METHOD
+}
+
+- (instancetype)initWithStream: (OFStream *)stream
+{
+	return [self initWithStream: stream
+		   compressionLevel: OFDeflateStreamDefaultCompressionLevel];
+}
+
+- (instancetype)initWithStream: (OFStream *)stream
+	      compressionLevel: (unsigned int)compressionLevel
+{
+	self = [super init];
+
+	@try {
+		if (compressionLevel > 9)
+			@throw [OFInvalidArgumentException exception];
+
+		_compressionLevel = compressionLevel;
+		/*
+		 * The window has room for reading past the end of the data
+		 * when checking the end of a match first.
+		 */
+		_window = OFAllocZeroedMemory(2 * windowSize + maxMatch + 1, 1);
+
+		if (compressionLevel > 0) {
+			_head = OFAllocZeroedMemory(1u << hashBits,
+			    sizeof(uint16_t));
+			_previous = OFAllocZeroedMemory(windowSize,
+			    sizeof(uint16_t));
+			_tokenDistances = OFAllocMemory(maxTokens,
+			    sizeof(uint16_t));
+			_tokenValues = OFAllocMemory(maxTokens, 1);
+		}
+
+		_matchLength = minMatch - 1;
+		_stream = [stream retain];
+	} @catch (id e) {
+		[self release];
+		@throw e;
+	}
+
+	return self;
+}
+
+- (void)dealloc
+{
+	if (_stream != nil)
+		[self close];
+
+	OFFreeMemory(_window);
+	OFFreeMemory(_head);
+	OFFreeMemory(_previous);
+	OFFreeMemory(_tokenDistances);
+	OFFreeMemory(_tokenValues);
+
+	[super dealloc];
+}
+
+- (size_t)lowlevelWriteBuffer: (const void *)buffer_ length: (size_t)length
+{
+	const unsigned char *buffer = buffer_;
+	size_t left = length;
+
+	if (_stream == nil)
+		@throw [OFNotOpenException exceptionWithObject: self];
+
+	while (left > 0) {
+		size_t toCopy;
+
+		if (_windowLength == 2 * windowSize)
+			slideWindow(self);
+
+		toCopy = 2 * windowSize - _windowLength;
+		if (toCopy > left)
+			toCopy = left;
+
+		memcpy(_window + _windowLength, buffer, toCopy);
+		_windowLength += (uint32_t)toCopy;
+		buffer += toCopy;
+		left -= toCopy;
+
+		compress(self, false);
+	}
+
+	return length;
+}
+
+- (void)of_setDictionary: (const void *)dictionary_ length: (size_t)length
+{
+	const unsigned char *dictionary = dictionary_;
+
+	if (_windowLength > 0)
+		@throw [OFInvalidArgumentException exception];
+
+	if (length > windowSize) {
+		dictionary += length - windowSize;
+		length = windowSize;
+	}
+
+	memcpy(_window, dictionary, length);
+	_windowLength = _position = (uint32_t)length;
+	_blockStart = (int32_t)length;
+
+	if (_compressionLevel > 0)
+		for (uint32_t i = 1; i + minMatch <= length; i++)
+			insertString(self, i);
+}
+
+- (void)of_closeWithoutFinalBlock
+{
+	if (_stream == nil)
+		@throw [OFNotOpenException exceptionWithObject: self];
+
+	compress(self, true);
+	if (_tokensCount > 0 || _blockLength > 0)
+		writeBlock(self, false);
+	writeStoredBlock(self, false);
+	flushBuffer(self);
+
+	[_stream release];
+	_stream = nil;
+
+	[super close];
+}
+
+- (void)close
+{
+	if (_stream == nil)
+		@throw [OFNotOpenException exceptionWithObject: self];
+
+	compress(self, true);
+	writeBlock(self, true);
+	alignToByte(self);
+	flushBuffer(self);
+
+	[_stream release];
+	_stream = nil;
+
+	[super close];
+}
+@end
@@ -32,6 +32,7 @@
 OF_ASSUME_NONNULL_BEGIN
 
 @class OFArray OF_GENERIC(ObjectType);
+@class OFStream;
 
 #ifdef OF_HAVE_BLOCKS
 typedef void (^OFDictionaryEnumerationBlock)(id key, id object, bool *stop);
@@ -265,6 +266,34 @@ typedef id _Nonnull (^OFDictionaryMapBlock)(id key, id object);
  */
 - (OFEnumerator OF_GENERIC(ObjectType) *)objectEnumerator;
 
+/**
+ * @brief Writes the JSON representation of the dictionary to the specified
+ *	  stream.
+ *
+ * Unlike @ref JSONRepresentationWithOptions:, this does not create an
+ * intermediate string for each contained object, but writes everything
+ * directly to the stream. For best performance, the stream should have
+ * @ref OFStream#buffersWrites enabled.
+ *
+ * @param stream The stream to write the JSON representation to
+ * @param options The options to use when creating the JSON representation
+ */
+- (void)writeJSONToStream: (OFStream *)stream
+		  options: (OFJSONRepresentationOptions)options;
+
+/**
+ * @brief Writes the MessagePack representation of the dictionary to the
+ *	  specified stream.
+ *
+ * Unlike @ref messagePackRepresentation, this does not create an intermediate
+ * OFData for each contained object, but writes everything directly to the
+ * stream. For best performance, the stream should have
+ * @ref OFStream#buffersWrites enabled.
+ *
+ * @param stream The stream to write the MessagePack representation to
+ */
+- (void)writeMessagePackToStream: (OFStream *)stream;
+
 #ifdef OF_HAVE_BLOCKS
 /**
  * @brief Executes a block for each key / object pair.
@@ -16,6 +16,7 @@
 #include "config.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <assert.h>
 
@@ -25,11 +26,12 @@
 #import "OFData.h"
 #import "OFEnumerator.h"
 #import "OFMapTableDictionary.h"
+#import "OFMessagePackWriting.h"
+#import "OFStream.h"
 #import "OFString.h"
 #import "OFXMLElement.h"
 
 #import "OFInvalidArgumentException.h"
-#import "OFOutOfRangeException.h"
 #import "OFUndefinedKeyException.h"
 
 static struct {
@@ -42,6 +44,9 @@ static OFCharacterSet *URLQueryPartAllowedCharacterSet = nil;
 - (OFString *)
     of_JSONRepresentationWithOptions: (OFJSONRepresentationOptions)options
 			       depth: (size_t)depth;
+- (void)of_writeJSONToStream: (OFStream *)stream
+		     options: (OFJSONRepresentationOptions)options
+		       depth: (size_t)depth;
 @end
 
 @interface OFDictionaryPlaceholder: OFDictionary
@@ -808,34 +813,84 @@ OF_DIRECT_MEMBERS
 	return JSON;
 }
 
+- (void)writeJSONToStream: (OFStream *)stream
+		  options: (OFJSONRepresentationOptions)options
+{
+	[self of_writeJSONToStream: stream options: options depth: 0];
+}
+
+- (void)of_writeJSONToStream: (OFStream *)stream
+		     options: (OFJSONRepresentationOptions)options
+		       depth: (size_t)depth
+{
+	void *pool = objc_autoreleasePoolPush();
+	OFEnumerator *keyEnumerator = [self keyEnumerator];
+	OFEnumerator *objectEnumerator = [self objectEnumerator];
+	int identifierOptions =
+	    options | OFJSONRepresentationOptionIsIdentifier;
+	bool pretty = (options & OFJSONRepresentationOptionPretty);
+	size_t i, count = self.count;
+	id key, object;
+
+	[stream writeBuffer: "{" length: 1];
+
+	if (pretty)
+		[stream writeBuffer: "\n" length: 1];
+
+	i = 0;
+	while ((key = [keyEnumerator nextObject]) != nil &&
+	    (object = [objectEnumerator nextObject]) != nil) {
+		if (![key isKindOfClass: [OFString class]])
+			@throw [OFInvalidArgumentException exception];
+
+		if (pretty)
+			for (size_t j = 0; j <= depth; j++)
+				[stream writeBuffer: "\t" length: 1];
+
+		[key of_writeJSONToStream: stream
+				  options: identifierOptions
+				    depth: depth + 1];
+
+		if (pretty)
+			[stream writeBuffer: ": " length: 2];
+		else
+			[stream writeBuffer: ":" length: 1];
+
+		[object of_writeJSONToStream: stream
+				     options: options
+				       depth: depth + 1];
+
+		if (++i < count) {
+			if (pretty)
+				[stream writeBuffer: ",\n" length: 2];
+			else
+				[stream writeBuffer: "," length: 1];
+		} else if (pretty)
+			[stream writeBuffer: "\n" length: 1];
+	}
+
+	if (pretty)
+		for (size_t j = 0; j < depth; j++)
+			[stream writeBuffer: "\t" length: 1];
+
+	[stream writeBuffer: "}" length: 1];
+
+	objc_autoreleasePoolPop(pool);
+}
+
 - (OFData *)messagePackRepresentation
 {
 	OFMutableData *data;
 	size_t i, count;
+	uint8_t header[5];
 	void *pool;
 	OFEnumerator *keyEnumerator, *objectEnumerator;
 	id <OFMessagePackRepresentation> key, object;
 
-	data = [OFMutableData data];
 	count = self.count;
 
-	if (count <= 15) {
-		uint8_t tmp = 0x80 | ((uint8_t)count & 0xF);
-		[data addItem: &tmp];
-	} else if (count <= UINT16_MAX) {
-		uint8_t type = 0xDE;
-		uint16_t tmp = OFToBigEndian16((uint16_t)count);
-
-		[data addItem: &type];
-		[data addItems: &tmp count: sizeof(tmp)];
-	} else if (count <= UINT32_MAX) {
-		uint8_t type = 0xDF;
-		uint32_t tmp = OFToBigEndian32((uint32_t)count);
-
-		[data addItem: &type];
-		[data addItems: &tmp count: sizeof(tmp)];
-	} else
-		@throw [OFOutOfRangeException exception];
+	data = [OFMutableData data];
+	[data addItems: header count: OFMessagePackMapHeader(count, header)];
 
 	pool = objc_autoreleasePoolPush();
 
@@ -866,6 +921,34 @@ OF_DIRECT_MEMBERS
 
 	return data;
 }
+
+- (void)writeMessagePackToStream: (OFStream *)stream
+{
+	void *pool = objc_autoreleasePoolPush();
+	OFEnumerator *keyEnumerator, *objectEnumerator;
+	size_t i, count;
+	uint8_t header[5];
+	id key, object;
+
+	count = self.count;
+	[stream writeBuffer: header
+		     length: OFMessagePackMapHeader(count, header)];
+
+	i = 0;
+	keyEnumerator = [self keyEnumerator];
+	objectEnumerator = [self objectEnumerator];
+	while ((key = [keyEnumerator nextObject]) != nil &&
+	    (object = [objectEnumerator nextObject]) != nil) {
+		i++;
+
+		OFMessagePackWriteObject(key, stream);
+		OFMessagePackWriteObject(object, stream);
+	}
+
+	assert(i == count);
+
+	objc_autoreleasePoolPop(pool);
+}
 @end
 
 @implementation OFDictionaryObjectEnumerator
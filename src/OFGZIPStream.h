@@ -16,7 +16,12 @@
 #import "OFStream.h"
 #import "OFDate.h"
 
+@class OFData;
+@class OFDeflateStream;
 @class OFInflateStream;
+@class OFMutableArray OF_GENERIC(ObjectType);
+@class OFMutableData;
+@class OFThreadPool;
 
 OF_ASSUME_NONNULL_BEGIN
 
@@ -52,6 +57,7 @@ OF_SUBCLASSING_RESTRICTED
 {
 	OFStream *_stream;
 	OFInflateStream *_Nullable _inflateStream;
+	OFDeflateStream *_Nullable _deflateStream;
 	enum {
 		OFGZIPStreamStateID1,
 		OFGZIPStreamStateID2,
@@ -83,6 +89,14 @@ OF_SUBCLASSING_RESTRICTED
 	OFDate *_Nullable _modificationDate;
 	uint16_t _extraLength;
 	uint32_t _CRC32, _uncompressedSize;
+	bool _writing;
+	unsigned int _compressionLevel;
+#ifdef OF_HAVE_THREADS
+	OFThreadPool *_Nullable _threadPool;
+	OFMutableData *_Nullable _pendingBlock;
+	OFData *_Nullable _previousBlock;
+	OFMutableArray *_Nullable _blocks;
+#endif
 }
 
 /**
@@ -102,12 +116,29 @@ OF_SUBCLASSING_RESTRICTED
  */
 @property OF_NULLABLE_PROPERTY (readonly, nonatomic) OFDate *modificationDate;
 
+#ifdef OF_HAVE_THREADS
+/**
+ * @brief The thread pool on which the data is compressed when writing, or
+ *	  `nil` to compress in the calling thread.
+ *
+ * If a thread pool is set, the data is split into blocks of 128 KiB which are
+ * compressed independently, using the end of the preceding block as the
+ * dictionary. The result is a single gzip member that is slightly larger
+ * than when compressing in one thread.
+ *
+ * This can only be set in write mode before any data has been written.
+ */
+@property OF_NULLABLE_PROPERTY (retain, nonatomic) OFThreadPool *threadPool;
+#endif
+
 /**
  * @brief Creates a new OFGZIPStream with the specified underlying stream.
  *
  * @param stream The underlying stream for the OFGZIPStream
  * @param mode The mode for the OFGZIPStream. Valid modes are "r" for reading
- *	       and "w" for writing.
+ *	       and "w" for writing. "w" can be followed by a digit from 0
+ *	       (no compression) to 9 (best compression) to specify the
+ *	       compression level.
  * @return A new, autoreleased OFGZIPStream
  */
 + (instancetype)streamWithStream: (OFStream *)stream mode: (OFString *)mode;
@@ -120,7 +151,9 @@ OF_SUBCLASSING_RESTRICTED
  *
  * @param stream The underlying stream for the OFGZIPStream
  * @param mode The mode for the OFGZIPStream. Valid modes are "r" for reading
- *	       and "w" for writing.
+ *	       and "w" for writing. "w" can be followed by a digit from 0
+ *	       (no compression) to 9 (best compression) to specify the
+ *	       compression level.
  * @return An initialized OFGZIPStream
  */
 - (instancetype)initWithStream: (OFStream *)stream
@@ -18,14 +18,146 @@
 #import "OFGZIPStream.h"
 #import "OFCRC32.h"
 #import "OFDate.h"
+#import "OFDeflateStream.h"
+#import "OFDeflateStream+Private.h"
 #import "OFInflateStream.h"
+#ifdef OF_HAVE_THREADS
+# import "OFArray.h"
+# import "OFCondition.h"
+# import "OFData.h"
+# import "OFThreadPool.h"
+#endif
 
 #import "OFChecksumMismatchException.h"
+#import "OFInvalidArgumentException.h"
 #import "OFInvalidFormatException.h"
 #import "OFNotImplementedException.h"
 #import "OFNotOpenException.h"
 #import "OFTruncatedDataException.h"
 
+#ifdef OF_HAVE_THREADS
+static const size_t blockSize = 128 * 1024;
+
+/*
+ * A block of data that is compressed and checksummed on a thread pool. The
+ * Deflate stream writes the compressed data back into the block.
+ */
+@interface OFGZIPStreamBlock: OFStream
+{
+	OFData *_Nullable _dictionary;
+	unsigned int _compressionLevel;
+	bool _finalBlock;
+	id _Nullable _exception;
+@public
+	OFData *_data;
+	OFCondition *_condition;
+	bool _done;
+	OFMutableData *_output;
+	uint32_t _CRC32;
+}
+
+- (instancetype)initWithData: (OFData *)data
+		  dictionary: (nullable OFData *)dictionary
+	    compressionLevel: (unsigned int)compressionLevel
+		  finalBlock: (bool)finalBlock;
+- (void)compress: (nullable id)object;
+- (void)waitUntilDone;
+@end
+
+@interface OFGZIPStream ()
+- (void)of_dispatchPendingBlockAsFinalBlock: (bool)finalBlock OF_DIRECT;
+- (void)of_writeCompressedBlocksWaiting: (bool)wait OF_DIRECT;
+@end
+
+@implementation OFGZIPStreamBlock
+- (instancetype)initWithData: (OFData *)data
+		  dictionary: (OFData *)dictionary
+	    compressionLevel: (unsigned int)compressionLevel
+		  finalBlock: (bool)finalBlock
+{
+	self = [super init];
+
+	@try {
+		_data = [data retain];
+		_dictionary = [dictionary retain];
+		_compressionLevel = compressionLevel;
+		_finalBlock = finalBlock;
+		_condition = [[OFCondition alloc] init];
+		_output = [[OFMutableData alloc] init];
+	} @catch (id e) {
+		[self release];
+		@throw e;
+	}
+
+	return self;
+}
+
+- (void)dealloc
+{
+	[_data release];
+	[_dictionary release];
+	[_condition release];
+	[_exception release];
+	[_output release];
+
+	[super dealloc];
+}
+
+- (size_t)lowlevelWriteBuffer: (const void *)buffer length: (size_t)length
+{
+	[_output addItems: buffer count: length];
+
+	return length;
+}
+
+- (void)compress: (id)object
+{
+	void *pool = objc_autoreleasePoolPush();
+
+	@try {
+		OFDeflateStream *deflateStream = [OFDeflateStream
+		    streamWithStream: self
+		    compressionLevel: _compressionLevel];
+
+		if (_dictionary != nil)
+			[deflateStream of_setDictionary: _dictionary.items
+						 length: _dictionary.count];
+
+		[deflateStream writeBuffer: _data.items length: _data.count];
+		_CRC32 = ~OFCRC32(~0, _data.items, _data.count);
+
+		if (_finalBlock)
+			[deflateStream close];
+		else
+			[deflateStream of_closeWithoutFinalBlock];
+	} @catch (id e) {
+		_exception = [e retain];
+	}
+
+	objc_autoreleasePoolPop(pool);
+
+	[_condition lock];
+	_done = true;
+	[_condition signal];
+	[_condition unlock];
+}
+
+- (void)waitUntilDone
+{
+	[_condition lock];
+	@try {
+		while (!_done)
+			[_condition wait];
+	} @finally {
+		[_condition unlock];
+	}
+
+	if (_exception != nil)
+		@throw [[_exception retain] autorelease];
+}
+@end
+#endif
+
 @implementation OFGZIPStream
 @synthesize operatingSystemMadeOn = _operatingSystemMadeOn;
 @synthesize modificationDate = _modificationDate;
@@ -45,7 +177,16 @@
 	self = [super init];
 
 	@try {
-		if (![mode isEqual: @"r"])
+		_compressionLevel = OFDeflateStreamDefaultCompressionLevel;
+
+		if ([mode isEqual: @"w"])
+			_writing = true;
+		else if (mode.length == 2 && [mode hasPrefix: @"w"] &&
+		    [mode characterAtIndex: 1] >= '0' &&
+		    [mode characterAtIndex: 1] <= '9') {
+			_writing = true;
+			_compressionLevel = [mode characterAtIndex: 1] - '0';
+		} else if (![mode isEqual: @"r"])
 			@throw [OFNotImplementedException
 			    exceptionWithSelector: _cmd
 					   object: nil];
@@ -53,6 +194,21 @@
 		_stream = [stream retain];
 		_operatingSystemMadeOn = OFGZIPStreamOperatingSystemUnknown;
 		_CRC32 = ~0;
+
+		if (_writing) {
+			unsigned char header[10] = {
+				0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0,
+				OFGZIPStreamOperatingSystemUnknown
+			};
+
+			/* Extra flags for maximum and fastest compression */
+			if (_compressionLevel == 9)
+				header[8] = 2;
+			else if (_compressionLevel == 1)
+				header[8] = 4;
+
+			[_stream writeBuffer: header length: sizeof(header)];
+		}
 	} @catch (id e) {
 		[self release];
 		@throw e;
@@ -67,16 +223,97 @@
 		[self close];
 
 	[_inflateStream release];
+	[_deflateStream release];
 	[_modificationDate release];
+#ifdef OF_HAVE_THREADS
+	[_threadPool release];
+	[_pendingBlock release];
+	[_previousBlock release];
+	[_blocks release];
+#endif
 
 	[super dealloc];
 }
 
+#ifdef OF_HAVE_THREADS
+- (OFThreadPool *)threadPool
+{
+	return _threadPool;
+}
+
+- (void)setThreadPool: (OFThreadPool *)threadPool
+{
+	OFThreadPool *old;
+
+	if (!_writing || _deflateStream != nil || _pendingBlock != nil ||
+	    _blocks != nil)
+		@throw [OFInvalidArgumentException exception];
+
+	old = _threadPool;
+	_threadPool = [threadPool retain];
+	[old release];
+}
+
+- (void)of_dispatchPendingBlockAsFinalBlock: (bool)finalBlock
+{
+	OFGZIPStreamBlock *block = [[[OFGZIPStreamBlock alloc]
+	    initWithData: _pendingBlock
+	      dictionary: _previousBlock
+	compressionLevel: _compressionLevel
+	      finalBlock: finalBlock] autorelease];
+
+	if (_blocks == nil)
+		_blocks = [[OFMutableArray alloc] init];
+
+	[_blocks addObject: block];
+	[_threadPool dispatchWithTarget: block
+			       selector: @selector(compress:)
+				 object: nil];
+
+	[_previousBlock release];
+	_previousBlock = _pendingBlock;
+	_pendingBlock = nil;
+}
+
+/*
+ * Writes the compressed blocks in order. Unless waiting for all blocks, this
+ * only blocks if too many blocks are queued, so that memory usage is bounded.
+ */
+- (void)of_writeCompressedBlocksWaiting: (bool)wait
+{
+	while (_blocks.count > 0) {
+		OFGZIPStreamBlock *block = _blocks.firstObject;
+
+		if (!wait && _blocks.count <= 2 * _threadPool.size) {
+			bool done;
+
+			[block->_condition lock];
+			done = block->_done;
+			[block->_condition unlock];
+
+			if (!done)
+				break;
+		}
+
+		[block waitUntilDone];
+		[_stream writeBuffer: block->_output.items
+			      length: block->_output.count];
+		_CRC32 = ~OFCRC32Combine(~_CRC32, block->_CRC32,
+		    block->_data.count);
+		[_blocks removeObjectAtIndex: 0];
+	}
+}
+#endif
+
 - (size_t)lowlevelReadIntoBuffer: (void *)buffer length: (size_t)length
 {
 	if (_stream == nil)
 		@throw [OFNotOpenException exceptionWithObject: self];
 
+	if (_writing)
+		@throw [OFNotImplementedException exceptionWithSelector: _cmd
+								 object: self];
+
 	for (;;) {
 		uint8_t byte;
 		uint32_t CRC32, uncompressedSize;
@@ -298,6 +535,59 @@
 	}
 }
 
+- (size_t)lowlevelWriteBuffer: (const void *)buffer length: (size_t)length
+{
+	if (_stream == nil)
+		@throw [OFNotOpenException exceptionWithObject: self];
+
+	if (!_writing)
+		@throw [OFNotImplementedException exceptionWithSelector: _cmd
+								 object: self];
+
+#ifdef OF_HAVE_THREADS
+	if (_threadPool != nil) {
+		const unsigned char *bytes = buffer;
+		size_t left = length;
+
+		while (left > 0) {
+			size_t toCopy;
+
+			if (_pendingBlock == nil)
+				_pendingBlock = [[OFMutableData alloc]
+				    initWithCapacity: blockSize];
+
+			toCopy = blockSize - _pendingBlock.count;
+			if (toCopy > left)
+				toCopy = left;
+
+			[_pendingBlock addItems: bytes count: toCopy];
+			bytes += toCopy;
+			left -= toCopy;
+
+			if (_pendingBlock.count == blockSize) {
+				[self
+				    of_dispatchPendingBlockAsFinalBlock: false];
+				[self of_writeCompressedBlocksWaiting: false];
+			}
+		}
+	} else {
+#endif
+		if (_deflateStream == nil)
+			_deflateStream = [[OFDeflateStream alloc]
+			    initWithStream: _stream
+			  compressionLevel: _compressionLevel];
+
+		[_deflateStream writeBuffer: buffer length: length];
+		_CRC32 = OFCRC32(_CRC32, buffer, length);
+#ifdef OF_HAVE_THREADS
+	}
+#endif
+
+	_uncompressedSize += (uint32_t)length;
+
+	return length;
+}
+
 - (bool)lowlevelIsAtEndOfStream
 {
 	if (_stream == nil)
@@ -320,6 +610,45 @@
 	if (_stream == nil)
 		@throw [OFNotOpenException exceptionWithObject: self];
 
+	if (_writing) {
+		uint32_t CRC32;
+		unsigned char trailer[8];
+
+#ifdef OF_HAVE_THREADS
+		if (_threadPool != nil) {
+			if (_pendingBlock == nil)
+				_pendingBlock = [[OFMutableData alloc] init];
+
+			[self of_dispatchPendingBlockAsFinalBlock: true];
+			[self of_writeCompressedBlocksWaiting: true];
+		} else {
+#endif
+			if (_deflateStream == nil)
+				_deflateStream = [[OFDeflateStream alloc]
+				    initWithStream: _stream
+				  compressionLevel: _compressionLevel];
+
+			[_deflateStream close];
+#ifdef OF_HAVE_THREADS
+		}
+#endif
+
+		CRC32 = ~_CRC32;
+		trailer[0] = CRC32 & 0xFF;
+		trailer[1] = (CRC32 >> 8) & 0xFF;
+		trailer[2] = (CRC32 >> 16) & 0xFF;
+		trailer[3] = CRC32 >> 24;
+		trailer[4] = _uncompressedSize & 0xFF;
+		trailer[5] = (_uncompressedSize >> 8) & 0xFF;
+		trailer[6] = (_uncompressedSize >> 16) & 0xFF;
+		trailer[7] = _uncompressedSize >> 24;
+
+		[_stream writeBuffer: trailer length: sizeof(trailer)];
+
+		[_deflateStream release];
+		_deflateStream = nil;
+	}
+
 	[_stream release];
 	_stream = nil;
 
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#import "OFHMAC.h"
+
+OF_ASSUME_NONNULL_BEGIN
+
+@interface OFHMAC ()
+/*
+ * Runs PBKDF2 iterations without creating hashes or sending messages per
+ * iteration, if the hash class supports it. For each iteration, digest is
+ * replaced by its HMAC and XORed into accumulator. Returns false if the hash
+ * class is not supported, in which case nothing is changed.
+ */
+- (bool)of_PBKDF2IterateWithDigest: (unsigned char *)digest
+		       accumulator: (unsigned char *)accumulator
+			iterations: (size_t)iterations OF_DIRECT;
+@end
+
+OF_ASSUME_NONNULL_END
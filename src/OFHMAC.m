@@ -16,6 +16,11 @@
 #include "config.h"
 
 #import "OFHMAC.h"
+#import "OFHMAC+Private.h"
+#import "OFSHA1Hash.h"
+#import "OFSHA1Hash+Private.h"
+#import "OFSHA224Or256Hash.h"
+#import "OFSHA224Or256Hash+Private.h"
 #import "OFSecureData.h"
 
 #import "OFHashAlreadyCalculatedException.h"
@@ -183,6 +188,35 @@
 	_calculated = false;
 }
 
+- (bool)of_PBKDF2IterateWithDigest: (unsigned char *)digest
+		       accumulator: (unsigned char *)accumulator
+			iterations: (size_t)iterations
+{
+	if (_innerHashCopy == nil || _outerHashCopy == nil)
+		@throw [OFInvalidArgumentException exception];
+
+	if ([_innerHashCopy isKindOfClass: [OFSHA224Or256Hash class]]) {
+		[(OFSHA224Or256Hash *)_innerHashCopy
+		    of_PBKDF2IterateWithOuterHash:
+		    (OFSHA224Or256Hash *)_outerHashCopy
+					   digest: digest
+				      accumulator: accumulator
+				       iterations: iterations];
+		return true;
+	}
+
+	if ([_innerHashCopy isKindOfClass: [OFSHA1Hash class]]) {
+		[(OFSHA1Hash *)_innerHashCopy
+		    of_PBKDF2IterateWithOuterHash: (OFSHA1Hash *)_outerHashCopy
+					   digest: digest
+				      accumulator: accumulator
+				       iterations: iterations];
+		return true;
+	}
+
+	return false;
+}
+
 - (void)zero
 {
 	[_outerHash release];
@@ -96,6 +96,7 @@ OF_SUBCLASSING_RESTRICTED
 	uint16_t _port;
 	id <OFHTTPServerDelegate> _Nullable _delegate;
 	OFString *_Nullable _name;
+	bool _compressesResponses;
 	OFTCPSocket *_Nullable _listeningSocket;
 #ifdef OF_HAVE_THREADS
 	size_t _numberOfThreads, _nextThreadIndex;
@@ -148,6 +149,19 @@ OF_SUBCLASSING_RESTRICTED
  */
 @property OF_NULLABLE_PROPERTY (copy, nonatomic) OFString *name;
 
+/**
+ * @brief Whether responses are compressed using gzip for clients that accept
+ *	  it.
+ *
+ * Only responses to HTTP/1.1 requests which have a body and no
+ * `Content-Encoding` header are compressed. As the length of the compressed
+ * body is not known in advance, they are sent using chunked transfer encoding
+ * and any `Content-Length` header is removed.
+ *
+ * The default is `false`.
+ */
+@property (nonatomic) bool compressesResponses;
+
 /**
  * @brief Creates a new HTTP server.
  *
@@ -24,6 +24,7 @@
 #import "OFData.h"
 #import "OFDate.h"
 #import "OFDictionary.h"
+#import "OFGZIPStream.h"
 #import "OFHTTPRequest.h"
 #import "OFHTTPResponse.h"
 #import "OFNumber.h"
@@ -58,6 +59,7 @@ OF_DIRECT_MEMBERS
 	OFStreamSocket *_socket;
 	OFHTTPServer *_server;
 	OFHTTPRequest *_request;
+	OFGZIPStream *_Nullable _GZIPStream;
 	bool _chunked, _headersSent;
 }
 
@@ -66,6 +68,15 @@ OF_DIRECT_MEMBERS
 		       request: (OFHTTPRequest *)request;
 @end
 
+OF_DIRECT_MEMBERS
+@interface OFHTTPServerChunkedStream: OFStream
+{
+	OFStreamSocket *_socket;
+}
+
+- (instancetype)initWithSocket: (OFStreamSocket *)sock;
+@end
+
 OF_DIRECT_MEMBERS
 @interface OFHTTPServerConnection: OFObject <OFTCPSocketDelegate>
 {
@@ -149,6 +160,75 @@ normalizedKey(OFString *key)
 	return ret;
 }
 
+static void
+writeChunk(OFStreamSocket *sock, const void *buffer, size_t length)
+{
+	void *pool = objc_autoreleasePoolPush();
+	[sock writeString: [OFString stringWithFormat: @"%zX\r\n", length]];
+	objc_autoreleasePoolPop(pool);
+
+	[sock writeBuffer: buffer length: length];
+	[sock writeString: @"\r\n"];
+}
+
+static bool
+isZeroQValue(OFString *value)
+{
+	size_t length = value.length;
+
+	if (length == 0 || [value characterAtIndex: 0] != '0')
+		return false;
+
+	for (size_t i = 1; i < length; i++) {
+		OFUnichar character = [value characterAtIndex: i];
+
+		if (character != '.' && character != '0')
+			return false;
+	}
+
+	return true;
+}
+
+static bool
+acceptsGZIP(OFString *acceptEncoding)
+{
+	void *pool;
+	bool ret = false;
+
+	if (acceptEncoding == nil)
+		return false;
+
+	pool = objc_autoreleasePoolPush();
+
+	for (OFString *encoding in
+	    [acceptEncoding componentsSeparatedByString: @","]) {
+		OFArray OF_GENERIC(OFString *) *parameters =
+		    [encoding componentsSeparatedByString: @";"];
+		OFString *name = [parameters.firstObject
+		    stringByDeletingEnclosingWhitespaces].lowercaseString;
+
+		if (![name isEqual: @"gzip"] && ![name isEqual: @"x-gzip"])
+			continue;
+
+		ret = true;
+
+		for (OFString *parameter in parameters) {
+			OFString *trimmed =
+			    parameter.stringByDeletingEnclosingWhitespaces;
+
+			if ([trimmed hasPrefix: @"q="] &&
+			    isZeroQValue([trimmed substringFromIndex: 2]))
+				ret = false;
+		}
+
+		break;
+	}
+
+	objc_autoreleasePoolPop(pool);
+
+	return ret;
+}
+
 @implementation OFHTTPServerResponse
 - (instancetype)initWithSocket: (OFStreamSocket *)sock
 			server: (OFHTTPServer *)server
@@ -171,16 +251,44 @@ normalizedKey(OFString *key)
 
 	[_server release];
 	[_request release];
+	[_GZIPStream release];
 
 	[super dealloc];
 }
 
+- (bool)of_shouldCompressWithHeaders:
+    (OFDictionary OF_GENERIC(OFString *, OFString *) *)headers
+{
+	OFHTTPRequestProtocolVersion protocolVersion;
+
+	if (!_server.compressesResponses)
+		return false;
+
+	protocolVersion = _request.protocolVersion;
+	if (protocolVersion.major < 1 ||
+	    (protocolVersion.major == 1 && protocolVersion.minor < 1))
+		return false;
+
+	/* These responses have no body. */
+	if (_request.method == OFHTTPRequestMethodHead ||
+	    (_statusCode >= 100 && _statusCode < 200) || _statusCode == 204 ||
+	    _statusCode == 304)
+		return false;
+
+	if ([headers objectForKey: @"Content-Encoding"] != nil)
+		return false;
+
+	return acceptsGZIP(
+	    [_request.headers objectForKey: @"Accept-Encoding"]);
+}
+
 - (void)of_sendHeaders
 {
 	void *pool = objc_autoreleasePoolPush();
 	OFMutableDictionary OF_GENERIC(OFString *, OFString *) *headers;
 	OFEnumerator *keyEnumerator, *valueEnumerator;
 	OFString *key, *value;
+	bool compress;
 
 	[_socket writeFormat: @"HTTP/%@ %hd %@\r\n",
 			      self.protocolVersionString, _statusCode,
@@ -201,6 +309,19 @@ normalizedKey(OFString *key)
 			[headers setObject: name forKey: @"Server"];
 	}
 
+	compress = [self of_shouldCompressWithHeaders: headers];
+	if (compress) {
+		OFString *vary = [headers objectForKey: @"Vary"];
+
+		[headers removeObjectForKey: @"Content-Length"];
+		[headers setObject: @"gzip" forKey: @"Content-Encoding"];
+		[headers setObject: @"chunked" forKey: @"Transfer-Encoding"];
+		[headers setObject: (vary != nil
+		    ? [vary stringByAppendingString: @", Accept-Encoding"]
+		    : @"Accept-Encoding")
+			    forKey: @"Vary"];
+	}
+
 	keyEnumerator = [headers keyEnumerator];
 	valueEnumerator = [headers objectEnumerator];
 	while ((key = [keyEnumerator nextObject]) != nil &&
@@ -213,6 +334,16 @@ normalizedKey(OFString *key)
 	_chunked = [[headers objectForKey: @"Transfer-Encoding"]
 	    isEqual: @"chunked"];
 
+	if (compress) {
+		OFHTTPServerChunkedStream *chunkedStream =
+		    [[[OFHTTPServerChunkedStream alloc]
+		    initWithSocket: _socket] autorelease];
+
+		_GZIPStream = [[OFGZIPStream alloc]
+		    initWithStream: chunkedStream
+			      mode: @"w"];
+	}
+
 	objc_autoreleasePoolPop(pool);
 }
 
@@ -220,14 +351,17 @@ normalizedKey(OFString *key)
 {
 	/* TODO: Use non-blocking writes */
 
-	void *pool;
-
 	if (_socket == nil)
 		@throw [OFNotOpenException exceptionWithObject: self];
 
 	if (!_headersSent)
 		[self of_sendHeaders];
 
+	if (_GZIPStream != nil) {
+		[_GZIPStream writeBuffer: buffer length: length];
+		return length;
+	}
+
 	if (!_chunked) {
 		@try {
 			[_socket writeBuffer: buffer length: length];
@@ -241,12 +375,7 @@ normalizedKey(OFString *key)
 		return length;
 	}
 
-	pool = objc_autoreleasePoolPush();
-	[_socket writeString: [OFString stringWithFormat: @"%zX\r\n", length]];
-	objc_autoreleasePoolPop(pool);
-
-	[_socket writeBuffer: buffer length: length];
-	[_socket writeString: @"\r\n"];
+	writeChunk(_socket, buffer, length);
 
 	return length;
 }
@@ -260,6 +389,8 @@ normalizedKey(OFString *key)
 		if (!_headersSent)
 			[self of_sendHeaders];
 
+		[_GZIPStream close];
+
 		if (_chunked)
 			[_socket writeString: @"0\r\n\r\n"];
 	} @catch (OFWriteFailedException *e) {
@@ -276,6 +407,9 @@ normalizedKey(OFString *key)
 	[_socket release];
 	_socket = nil;
 
+	[_GZIPStream release];
+	_GZIPStream = nil;
+
 	[super close];
 }
 
@@ -288,6 +422,33 @@ normalizedKey(OFString *key)
 }
 @end
 
+@implementation OFHTTPServerChunkedStream
+- (instancetype)initWithSocket: (OFStreamSocket *)sock
+{
+	self = [super init];
+
+	_socket = [sock retain];
+
+	return self;
+}
+
+- (void)dealloc
+{
+	[_socket release];
+
+	[super dealloc];
+}
+
+- (size_t)lowlevelWriteBuffer: (const void *)buffer length: (size_t)length
+{
+	/* An empty chunk would end the body. */
+	if (length > 0)
+		writeChunk(_socket, buffer, length);
+
+	return length;
+}
+@end
+
 @implementation OFHTTPServerConnection
 - (instancetype)initWithSocket: (OFStreamSocket *)sock
 			server: (OFHTTPServer *)server
@@ -768,6 +929,7 @@ normalizedKey(OFString *key)
 
 @implementation OFHTTPServer
 @synthesize delegate = _delegate, name = _name;
+@synthesize compressesResponses = _compressesResponses;
 
 + (instancetype)server
 {
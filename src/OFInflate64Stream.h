@@ -35,39 +35,32 @@ OF_SUBCLASSING_RESTRICTED
 	OFStream *_stream;
 	unsigned char _buffer[OFInflate64StreamBufferSize];
 	uint16_t _bufferIndex, _bufferLength;
-	uint8_t _byte;
-	uint8_t _bitIndex, _savedBitsLength;
-	uint16_t _savedBits;
+	uint64_t _bitBuffer;
+	uint8_t _bitBufferLength;
 	unsigned char *_Nullable _slidingWindow;
 	uint16_t _slidingWindowIndex, _slidingWindowMask;
 	int _state;
 	union {
-		struct {
-			uint8_t position;
-			uint8_t length[4];
-		} uncompressedHeader;
 		struct {
 			uint16_t position, length;
 		} uncompressed;
 		struct {
-			struct _OFHuffmanTree *_Nullable litLenTree;
-			struct _OFHuffmanTree *_Nullable distTree;
-			struct _OFHuffmanTree *_Nullable codeLenTree;
-			struct _OFHuffmanTree *_Nullable treeIter;
+			uint32_t *_Nullable litLenTable;
+			uint32_t *_Nullable distTable;
+			uint32_t *_Nullable codeLenTable;
 			uint8_t *_Nullable lengths;
 			uint16_t receivedCount;
 			uint8_t value, litLenCodesCount, distCodesCount;
 			uint8_t codeLenCodesCount;
 		} huffmanTree;
 		struct {
-			struct _OFHuffmanTree *_Nullable litLenTree;
-			struct _OFHuffmanTree *_Nullable distTree;
-			struct _OFHuffmanTree *_Nullable treeIter;
+			uint32_t *_Nullable litLenTable;
+			uint32_t *_Nullable distTable;
 			int state;
 			uint16_t value, length, distance, extraBits;
 		} huffman;
 	} _context;
-	bool _inLastBlock, _atEndOfStream;
+	bool _inLastBlock, _atEndOfStream, _canInflateWithoutReading;
 }
 
 /**
@@ -26,12 +26,12 @@
 # import "OFInflate64Stream.h"
 # define OFInflateStream OFInflate64Stream
 #endif
-#import "OFHuffmanTree.h"
 
 #import "OFInitializationFailedException.h"
 #import "OFInvalidFormatException.h"
 #import "OFNotOpenException.h"
 #import "OFOutOfMemoryException.h"
+#import "OFTruncatedDataException.h"
 
 #ifndef OF_INFLATE64_STREAM_M
 # define bufferSize OFInflateStreamBufferSize
@@ -99,49 +99,295 @@ static const uint8_t distanceExtraBits[32] = {
 static const uint8_t codeLengthsOrder[19] = {
 	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
 };
-static OFHuffmanTree fixedLitLenTree, fixedDistTree;
+
+/*
+ * Huffman codes are decoded by looking up the next bits of the input in a
+ * table. Codes that are longer than the table's index need a second lookup in
+ * a subtable.
+ *
+ * The lower 16 bits of an entry are the symbol and the next 8 bits the length
+ * of its code. If tableLinkFlag is set, the lower 16 bits are instead the
+ * offset of a subtable and the next 8 bits the length of its index. Entries
+ * for codes that do not exist are 0.
+ */
+static const uint32_t tableLinkFlag = 0x80000000;
+static const uint8_t maxCodeLength = 15;
+static const uint8_t maxTableBits = 9;
+static const uint8_t litLenTableBits = 9;
+static const uint8_t distTableBits = 6;
+static const uint8_t codeLenTableBits = 7;
+static uint32_t *fixedLitLenTable, *fixedDistTable;
+
+static uint16_t
+reverseBits(uint16_t code, uint8_t length)
+{
+	uint16_t ret = 0;
+
+	for (uint_fast8_t i = 0; i < length; i++) {
+		ret = (ret << 1) | (code & 1);
+		code >>= 1;
+	}
+
+	return ret;
+}
+
+static uint32_t *
+newTable(const uint8_t *lengths, uint16_t count, uint8_t tableBits)
+{
+	uint16_t lengthCount[16] = { 0 }, nextCode[16], firstCode[16];
+	uint8_t subtableBits[1 << maxTableBits];
+	size_t tableSize = (size_t)1 << tableBits, totalSize;
+	uint16_t code;
+	int_fast32_t left;
+	uint32_t *table;
+
+	assert(tableBits <= maxTableBits);
+
+	for (uint16_t i = 0; i < count; i++) {
+		if OF_UNLIKELY (lengths[i] > maxCodeLength)
+			@throw [OFInvalidFormatException exception];
+
+		lengthCount[lengths[i]]++;
+	}
+	lengthCount[0] = 0;
+
+	/* Incomplete codes are allowed, but not over-subscribed ones. */
+	left = 1;
+	for (uint_fast8_t i = 1; i <= maxCodeLength; i++) {
+		left = (left << 1) - lengthCount[i];
+
+		if OF_UNLIKELY (left < 0)
+			@throw [OFInvalidFormatException exception];
+	}
+
+	code = 0;
+	firstCode[0] = 0;
+	for (uint_fast8_t i = 1; i <= maxCodeLength; i++) {
+		code = (code + lengthCount[i - 1]) << 1;
+		firstCode[i] = code;
+	}
+
+	/* Find out how large the subtable for each long prefix needs to be. */
+	memset(subtableBits, 0, tableSize);
+	memcpy(nextCode, firstCode, sizeof(nextCode));
+	for (uint16_t i = 0; i < count; i++) {
+		uint8_t length = lengths[i];
+		uint16_t prefix;
+
+		if (length <= tableBits)
+			continue;
+
+		prefix = reverseBits(nextCode[length]++, length) &
+		    (tableSize - 1);
+		if (length - tableBits > subtableBits[prefix])
+			subtableBits[prefix] = length - tableBits;
+	}
+
+	totalSize = tableSize;
+	for (size_t i = 0; i < tableSize; i++)
+		if (subtableBits[i] > 0)
+			totalSize += (size_t)1 << subtableBits[i];
+
+	table = OFAllocZeroedMemory(totalSize, sizeof(*table));
+
+	totalSize = tableSize;
+	for (size_t i = 0; i < tableSize; i++) {
+		if (subtableBits[i] == 0)
+			continue;
+
+		table[i] = tableLinkFlag | ((uint32_t)subtableBits[i] << 16) |
+		    (uint32_t)totalSize;
+		totalSize += (size_t)1 << subtableBits[i];
+	}
+
+	memcpy(nextCode, firstCode, sizeof(nextCode));
+	for (uint16_t i = 0; i < count; i++) {
+		uint8_t length = lengths[i];
+		uint32_t entry = ((uint32_t)length << 16) | i;
+		uint16_t reversed;
+
+		if (length == 0)
+			continue;
+
+		reversed = reverseBits(nextCode[length]++, length);
+
+		if (length <= tableBits) {
+			for (size_t j = reversed; j < tableSize;
+			    j += (size_t)1 << length)
+				table[j] = entry;
+		} else {
+			uint32_t link = table[reversed & (tableSize - 1)];
+			uint32_t *subtable = table + (link & 0xFFFF);
+			size_t subtableSize =
+			    (size_t)1 << ((link >> 16) & 0xFF);
+
+			for (size_t j = reversed >> tableBits;
+			    j < subtableSize;
+			    j += (size_t)1 << (length - tableBits))
+				subtable[j] = entry;
+		}
+	}
+
+	return table;
+}
+
+@interface OFInflateStream ()
+- (size_t)of_inflateIntoBuffer: (void *)buffer
+			length: (size_t)length OF_DIRECT;
+@end
 
 @implementation OFInflateStream
+static OF_INLINE void
+refillBitBuffer(OFInflateStream *stream)
+{
+	if OF_LIKELY (stream->_bufferLength - stream->_bufferIndex >= 8 &&
+	    stream->_bitBufferLength < 56) {
+		uint64_t word;
+
+		memcpy(&word, stream->_buffer + stream->_bufferIndex, 8);
+		word = OFFromLittleEndian64(word);
+
+		/* Add as many whole bytes as fit, keeping unused bits 0. */
+		stream->_bitBuffer |= word << stream->_bitBufferLength;
+		stream->_bufferIndex += (63 - stream->_bitBufferLength) >> 3;
+		stream->_bitBufferLength |= 56;
+		stream->_bitBuffer &=
+		    ((uint64_t)1 << stream->_bitBufferLength) - 1;
+
+		return;
+	}
+
+	while (stream->_bitBufferLength <= 56 &&
+	    stream->_bufferIndex < stream->_bufferLength) {
+		stream->_bitBuffer |=
+		    (uint64_t)stream->_buffer[stream->_bufferIndex++] <<
+		    stream->_bitBufferLength;
+		stream->_bitBufferLength += 8;
+	}
+}
+
+static bool
+fillBuffer(OFInflateStream *stream)
+{
+	size_t length = [stream->_stream readIntoBuffer: stream->_buffer
+						 length: bufferSize];
+
+	if OF_UNLIKELY (length < 1) {
+		if (stream->_stream.atEndOfStream)
+			@throw [OFTruncatedDataException exception];
+
+		return false;
+	}
+
+	stream->_bufferIndex = 0;
+	stream->_bufferLength = (uint16_t)length;
+
+	return true;
+}
+
+static OF_INLINE bool
+ensureBits(OFInflateStream *stream, uint8_t count)
+{
+	assert(count <= 32);
+
+	while (stream->_bitBufferLength < count) {
+		refillBitBuffer(stream);
+
+		if (stream->_bitBufferLength >= count)
+			break;
+
+		/* The buffer is empty, as we would have more bits otherwise. */
+		if OF_UNLIKELY (!fillBuffer(stream))
+			return false;
+	}
+
+	return true;
+}
+
+static OF_INLINE void
+dropBits(OFInflateStream *stream, uint8_t count)
+{
+	stream->_bitBuffer >>= count;
+	stream->_bitBufferLength -= count;
+}
+
 static OF_INLINE bool
 tryReadBits(OFInflateStream *stream, uint16_t *bits, uint8_t count)
 {
-	uint16_t ret = stream->_savedBits;
-
-	assert(stream->_savedBitsLength < count);
-
-	for (uint_fast8_t i = stream->_savedBitsLength; i < count; i++) {
-		if OF_UNLIKELY (stream->_bitIndex == 8) {
-			if OF_LIKELY (stream->_bufferIndex <
-			    stream->_bufferLength)
-				stream->_byte =
-				    stream->_buffer[stream->_bufferIndex++];
-			else {
-				size_t length = [stream->_stream
-				    readIntoBuffer: stream->_buffer
-					    length: bufferSize];
-
-				if OF_UNLIKELY (length < 1) {
-					stream->_savedBits = ret;
-					stream->_savedBitsLength = i;
-					return false;
-				}
+	if OF_UNLIKELY (!ensureBits(stream, count))
+		return false;
 
-				stream->_byte = stream->_buffer[0];
-				stream->_bufferIndex = 1;
-				stream->_bufferLength = (uint16_t)length;
-			}
+	*bits = (uint16_t)(stream->_bitBuffer & ((1u << count) - 1));
+	dropBits(stream, count);
+
+	return true;
+}
+
+static OF_INLINE bool
+tryReadSymbol(OFInflateStream *stream, const uint32_t *table,
+    uint8_t tableBits, uint16_t *symbol)
+{
+	for (;;) {
+		uint8_t neededBits = tableBits, length;
+		uint32_t entry;
 
-			stream->_bitIndex = 0;
+		refillBitBuffer(stream);
+
+		entry = table[stream->_bitBuffer & ((1u << tableBits) - 1)];
+		if (entry & tableLinkFlag) {
+			uint8_t subtableBits = (entry >> 16) & 0xFF;
+
+			neededBits += subtableBits;
+			entry = table[(entry & 0xFFFF) +
+			    ((stream->_bitBuffer >> tableBits) &
+			    ((1u << subtableBits) - 1))];
 		}
 
-		ret |= ((stream->_byte >> stream->_bitIndex++) & 1) << i;
+		/*
+		 * Near the end of the input, there can be fewer bits than the
+		 * table's index is long. The missing bits are 0, which is
+		 * fine as long as the code found is not longer than the bits
+		 * available.
+		 */
+		length = (entry >> 16) & 0xFF;
+		if OF_LIKELY (length > 0 &&
+		    length <= stream->_bitBufferLength) {
+			dropBits(stream, length);
+			*symbol = entry & 0xFFFF;
+			return true;
+		}
+
+		if OF_UNLIKELY (stream->_bitBufferLength >= neededBits)
+			@throw [OFInvalidFormatException exception];
+
+		if OF_UNLIKELY (!fillBuffer(stream))
+			return false;
 	}
+}
 
-	stream->_savedBits = 0;
-	stream->_savedBitsLength = 0;
-	*bits = ret;
+/* Gives back all bytes that have been read but not used. */
+static void
+unreadUnusedBytes(OFInflateStream *stream)
+{
+	unsigned char bytes[8];
+	uint8_t count;
 
-	return true;
+	/* The rest of a partially used byte is padding. */
+	dropBits(stream, stream->_bitBufferLength % 8);
+
+	count = stream->_bitBufferLength / 8;
+	for (uint_fast8_t i = 0; i < count; i++)
+		bytes[i] = (unsigned char)(stream->_bitBuffer >> (i * 8));
+
+	/* Unreading prepends, so this needs to be done in reverse order. */
+	[stream->_stream
+	    unreadFromBuffer: stream->_buffer + stream->_bufferIndex
+		      length: stream->_bufferLength - stream->_bufferIndex];
+	[stream->_stream unreadFromBuffer: bytes length: count];
+
+	stream->_bufferIndex = stream->_bufferLength = 0;
+	stream->_bitBuffer = 0;
+	stream->_bitBufferLength = 0;
 }
 
 + (void)initialize
@@ -160,12 +406,12 @@ tryReadBits(OFInflateStream *stream, uint16_t *bits, uint8_t count)
 	for (uint16_t i = 280; i <= 287; i++)
 		lengths[i] = 8;
 
-	fixedLitLenTree = OFHuffmanTreeNew(lengths, 288);
+	fixedLitLenTable = newTable(lengths, 288, litLenTableBits);
 
 	for (uint16_t i = 0; i <= 31; i++)
 		lengths[i] = 5;
 
-	fixedDistTree = OFHuffmanTreeNew(lengths, 32);
+	fixedDistTable = newTable(lengths, 32, distTableBits);
 }
 
 + (instancetype)streamWithStream: (OFStream *)stream
@@ -185,9 +431,6 @@ tryReadBits(OFInflateStream *stream, uint16_t *bits, uint8_t count)
 	@try {
 		_stream = [stream retain];
 
-		/* 0-7 address the bit, 8 means fetch next byte */
-		_bitIndex = 8;
-
 #ifdef OF_INFLATE64_STREAM_M
 		_slidingWindowMask = 0xFFFF;
 #else
@@ -211,23 +454,34 @@ tryReadBits(OFInflateStream *stream, uint16_t *bits, uint8_t count)
 
 	if (_state == stateHuffmanTree) {
 		OFFreeMemory(_context.huffmanTree.lengths);
-
-		if (_context.huffmanTree.codeLenTree != NULL)
-			OFHuffmanTreeFree(_context.huffmanTree.codeLenTree);
+		OFFreeMemory(_context.huffmanTree.codeLenTable);
 	}
 
 	if (_state == stateHuffmanTree || _state == stateHuffmanBlock) {
-		if (_context.huffman.litLenTree != fixedLitLenTree)
-			OFHuffmanTreeFree(_context.huffman.litLenTree);
-		if (_context.huffman.distTree != fixedDistTree)
-			OFHuffmanTreeFree(_context.huffman.distTree);
+		if (_context.huffman.litLenTable != fixedLitLenTable)
+			OFFreeMemory(_context.huffman.litLenTable);
+		if (_context.huffman.distTable != fixedDistTable)
+			OFFreeMemory(_context.huffman.distTable);
 	}
 
 	[super dealloc];
 }
 
-- (size_t)lowlevelReadIntoBuffer: (void *)buffer_
-			  length: (size_t)length
+- (size_t)lowlevelReadIntoBuffer: (void *)buffer length: (size_t)length
+{
+	size_t ret = [self of_inflateIntoBuffer: buffer length: length];
+
+	/*
+	 * Decoding only stops before the buffer is full if more input is
+	 * needed. If it is full, the bits already read might be enough to
+	 * decode more.
+	 */
+	_canInflateWithoutReading = (length > 0 && ret == length);
+
+	return ret;
+}
+
+- (size_t)of_inflateIntoBuffer: (void *)buffer_ length: (size_t)length
 {
 	unsigned char *buffer = buffer_;
 	uint16_t bits = 0, tmp, value = 0;
@@ -245,10 +499,7 @@ start:
 	switch ((enum State)_state) {
 	case stateBlockHeader:
 		if OF_UNLIKELY (_inLastBlock) {
-			[_stream unreadFromBuffer: _buffer + _bufferIndex
-					   length: _bufferLength -
-						   _bufferIndex];
-			_bufferIndex = _bufferLength = 0;
+			unreadUnusedBytes(self);
 
 			_atEndOfStream = true;
 			return bytesWritten;
@@ -262,19 +513,20 @@ start:
 		switch (bits >> 1) {
 		case 0: /* No compression */
 			_state = stateUncompressedBlockHeader;
-			_bitIndex = 8;
-			_context.uncompressedHeader.position = 0;
-			memset(_context.uncompressedHeader.length, 0, 4);
+			/* The header starts at the next byte boundary */
+			dropBits(self, _bitBufferLength % 8);
 			break;
 		case 1: /* Fixed Huffman */
 			_state = stateHuffmanBlock;
 			_context.huffman.state = huffmanStateAwaitCode;
-			_context.huffman.litLenTree = fixedLitLenTree;
-			_context.huffman.distTree = fixedDistTree;
-			_context.huffman.treeIter = fixedLitLenTree;
+			_context.huffman.litLenTable = fixedLitLenTable;
+			_context.huffman.distTable = fixedDistTable;
 			break;
 		case 2: /* Dynamic Huffman */
 			_state = stateHuffmanTree;
+			_context.huffmanTree.litLenTable = NULL;
+			_context.huffmanTree.distTable = NULL;
+			_context.huffmanTree.codeLenTable = NULL;
 			_context.huffmanTree.lengths = NULL;
 			_context.huffmanTree.receivedCount = 0;
 			_context.huffmanTree.value = 0xFE;
@@ -288,45 +540,66 @@ start:
 
 		goto start;
 	case stateUncompressedBlockHeader:
-#define CTX _context.uncompressedHeader
-		/* FIXME: This can be done more efficiently than unreading */
-		[_stream unreadFromBuffer: _buffer + _bufferIndex
-				   length: _bufferLength - _bufferIndex];
-		_bufferIndex = _bufferLength = 0;
-
-		CTX.position += [_stream
-		    readIntoBuffer: CTX.length + CTX.position
-			    length: 4 - CTX.position];
-
-		if OF_UNLIKELY (CTX.position < 4)
+		if OF_UNLIKELY (!ensureBits(self, 32))
 			return bytesWritten;
 
-		if OF_UNLIKELY ((CTX.length[0] | (CTX.length[1] << 8)) !=
-		    (uint16_t)~(CTX.length[2] | (CTX.length[3] << 8)))
+		tmp = (uint16_t)_bitBuffer;
+		if OF_UNLIKELY (tmp != (uint16_t)~(_bitBuffer >> 16))
 			@throw [OFInvalidFormatException exception];
 
-		_state = stateUncompressedBlock;
+		dropBits(self, 32);
 
-		/*
-		 * Do not reorder! _context.uncompressed.position and
-		 * _context.uncompressedHeader.length overlap!
-		 */
-		_context.uncompressed.length =
-		    CTX.length[0] | (CTX.length[1] << 8);
+		_state = stateUncompressedBlock;
+		_context.uncompressed.length = tmp;
 		_context.uncompressed.position = 0;
 
 		goto start;
-#undef CTX
 	case stateUncompressedBlock:
 #define CTX _context.uncompressed
+		if OF_UNLIKELY (CTX.position == CTX.length) {
+			_state = stateBlockHeader;
+			goto start;
+		}
+
 		if OF_UNLIKELY (length == 0)
 			return bytesWritten;
 
 		tmp = (length < (size_t)CTX.length - CTX.position
 		    ? (uint16_t)length : CTX.length - CTX.position);
 
-		tmp = (uint16_t)[_stream readIntoBuffer: buffer + bytesWritten
-						 length: tmp];
+		/*
+		 * Bytes already in the bit buffer or our buffer need to be
+		 * used up before reading from the underlying stream again.
+		 */
+		if (_bitBufferLength > 0) {
+			if (tmp > _bitBufferLength / 8)
+				tmp = _bitBufferLength / 8;
+
+			for (uint_fast16_t i = 0; i < tmp; i++) {
+				buffer[bytesWritten + i] =
+				    (unsigned char)_bitBuffer;
+				dropBits(self, 8);
+			}
+		} else if (_bufferIndex < _bufferLength) {
+			if (tmp > _bufferLength - _bufferIndex)
+				tmp = _bufferLength - _bufferIndex;
+
+			memcpy(buffer + bytesWritten, _buffer + _bufferIndex,
+			    tmp);
+			_bufferIndex += tmp;
+		} else {
+			tmp = (uint16_t)[_stream
+			    readIntoBuffer: buffer + bytesWritten
+				    length: tmp];
+
+			if OF_UNLIKELY (tmp == 0) {
+				if (_stream.atEndOfStream)
+					@throw [OFTruncatedDataException
+					    exception];
+
+				return bytesWritten;
+			}
+		}
 
 		slidingWindow = _slidingWindow;
 		slidingWindowIndex = _slidingWindowIndex;
@@ -342,8 +615,6 @@ start:
 		bytesWritten += tmp;
 
 		CTX.position += tmp;
-		if OF_UNLIKELY (CTX.position == CTX.length)
-			_state = stateBlockHeader;
 
 		goto start;
 #undef CTX
@@ -388,8 +659,8 @@ start:
 				CTX.lengths[codeLengthsOrder[i]] = bits;
 			}
 
-			CTX.codeLenTree = OFHuffmanTreeNew(CTX.lengths, 19);
-			CTX.treeIter = CTX.codeLenTree;
+			CTX.codeLenTable = newTable(CTX.lengths, 19,
+			    codeLenTableBits);
 
 			OFFreeMemory(CTX.lengths);
 			CTX.lengths = NULL;
@@ -406,14 +677,13 @@ start:
 			uint8_t j, count;
 
 			if OF_LIKELY (CTX.value == 0xFF) {
-				if OF_UNLIKELY (!OFHuffmanTreeWalk(self,
-				    tryReadBits, &CTX.treeIter, &value)) {
+				if OF_UNLIKELY (!tryReadSymbol(self,
+				    CTX.codeLenTable, codeLenTableBits,
+				    &value)) {
 					CTX.receivedCount = i;
 					return bytesWritten;
 				}
 
-				CTX.treeIter = CTX.codeLenTree;
-
 				if (value < 16) {
 					CTX.lengths[i++] = value;
 					continue;
@@ -473,25 +743,24 @@ start:
 			CTX.value = 0xFF;
 		}
 
-		OFHuffmanTreeFree(CTX.codeLenTree);
-		CTX.codeLenTree = NULL;
+		OFFreeMemory(CTX.codeLenTable);
+		CTX.codeLenTable = NULL;
 
-		CTX.litLenTree = OFHuffmanTreeNew(CTX.lengths,
-		    CTX.litLenCodesCount + 257);
-		CTX.distTree = OFHuffmanTreeNew(
+		CTX.litLenTable = newTable(CTX.lengths,
+		    CTX.litLenCodesCount + 257, litLenTableBits);
+		CTX.distTable = newTable(
 		    CTX.lengths + CTX.litLenCodesCount + 257,
-		    CTX.distCodesCount + 1);
+		    CTX.distCodesCount + 1, distTableBits);
 
 		OFFreeMemory(CTX.lengths);
 
 		/*
-		 * litLenTree and distTree are at the same location in
+		 * litLenTable and distTable are at the same location in
 		 * _context.huffman and _context.huffmanTree, thus no need to
 		 * set them.
 		 */
 		_state = stateHuffmanBlock;
 		_context.huffman.state = huffmanStateAwaitCode;
-		_context.huffman.treeIter = CTX.litLenTree;
 
 		goto start;
 #undef CTX
@@ -513,7 +782,6 @@ start:
 				    _slidingWindowMask;
 
 				CTX.state = huffmanStateAwaitCode;
-				CTX.treeIter = CTX.litLenTree;
 			}
 
 			if OF_UNLIKELY (CTX.state ==
@@ -525,13 +793,12 @@ start:
 				CTX.length += bits;
 
 				CTX.state = huffmanStateAwaitDistance;
-				CTX.treeIter = CTX.distTree;
 			}
 
 			/* Distance of length distance pair */
 			if (CTX.state == huffmanStateAwaitDistance) {
-				if OF_UNLIKELY (!OFHuffmanTreeWalk(self,
-				    tryReadBits, &CTX.treeIter, &value))
+				if OF_UNLIKELY (!tryReadSymbol(self,
+				    CTX.distTable, distTableBits, &value))
 					return bytesWritten;
 
 				if OF_UNLIKELY (value >= numDistanceCodes)
@@ -591,19 +858,18 @@ start:
 				}
 
 				CTX.state = huffmanStateAwaitCode;
-				CTX.treeIter = CTX.litLenTree;
 			}
 
-			if OF_UNLIKELY (!OFHuffmanTreeWalk(self, tryReadBits,
-			    &CTX.treeIter, &value))
+			if OF_UNLIKELY (!tryReadSymbol(self, CTX.litLenTable,
+			    litLenTableBits, &value))
 				return bytesWritten;
 
 			/* End of block */
 			if OF_UNLIKELY (value == 256) {
-				if (CTX.litLenTree != fixedLitLenTree)
-					OFHuffmanTreeFree(CTX.litLenTree);
-				if (CTX.distTree != fixedDistTree)
-					OFHuffmanTreeFree(CTX.distTree);
+				if (CTX.litLenTable != fixedLitLenTable)
+					OFFreeMemory(CTX.litLenTable);
+				if (CTX.distTable != fixedDistTable)
+					OFFreeMemory(CTX.distTable);
 
 				_state = stateBlockHeader;
 				goto start;
@@ -625,7 +891,6 @@ start:
 				    (_slidingWindowIndex + 1) &
 				    _slidingWindowMask;
 
-				CTX.treeIter = CTX.litLenTree;
 				continue;
 			}
 
@@ -649,7 +914,6 @@ start:
 				CTX.length += bits;
 			}
 
-			CTX.treeIter = CTX.distTree;
 			CTX.state = huffmanStateAwaitDistance;
 		}
 
@@ -677,7 +941,7 @@ start:
 - (bool)hasDataInReadBuffer
 {
 	return (super.hasDataInReadBuffer || _stream.hasDataInReadBuffer ||
-	    _bufferLength - _bufferIndex > 0);
+	    _bufferLength - _bufferIndex > 0 || _canInflateWithoutReading);
 }
 
 - (void)close
@@ -686,9 +950,7 @@ start:
 		@throw [OFNotOpenException exceptionWithObject: self];
 
 	/* Give back our buffer to the stream, in case it's shared */
-	[_stream unreadFromBuffer: _buffer + _bufferIndex
-			   length: _bufferLength - _bufferIndex];
-	_bufferIndex = _bufferLength = 0;
+	unreadUnusedBytes(self);
 
 	[_stream release];
 	_stream = nil;
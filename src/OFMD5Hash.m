@@ -17,8 +17,16 @@
 
 #include <string.h>
 
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
+
 #import "OFMD5Hash.h"
+#import "OFMultiBufferHash.h"
 #import "OFSecureData.h"
+#ifdef HAVE_AVX2_INTRINSICS
+# import "OFSystemInfo.h"
+#endif
 
 #import "OFHashAlreadyCalculatedException.h"
 #import "OFHashNotCalculatedException.h"
@@ -26,6 +34,9 @@
 
 static const size_t digestSize = 16;
 static const size_t blockSize = 64;
+static const uint32_t initialState[] = {
+	0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476
+};
 
 OF_DIRECT_MEMBERS
 @interface OFMD5Hash ()
@@ -123,6 +134,84 @@ processBlock(uint32_t *state, uint32_t *buffer)
 	state[3] += new[3];
 }
 
+static void
+hashMessage(uint32_t *state, const unsigned char *bytes, size_t length)
+{
+	size_t blocksCount = OFMultiBufferHashMessageBlocksCount(length);
+	unsigned char padding[64];
+	uint32_t buffer[16];
+
+	for (size_t i = 0; i < blocksCount; i++) {
+		memcpy(buffer, OFMultiBufferHashMessageBlock(bytes, length, i,
+		    padding, false), 64);
+		processBlock(state, buffer);
+	}
+
+	OFZeroMemory(padding, sizeof(padding));
+	OFZeroMemory(buffer, sizeof(buffer));
+}
+
+#ifdef HAVE_AVX2_INTRINSICS
+static signed char multiBufferSupported = -1;
+
+static OF_INLINE bool
+useMultiBuffer(void)
+{
+	if OF_UNLIKELY (multiBufferSupported == -1)
+		multiBufferSupported = [OFSystemInfo supportsAVX2];
+
+	return multiBufferSupported;
+}
+
+/* The lane layout of processBlock for OFMultiBufferHashInLanes(). */
+static __attribute__((__target__("avx2"))) void
+processBlocksAVX2(uint32_t state[8][8], uint32_t words[16][8])
+{
+	const __m256i ones = _mm256_set1_epi32(-1);
+	__m256i new[4];
+	uint_fast8_t i;
+
+	for (i = 0; i < 4; i++)
+		new[i] = _mm256_loadu_si256(
+		    (const __m256i *)(const void *)state[i]);
+
+	for (i = 0; i < 64; i++) {
+		uint_fast8_t bits = rotateBits[(i % 4) + (i / 16) * 4];
+		__m256i f, tmp = new[3];
+
+		if (i < 16)
+			f = _mm256_or_si256(_mm256_and_si256(new[1], new[2]),
+			    _mm256_andnot_si256(new[1], new[3]));
+		else if (i < 32)
+			f = _mm256_or_si256(_mm256_and_si256(new[1], new[3]),
+			    _mm256_andnot_si256(new[3], new[2]));
+		else if (i < 48)
+			f = _mm256_xor_si256(_mm256_xor_si256(new[1], new[2]),
+			    new[3]);
+		else
+			f = _mm256_xor_si256(new[2], _mm256_or_si256(new[1],
+			    _mm256_xor_si256(new[3], ones)));
+
+		new[0] = _mm256_add_epi32(_mm256_add_epi32(new[0], f),
+		    _mm256_add_epi32(_mm256_loadu_si256(
+		    (const __m256i *)(const void *)words[wordOrder[i]]),
+		    _mm256_set1_epi32((int)table[i])));
+		new[0] = _mm256_or_si256(
+		    _mm256_sll_epi32(new[0], _mm_cvtsi32_si128(bits)),
+		    _mm256_srl_epi32(new[0], _mm_cvtsi32_si128(32 - bits)));
+		new[3] = new[2];
+		new[2] = new[1];
+		new[1] = _mm256_add_epi32(new[1], new[0]);
+		new[0] = tmp;
+	}
+
+	for (i = 0; i < 4; i++)
+		_mm256_storeu_si256((__m256i *)(void *)state[i],
+		    _mm256_add_epi32(_mm256_loadu_si256(
+		    (const __m256i *)(const void *)state[i]), new[i]));
+}
+#endif
+
 @implementation OFMD5Hash
 @synthesize calculated = _calculated;
 @synthesize allowsSwappableMemory = _allowsSwappableMemory;
@@ -143,6 +232,35 @@ processBlock(uint32_t *state, uint32_t *buffer)
 	    allowsSwappableMemory] autorelease];
 }
 
++ (void)hashBuffers: (const void *const *)buffers
+	    lengths: (const size_t *)lengths
+	      count: (size_t)count
+	    digests: (unsigned char *)digests
+{
+	uint32_t state[4];
+
+	for (size_t i = 0; i < count; i++)
+		if (lengths[i] > SIZE_MAX / 8)
+			@throw [OFOutOfRangeException exception];
+
+#ifdef HAVE_AVX2_INTRINSICS
+	if (count > 1 && useMultiBuffer()) {
+		OFMultiBufferHashInLanes(processBlocksAVX2, initialState, 4,
+		    false, buffers, lengths, count, digests, digestSize);
+		return;
+	}
+#endif
+
+	for (size_t i = 0; i < count; i++) {
+		memcpy(state, initialState, sizeof(state));
+		hashMessage(state, buffers[i], lengths[i]);
+		OFMultiBufferHashStoreDigest(state, digests + i * digestSize,
+		    digestSize, false);
+	}
+
+	OFZeroMemory(state, sizeof(state));
+}
+
 - (instancetype)initWithAllowsSwappableMemory: (bool)allowsSwappableMemory
 {
 	self = [super init];
@@ -204,10 +322,7 @@ processBlock(uint32_t *state, uint32_t *buffer)
 
 - (void)of_resetState
 {
-	_iVars->state[0] = 0x67452301;
-	_iVars->state[1] = 0xEFCDAB89;
-	_iVars->state[2] = 0x98BADCFE;
-	_iVars->state[3] = 0x10325476;
+	memcpy(_iVars->state, initialState, sizeof(initialState));
 }
 
 - (void)updateWithBuffer: (const void *)buffer_ length: (size_t)length
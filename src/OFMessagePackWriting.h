@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#import "OFObject.h"
+
+OF_ASSUME_NONNULL_BEGIN
+
+@class OFStream;
+
+/*
+ * Helpers shared by the classes implementing -[messagePackRepresentation] and
+ * -[writeMessagePackToStream:].
+ *
+ * The header functions write the MessagePack header for an array, map, string
+ * or binary of the specified count or length into header, which needs to be
+ * at least 5 bytes, and return the length of the header. They throw an
+ * OFOutOfRangeException if the count or length is too big for MessagePack.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern size_t OFMessagePackArrayHeader(size_t count, uint8_t *header);
+extern size_t OFMessagePackMapHeader(size_t count, uint8_t *header);
+extern size_t OFMessagePackStringHeader(size_t length, uint8_t *header);
+extern size_t OFMessagePackBinaryHeader(size_t length, uint8_t *header);
+
+/*
+ * Writes the MessagePack representation of the object to the stream, without
+ * creating it as OFData first if the object supports that.
+ */
+extern void OFMessagePackWriteObject(id object, OFStream *stream);
+#ifdef __cplusplus
+}
+#endif
+
+OF_ASSUME_NONNULL_END
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#import "OFMessagePackWriting.h"
+#import "OFData.h"
+#import "OFMessagePackRepresentation.h"
+#import "OFStream.h"
+
+#import "OFOutOfRangeException.h"
+
+/*
+ * Writes a header with a length of 8, 16 or 32 bits, using the smallest type
+ * available. A type of 0 means there is no 8 bit variant.
+ */
+static size_t
+sizedHeader(size_t length, uint8_t *header, uint8_t type8, uint8_t type16,
+    uint8_t type32)
+{
+	if (type8 != 0 && length <= UINT8_MAX) {
+		header[0] = type8;
+		header[1] = (uint8_t)length;
+		return 2;
+	} else if (length <= UINT16_MAX) {
+		uint16_t tmp = OFToBigEndian16((uint16_t)length);
+
+		header[0] = type16;
+		memcpy(header + 1, &tmp, sizeof(tmp));
+		return 3;
+	} else if (length <= UINT32_MAX) {
+		uint32_t tmp = OFToBigEndian32((uint32_t)length);
+
+		header[0] = type32;
+		memcpy(header + 1, &tmp, sizeof(tmp));
+		return 5;
+	} else
+		@throw [OFOutOfRangeException exception];
+}
+
+size_t
+OFMessagePackArrayHeader(size_t count, uint8_t *header)
+{
+	if (count <= 15) {
+		header[0] = 0x90 | ((uint8_t)count & 0xF);
+		return 1;
+	}
+
+	return sizedHeader(count, header, 0, 0xDC, 0xDD);
+}
+
+size_t
+OFMessagePackMapHeader(size_t count, uint8_t *header)
+{
+	if (count <= 15) {
+		header[0] = 0x80 | ((uint8_t)count & 0xF);
+		return 1;
+	}
+
+	return sizedHeader(count, header, 0, 0xDE, 0xDF);
+}
+
+size_t
+OFMessagePackStringHeader(size_t length, uint8_t *header)
+{
+	if (length <= 31) {
+		header[0] = 0xA0 | ((uint8_t)length & 0x1F);
+		return 1;
+	}
+
+	return sizedHeader(length, header, 0xD9, 0xDA, 0xDB);
+}
+
+size_t
+OFMessagePackBinaryHeader(size_t length, uint8_t *header)
+{
+	return sizedHeader(length, header, 0xC4, 0xC5, 0xC6);
+}
+
+void
+OFMessagePackWriteObject(id object, OFStream *stream)
+{
+	void *pool;
+
+	if ([object respondsToSelector: @selector(writeMessagePackToStream:)]) {
+		[object writeMessagePackToStream: stream];
+		return;
+	}
+
+	pool = objc_autoreleasePoolPush();
+	[stream writeData: [object messagePackRepresentation]];
+	objc_autoreleasePoolPop(pool);
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#import "macros.h"
+
+OF_ASSUME_NONNULL_BEGIN
+
+/*
+ * Helpers shared by the implementations of
+ * +[OFCryptographicHash hashBuffers:lengths:count:digests:] for hashes using
+ * 64 byte blocks of 32 bit words and Merkle–Damgård padding, which are MD5,
+ * SHA-1 and SHA-224/256. They only differ in byte order, which is little
+ * endian for MD5 and big endian for the others.
+ */
+
+/*
+ * Processes one block for each of 8 messages at once. Both the state and the
+ * words of the blocks are interleaved, with the lane as the inner index. The
+ * words are already in host byte order.
+ */
+typedef void (*OFMultiBufferHashLanesFunction)(uint32_t state[_Nonnull 8][8],
+    uint32_t words[_Nonnull 16][8]);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/*
+ * Returns the specified block of the padded message. This either points into
+ * the message or to the padding, which needs to be 64 bytes.
+ */
+extern const unsigned char *_Nonnull OFMultiBufferHashMessageBlock(
+    const unsigned char *_Nonnull bytes, size_t length, size_t block,
+    unsigned char *_Nonnull padding, bool bigEndian);
+
+/* Returns the number of blocks of the padded message. */
+extern size_t OFMultiBufferHashMessageBlocksCount(size_t length);
+
+/* Writes the first digestSize / 4 words of the state to digest. */
+extern void OFMultiBufferHashStoreDigest(const uint32_t *_Nonnull state,
+    unsigned char *_Nonnull digest, size_t digestSize, bool bigEndian);
+
+/*
+ * Hashes the messages in 8 lanes using processLanes, which uses the first
+ * stateWords rows of the state. Whenever a message is finished, its lane is
+ * refilled with the next message, so that messages of different lengths keep
+ * all lanes busy.
+ */
+extern void OFMultiBufferHashInLanes(
+    OFMultiBufferHashLanesFunction _Nonnull processLanes,
+    const uint32_t *_Nonnull initialState, size_t stateWords, bool bigEndian,
+    const void *_Nonnull const *_Nonnull buffers,
+    const size_t *_Nonnull lengths, size_t count,
+    unsigned char *_Nonnull digests, size_t digestSize);
+#ifdef __cplusplus
+}
+#endif
+
+OF_ASSUME_NONNULL_END
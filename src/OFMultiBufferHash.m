@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#import "OFMultiBufferHash.h"
+
+const unsigned char *
+OFMultiBufferHashMessageBlock(const unsigned char *bytes, size_t length,
+    size_t block, unsigned char *padding, bool bigEndian)
+{
+	size_t tailLength = length % 64;
+	uint64_t bits;
+
+	if (block < length / 64)
+		return bytes + block * 64;
+
+	memset(padding, 0, 64);
+
+	if (block == length / 64) {
+		memcpy(padding, bytes + block * 64, tailLength);
+		padding[tailLength] = 0x80;
+
+		if (tailLength >= 56)
+			return padding;
+	}
+
+	bits = (bigEndian
+	    ? OFToBigEndian64((uint64_t)length * 8)
+	    : OFToLittleEndian64((uint64_t)length * 8));
+	memcpy(padding + 56, &bits, 8);
+
+	return padding;
+}
+
+size_t
+OFMultiBufferHashMessageBlocksCount(size_t length)
+{
+	return length / 64 + (length % 64 < 56 ? 1 : 2);
+}
+
+void
+OFMultiBufferHashStoreDigest(const uint32_t *state, unsigned char *digest,
+    size_t digestSize, bool bigEndian)
+{
+	for (size_t i = 0; i < digestSize / 4; i++) {
+		uint32_t word = (bigEndian
+		    ? OFToBigEndian32(state[i]) : OFToLittleEndian32(state[i]));
+
+		memcpy(digest + i * 4, &word, 4);
+	}
+}
+
+void
+OFMultiBufferHashInLanes(OFMultiBufferHashLanesFunction processLanes,
+    const uint32_t *initialState, size_t stateWords, bool bigEndian,
+    const void *const *buffers, const size_t *lengths, size_t count,
+    unsigned char *digests, size_t digestSize)
+{
+	struct {
+		size_t message, block, blocksCount;
+		bool active;
+	} lanes[8];
+	uint32_t state[8][8], words[16][8], laneState[8];
+	unsigned char padding[64];
+	size_t next = 0;
+	uint_fast8_t activeLanes = 0;
+
+	memset(state, 0, sizeof(state));
+
+	for (uint_fast8_t lane = 0; lane < 8; lane++) {
+		lanes[lane].active = (next < count);
+
+		if (!lanes[lane].active)
+			continue;
+
+		lanes[lane].message = next;
+		lanes[lane].block = 0;
+		lanes[lane].blocksCount =
+		    OFMultiBufferHashMessageBlocksCount(lengths[next]);
+		for (size_t i = 0; i < stateWords; i++)
+			state[i][lane] = initialState[i];
+
+		next++;
+		activeLanes++;
+	}
+
+	while (activeLanes > 0) {
+		for (uint_fast8_t lane = 0; lane < 8; lane++) {
+			const unsigned char *block;
+
+			if (!lanes[lane].active) {
+				for (uint_fast8_t i = 0; i < 16; i++)
+					words[i][lane] = 0;
+
+				continue;
+			}
+
+			block = OFMultiBufferHashMessageBlock(
+			    buffers[lanes[lane].message],
+			    lengths[lanes[lane].message], lanes[lane].block,
+			    padding, bigEndian);
+
+			for (uint_fast8_t i = 0; i < 16; i++) {
+				uint32_t word;
+
+				memcpy(&word, block + i * 4, 4);
+				words[i][lane] = (bigEndian
+				    ? OFFromBigEndian32(word)
+				    : OFFromLittleEndian32(word));
+			}
+		}
+
+		processLanes(state, words);
+
+		for (uint_fast8_t lane = 0; lane < 8; lane++) {
+			if (!lanes[lane].active ||
+			    ++lanes[lane].block < lanes[lane].blocksCount)
+				continue;
+
+			for (size_t i = 0; i < stateWords; i++)
+				laneState[i] = state[i][lane];
+
+			OFMultiBufferHashStoreDigest(laneState,
+			    digests + lanes[lane].message * digestSize,
+			    digestSize, bigEndian);
+
+			if (next < count) {
+				lanes[lane].message = next;
+				lanes[lane].block = 0;
+				lanes[lane].blocksCount =
+				    OFMultiBufferHashMessageBlocksCount(
+				    lengths[next]);
+				for (size_t i = 0; i < stateWords; i++)
+					state[i][lane] = initialState[i];
+
+				next++;
+			} else {
+				lanes[lane].active = false;
+				activeLanes--;
+			}
+		}
+	}
+
+	OFZeroMemory(state, sizeof(state));
+	OFZeroMemory(words, sizeof(words));
+	OFZeroMemory(laneState, sizeof(laneState));
+	OFZeroMemory(padding, sizeof(padding));
+}
@@ -24,6 +24,9 @@ OF_ASSUME_NONNULL_BEGIN
 	OFMutableData *_array;
 	unsigned long _mutations;
 }
+
+/* The objects, which can be rearranged in place, e.g. for sorting them. */
+- (id *)of_mutableObjects OF_DIRECT;
 @end
 
 OF_ASSUME_NONNULL_END
@@ -278,6 +278,11 @@
 	objects[idx2] = tmp;
 }
 
+- (id *)of_mutableObjects
+{
+	return _array.mutableItems;
+}
+
 - (void)reverse
 {
 	id *objects = _array.mutableItems;
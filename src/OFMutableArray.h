@@ -213,6 +213,39 @@ typedef id _Nonnull (^OFArrayReplaceBlock)(id object, size_t index);
 		    options: (OFArraySortOptions)options;
 #endif
 
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_BLOCKS)
+/**
+ * @brief Sorts the array using the specified selector and options, sorting
+ *	  parts of large arrays concurrently on the specified thread pool and
+ *	  then merging them.
+ *
+ * The selector is performed from multiple threads concurrently.
+ *
+ * @param threadPool The thread pool to sort the array on
+ * @param selector The selector to use to sort the array. It's signature
+ *		   should be the same as that of -[compare:].
+ * @param options The options to use when sorting the array
+ */
+- (void)sortConcurrentlyOnThreadPool: (OFThreadPool *)threadPool
+		       usingSelector: (SEL)selector
+			     options: (OFArraySortOptions)options;
+
+/**
+ * @brief Sorts the array using the specified comparator and options, sorting
+ *	  parts of large arrays concurrently on the specified thread pool and
+ *	  then merging them.
+ *
+ * The comparator is called from multiple threads concurrently.
+ *
+ * @param threadPool The thread pool to sort the array on
+ * @param comparator The comparator to use to sort the array
+ * @param options The options to use when sorting the array
+ */
+- (void)sortConcurrentlyOnThreadPool: (OFThreadPool *)threadPool
+		     usingComparator: (OFComparator)comparator
+			     options: (OFArraySortOptions)options;
+#endif
+
 /**
  * @brief Reverts the order of the objects in the array.
  */
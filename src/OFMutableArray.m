@@ -21,7 +21,11 @@
 #include <assert.h>
 
 #import "OFMutableArray.h"
+#import "OFArray+Private.h"
 #import "OFMutableAdjacentArray.h"
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_BLOCKS)
+# import "OFThreadPool.h"
+#endif
 
 #import "OFEnumerationMutationException.h"
 #import "OFInvalidArgumentException.h"
@@ -34,108 +38,624 @@ static struct {
 @interface OFMutableArrayPlaceholder: OFMutableArray
 @end
 
-static OFComparisonResult
-compare(id left, id right, SEL selector)
+typedef struct {
+	SEL selector;
+	/* The last class compared and its method, to avoid looking it up */
+	Class class;
+	OFComparisonResult (*method)(id, SEL, id);
+#ifdef OF_HAVE_BLOCKS
+	OFComparator comparator;
+#endif
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_BLOCKS)
+	OFThreadPool *threadPool;
+#endif
+	/* The result meaning that left comes before right */
+	OFComparisonResult ascending;
+	bool stable;
+} SortContext;
+
+/* Ranges shorter than this are sorted using insertion sort. */
+static const size_t insertionSortThreshold = 24;
+/* Ranges longer than this use the median of three medians as pivot. */
+static const size_t nintherThreshold = 128;
+/* Partial insertion sort gives up after moving this many objects. */
+static const size_t partialInsertionSortLimit = 8;
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_BLOCKS)
+/* Arrays are not split into chunks smaller than this for sorting. */
+static const size_t concurrentSortMinChunkSize = 4096;
+#endif
+
+static OF_INLINE bool
+isLess(SortContext *context, id left, id right)
+{
+	OFComparisonResult result;
+
+#ifdef OF_HAVE_BLOCKS
+	if (context->comparator != NULL)
+		result = context->comparator(left, right);
+	else {
+#endif
+		Class class = object_getClass(left);
+
+		if OF_UNLIKELY (class != context->class) {
+			context->method = (OFComparisonResult (*)(id, SEL, id))
+			    [left methodForSelector: context->selector];
+			context->class = class;
+		}
+
+		result = context->method(left, context->selector, right);
+#ifdef OF_HAVE_BLOCKS
+	}
+#endif
+
+	return (result == context->ascending);
+}
+
+/*
+ * The sorting functions below only swap objects in place, so that an exception
+ * thrown by a comparison never loses or duplicates an object. They also check
+ * all bounds, so that inconsistent comparisons can not make them leave the
+ * range that is being sorted.
+ */
+static OF_INLINE void
+swapObjects(id *objects, size_t i, size_t j)
 {
-	OFComparisonResult (*comparator)(id, SEL, id) =
-	    (OFComparisonResult (*)(id, SEL, id))
-	    [left methodForSelector: selector];
+	id tmp = objects[i];
 
-	return comparator(left, selector, right);
+	objects[i] = objects[j];
+	objects[j] = tmp;
 }
 
 static void
-quicksort(OFMutableArray *array, size_t left, size_t right, SEL selector,
-    OFArraySortOptions options)
+insertionSort(id *objects, size_t count, SortContext *context)
+{
+	for (size_t i = 1; i < count; i++)
+		for (size_t j = i; j > 0 &&
+		    isLess(context, objects[j], objects[j - 1]); j--)
+			swapObjects(objects, j, j - 1);
+}
+
+/*
+ * Like insertionSort, but gives up if too many objects are out of order.
+ * Returns whether the objects have been sorted.
+ */
+static bool
+partialInsertionSort(id *objects, size_t count, SortContext *context)
 {
-	OFComparisonResult ascending, descending;
+	size_t moved = 0;
 
-	if (options & OFArraySortDescending) {
-		ascending = OFOrderedDescending;
-		descending = OFOrderedAscending;
-	} else {
-		ascending = OFOrderedAscending;
-		descending = OFOrderedDescending;
+	for (size_t i = 1; i < count; i++) {
+		size_t j;
+
+		if (moved > partialInsertionSortLimit)
+			return false;
+
+		for (j = i; j > 0 &&
+		    isLess(context, objects[j], objects[j - 1]); j--)
+			swapObjects(objects, j, j - 1);
+
+		moved += i - j;
 	}
 
-	while (left < right) {
-		size_t i = left;
-		size_t j = right - 1;
-		id pivot = [array objectAtIndex: right];
+	return true;
+}
 
-		do {
-			while (compare([array objectAtIndex: i], pivot,
-			    selector) != descending && i < right)
-				i++;
+static void
+siftDown(id *objects, size_t i, size_t count, SortContext *context)
+{
+	for (;;) {
+		size_t child = 2 * i + 1;
 
-			while (compare([array objectAtIndex: j], pivot,
-			    selector) != ascending && j > left)
-				j--;
+		if (child >= count)
+			return;
 
-			if (i < j)
-				[array exchangeObjectAtIndex: i
-					   withObjectAtIndex: j];
-		} while (i < j);
+		if (child + 1 < count &&
+		    isLess(context, objects[child], objects[child + 1]))
+			child++;
 
-		if (compare([array objectAtIndex: i], pivot, selector) ==
-		    descending)
-			[array exchangeObjectAtIndex: i
-				   withObjectAtIndex: right];
+		if (!isLess(context, objects[i], objects[child]))
+			return;
+
+		swapObjects(objects, i, child);
+		i = child;
+	}
+}
 
-		if (i > 0)
-			quicksort(array, left, i - 1, selector, options);
+static void
+heapSort(id *objects, size_t count, SortContext *context)
+{
+	for (size_t i = count / 2; i > 0; i--)
+		siftDown(objects, i - 1, count, context);
 
-		left = i + 1;
+	for (size_t i = count - 1; i > 0; i--) {
+		swapObjects(objects, 0, i);
+		siftDown(objects, 0, i, context);
 	}
 }
 
-#ifdef OF_HAVE_BLOCKS
+static OF_INLINE void
+sort2(id *objects, size_t i, size_t j, SortContext *context)
+{
+	if (isLess(context, objects[j], objects[i]))
+		swapObjects(objects, i, j);
+}
+
+static OF_INLINE void
+sort3(id *objects, size_t i, size_t j, size_t k, SortContext *context)
+{
+	sort2(objects, i, j, context);
+	sort2(objects, j, k, context);
+	sort2(objects, i, j, context);
+}
+
+/*
+ * Partitions the objects around the pivot in objects[0], putting objects equal
+ * to the pivot to the right, and returns the new index of the pivot.
+ */
+static size_t
+partitionRight(id *objects, size_t count, SortContext *context,
+    bool *alreadyPartitioned)
+{
+	id pivot = objects[0];
+	size_t first = 0, last = count;
+
+	while (++first < count && isLess(context, objects[first], pivot));
+
+	if (first == 1)
+		while (first < last &&
+		    !isLess(context, objects[--last], pivot));
+	else
+		while (last > 1 && !isLess(context, objects[--last], pivot));
+
+	*alreadyPartitioned = (first >= last);
+
+	while (first < last) {
+		swapObjects(objects, first, last);
+
+		while (++first < count &&
+		    isLess(context, objects[first], pivot));
+		while (last > 1 && !isLess(context, objects[--last], pivot));
+	}
+
+	swapObjects(objects, 0, first - 1);
+
+	return first - 1;
+}
+
+/*
+ * Partitions the objects around the pivot in objects[0], putting objects equal
+ * to the pivot to the left, and returns the new index of the pivot. This is
+ * used if the pivot is equal to the object right before the range, as then
+ * there are no smaller objects and many equal ones can be skipped at once.
+ */
+static size_t
+partitionLeft(id *objects, size_t count, SortContext *context)
+{
+	id pivot = objects[0];
+	size_t first = 0, last = count;
+
+	while (last > 1 && isLess(context, pivot, objects[--last]));
+
+	if (last + 1 == count)
+		while (first < last &&
+		    !isLess(context, pivot, objects[++first]));
+	else
+		while (first + 1 < count &&
+		    !isLess(context, pivot, objects[++first]));
+
+	while (first < last) {
+		swapObjects(objects, first, last);
+
+		while (last > 1 && isLess(context, pivot, objects[--last]));
+		while (first + 1 < count &&
+		    !isLess(context, pivot, objects[++first]));
+	}
+
+	swapObjects(objects, 0, last);
+
+	return last;
+}
+
+/*
+ * Swaps a few objects around if a partition was very unbalanced, so that
+ * patterns in the input can not keep producing bad pivots.
+ */
 static void
-quicksortWithBlock(OFMutableArray *array, size_t left, size_t right,
-    OFComparator comparator, OFArraySortOptions options)
+breakPatterns(id *objects, size_t count, SortContext *context)
 {
-	OFComparisonResult ascending, descending;
+	size_t quarter = count / 4;
+
+	if (count < insertionSortThreshold)
+		return;
 
-	if (options & OFArraySortDescending) {
-		ascending = OFOrderedDescending;
-		descending = OFOrderedAscending;
-	} else {
-		ascending = OFOrderedAscending;
-		descending = OFOrderedDescending;
+	swapObjects(objects, 0, quarter);
+	swapObjects(objects, count - 1, count - quarter);
+
+	if (count > nintherThreshold) {
+		swapObjects(objects, 1, quarter + 1);
+		swapObjects(objects, 2, quarter + 2);
+		swapObjects(objects, count - 2, count - quarter - 1);
+		swapObjects(objects, count - 3, count - quarter - 2);
 	}
+}
+
+/*
+ * Pattern-defeating quicksort by Orson Peters: Sorted, reversed and partially
+ * sorted input as well as input with many equal objects takes linear time,
+ * and falls back to heap sort after too many bad partitions, so that the worst
+ * case is O(n log n).
+ */
+static void
+patternDefeatingQuicksort(id *objects, size_t count, SortContext *context,
+    unsigned int badAllowed, bool leftmost)
+{
+	for (;;) {
+		size_t half = count / 2, pivotIndex, leftCount, rightCount;
+		bool alreadyPartitioned;
 
-	while (left < right) {
-		size_t i = left;
-		size_t j = right - 1;
-		id pivot = [array objectAtIndex: right];
+		if (count < insertionSortThreshold) {
+			insertionSort(objects, count, context);
+			return;
+		}
 
-		do {
-			while (comparator([array objectAtIndex: i], pivot) !=
-			    descending && i < right)
-				i++;
+		if (count > nintherThreshold) {
+			sort3(objects, 0, half, count - 1, context);
+			sort3(objects, 1, half - 1, count - 2, context);
+			sort3(objects, 2, half + 1, count - 3, context);
+			sort3(objects, half - 1, half, half + 1, context);
+			swapObjects(objects, 0, half);
+		} else
+			sort3(objects, half, 0, count - 1, context);
+
+		if (!leftmost && !isLess(context, objects[-1], objects[0])) {
+			pivotIndex = partitionLeft(objects, count, context);
+			objects += pivotIndex + 1;
+			count -= pivotIndex + 1;
+			continue;
+		}
+
+		pivotIndex = partitionRight(objects, count, context,
+		    &alreadyPartitioned);
+		leftCount = pivotIndex;
+		rightCount = count - pivotIndex - 1;
+
+		if (leftCount < count / 8 || rightCount < count / 8) {
+			if (--badAllowed == 0) {
+				heapSort(objects, count, context);
+				return;
+			}
+
+			breakPatterns(objects, leftCount, context);
+			breakPatterns(objects + pivotIndex + 1, rightCount,
+			    context);
+		} else if (alreadyPartitioned &&
+		    partialInsertionSort(objects, leftCount, context) &&
+		    partialInsertionSort(objects + pivotIndex + 1, rightCount,
+		    context))
+			return;
+
+		/* Recurse into the smaller part to bound the stack depth. */
+		if (leftCount < rightCount) {
+			patternDefeatingQuicksort(objects, leftCount, context,
+			    badAllowed, leftmost);
+			objects += pivotIndex + 1;
+			count = rightCount;
+			leftmost = false;
+		} else {
+			patternDefeatingQuicksort(objects + pivotIndex + 1,
+			    rightCount, context, badAllowed, false);
+			count = leftCount;
+		}
+	}
+}
 
-			while (comparator([array objectAtIndex: j], pivot) !=
-			    ascending && j > left)
-				j--;
+static void
+quicksort(id *objects, size_t count, SortContext *context)
+{
+	unsigned int badAllowed = 1;
 
-			if (i < j)
-				[array exchangeObjectAtIndex: i
-					   withObjectAtIndex: j];
-		} while (i < j);
+	for (size_t i = count; i > 1; i >>= 1)
+		badAllowed++;
 
-		if (comparator([array objectAtIndex: i], pivot) == descending)
-			[array exchangeObjectAtIndex: i
-				   withObjectAtIndex: right];
+	patternDefeatingQuicksort(objects, count, context, badAllowed, true);
+}
 
-		if (i > 0)
-			quicksortWithBlock(array, left, i - 1, comparator,
-			    options);
+/*
+ * Merges left and right into destination. Objects from left come first if
+ * they are equal to objects from right, so that merging is stable.
+ */
+static void
+merge(id *destination, id *left, size_t leftCount, id *right,
+    size_t rightCount, SortContext *context)
+{
+	size_t i = 0, j = 0, k = 0;
 
-		left = i + 1;
+	while (i < leftCount && j < rightCount) {
+		if (isLess(context, right[j], left[i]))
+			destination[k++] = right[j++];
+		else
+			destination[k++] = left[i++];
 	}
+
+	memcpy(destination + k, left + i, (leftCount - i) * sizeof(id));
+	k += leftCount - i;
+
+	/*
+	 * When merging in place, the remaining right objects are already where
+	 * they belong, and copying them onto themselves is undefined.
+	 */
+	if (destination + k != right + j)
+		memcpy(destination + k, right + j,
+		    (rightCount - j) * sizeof(id));
+}
+
+/*
+ * Stable merge sort, which needs a buffer for count / 2 objects. Unlike the
+ * functions above, it leaves the objects in an undefined state when a
+ * comparison throws an exception, so it needs to be called on a copy.
+ */
+static void
+mergeSort(id *objects, size_t count, id *buffer, SortContext *context)
+{
+	size_t half = count / 2;
+
+	if (count < insertionSortThreshold) {
+		insertionSort(objects, count, context);
+		return;
+	}
+
+	mergeSort(objects, half, buffer, context);
+	mergeSort(objects + half, count - half, buffer, context);
+
+	/* Skip merging if both halves are in order already. */
+	if (!isLess(context, objects[half], objects[half - 1]))
+		return;
+
+	/* Merging back into objects never overwrites unmerged right ones. */
+	memcpy(buffer, objects, half * sizeof(id));
+	merge(objects, buffer, half, objects + half, count - half, context);
+}
+
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_BLOCKS)
+/* Returns where part idx starts when splitting count into partsCount parts. */
+static OF_INLINE size_t
+partStart(size_t idx, size_t partsCount, size_t count)
+{
+	size_t length = count / partsCount, remainder = count % partsCount;
+
+	if (idx >= partsCount)
+		return count;
+
+	return idx * length + (idx < remainder ? idx : remainder);
+}
+
+/* Returns how many of the sorted objects are less than object. */
+static size_t
+lowerBound(id *objects, size_t count, id object, SortContext *context)
+{
+	size_t low = 0, high = count;
+
+	while (low < high) {
+		size_t middle = low + (high - low) / 2;
+
+		if (isLess(context, objects[middle], object))
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return low;
+}
+
+/*
+ * Splits merging left and right into piecesCount pieces that can be merged
+ * independently. Piece i merges the objects of left from
+ * partStart(i, piecesCount, leftCount) and those of right from
+ * rightStarts[i], which needs room for piecesCount + 1 indexes.
+ */
+static void
+splitMerge(id *left, size_t leftCount, id *right, size_t rightCount,
+    size_t piecesCount, size_t *rightStarts, SortContext *context)
+{
+	rightStarts[0] = 0;
+
+	for (size_t i = 1; i < piecesCount; i++) {
+		size_t start = lowerBound(right, rightCount,
+		    left[partStart(i, piecesCount, leftCount)], context);
+
+		/* Keep the pieces apart even for inconsistent comparisons. */
+		if (start < rightStarts[i - 1])
+			start = rightStarts[i - 1];
+
+		rightStarts[i] = start;
+	}
+
+	rightStarts[piecesCount] = rightCount;
+}
+
+/*
+ * Sorts chunks of the objects on the thread pool and then merges them in
+ * rounds, alternating between objects and buffer, which needs room for count
+ * objects. Each merge is split into pieces, so that the last rounds are
+ * concurrent as well. Returns whichever of both contains the result.
+ */
+static id *
+sortConcurrently(id *objects, size_t count, id *buffer, SortContext *context)
+{
+	OFThreadPool *threadPool = context->threadPool;
+	size_t tasksCount = (threadPool.size + 1) * 2;
+	size_t chunksCount = count / concurrentSortMinChunkSize;
+
+	if (chunksCount > tasksCount)
+		chunksCount = tasksCount;
+
+	OFArrayApplyConcurrently(threadPool, chunksCount, ^ (size_t idx) {
+		size_t start = partStart(idx, chunksCount, count);
+		size_t length = partStart(idx + 1, chunksCount, count) - start;
+		SortContext chunkContext = *context;
+
+		if (chunkContext.stable)
+			mergeSort(objects + start, length, buffer + start,
+			    &chunkContext);
+		else
+			quicksort(objects + start, length, &chunkContext);
+	});
+
+	for (size_t width = 1; width < chunksCount; width *= 2) {
+		size_t pairsCount = (chunksCount + 2 * width - 1) / (2 * width);
+		size_t piecesCount = tasksCount / pairsCount;
+		size_t *rightStarts = OFAllocMemory(pairsCount,
+		    (piecesCount + 1) * sizeof(size_t));
+		id *source = objects, *destination = buffer;
+
+		@try {
+			for (size_t i = 0; i < pairsCount; i++) {
+				size_t chunk = 2 * width * i;
+				size_t start = partStart(chunk, chunksCount,
+				    count);
+				size_t middle = partStart(chunk + width,
+				    chunksCount, count);
+				size_t end = partStart(chunk + 2 * width,
+				    chunksCount, count);
+
+				splitMerge(source + start, middle - start,
+				    source + middle, end - middle, piecesCount,
+				    rightStarts + i * (piecesCount + 1),
+				    context);
+			}
+
+			OFArrayApplyConcurrently(threadPool,
+			    pairsCount * piecesCount, ^ (size_t idx) {
+				size_t pair = idx / piecesCount;
+				size_t piece = idx % piecesCount;
+				size_t chunk = 2 * width * pair;
+				size_t start = partStart(chunk, chunksCount,
+				    count);
+				size_t middle = partStart(chunk + width,
+				    chunksCount, count);
+				size_t *pieceRightStarts =
+				    rightStarts + pair * (piecesCount + 1);
+				size_t leftStart = partStart(piece,
+				    piecesCount, middle - start);
+				size_t leftEnd = partStart(piece + 1,
+				    piecesCount, middle - start);
+				size_t rightStart = pieceRightStarts[piece];
+				size_t rightEnd = pieceRightStarts[piece + 1];
+				SortContext pieceContext = *context;
+
+				merge(destination + start + leftStart +
+				    rightStart, source + start + leftStart,
+				    leftEnd - leftStart,
+				    source + middle + rightStart,
+				    rightEnd - rightStart, &pieceContext);
+			});
+		} @finally {
+			OFFreeMemory(rightStarts);
+		}
+
+		objects = destination;
+		buffer = source;
+	}
+
+	return objects;
 }
 #endif
 
+static void
+sortObjects(id *objects, size_t count, SortContext *context)
+{
+	bool concurrent = false;
+	id *copy, *sorted;
+
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_BLOCKS)
+	concurrent = (context->threadPool != nil &&
+	    count >= 2 * concurrentSortMinChunkSize);
+#endif
+
+	if (!context->stable && !concurrent) {
+		quicksort(objects, count, context);
+		return;
+	}
+
+	/* Sort a copy, so that an exception leaves the objects unchanged. */
+	copy = OFAllocMemory(count, 2 * sizeof(id));
+	@try {
+		memcpy(copy, objects, count * sizeof(id));
+
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_BLOCKS)
+		if (concurrent)
+			sorted = sortConcurrently(copy, count, copy + count,
+			    context);
+		else {
+#endif
+			mergeSort(copy, count, copy + count, context);
+			sorted = copy;
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_BLOCKS)
+		}
+#endif
+
+		memcpy(objects, sorted, count * sizeof(id));
+	} @finally {
+		OFFreeMemory(copy);
+	}
+}
+
+static void
+initSortContext(SortContext *context, OFArraySortOptions options)
+{
+	memset(context, 0, sizeof(*context));
+
+	if (options & OFArraySortDescending)
+		context->ascending = OFOrderedDescending;
+	else
+		context->ascending = OFOrderedAscending;
+
+	context->stable = (options & OFArraySortStable);
+}
+
+static void
+sortArray(OFMutableArray *array, SortContext *context)
+{
+	size_t count = array.count;
+	id *objects;
+
+	if (count == 0 || count == 1)
+		return;
+
+	if ([array isKindOfClass: [OFMutableAdjacentArray class]]) {
+		sortObjects(((OFMutableAdjacentArray *)array).of_mutableObjects,
+		    count, context);
+		return;
+	}
+
+	/*
+	 * Sort a retained copy of the objects and replace them all at the end,
+	 * instead of rearranging them through messages while sorting.
+	 */
+	objects = OFAllocMemory(count, sizeof(id));
+	@try {
+		[array getObjects: objects inRange: OFRangeMake(0, count)];
+	} @catch (id e) {
+		OFFreeMemory(objects);
+		@throw e;
+	}
+
+	for (size_t i = 0; i < count; i++)
+		[objects[i] retain];
+
+	@try {
+		sortObjects(objects, count, context);
+
+		for (size_t i = 0; i < count; i++)
+			[array replaceObjectAtIndex: i withObject: objects[i]];
+	} @finally {
+		for (size_t i = 0; i < count; i++)
+			[objects[i] release];
+
+		OFFreeMemory(objects);
+	}
+}
+
 @implementation OFMutableArrayPlaceholder
 - (instancetype)init
 {
@@ -418,24 +938,52 @@ quicksortWithBlock(OFMutableArray *array, size_t left, size_t right,
 - (void)sortUsingSelector: (SEL)selector
 		  options: (OFArraySortOptions)options
 {
-	size_t count = self.count;
+	SortContext context;
 
-	if (count == 0 || count == 1)
-		return;
+	initSortContext(&context, options);
+	context.selector = selector;
 
-	quicksort(self, 0, count - 1, selector, options);
+	sortArray(self, &context);
 }
 
 #ifdef OF_HAVE_BLOCKS
 - (void)sortUsingComparator: (OFComparator)comparator
 		    options: (OFArraySortOptions)options
 {
-	size_t count = self.count;
+	SortContext context;
 
-	if (count == 0 || count == 1)
-		return;
+	initSortContext(&context, options);
+	context.comparator = comparator;
+
+	sortArray(self, &context);
+}
+#endif
+
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_BLOCKS)
+- (void)sortConcurrentlyOnThreadPool: (OFThreadPool *)threadPool
+		       usingSelector: (SEL)selector
+			     options: (OFArraySortOptions)options
+{
+	SortContext context;
+
+	initSortContext(&context, options);
+	context.selector = selector;
+	context.threadPool = threadPool;
+
+	sortArray(self, &context);
+}
+
+- (void)sortConcurrentlyOnThreadPool: (OFThreadPool *)threadPool
+		     usingComparator: (OFComparator)comparator
+			     options: (OFArraySortOptions)options
+{
+	SortContext context;
+
+	initSortContext(&context, options);
+	context.comparator = comparator;
+	context.threadPool = threadPool;
 
-	quicksortWithBlock(self, 0, count - 1, comparator, options);
+	sortArray(self, &context);
 }
 #endif
 
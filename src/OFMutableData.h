@@ -178,6 +178,14 @@ OF_ASSUME_NONNULL_BEGIN
  */
 - (void)increaseCountBy: (size_t)count;
 
+/**
+ * @brief Makes sure the OFMutableData can hold at least the specified number
+ *	  of items without needing to reallocate its memory.
+ *
+ * @param capacity The number of items the OFMutableData should be able to hold
+ */
+- (void)reserveCapacity: (size_t)capacity;
+
 /**
  * @brief Removes the item at the specified index.
  *
@@ -26,6 +26,11 @@
 #import "OFOutOfMemoryException.h"
 #import "OFOutOfRangeException.h"
 
+@interface OFMutableData ()
+- (void)of_growToCount: (size_t)count OF_DIRECT;
+- (void)of_shrinkIfWasteful OF_DIRECT;
+@end
+
 @implementation OFMutableData
 + (instancetype)data
 {
@@ -135,6 +140,43 @@
 	return self;
 }
 
+- (void)of_growToCount: (size_t)count
+{
+	size_t capacity = _capacity;
+
+	/*
+	 * Grow geometrically so that adding items one by one only takes
+	 * amortized constant time.
+	 */
+	if (capacity < 16)
+		capacity = 16;
+	else if (capacity <= SIZE_MAX / 2 / _itemSize)
+		capacity *= 2;
+
+	if (capacity < count || capacity > SIZE_MAX / _itemSize)
+		capacity = count;
+
+	_items = OFResizeMemory(_items, capacity, _itemSize);
+	_capacity = capacity;
+}
+
+- (void)of_shrinkIfWasteful
+{
+	/*
+	 * Only give memory back once most of it is unused, so that alternately
+	 * adding and removing items does not reallocate every time.
+	 */
+	if (_count > _capacity / 4)
+		return;
+
+	@try {
+		_items = OFResizeMemory(_items, _count, _itemSize);
+		_capacity = _count;
+	} @catch (OFOutOfMemoryException *e) {
+		/* We don't care, as we only made it smaller */
+	}
+}
+
 - (void *)mutableItems
 {
 	return _items;
@@ -180,10 +222,8 @@
 	if (SIZE_MAX - _count < 1)
 		@throw [OFOutOfRangeException exception];
 
-	if (_count + 1 > _capacity) {
-		_items = OFResizeMemory(_items, _count + 1, _itemSize);
-		_capacity = _count + 1;
-	}
+	if (_count + 1 > _capacity)
+		[self of_growToCount: _count + 1];
 
 	memcpy(_items + _count * _itemSize, item, _itemSize);
 
@@ -200,10 +240,8 @@
 	if (count > SIZE_MAX - _count)
 		@throw [OFOutOfRangeException exception];
 
-	if (_count + count > _capacity) {
-		_items = OFResizeMemory(_items, _count + count, _itemSize);
-		_capacity = _count + count;
-	}
+	if (_count + count > _capacity)
+		[self of_growToCount: _count + count];
 
 	memcpy(_items + _count * _itemSize, items, count * _itemSize);
 	_count += count;
@@ -216,10 +254,8 @@
 	if (count > SIZE_MAX - _count || idx > _count)
 		@throw [OFOutOfRangeException exception];
 
-	if (_count + count > _capacity) {
-		_items = OFResizeMemory(_items, _count + count, _itemSize);
-		_capacity = _count + count;
-	}
+	if (_count + count > _capacity)
+		[self of_growToCount: _count + count];
 
 	memmove(_items + (idx + count) * _itemSize, _items + idx * _itemSize,
 	    (_count - idx) * _itemSize);
@@ -233,15 +269,22 @@
 	if (count > SIZE_MAX - _count)
 		@throw [OFOutOfRangeException exception];
 
-	if (_count + count > _capacity) {
-		_items = OFResizeMemory(_items, _count + count, _itemSize);
-		_capacity = _count + count;
-	}
+	if (_count + count > _capacity)
+		[self of_growToCount: _count + count];
 
 	memset(_items + _count * _itemSize, '\0', count * _itemSize);
 	_count += count;
 }
 
+- (void)reserveCapacity: (size_t)capacity
+{
+	if (capacity <= _capacity)
+		return;
+
+	_items = OFResizeMemory(_items, capacity, _itemSize);
+	_capacity = capacity;
+}
+
 - (void)removeItemAtIndex: (size_t)idx
 {
 	[self removeItemsInRange: OFRangeMake(idx, 1)];
@@ -258,12 +301,7 @@
 	    (_count - range.location - range.length) * _itemSize);
 
 	_count -= range.length;
-	@try {
-		_items = OFResizeMemory(_items, _count, _itemSize);
-		_capacity = _count;
-	} @catch (OFOutOfMemoryException *e) {
-		/* We don't really care, as we only made it smaller */
-	}
+	[self of_shrinkIfWasteful];
 }
 
 - (void)removeLastItem
@@ -272,12 +310,7 @@
 		return;
 
 	_count--;
-	@try {
-		_items = OFResizeMemory(_items, _count, _itemSize);
-		_capacity = _count;
-	} @catch (OFOutOfMemoryException *e) {
-		/* We don't care, as we only made it smaller */
-	}
+	[self of_shrinkIfWasteful];
 }
 
 - (void)removeAllItems
@@ -205,6 +205,17 @@ OF_ASSUME_NONNULL_BEGIN
  */
 - (void)deleteEnclosingWhitespaces;
 
+/**
+ * @brief Reserves enough memory so that the string can grow to the specified
+ *	  length in UTF-8 without needing to reallocate.
+ *
+ * This is only a hint and might be ignored by some implementations.
+ *
+ * @param capacity The UTF-8 length in bytes the string should be able to grow
+ *		   to without needing to reallocate
+ */
+- (void)reserveCapacity: (size_t)capacity;
+
 /**
  * @brief Converts the mutable string to an immutable string.
  */
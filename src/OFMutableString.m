@@ -558,6 +558,10 @@ convert(OFMutableString *self, char (*startFunction)(char),
 	return [[OFString alloc] initWithString: self];
 }
 
+- (void)reserveCapacity: (size_t)capacity
+{
+}
+
 - (void)makeImmutable
 {
 }
@@ -23,6 +23,7 @@
 #import "OFMutableUTF8String.h"
 #import "OFASPrintF.h"
 #import "OFString.h"
+#import "OFSubstringSearch.h"
 #import "OFUTF8String.h"
 
 #import "OFInvalidArgumentException.h"
@@ -33,6 +34,53 @@
 
 #import "unicode.h"
 
+/* Makes sure there is enough room for length bytes and a terminating NUL. */
+static void
+growCString(struct OFUTF8StringIvars *ivars, size_t length)
+{
+	size_t capacity = (ivars->capacity > 0
+	    ? ivars->capacity : ivars->cStringLength + 1);
+
+	if (length == SIZE_MAX)
+		@throw [OFOutOfRangeException exception];
+
+	if (length < capacity)
+		return;
+
+	/*
+	 * Grow geometrically so that building a string by appending to it
+	 * only takes amortized linear time.
+	 */
+	capacity = (capacity <= SIZE_MAX / 2 ? capacity * 2 : SIZE_MAX);
+	if (capacity < length + 1)
+		capacity = length + 1;
+
+	ivars->cString = OFResizeMemory(ivars->cString, capacity, 1);
+	ivars->capacity = capacity;
+}
+
+/* Must be called after cStringLength has been reduced. */
+static void
+shrinkCString(struct OFUTF8StringIvars *ivars)
+{
+	/*
+	 * Only give memory back once most of it is unused, so that a string
+	 * that is alternately shortened and extended is not reallocated every
+	 * time.
+	 */
+	if (ivars->capacity > 0 &&
+	    ivars->cStringLength + 1 > ivars->capacity / 4)
+		return;
+
+	@try {
+		ivars->cString = OFResizeMemory(ivars->cString,
+		    ivars->cStringLength + 1, 1);
+		ivars->capacity = 0;
+	} @catch (OFOutOfMemoryException *e) {
+		/* We don't really care, as we only made it smaller */
+	}
+}
+
 @implementation OFMutableUTF8String
 + (void)initialize
 {
@@ -179,8 +227,10 @@
 
 	OFFreeMemory(_s->cString);
 	_s->hasHash = false;
+	OFUTF8StringIvarsDiscardIndexCheckpoints(_s);
 	_s->cString = newCString;
 	_s->cStringLength = newCStringLength;
+	_s->capacity = 0;
 
 	/*
 	 * Even though cStringLength can change, length cannot, therefore no
@@ -197,8 +247,7 @@
 	ssize_t lenOld;
 
 	if (_s->isUTF8)
-		idx = OFUTF8StringIndexToPosition(_s->cString, idx,
-		    _s->cStringLength);
+		idx = OFUTF8StringIvarsIndexToPosition(_s, idx);
 
 	if (idx >= _s->cStringLength)
 		@throw [OFOutOfRangeException exception];
@@ -218,12 +267,12 @@
 		@throw [OFInvalidEncodingException exception];
 
 	_s->hasHash = false;
+	OFUTF8StringIvarsDiscardIndexCheckpoints(_s);
 
 	if (lenNew == (size_t)lenOld)
 		memcpy(_s->cString + idx, buffer, lenNew);
 	else if (lenNew > (size_t)lenOld) {
-		_s->cString = OFResizeMemory(_s->cString,
-		    _s->cStringLength - lenOld + lenNew + 1, 1);
+		growCString(_s, _s->cStringLength - lenOld + lenNew);
 
 		memmove(_s->cString + idx + lenNew, _s->cString + idx + lenOld,
 		    _s->cStringLength - idx - lenOld);
@@ -247,12 +296,7 @@
 		if (character >= 0x80)
 			_s->isUTF8 = true;
 
-		@try {
-			_s->cString = OFResizeMemory(_s->cString,
-			    _s->cStringLength + 1, 1);
-		} @catch (OFOutOfMemoryException *e) {
-			/* We don't really care, as we only made it smaller */
-		}
+		shrinkCString(_s);
 	}
 }
 
@@ -275,9 +319,11 @@
 		@throw [OFInvalidEncodingException exception];
 	}
 
+	if (UTF8StringLength > SIZE_MAX - _s->cStringLength)
+		@throw [OFOutOfRangeException exception];
+
 	_s->hasHash = false;
-	_s->cString = OFResizeMemory(_s->cString,
-	    _s->cStringLength + UTF8StringLength + 1, 1);
+	growCString(_s, _s->cStringLength + UTF8StringLength);
 	memcpy(_s->cString + _s->cStringLength, UTF8String,
 	    UTF8StringLength + 1);
 
@@ -304,9 +350,11 @@
 		@throw [OFInvalidEncodingException exception];
 	}
 
+	if (UTF8StringLength > SIZE_MAX - _s->cStringLength)
+		@throw [OFOutOfRangeException exception];
+
 	_s->hasHash = false;
-	_s->cString = OFResizeMemory(_s->cString,
-	    _s->cStringLength + UTF8StringLength + 1, 1);
+	growCString(_s, _s->cStringLength + UTF8StringLength);
 	memcpy(_s->cString + _s->cStringLength, UTF8String, UTF8StringLength);
 
 	_s->cStringLength += UTF8StringLength;
@@ -350,9 +398,11 @@
 
 	UTF8StringLength = string.UTF8StringLength;
 
+	if (UTF8StringLength > SIZE_MAX - _s->cStringLength)
+		@throw [OFOutOfRangeException exception];
+
 	_s->hasHash = false;
-	_s->cString = OFResizeMemory(_s->cString,
-	    _s->cStringLength + UTF8StringLength + 1, 1);
+	growCString(_s, _s->cStringLength + UTF8StringLength);
 	memcpy(_s->cString + _s->cStringLength, string.UTF8String,
 	    UTF8StringLength);
 
@@ -391,9 +441,11 @@
 
 		tmp[j] = '\0';
 
+		if (j > SIZE_MAX - _s->cStringLength)
+			@throw [OFOutOfRangeException exception];
+
 		_s->hasHash = false;
-		_s->cString = OFResizeMemory(_s->cString,
-		    _s->cStringLength + j + 1, 1);
+		growCString(_s, _s->cStringLength + j);
 		memcpy(_s->cString + _s->cStringLength, tmp, j + 1);
 
 		_s->cStringLength += j;
@@ -430,6 +482,7 @@
 	size_t i, j;
 
 	_s->hasHash = false;
+	OFUTF8StringIvarsDiscardIndexCheckpoints(_s);
 
 	/* We reverse all bytes and restore UTF-8 later, if necessary */
 	for (i = 0, j = _s->cStringLength - 1; i < _s->cStringLength / 2;
@@ -513,12 +566,12 @@
 		@throw [OFOutOfRangeException exception];
 
 	if (_s->isUTF8)
-		idx = OFUTF8StringIndexToPosition(_s->cString, idx,
-		    _s->cStringLength);
+		idx = OFUTF8StringIvarsIndexToPosition(_s, idx);
 
 	newCStringLength = _s->cStringLength + string.UTF8StringLength;
 	_s->hasHash = false;
-	_s->cString = OFResizeMemory(_s->cString, newCStringLength + 1, 1);
+	OFUTF8StringIvarsDiscardIndexCheckpoints(_s);
+	growCString(_s, newCStringLength);
 
 	memmove(_s->cString + idx + string.UTF8StringLength,
 	    _s->cString + idx, _s->cStringLength - idx);
@@ -546,25 +599,19 @@
 		@throw [OFOutOfRangeException exception];
 
 	if (_s->isUTF8) {
-		start = OFUTF8StringIndexToPosition(_s->cString, start,
-		    _s->cStringLength);
-		end = OFUTF8StringIndexToPosition(_s->cString, end,
-		    _s->cStringLength);
+		start = OFUTF8StringIvarsIndexToPosition(_s, start);
+		end = OFUTF8StringIvarsIndexToPosition(_s, end);
 	}
 
 	memmove(_s->cString + start, _s->cString + end,
 	    _s->cStringLength - end);
 	_s->hasHash = false;
+	OFUTF8StringIvarsDiscardIndexCheckpoints(_s);
 	_s->length -= range.length;
 	_s->cStringLength -= end - start;
 	_s->cString[_s->cStringLength] = 0;
 
-	@try {
-		_s->cString = OFResizeMemory(_s->cString, _s->cStringLength + 1,
-		    1);
-	} @catch (OFOutOfMemoryException *e) {
-		/* We don't really care, as we only made it smaller */
-	}
+	shrinkCString(_s);
 }
 
 - (void)replaceCharactersInRange: (OFRange)range
@@ -583,15 +630,14 @@
 	newLength = _s->length - range.length + replacement.length;
 
 	if (_s->isUTF8) {
-		start = OFUTF8StringIndexToPosition(_s->cString, start,
-		    _s->cStringLength);
-		end = OFUTF8StringIndexToPosition(_s->cString, end,
-		    _s->cStringLength);
+		start = OFUTF8StringIvarsIndexToPosition(_s, start);
+		end = OFUTF8StringIvarsIndexToPosition(_s, end);
 	}
 
 	newCStringLength = _s->cStringLength - (end - start) +
 	    replacement.UTF8StringLength;
 	_s->hasHash = false;
+	OFUTF8StringIvarsDiscardIndexCheckpoints(_s);
 
 	/*
 	 * If the new string is bigger, we need to resize it first so we can
@@ -602,8 +648,7 @@
 	 * lost due to the resize!
 	 */
 	if (newCStringLength > _s->cStringLength)
-		_s->cString = OFResizeMemory(_s->cString, newCStringLength + 1,
-		    1);
+		growCString(_s, newCStringLength);
 
 	memmove(_s->cString + start + replacement.UTF8StringLength,
 	    _s->cString + end, _s->cStringLength - end);
@@ -611,16 +656,14 @@
 	    replacement.UTF8StringLength);
 	_s->cString[newCStringLength] = '\0';
 
+	_s->cStringLength = newCStringLength;
+	_s->length = newLength;
+
 	/*
 	 * If the new string is smaller, we can safely resize it now as we're
 	 * done with memmove().
 	 */
-	if (newCStringLength < _s->cStringLength)
-		_s->cString = OFResizeMemory(_s->cString, newCStringLength + 1,
-		    1);
-
-	_s->cStringLength = newCStringLength;
-	_s->length = newLength;
+	shrinkCString(_s);
 
 	if ([replacement isKindOfClass: [OFUTF8String class]] ||
 	    [replacement isKindOfClass: [OFMutableUTF8String class]]) {
@@ -639,7 +682,9 @@
 	const char *replacementString = replacement.UTF8String;
 	size_t searchLength = string.UTF8StringLength;
 	size_t replacementLength = replacement.UTF8StringLength;
-	size_t last, newCStringLength, newLength;
+	OFSubstringSearch search;
+	size_t i, end, position, last;
+	size_t newCStringLength, newCStringCapacity, newLength;
 	char *newCString;
 
 	if (string == nil || replacement == nil)
@@ -650,32 +695,47 @@
 		@throw [OFOutOfRangeException exception];
 
 	if (_s->isUTF8) {
-		range.location = OFUTF8StringIndexToPosition(_s->cString,
-		    range.location, _s->cStringLength);
+		range.location = OFUTF8StringIvarsIndexToPosition(_s,
+		    range.location);
 		range.length = OFUTF8StringIndexToPosition(
 		    _s->cString + range.location, range.length,
 		    _s->cStringLength - range.location);
 	}
 
-	if (string.UTF8StringLength > range.length)
+	if (searchLength == 0 || searchLength > range.length)
 		return;
 
 	newCString = NULL;
-	newCStringLength = 0;
+	newCStringLength = newCStringCapacity = 0;
 	newLength = _s->length;
 	last = 0;
 
-	for (size_t i = range.location; i <= range.length - searchLength; i++) {
-		if (memcmp(_s->cString + i, searchString, searchLength) != 0)
-			continue;
+	OFSubstringSearchInit(&search, searchString, searchLength, false);
+	i = range.location;
+	end = range.location + range.length;
 
-		@try {
-			newCString = OFResizeMemory(newCString,
-			    newCStringLength + i - last + replacementLength + 1,
-			    1);
-		} @catch (id e) {
-			OFFreeMemory(newCString);
-			@throw e;
+	while ((position = OFSubstringSearchFind(&search, _s->cString + i,
+	    end - i)) != OFNotFound) {
+		size_t needed;
+
+		i += position;
+
+		needed = newCStringLength + i - last + replacementLength + 1;
+		if (needed > newCStringCapacity) {
+			/* Grow geometrically to avoid quadratic copying. */
+			if (newCStringCapacity <= SIZE_MAX / 2 &&
+			    newCStringCapacity * 2 > needed)
+				needed = newCStringCapacity * 2;
+
+			@try {
+				newCString = OFResizeMemory(newCString, needed,
+				    1);
+			} @catch (id e) {
+				OFFreeMemory(newCString);
+				@throw e;
+			}
+
+			newCStringCapacity = needed;
 		}
 		memcpy(newCString + newCStringLength, _s->cString + last,
 		    i - last);
@@ -685,16 +745,22 @@
 		newCStringLength += i - last + replacementLength;
 		newLength = newLength - string.length + replacement.length;
 
-		i += searchLength - 1;
-		last = i + 1;
+		i += searchLength;
+		last = i;
 	}
 
-	@try {
-		newCString = OFResizeMemory(newCString,
-		    newCStringLength + _s->cStringLength - last + 1, 1);
-	} @catch (id e) {
-		OFFreeMemory(newCString);
-		@throw e;
+	if (newCStringLength + _s->cStringLength - last + 1 >
+	    newCStringCapacity) {
+		newCStringCapacity =
+		    newCStringLength + _s->cStringLength - last + 1;
+
+		@try {
+			newCString = OFResizeMemory(newCString,
+			    newCStringCapacity, 1);
+		} @catch (id e) {
+			OFFreeMemory(newCString);
+			@throw e;
+		}
 	}
 	memcpy(newCString + newCStringLength, _s->cString + last,
 	    _s->cStringLength - last);
@@ -703,8 +769,10 @@
 
 	OFFreeMemory(_s->cString);
 	_s->hasHash = false;
+	OFUTF8StringIvarsDiscardIndexCheckpoints(_s);
 	_s->cString = newCString;
 	_s->cStringLength = newCStringLength;
+	_s->capacity = newCStringCapacity;
 	_s->length = newLength;
 
 	if ([replacement isKindOfClass: [OFUTF8String class]] ||
@@ -724,18 +792,14 @@
 			break;
 
 	_s->hasHash = false;
+	OFUTF8StringIvarsDiscardIndexCheckpoints(_s);
 	_s->cStringLength -= i;
 	_s->length -= i;
 
 	memmove(_s->cString, _s->cString + i, _s->cStringLength);
 	_s->cString[_s->cStringLength] = '\0';
 
-	@try {
-		_s->cString = OFResizeMemory(_s->cString, _s->cStringLength + 1,
-		    1);
-	} @catch (OFOutOfMemoryException *e) {
-		/* We don't really care, as we only made it smaller */
-	}
+	shrinkCString(_s);
 }
 
 - (void)deleteTrailingWhitespaces
@@ -744,6 +808,7 @@
 	char *p;
 
 	_s->hasHash = false;
+	OFUTF8StringIvarsDiscardIndexCheckpoints(_s);
 
 	d = 0;
 	for (p = _s->cString + _s->cStringLength - 1; p >= _s->cString; p--) {
@@ -757,12 +822,7 @@
 	_s->cStringLength -= d;
 	_s->length -= d;
 
-	@try {
-		_s->cString = OFResizeMemory(_s->cString, _s->cStringLength + 1,
-		    1);
-	} @catch (OFOutOfMemoryException *e) {
-		/* We don't really care, as we only made it smaller */
-	}
+	shrinkCString(_s);
 }
 
 - (void)deleteEnclosingWhitespaces
@@ -771,6 +831,7 @@
 	char *p;
 
 	_s->hasHash = false;
+	OFUTF8StringIvarsDiscardIndexCheckpoints(_s);
 
 	d = 0;
 	for (p = _s->cString + _s->cStringLength - 1; p >= _s->cString; p--) {
@@ -794,16 +855,34 @@
 	memmove(_s->cString, _s->cString + i, _s->cStringLength);
 	_s->cString[_s->cStringLength] = '\0';
 
-	@try {
-		_s->cString = OFResizeMemory(_s->cString, _s->cStringLength + 1,
-		    1);
-	} @catch (OFOutOfMemoryException *e) {
-		/* We don't really care, as we only made it smaller */
-	}
+	shrinkCString(_s);
+}
+
+- (void)reserveCapacity: (size_t)capacity
+{
+	if (capacity == SIZE_MAX)
+		@throw [OFOutOfRangeException exception];
+
+	if (capacity < (_s->capacity > 0
+	    ? _s->capacity : _s->cStringLength + 1))
+		return;
+
+	_s->cString = OFResizeMemory(_s->cString, capacity + 1, 1);
+	_s->capacity = capacity + 1;
 }
 
 - (void)makeImmutable
 {
+	if (_s->capacity > 0) {
+		@try {
+			_s->cString = OFResizeMemory(_s->cString,
+			    _s->cStringLength + 1, 1);
+			_s->capacity = 0;
+		} @catch (OFOutOfMemoryException *e) {
+			/* We don't care, as we only made it smaller */
+		}
+	}
+
 	object_setClass(self, [OFUTF8String class]);
 }
 @end
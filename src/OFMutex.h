@@ -29,15 +29,46 @@ OF_ASSUME_NONNULL_BEGIN
 	OFPlainMutex _mutex;
 	bool _initialized;
 	OFString *_Nullable _name;
-	OF_RESERVE_IVARS(OFMutex, 4)
+	struct OFMutexStatistics *_Nullable _statistics;
+	OF_RESERVE_IVARS(OFMutex, 3)
 }
 
+/**
+ * @brief Whether the mutex keeps statistics about how often it is acquired and
+ *	  how often and how long threads had to wait for it.
+ *
+ * This is disabled by default, as it makes acquiring the mutex slower. If
+ * enabled, the statistics are also included in the description.
+ */
+@property (nonatomic) bool keepsStatistics;
+
+/**
+ * @brief How often the mutex has been acquired while keeping statistics.
+ */
+@property (readonly, nonatomic) unsigned long long acquisitionsCount;
+
+/**
+ * @brief How often a thread had to wait for the mutex while keeping
+ *	  statistics.
+ */
+@property (readonly, nonatomic) unsigned long long contendedAcquisitionsCount;
+
+/**
+ * @brief The total time threads waited for the mutex while keeping statistics.
+ */
+@property (readonly, nonatomic) OFTimeInterval waitTime;
+
 /**
  * @brief Creates a new mutex.
  *
  * @return A new autoreleased mutex.
  */
 + (instancetype)mutex;
+
+/**
+ * @brief Resets the statistics of the mutex.
+ */
+- (void)resetStatistics;
 @end
 
 OF_ASSUME_NONNULL_END
@@ -16,6 +16,9 @@
 #include "config.h"
 
 #include <errno.h>
+#include <time.h>
+
+#include <sys/time.h>
 
 #import "OFMutex.h"
 #import "OFString.h"
@@ -25,6 +28,53 @@
 #import "OFStillLockedException.h"
 #import "OFUnlockFailedException.h"
 
+/*
+ * Only allocated once statistics are enabled, so that they don't take space in
+ * every instance and don't change the size of the ivars.
+ */
+struct OFMutexStatistics {
+	bool keepsStatistics;
+	unsigned long long acquisitionsCount, contendedAcquisitionsCount;
+	OFTimeInterval waitTime;
+};
+
+/*
+ * Returns the time of a monotonic clock if possible, so that the wait time is
+ * not affected by changes of the system time.
+ */
+static OFTimeInterval
+now(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+	OFTimeInterval seconds;
+
+	OFEnsure(clock_gettime(CLOCK_MONOTONIC, &ts) == 0);
+
+	seconds = ts.tv_sec;
+	seconds += (OFTimeInterval)ts.tv_nsec / 1000000000;
+
+	return seconds;
+#elif defined(OF_WINDOWS)
+	LARGE_INTEGER counter, frequency;
+
+	OFEnsure(QueryPerformanceCounter(&counter));
+	OFEnsure(QueryPerformanceFrequency(&frequency));
+
+	return (OFTimeInterval)counter.QuadPart / frequency.QuadPart;
+#else
+	struct timeval tv;
+	OFTimeInterval seconds;
+
+	OFEnsure(gettimeofday(&tv, NULL) == 0);
+
+	seconds = tv.tv_sec;
+	seconds += (OFTimeInterval)tv.tv_usec / 1000000;
+
+	return seconds;
+#endif
+}
+
 @implementation OFMutex
 @synthesize name = _name;
 
@@ -61,13 +111,32 @@
 	}
 
 	[_name release];
+	OFFreeMemory(_statistics);
 
 	[super dealloc];
 }
 
 - (void)lock
 {
-	int error = OFPlainMutexLock(&_mutex);
+	int error;
+
+	if OF_UNLIKELY (_statistics != NULL && _statistics->keepsStatistics) {
+		error = OFPlainMutexTryLock(&_mutex);
+
+		if (error == EBUSY) {
+			OFTimeInterval start = now();
+
+			if ((error = OFPlainMutexLock(&_mutex)) == 0) {
+				/* We hold the mutex, so no atomics needed. */
+				_statistics->contendedAcquisitionsCount++;
+				_statistics->waitTime += now() - start;
+			}
+		}
+
+		if (error == 0)
+			_statistics->acquisitionsCount++;
+	} else
+		error = OFPlainMutexLock(&_mutex);
 
 	if (error != 0)
 		@throw [OFLockFailedException exceptionWithLock: self
@@ -86,6 +155,9 @@
 								  errNo: error];
 	}
 
+	if OF_UNLIKELY (_statistics != NULL && _statistics->keepsStatistics)
+		_statistics->acquisitionsCount++;
+
 	return true;
 }
 
@@ -98,11 +170,71 @@
 							    errNo: error];
 }
 
+- (bool)keepsStatistics
+{
+	return (_statistics != NULL && _statistics->keepsStatistics);
+}
+
+- (void)setKeepsStatistics: (bool)keepsStatistics
+{
+	if (_statistics == NULL) {
+		if (!keepsStatistics)
+			return;
+
+		_statistics = OFAllocZeroedMemory(1, sizeof(*_statistics));
+	}
+
+	_statistics->keepsStatistics = keepsStatistics;
+}
+
+- (unsigned long long)acquisitionsCount
+{
+	return (_statistics != NULL ? _statistics->acquisitionsCount : 0);
+}
+
+- (unsigned long long)contendedAcquisitionsCount
+{
+	return (_statistics != NULL
+	    ? _statistics->contendedAcquisitionsCount : 0);
+}
+
+- (OFTimeInterval)waitTime
+{
+	return (_statistics != NULL ? _statistics->waitTime : 0);
+}
+
+- (void)resetStatistics
+{
+	if (_statistics == NULL)
+		return;
+
+	_statistics->acquisitionsCount = 0;
+	_statistics->contendedAcquisitionsCount = 0;
+	_statistics->waitTime = 0;
+}
+
 - (OFString *)description
 {
+	OFString *statistics;
+
+	if (!self.keepsStatistics) {
+		if (_name == nil)
+			return super.description;
+
+		return [OFString stringWithFormat: @"<%@: %@>",
+						   self.className, _name];
+	}
+
+	statistics = [OFString stringWithFormat:
+	    @"%llu acquisitions, %llu contended, waited %f s",
+	    _statistics->acquisitionsCount,
+	    _statistics->contendedAcquisitionsCount, _statistics->waitTime];
+
 	if (_name == nil)
-		return super.description;
+		return [OFString stringWithFormat: @"<%@: %@>",
+						   self.className, statistics];
 
-	return [OFString stringWithFormat: @"<%@: %@>", self.className, _name];
+	return [OFString stringWithFormat: @"<%@: %@, %@>",
+					   self.className, _name, statistics];
 }
 @end
@@ -18,6 +18,7 @@
 
 OF_ASSUME_NONNULL_BEGIN
 
+@class OFDictionary OF_GENERIC(KeyType, ObjectType);
 @class OFMutableDictionary OF_GENERIC(KeyType, ObjectType);
 #ifdef OF_HAVE_THREADS
 @class OFMutex;
@@ -45,7 +46,8 @@ typedef void (^OFNotificationCenterBlock)(OFNotification *notification);
 	OFMutex *_mutex;
 #endif
 	OFMutableDictionary *_handles;
-	OF_RESERVE_IVARS(OFNotificationCenter, 4)
+	struct OFNotificationCenterSnapshots *_snapshots;
+	OF_RESERVE_IVARS(OFNotificationCenter, 3)
 }
 
 #ifdef OF_HAVE_CLASS_PROPERTIES
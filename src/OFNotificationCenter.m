@@ -17,6 +17,9 @@
 
 #import "OFNotificationCenter.h"
 #import "OFArray.h"
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_ATOMIC_OPS)
+# import "OFAtomic.h"
+#endif
 #import "OFDictionary.h"
 #ifdef OF_HAVE_THREADS
 # import "OFMutex.h"
@@ -26,6 +29,20 @@
 
 #import "OFInvalidArgumentException.h"
 
+/*
+ * The copy-on-write snapshots of the handles that are used for posting. They
+ * are referenced from a reserved ivar slot, so that the ivar layout does not
+ * change.
+ */
+struct OFNotificationCenterSnapshots {
+	OFDictionary *volatile current;
+#ifdef OF_HAVE_THREADS
+	volatile int readersCount;
+	OFMutableArray *retired;
+	volatile bool hasRetired;
+#endif
+};
+
 @interface OFDefaultNotificationCenter: OFNotificationCenter
 @end
 
@@ -35,6 +52,7 @@
 	OFNotificationName _name;
 	id _observer;
 	SEL _selector;
+	void (*_callback)(id, SEL, OFNotification *);
 	unsigned long _selectorHash;
 #ifdef OF_HAVE_BLOCKS
 	OFNotificationCenterBlock _block;
@@ -71,6 +89,9 @@ static OFNotificationCenter *defaultCenter;
 		_selector = selector;
 		_object = [object retain];
 
+		_callback = (void (*)(id, SEL, OFNotification *))
+		    [_observer methodForSelector: _selector];
+
 		_selectorHash = [[OFString stringWithUTF8String:
 		    sel_getName(_selector)] hash];
 
@@ -186,6 +207,11 @@ static OFNotificationCenter *defaultCenter;
 		_mutex = [[OFMutex alloc] init];
 #endif
 		_handles = [[OFMutableDictionary alloc] init];
+		_snapshots = OFAllocZeroedMemory(1, sizeof(*_snapshots));
+		_snapshots->current = [[OFDictionary alloc] init];
+#ifdef OF_HAVE_THREADS
+		_snapshots->retired = [[OFMutableArray alloc] init];
+#endif
 	} @catch (id e) {
 		[self release];
 		@throw e;
@@ -201,9 +227,159 @@ static OFNotificationCenter *defaultCenter;
 #endif
 	[_handles release];
 
+	if (_snapshots != NULL) {
+		[_snapshots->current release];
+#ifdef OF_HAVE_THREADS
+		[_snapshots->retired release];
+#endif
+		OFFreeMemory(_snapshots);
+	}
+
 	[super dealloc];
 }
 
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_ATOMIC_OPS)
+/*
+ * Releases the retired snapshots if no thread is reading a snapshot anymore.
+ * Must be called with the mutex held.
+ */
+static void
+releaseRetiredSnapshotsIfUnused(OFNotificationCenter *self)
+{
+	/*
+	 * Pairs with the barrier in beginReading(): A reader that is not
+	 * counted yet will see the current snapshot, which is never retired
+	 * while the mutex is held.
+	 */
+	OFMemoryBarrier();
+
+	if (self->_snapshots->readersCount == 0) {
+		[self->_snapshots->retired removeAllObjects];
+		self->_snapshots->hasRetired = false;
+	}
+}
+
+static OF_INLINE void
+beginReading(OFNotificationCenter *self)
+{
+	OFAtomicIntIncrease(&self->_snapshots->readersCount);
+	OFMemoryBarrier();
+}
+
+/*
+ * The last reader releases the snapshots that were retired while it was
+ * reading, so that they don't pile up while there is no further change. If
+ * another thread holds the mutex, that thread or a later reader releases
+ * them instead.
+ */
+static OF_INLINE void
+endReading(OFNotificationCenter *self)
+{
+	OFMemoryBarrier();
+
+	if (OFAtomicIntDecrease(&self->_snapshots->readersCount) > 0)
+		return;
+
+	/* Pairs with the barrier in releaseRetiredSnapshotsIfUnused(). */
+	OFMemoryBarrier();
+
+	if (!self->_snapshots->hasRetired || ![self->_mutex tryLock])
+		return;
+
+	@try {
+		releaseRetiredSnapshotsIfUnused(self);
+	} @finally {
+		[self->_mutex unlock];
+	}
+}
+#endif
+
+/*
+ * Replaces the snapshot of the handles that is used for posting with one that
+ * reflects the current handles for the specified name. Must be called with
+ * the mutex held.
+ *
+ * Snapshots are never modified once published, so posting only needs to keep
+ * the snapshot it read alive. For this, the old snapshot is retired and only
+ * released once no thread is reading a snapshot anymore, either by the next
+ * change or by the last reader.
+ */
+- (void)of_publishHandlesForName: (OFNotificationName)name
+{
+	void *pool = objc_autoreleasePoolPush();
+	OFDictionary *oldSnapshot = _snapshots->current;
+	OFMutableDictionary *snapshot = [[oldSnapshot mutableCopy] autorelease];
+	OFSet *handlesForName = [_handles objectForKey: name];
+
+	if (handlesForName != nil)
+		[snapshot setObject: handlesForName.allObjects forKey: name];
+	else
+		[snapshot removeObjectForKey: name];
+
+	[snapshot makeImmutable];
+
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_ATOMIC_OPS)
+	[_snapshots->retired addObject: oldSnapshot];
+	_snapshots->hasRetired = true;
+
+	_snapshots->current = [snapshot retain];
+	[oldSnapshot release];
+
+	/* Either the reader sees the new snapshot or we see the reader. */
+	releaseRetiredSnapshotsIfUnused(self);
+#else
+	_snapshots->current = [snapshot retain];
+	[oldSnapshot release];
+#endif
+
+	objc_autoreleasePoolPop(pool);
+}
+
+- (OFArray *)of_handlesForName: (OFNotificationName)name
+{
+	OFArray *handles;
+
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_ATOMIC_OPS)
+	beginReading(self);
+	handles = [[_snapshots->current objectForKey: name] retain];
+	endReading(self);
+#elif defined(OF_HAVE_THREADS)
+	[_mutex lock];
+	@try {
+		handles = [[_snapshots->current objectForKey: name] retain];
+	} @finally {
+		[_mutex unlock];
+	}
+#else
+	handles = [[_snapshots->current objectForKey: name] retain];
+#endif
+
+	return [handles autorelease];
+}
+
+- (bool)of_hasObserversForName: (OFNotificationName)name
+{
+	bool hasObservers;
+
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_ATOMIC_OPS)
+	beginReading(self);
+	hasObservers = ([_snapshots->current objectForKey: name] != nil);
+	endReading(self);
+#elif defined(OF_HAVE_THREADS)
+	[_mutex lock];
+	@try {
+		hasObservers =
+		    ([_snapshots->current objectForKey: name] != nil);
+	} @finally {
+		[_mutex unlock];
+	}
+#else
+	hasObservers = ([_snapshots->current objectForKey: name] != nil);
+#endif
+
+	return hasObservers;
+}
+
 - (void)of_addObserver: (OFNotificationCenterHandle *)handle
 {
 #ifdef OF_HAVE_THREADS
@@ -220,6 +396,8 @@ static OFNotificationCenter *defaultCenter;
 		}
 
 		[handlesForName addObject: handle];
+
+		[self of_publishHandlesForName: handle->_name];
 #ifdef OF_HAVE_THREADS
 	} @finally {
 		[_mutex unlock];
@@ -287,6 +465,8 @@ static OFNotificationCenter *defaultCenter;
 
 		if (handlesForName.count == 0)
 			[_handles removeObjectForKey: name];
+
+		[self of_publishHandlesForName: name];
 #ifdef OF_HAVE_THREADS
 	} @finally {
 		[_mutex unlock];
@@ -316,39 +496,20 @@ static OFNotificationCenter *defaultCenter;
 - (void)postNotification: (OFNotification *)notification
 {
 	void *pool = objc_autoreleasePoolPush();
-	OFMutableArray *matchedHandles = [OFMutableArray array];
+	id object = notification.object;
 
-#ifdef OF_HAVE_THREADS
-	[_mutex lock];
-	@try {
-#endif
-		for (OFNotificationCenterHandle *handle in
-		    [_handles objectForKey: notification.name])
-			if (handle->_object == nil ||
-			    handle->_object == notification.object)
-				[matchedHandles addObject: handle];
-#ifdef OF_HAVE_THREADS
-	} @finally {
-		[_mutex unlock];
-	}
-#endif
+	for (OFNotificationCenterHandle *handle in
+	    [self of_handlesForName: notification.name]) {
+		if (handle->_object != nil && handle->_object != object)
+			continue;
 
-	for (OFNotificationCenterHandle *handle in matchedHandles) {
 #ifdef OF_HAVE_BLOCKS
 		if (handle->_block != NULL)
 			handle->_block(notification);
-		else {
+		else
 #endif
-			void (*callback)(id, SEL, OFNotification *) =
-			    (void (*)(id, SEL, OFNotification *))
-			    [handle->_observer methodForSelector:
-			    handle->_selector];
-
-			callback(handle->_observer, handle->_selector,
+			handle->_callback(handle->_observer, handle->_selector,
 			    notification);
-#ifdef OF_HAVE_BLOCKS
-		}
-#endif
 	}
 
 	objc_autoreleasePoolPop(pool);
@@ -364,7 +525,13 @@ static OFNotificationCenter *defaultCenter;
 		      object: (nullable id)object
 		    userInfo: (nullable OFDictionary *)userInfo
 {
-	void *pool = objc_autoreleasePoolPush();
+	void *pool;
+
+	/* Avoid creating a notification nobody would receive. */
+	if (![self of_hasObserversForName: name])
+		return;
+
+	pool = objc_autoreleasePoolPush();
 
 	[self postNotification:
 	    [OFNotification notificationWithName: name
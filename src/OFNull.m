@@ -16,6 +16,7 @@
 #include "config.h"
 
 #import "OFNull.h"
+#import "OFStream.h"
 #import "OFString.h"
 #import "OFXMLElement.h"
 #import "OFData.h"
@@ -26,6 +27,10 @@
 - (OFString *)
     of_JSONRepresentationWithOptions: (OFJSONRepresentationOptions)options
 			       depth: (size_t)depth;
+- (void)of_writeJSONToStream: (OFStream *)stream
+		     options: (OFJSONRepresentationOptions)options
+		       depth: (size_t)depth;
+- (void)writeMessagePackToStream: (OFStream *)stream;
 @end
 
 static OFNull *null = nil;
@@ -101,12 +106,24 @@ static OFNull *null = nil;
 	return @"null";
 }
 
+- (void)of_writeJSONToStream: (OFStream *)stream
+		     options: (OFJSONRepresentationOptions)options
+		       depth: (size_t)depth
+{
+	[stream writeBuffer: "null" length: 4];
+}
+
 - (OFData *)messagePackRepresentation
 {
 	uint8_t type = 0xC0;
 	return [OFData dataWithItems: &type count: 1];
 }
 
+- (void)writeMessagePackToStream: (OFStream *)stream
+{
+	[stream writeInt8: 0xC0];
+}
+
 - (instancetype)autorelease
 {
 	return self;
@@ -35,6 +35,8 @@ OF_ASSUME_NONNULL_BEGIN
 
 /** @file */
 
+@class OFStream;
+
 /**
  * @class OFNumber OFNumber.h ObjFW/OFNumber.h
  *
@@ -363,6 +365,24 @@ OF_SUBCLASSING_RESTRICTED
  * @return The result of the comparison
  */
 - (OFComparisonResult)compare: (OFNumber *)number;
+
+/**
+ * @brief Writes the JSON representation of the number to the specified
+ *	  stream.
+ *
+ * @param stream The stream to write the JSON representation to
+ * @param options The options to use when creating the JSON representation
+ */
+- (void)writeJSONToStream: (OFStream *)stream
+		  options: (OFJSONRepresentationOptions)options;
+
+/**
+ * @brief Writes the MessagePack representation of the number to the
+ *	  specified stream.
+ *
+ * @param stream The stream to write the MessagePack representation to
+ */
+- (void)writeMessagePackToStream: (OFStream *)stream;
 @end
 
 OF_ASSUME_NONNULL_END
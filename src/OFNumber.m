@@ -18,8 +18,11 @@
 #include "config.h"
 
 #include <math.h>
+#include <stdio.h>
+#include <string.h>
 
 #import "OFNumber.h"
+#import "OFStream.h"
 #import "OFString.h"
 #import "OFXMLElement.h"
 #import "OFXMLAttribute.h"
@@ -34,6 +37,10 @@
 - (OFString *)
     of_JSONRepresentationWithOptions: (OFJSONRepresentationOptions)options
 			       depth: (size_t)depth;
+- (size_t)of_getMessagePackRepresentation: (uint8_t *)buffer OF_DIRECT;
+- (void)of_writeJSONToStream: (OFStream *)stream
+		     options: (OFJSONRepresentationOptions)options
+		       depth: (size_t)depth;
 @end
 
 @interface OFNumberPlaceholder: OFNumber
@@ -1103,106 +1110,149 @@ isFloat(OFNumber *number)
 	return self.description;
 }
 
-- (OFData *)messagePackRepresentation
+- (void)of_writeJSONToStream: (OFStream *)stream
+		     options: (OFJSONRepresentationOptions)options
+		       depth: (size_t)depth
+{
+	char buffer[24];
+	int length;
+
+	if (*self.objCType == 'B') {
+		if (self.boolValue)
+			[stream writeBuffer: "true" length: 4];
+		else
+			[stream writeBuffer: "false" length: 5];
+
+		return;
+	}
+
+	if (isSigned(self))
+		length = snprintf(buffer, sizeof(buffer), "%lld",
+		    self.longLongValue);
+	else if (isUnsigned(self))
+		length = snprintf(buffer, sizeof(buffer), "%llu",
+		    self.unsignedLongLongValue);
+	else {
+		/* Floats need locale-independent formatting and Infinity. */
+		void *pool = objc_autoreleasePoolPush();
+
+		[stream writeString: [self
+		    of_JSONRepresentationWithOptions: options
+					       depth: depth]];
+
+		objc_autoreleasePoolPop(pool);
+
+		return;
+	}
+
+	if (length < 0 || (size_t)length >= sizeof(buffer))
+		@throw [OFOutOfRangeException exception];
+
+	[stream writeBuffer: buffer length: length];
+}
+
+- (void)writeJSONToStream: (OFStream *)stream
+		  options: (OFJSONRepresentationOptions)options
+{
+	[self of_writeJSONToStream: stream options: options depth: 0];
+}
+
+- (size_t)of_getMessagePackRepresentation: (uint8_t *)buffer
 {
-	OFMutableData *data;
 	const char *typeEncoding = self.objCType;
 
 	if (*typeEncoding == 'B') {
-		uint8_t type = (self.boolValue ? 0xC3 : 0xC2);
-		data = [OFMutableData dataWithItems: &type count: 1];
+		buffer[0] = (self.boolValue ? 0xC3 : 0xC2);
+		return 1;
 	} else if (*typeEncoding == 'f') {
-		uint8_t type = 0xCA;
 		float tmp = OFToBigEndianFloat(self.floatValue);
 
-		data = [OFMutableData dataWithCapacity: 5];
-		[data addItem: &type];
-		[data addItems: &tmp count: sizeof(tmp)];
+		buffer[0] = 0xCA;
+		memcpy(buffer + 1, &tmp, sizeof(tmp));
+		return 1 + sizeof(tmp);
 	} else if (*typeEncoding == 'd') {
-		uint8_t type = 0xCB;
 		double tmp = OFToBigEndianDouble(self.doubleValue);
 
-		data = [OFMutableData dataWithCapacity: 9];
-		[data addItem: &type];
-		[data addItems: &tmp count: sizeof(tmp)];
+		buffer[0] = 0xCB;
+		memcpy(buffer + 1, &tmp, sizeof(tmp));
+		return 1 + sizeof(tmp);
 	} else if (isSigned(self)) {
 		long long value = self.longLongValue;
 
 		if (value >= -32 && value < 0) {
-			uint8_t tmp = 0xE0 | ((uint8_t)(value - 32) & 0x1F);
-
-			data = [OFMutableData dataWithItems: &tmp count: 1];
+			buffer[0] = 0xE0 | ((uint8_t)(value - 32) & 0x1F);
+			return 1;
 		} else if (value >= INT8_MIN && value <= INT8_MAX) {
-			uint8_t type = 0xD0;
-			int8_t tmp = (int8_t)value;
-
-			data = [OFMutableData dataWithCapacity: 2];
-			[data addItem: &type];
-			[data addItem: &tmp];
+			buffer[0] = 0xD0;
+			buffer[1] = (uint8_t)(int8_t)value;
+			return 2;
 		} else if (value >= INT16_MIN && value <= INT16_MAX) {
-			uint8_t type = 0xD1;
 			int16_t tmp = OFToBigEndian16((int16_t)value);
 
-			data = [OFMutableData dataWithCapacity: 3];
-			[data addItem: &type];
-			[data addItems: &tmp count: sizeof(tmp)];
+			buffer[0] = 0xD1;
+			memcpy(buffer + 1, &tmp, sizeof(tmp));
+			return 1 + sizeof(tmp);
 		} else if (value >= INT32_MIN && value <= INT32_MAX) {
-			uint8_t type = 0xD2;
 			int32_t tmp = OFToBigEndian32((int32_t)value);
 
-			data = [OFMutableData dataWithCapacity: 5];
-			[data addItem: &type];
-			[data addItems: &tmp count: sizeof(tmp)];
+			buffer[0] = 0xD2;
+			memcpy(buffer + 1, &tmp, sizeof(tmp));
+			return 1 + sizeof(tmp);
 		} else if (value >= INT64_MIN && value <= INT64_MAX) {
-			uint8_t type = 0xD3;
 			int64_t tmp = OFToBigEndian64((int64_t)value);
 
-			data = [OFMutableData dataWithCapacity: 9];
-			[data addItem: &type];
-			[data addItems: &tmp count: sizeof(tmp)];
+			buffer[0] = 0xD3;
+			memcpy(buffer + 1, &tmp, sizeof(tmp));
+			return 1 + sizeof(tmp);
 		} else
 			@throw [OFOutOfRangeException exception];
 	} else if (isUnsigned(self)) {
 		unsigned long long value = self.unsignedLongLongValue;
 
 		if (value <= 127) {
-			uint8_t tmp = ((uint8_t)value & 0x7F);
-			data = [OFMutableData dataWithItems: &tmp count: 1];
+			buffer[0] = ((uint8_t)value & 0x7F);
+			return 1;
 		} else if (value <= UINT8_MAX) {
-			uint8_t type = 0xCC;
-			uint8_t tmp = (uint8_t)value;
-
-			data = [OFMutableData dataWithCapacity: 2];
-			[data addItem: &type];
-			[data addItem: &tmp];
+			buffer[0] = 0xCC;
+			buffer[1] = (uint8_t)value;
+			return 2;
 		} else if (value <= UINT16_MAX) {
-			uint8_t type = 0xCD;
 			uint16_t tmp = OFToBigEndian16((uint16_t)value);
 
-			data = [OFMutableData dataWithCapacity: 3];
-			[data addItem: &type];
-			[data addItems: &tmp count: sizeof(tmp)];
+			buffer[0] = 0xCD;
+			memcpy(buffer + 1, &tmp, sizeof(tmp));
+			return 1 + sizeof(tmp);
 		} else if (value <= UINT32_MAX) {
-			uint8_t type = 0xCE;
 			uint32_t tmp = OFToBigEndian32((uint32_t)value);
 
-			data = [OFMutableData dataWithCapacity: 5];
-			[data addItem: &type];
-			[data addItems: &tmp count: sizeof(tmp)];
+			buffer[0] = 0xCE;
+			memcpy(buffer + 1, &tmp, sizeof(tmp));
+			return 1 + sizeof(tmp);
 		} else if (value <= UINT64_MAX) {
-			uint8_t type = 0xCF;
 			uint64_t tmp = OFToBigEndian64((uint64_t)value);
 
-			data = [OFMutableData dataWithCapacity: 9];
-			[data addItem: &type];
-			[data addItems: &tmp count: sizeof(tmp)];
+			buffer[0] = 0xCF;
+			memcpy(buffer + 1, &tmp, sizeof(tmp));
+			return 1 + sizeof(tmp);
 		} else
 			@throw [OFOutOfRangeException exception];
 	} else
 		@throw [OFInvalidFormatException exception];
+}
+
+- (OFData *)messagePackRepresentation
+{
+	uint8_t buffer[9];
+	size_t length = [self of_getMessagePackRepresentation: buffer];
+
+	return [OFData dataWithItems: buffer count: length];
+}
 
-	[data makeImmutable];
+- (void)writeMessagePackToStream: (OFStream *)stream
+{
+	uint8_t buffer[9];
+	size_t length = [self of_getMessagePackRepresentation: buffer];
 
-	return data;
+	[stream writeBuffer: buffer length: length];
 }
 @end
@@ -22,31 +22,290 @@
 #import "OFArray.h"
 #import "OFMethodSignature.h"
 #import "OFNumber.h"
+#import "OFOnce.h"
 #import "OFString.h"
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_ATOMIC_OPS)
+# import "OFAtomic.h"
+#endif
+#ifdef OF_HAVE_THREADS
+# import "OFPlainMutex.h"
+#endif
 
 #import "OFInvalidArgumentException.h"
 #import "OFOutOfMemoryException.h"
 #import "OFUndefinedKeyException.h"
 
+/*
+ * Resolving an accessor needs to register a selector, which takes the global
+ * runtime lock, and to create a method signature. Resolved accessors are
+ * therefore cached per class and key.
+ */
+struct KVCAccessor {
+	SEL selector;
+	IMP implementation;
+	/* A selector that takes precedence once it is implemented. */
+	SEL shadowingSelector;
+	char type;
+};
+
+struct KVCCacheEntry {
+	Class class;
+	OFString *key;
+	unsigned long hash;
+	struct KVCAccessor *volatile getter, *volatile setter;
+};
+
+/*
+ * The cache is an open addressing hash table that only ever grows, so that it
+ * can be read without taking a lock. Entries are never removed and replaced
+ * tables are never freed, as a reader might still use them. As only accessors
+ * that exist are cached, the size is bounded by the accessors of all classes.
+ */
+struct KVCCache {
+	size_t size, count;
+	struct KVCCacheEntry *volatile *entries;
+};
+
+static struct KVCCache *volatile cache = NULL;
+#ifdef OF_HAVE_THREADS
+static OFPlainMutex cacheMutex;
+static OFOnceControl cacheMutexOnceControl = OFOnceControlInitValue;
+#endif
+
 int _OFObject_KeyValueCoding_reference;
 
-@implementation OFObject (KeyValueCoding)
-- (id)valueForKey: (OFString *)key
+#ifdef OF_HAVE_THREADS
+static void
+initCacheMutex(void)
+{
+	OFEnsure(OFPlainMutexNew(&cacheMutex) == 0);
+}
+#endif
+
+static OF_INLINE void
+lockCache(void)
+{
+#ifdef OF_HAVE_THREADS
+	OFOnce(&cacheMutexOnceControl, initCacheMutex);
+	OFEnsure(OFPlainMutexLock(&cacheMutex) == 0);
+#endif
+}
+
+static OF_INLINE void
+unlockCache(void)
+{
+#ifdef OF_HAVE_THREADS
+	OFEnsure(OFPlainMutexUnlock(&cacheMutex) == 0);
+#endif
+}
+
+static OF_INLINE unsigned long
+cacheHash(Class class, OFString *key)
+{
+	return key.hash ^ (unsigned long)((uintptr_t)class >> 4);
+}
+
+static struct KVCCacheEntry *
+lookupEntry(struct KVCCache *cache_, Class class, OFString *key,
+    unsigned long hash)
+{
+	size_t mask;
+
+	if (cache_ == NULL)
+		return NULL;
+
+	mask = cache_->size - 1;
+
+	for (size_t i = hash & mask;; i = (i + 1) & mask) {
+		struct KVCCacheEntry *entry = cache_->entries[i];
+
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_ATOMIC_OPS)
+		OFAcquireMemoryBarrier();
+#endif
+
+		if (entry == NULL)
+			return NULL;
+
+		if (entry->class == class && entry->hash == hash &&
+		    (entry->key == key || [entry->key isEqual: key]))
+			return entry;
+	}
+}
+
+static struct KVCAccessor *
+cachedAccessor(Class class, OFString *key, bool setter)
+{
+	unsigned long hash = cacheHash(class, key);
+	struct KVCCacheEntry *entry;
+	struct KVCAccessor *accessor = NULL;
+
+#if defined(OF_HAVE_THREADS) && !defined(OF_HAVE_ATOMIC_OPS)
+	lockCache();
+	@try {
+#endif
+		struct KVCCache *cache_ = cache;
+
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_ATOMIC_OPS)
+		OFAcquireMemoryBarrier();
+#endif
+
+		if ((entry = lookupEntry(cache_, class, key, hash)) != NULL)
+			accessor = (setter ? entry->setter : entry->getter);
+#if defined(OF_HAVE_THREADS) && !defined(OF_HAVE_ATOMIC_OPS)
+	} @finally {
+		unlockCache();
+	}
+#endif
+
+	if (accessor == NULL)
+		return NULL;
+
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_ATOMIC_OPS)
+	OFAcquireMemoryBarrier();
+#endif
+
+	/* Methods might have been added or replaced since. */
+	if (class_getMethodImplementation(class, accessor->selector) !=
+	    accessor->implementation)
+		return NULL;
+
+	if (accessor->shadowingSelector != NULL &&
+	    class_respondsToSelector(class, accessor->shadowingSelector))
+		return NULL;
+
+	return accessor;
+}
+
+/* Needs to be called with the cache locked. */
+static void
+insertEntry(struct KVCCache *cache_, struct KVCCacheEntry *entry)
+{
+	size_t mask = cache_->size - 1;
+	size_t i;
+
+	for (i = entry->hash & mask; cache_->entries[i] != NULL;
+	    i = (i + 1) & mask);
+
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_ATOMIC_OPS)
+	/* Make the entry visible before publishing it. */
+	OFReleaseMemoryBarrier();
+#endif
+
+	cache_->entries[i] = entry;
+	cache_->count++;
+}
+
+/* Needs to be called with the cache locked. */
+static struct KVCCache *
+resizedCache(struct KVCCache *cache_)
+{
+	struct KVCCache *newCache;
+	size_t size = (cache_ != NULL ? cache_->size * 2 : 64);
+
+	newCache = OFAllocMemory(1, sizeof(*newCache));
+	@try {
+		newCache->entries = OFAllocZeroedMemory(size,
+		    sizeof(*newCache->entries));
+	} @catch (id e) {
+		OFFreeMemory(newCache);
+		@throw e;
+	}
+	newCache->size = size;
+	newCache->count = 0;
+
+	if (cache_ != NULL)
+		for (size_t i = 0; i < cache_->size; i++)
+			if (cache_->entries[i] != NULL)
+				insertEntry(newCache, cache_->entries[i]);
+
+	return newCache;
+}
+
+static void
+cacheAccessor(Class class, OFString *key, bool setter,
+    const struct KVCAccessor *accessor_)
+{
+	unsigned long hash = cacheHash(class, key);
+	struct KVCAccessor *accessor;
+
+	accessor = OFAllocMemory(1, sizeof(*accessor));
+	*accessor = *accessor_;
+
+	lockCache();
+	@try {
+		struct KVCCache *cache_ = cache;
+		struct KVCCacheEntry *entry;
+
+		if ((entry = lookupEntry(cache_, class, key, hash)) == NULL) {
+			if (cache_ == NULL ||
+			    (cache_->count + 1) * 4 > cache_->size * 3) {
+				cache_ = resizedCache(cache_);
+
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_ATOMIC_OPS)
+				OFReleaseMemoryBarrier();
+#endif
+				cache = cache_;
+			}
+
+			entry = OFAllocZeroedMemory(1, sizeof(*entry));
+			@try {
+				entry->key = [key copy];
+			} @catch (id e) {
+				OFFreeMemory(entry);
+				@throw e;
+			}
+			entry->class = class;
+			entry->hash = hash;
+
+			insertEntry(cache_, entry);
+		}
+
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_ATOMIC_OPS)
+		OFReleaseMemoryBarrier();
+#endif
+
+		/*
+		 * An accessor that is replaced is leaked, as a reader might
+		 * still use it. This only happens if methods are replaced at
+		 * runtime.
+		 */
+		if (setter)
+			entry->setter = accessor;
+		else
+			entry->getter = accessor;
+	} @catch (id e) {
+		OFFreeMemory(accessor);
+		@throw e;
+	} @finally {
+		unlockCache();
+	}
+}
+
+/*
+ * Only methods implemented by the class are cached, as a class that forwards
+ * them might return a different method signature for each instance.
+ */
+static OF_INLINE bool
+isCacheable(Class class, SEL selector)
+{
+	return (class_getInstanceMethod(class, selector) != NULL);
+}
+
+static bool
+resolveGetter(id self, OFString *key, struct KVCAccessor *accessor)
 {
-	void *pool = objc_autoreleasePoolPush();
 	SEL selector = sel_registerName(key.UTF8String);
 	OFMethodSignature *methodSignature =
 	    [self methodSignatureForSelector: selector];
-	id ret;
+
+	accessor->shadowingSelector = NULL;
 
 	if (methodSignature == nil) {
 		size_t keyLength;
 		char *name;
 
-		if ((keyLength = key.UTF8StringLength) < 1) {
-			objc_autoreleasePoolPop(pool);
-			return [self valueForUndefinedKey: key];
-		}
+		if ((keyLength = key.UTF8StringLength) < 1)
+			return false;
 
 		name = OFAllocMemory(keyLength + 3, 1);
 		@try {
@@ -56,6 +315,7 @@ int _OFObject_KeyValueCoding_reference;
 
 			name[2] = OFASCIIToUpper(name[2]);
 
+			accessor->shadowingSelector = selector;
 			selector = sel_registerName(name);
 		} @finally {
 			OFFreeMemory(name);
@@ -63,39 +323,104 @@ int _OFObject_KeyValueCoding_reference;
 
 		methodSignature = [self methodSignatureForSelector: selector];
 
-		if (methodSignature == NULL) {
-			objc_autoreleasePoolPop(pool);
-			return [self valueForUndefinedKey: key];
-		}
+		if (methodSignature == NULL)
+			return false;
 
 		switch (*methodSignature.methodReturnType) {
 		case '@':
 		case '#':
-			objc_autoreleasePoolPop(pool);
-			return [self valueForUndefinedKey: key];
+			return false;
 		}
 	}
 
 	if (methodSignature.numberOfArguments != 2 ||
 	    *[methodSignature argumentTypeAtIndex: 0] != '@' ||
-	    *[methodSignature argumentTypeAtIndex: 1] != ':') {
+	    *[methodSignature argumentTypeAtIndex: 1] != ':')
+		return false;
+
+	accessor->selector = selector;
+	accessor->implementation = [self methodForSelector: selector];
+	accessor->type = *methodSignature.methodReturnType;
+
+	return true;
+}
+
+static bool
+resolveSetter(id self, OFString *key, struct KVCAccessor *accessor)
+{
+	size_t keyLength;
+	char *name;
+	SEL selector;
+	OFMethodSignature *methodSignature;
+
+	if ((keyLength = key.UTF8StringLength) < 1)
+		return false;
+
+	name = OFAllocMemory(keyLength + 5, 1);
+	@try {
+		memcpy(name, "set", 3);
+		memcpy(name + 3, key.UTF8String, keyLength);
+		memcpy(name + keyLength + 3, ":", 2);
+
+		name[3] = OFASCIIToUpper(name[3]);
+
+		selector = sel_registerName(name);
+	} @finally {
+		OFFreeMemory(name);
+	}
+
+	methodSignature = [self methodSignatureForSelector: selector];
+
+	if (methodSignature == nil ||
+	    methodSignature.numberOfArguments != 3 ||
+	    *methodSignature.methodReturnType != 'v' ||
+	    *[methodSignature argumentTypeAtIndex: 0] != '@' ||
+	    *[methodSignature argumentTypeAtIndex: 1] != ':')
+		return false;
+
+	accessor->selector = selector;
+	accessor->implementation = [self methodForSelector: selector];
+	accessor->shadowingSelector = NULL;
+	accessor->type = *[methodSignature argumentTypeAtIndex: 2];
+
+	return true;
+}
+
+@implementation OFObject (KeyValueCoding)
+- (id)valueForKey: (OFString *)key
+{
+	Class class = object_getClass(self);
+	const struct KVCAccessor *accessor;
+	struct KVCAccessor resolved;
+	SEL selector;
+	IMP implementation;
+
+	if ((accessor = cachedAccessor(class, key, false)) == NULL) {
+		void *pool = objc_autoreleasePoolPush();
+		bool found = resolveGetter(self, key, &resolved);
+
 		objc_autoreleasePoolPop(pool);
-		return [self valueForUndefinedKey: key];
+
+		if (!found)
+			return [self valueForUndefinedKey: key];
+
+		if (isCacheable(class, resolved.selector))
+			cacheAccessor(class, key, false, &resolved);
+
+		accessor = &resolved;
 	}
 
-	switch (*methodSignature.methodReturnType) {
+	selector = accessor->selector;
+	implementation = accessor->implementation;
+
+	switch (accessor->type) {
 	case '@':
 	case '#':
-		ret = [self performSelector: selector];
-		break;
-#define CASE(encoding, type, method)					  \
-	case encoding:							  \
-		{							  \
-			type (*getter)(id, SEL) = (type (*)(id, SEL))	  \
-			    [self methodForSelector: selector];		  \
-			ret = [OFNumber method getter(self, selector)]; \
-		}							  \
-		break;
+		return ((id (*)(id, SEL))implementation)(self, selector);
+#define CASE(encoding, type, method)					\
+	case encoding:							\
+		return [OFNumber method					\
+		    ((type (*)(id, SEL))implementation)(self, selector)];
 	CASE('B', bool, numberWithBool:)
 	CASE('c', char, numberWithChar:)
 	CASE('s', short, numberWithShort:)
@@ -111,15 +436,8 @@ int _OFObject_KeyValueCoding_reference;
 	CASE('d', double, numberWithDouble:)
 #undef CASE
 	default:
-		objc_autoreleasePoolPop(pool);
 		return [self valueForUndefinedKey: key];
 	}
-
-	[ret retain];
-
-	objc_autoreleasePoolPop(pool);
-
-	return [ret autorelease];
 }
 
 - (id)valueForKeyPath: (OFString *)keyPath
@@ -144,69 +462,46 @@ int _OFObject_KeyValueCoding_reference;
 
 - (void)setValue: (id)value forKey: (OFString *)key
 {
-	void *pool = objc_autoreleasePoolPush();
-	size_t keyLength;
-	char *name;
+	Class class = object_getClass(self);
+	const struct KVCAccessor *accessor;
+	struct KVCAccessor resolved;
 	SEL selector;
-	OFMethodSignature *methodSignature;
-	const char *valueType;
+	IMP implementation;
 
-	if ((keyLength = key.UTF8StringLength) < 1) {
-		objc_autoreleasePoolPop(pool);
-		[self setValue: value forUndefinedKey: key];
-		return;
-	}
+	if ((accessor = cachedAccessor(class, key, true)) == NULL) {
+		void *pool = objc_autoreleasePoolPush();
+		bool found = resolveSetter(self, key, &resolved);
 
-	name = OFAllocMemory(keyLength + 5, 1);
-	@try {
-		memcpy(name, "set", 3);
-		memcpy(name + 3, key.UTF8String, keyLength);
-		memcpy(name + keyLength + 3, ":", 2);
-
-		name[3] = OFASCIIToUpper(name[3]);
+		objc_autoreleasePoolPop(pool);
 
-		selector = sel_registerName(name);
-	} @finally {
-		OFFreeMemory(name);
-	}
+		if (!found) {
+			[self setValue: value forUndefinedKey: key];
+			return;
+		}
 
-	methodSignature = [self methodSignatureForSelector: selector];
+		if (isCacheable(class, resolved.selector))
+			cacheAccessor(class, key, true, &resolved);
 
-	if (methodSignature == nil ||
-	    methodSignature.numberOfArguments != 3 ||
-	    *methodSignature.methodReturnType != 'v' ||
-	    *[methodSignature argumentTypeAtIndex: 0] != '@' ||
-	    *[methodSignature argumentTypeAtIndex: 1] != ':') {
-		objc_autoreleasePoolPop(pool);
-		[self setValue: value forUndefinedKey: key];
-		return;
+		accessor = &resolved;
 	}
 
-	valueType = [methodSignature argumentTypeAtIndex: 2];
-
-	if (*valueType != '@' && *valueType != '#' && value == nil) {
-		objc_autoreleasePoolPop(pool);
+	if (accessor->type != '@' && accessor->type != '#' && value == nil) {
 		[self setNilValueForKey: key];
 		return;
 	}
 
-	switch (*valueType) {
+	selector = accessor->selector;
+	implementation = accessor->implementation;
+
+	switch (accessor->type) {
 	case '@':
 	case '#':
-		{
-			void (*setter)(id, SEL, id) = (void (*)(id, SEL, id))
-			    [self methodForSelector: selector];
-			setter(self, selector, value);
-		}
+		((void (*)(id, SEL, id))implementation)(self, selector, value);
 		break;
-#define CASE(encoding, type, method) \
-	case encoding:						\
-		{						\
-			void (*setter)(id, SEL, type) =		\
-			    (void (*)(id, SEL, type))		\
-			    [self methodForSelector: selector];	\
-			setter(self, selector, [value method]);	\
-		}						\
+#define CASE(encoding, type, method)					\
+	case encoding:							\
+		((void (*)(id, SEL, type))implementation)(self, selector, \
+		    [value method]);					\
 		break;
 	CASE('B', bool, boolValue)
 	CASE('c', char, charValue)
@@ -223,12 +518,9 @@ int _OFObject_KeyValueCoding_reference;
 	CASE('d', double, doubleValue)
 #undef CASE
 	default:
-		objc_autoreleasePoolPop(pool);
 		[self setValue: value forUndefinedKey: key];
 		return;
 	}
-
-	objc_autoreleasePoolPop(pool);
 }
 
 - (void)setValue: (id)value forKeyPath: (OFString *)keyPath
@@ -42,6 +42,7 @@
 #import "OFLocale.h"
 #import "OFMethodSignature.h"
 #import "OFRunLoop.h"
+#import "OFRunLoop+Private.h"
 #if !defined(OF_HAVE_ATOMIC_OPS) && defined(OF_HAVE_THREADS)
 # import "OFPlainMutex.h"	/* For OFSpinlock */
 #endif
@@ -855,17 +856,11 @@ _references_to_categories_of_OFObject(void)
 	       onThread: (OFThread *)thread
 	  waitUntilDone: (bool)waitUntilDone
 {
-	void *pool = objc_autoreleasePoolPush();
-	OFTimer *timer = [OFTimer timerWithTimeInterval: 0
-						 target: self
-					       selector: selector
-						repeats: false];
-	[thread.runLoop addTimer: timer];
-
-	if (waitUntilDone)
-		[timer waitUntilDone];
-
-	objc_autoreleasePoolPop(pool);
+	[thread.runLoop of_performSelector: selector
+				    target: self
+				   objects: NULL
+				     count: 0
+			     waitUntilDone: waitUntilDone];
 }
 
 - (void)performSelector: (SEL)selector
@@ -873,18 +868,11 @@ _references_to_categories_of_OFObject(void)
 	     withObject: (id)object
 	  waitUntilDone: (bool)waitUntilDone
 {
-	void *pool = objc_autoreleasePoolPush();
-	OFTimer *timer = [OFTimer timerWithTimeInterval: 0
-						 target: self
-					       selector: selector
-						 object: object
-						repeats: false];
-	[thread.runLoop addTimer: timer];
-
-	if (waitUntilDone)
-		[timer waitUntilDone];
-
-	objc_autoreleasePoolPop(pool);
+	[thread.runLoop of_performSelector: selector
+				    target: self
+				   objects: &object
+				     count: 1
+			     waitUntilDone: waitUntilDone];
 }
 
 - (void)performSelector: (SEL)selector
@@ -893,19 +881,13 @@ _references_to_categories_of_OFObject(void)
 	     withObject: (id)object2
 	  waitUntilDone: (bool)waitUntilDone
 {
-	void *pool = objc_autoreleasePoolPush();
-	OFTimer *timer = [OFTimer timerWithTimeInterval: 0
-						 target: self
-					       selector: selector
-						 object: object1
-						 object: object2
-						repeats: false];
-	[thread.runLoop addTimer: timer];
-
-	if (waitUntilDone)
-		[timer waitUntilDone];
+	id objects[] = { object1, object2 };
 
-	objc_autoreleasePoolPop(pool);
+	[thread.runLoop of_performSelector: selector
+				    target: self
+				   objects: objects
+				     count: 2
+			     waitUntilDone: waitUntilDone];
 }
 
 - (void)performSelector: (SEL)selector
@@ -915,20 +897,13 @@ _references_to_categories_of_OFObject(void)
 	     withObject: (id)object3
 	  waitUntilDone: (bool)waitUntilDone
 {
-	void *pool = objc_autoreleasePoolPush();
-	OFTimer *timer = [OFTimer timerWithTimeInterval: 0
-						 target: self
-					       selector: selector
-						 object: object1
-						 object: object2
-						 object: object3
-						repeats: false];
-	[thread.runLoop addTimer: timer];
-
-	if (waitUntilDone)
-		[timer waitUntilDone];
+	id objects[] = { object1, object2, object3 };
 
-	objc_autoreleasePoolPop(pool);
+	[thread.runLoop of_performSelector: selector
+				    target: self
+				   objects: objects
+				     count: 3
+			     waitUntilDone: waitUntilDone];
 }
 
 - (void)performSelector: (SEL)selector
@@ -939,55 +914,34 @@ _references_to_categories_of_OFObject(void)
 	     withObject: (id)object4
 	  waitUntilDone: (bool)waitUntilDone
 {
-	void *pool = objc_autoreleasePoolPush();
-	OFTimer *timer = [OFTimer timerWithTimeInterval: 0
-						 target: self
-					       selector: selector
-						 object: object1
-						 object: object2
-						 object: object3
-						 object: object4
-						repeats: false];
-	[thread.runLoop addTimer: timer];
-
-	if (waitUntilDone)
-		[timer waitUntilDone];
+	id objects[] = { object1, object2, object3, object4 };
 
-	objc_autoreleasePoolPop(pool);
+	[thread.runLoop of_performSelector: selector
+				    target: self
+				   objects: objects
+				     count: 4
+			     waitUntilDone: waitUntilDone];
 }
 
 - (void)performSelectorOnMainThread: (SEL)selector
 		      waitUntilDone: (bool)waitUntilDone
 {
-	void *pool = objc_autoreleasePoolPush();
-	OFTimer *timer = [OFTimer timerWithTimeInterval: 0
-						 target: self
-					       selector: selector
-						repeats: false];
-	[[OFRunLoop mainRunLoop] addTimer: timer];
-
-	if (waitUntilDone)
-		[timer waitUntilDone];
-
-	objc_autoreleasePoolPop(pool);
+	[[OFRunLoop mainRunLoop] of_performSelector: selector
+					     target: self
+					    objects: NULL
+					      count: 0
+				      waitUntilDone: waitUntilDone];
 }
 
 - (void)performSelectorOnMainThread: (SEL)selector
 			 withObject: (id)object
 		      waitUntilDone: (bool)waitUntilDone
 {
-	void *pool = objc_autoreleasePoolPush();
-	OFTimer *timer = [OFTimer timerWithTimeInterval: 0
-						 target: self
-					       selector: selector
-						 object: object
-						repeats: false];
-	[[OFRunLoop mainRunLoop] addTimer: timer];
-
-	if (waitUntilDone)
-		[timer waitUntilDone];
-
-	objc_autoreleasePoolPop(pool);
+	[[OFRunLoop mainRunLoop] of_performSelector: selector
+					     target: self
+					    objects: &object
+					      count: 1
+				      waitUntilDone: waitUntilDone];
 }
 
 - (void)performSelectorOnMainThread: (SEL)selector
@@ -995,19 +949,13 @@ _references_to_categories_of_OFObject(void)
 			 withObject: (id)object2
 		      waitUntilDone: (bool)waitUntilDone
 {
-	void *pool = objc_autoreleasePoolPush();
-	OFTimer *timer = [OFTimer timerWithTimeInterval: 0
-						 target: self
-					       selector: selector
-						 object: object1
-						 object: object2
-						repeats: false];
-	[[OFRunLoop mainRunLoop] addTimer: timer];
-
-	if (waitUntilDone)
-		[timer waitUntilDone];
+	id objects[] = { object1, object2 };
 
-	objc_autoreleasePoolPop(pool);
+	[[OFRunLoop mainRunLoop] of_performSelector: selector
+					     target: self
+					    objects: objects
+					      count: 2
+				      waitUntilDone: waitUntilDone];
 }
 
 - (void)performSelectorOnMainThread: (SEL)selector
@@ -1016,20 +964,13 @@ _references_to_categories_of_OFObject(void)
 			 withObject: (id)object3
 		      waitUntilDone: (bool)waitUntilDone
 {
-	void *pool = objc_autoreleasePoolPush();
-	OFTimer *timer = [OFTimer timerWithTimeInterval: 0
-						 target: self
-					       selector: selector
-						 object: object1
-						 object: object2
-						 object: object3
-						repeats: false];
-	[[OFRunLoop mainRunLoop] addTimer: timer];
-
-	if (waitUntilDone)
-		[timer waitUntilDone];
+	id objects[] = { object1, object2, object3 };
 
-	objc_autoreleasePoolPop(pool);
+	[[OFRunLoop mainRunLoop] of_performSelector: selector
+					     target: self
+					    objects: objects
+					      count: 3
+				      waitUntilDone: waitUntilDone];
 }
 
 - (void)performSelectorOnMainThread: (SEL)selector
@@ -1039,21 +980,13 @@ _references_to_categories_of_OFObject(void)
 			 withObject: (id)object4
 		      waitUntilDone: (bool)waitUntilDone
 {
-	void *pool = objc_autoreleasePoolPush();
-	OFTimer *timer = [OFTimer timerWithTimeInterval: 0
-						 target: self
-					       selector: selector
-						 object: object1
-						 object: object2
-						 object: object3
-						 object: object4
-						repeats: false];
-	[[OFRunLoop mainRunLoop] addTimer: timer];
-
-	if (waitUntilDone)
-		[timer waitUntilDone];
+	id objects[] = { object1, object2, object3, object4 };
 
-	objc_autoreleasePoolPop(pool);
+	[[OFRunLoop mainRunLoop] of_performSelector: selector
+					     target: self
+					    objects: objects
+					      count: 4
+				      waitUntilDone: waitUntilDone];
 }
 
 - (void)performSelector: (SEL)selector
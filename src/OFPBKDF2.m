@@ -19,6 +19,7 @@
 
 #import "OFPBKDF2.h"
 #import "OFHMAC.h"
+#import "OFHMAC+Private.h"
 #import "OFSecureData.h"
 
 #import "OFInvalidArgumentException.h"
@@ -77,16 +78,27 @@ OFPBKDF2(OFPBKDF2Parameters param)
 			memcpy(bufferItems, param.HMAC.digest, digestSize);
 			memcpy(digestItems, param.HMAC.digest, digestSize);
 
-			for (size_t j = 1; j < param.iterations; j++) {
-				[param.HMAC reset];
-				[param.HMAC updateWithBuffer: digestItems
+			/*
+			 * For the built-in hashes, iterate on the compression
+			 * function directly instead of sending messages.
+			 */
+			if (![param.HMAC
+			    of_PBKDF2IterateWithDigest: digestItems
+					   accumulator: bufferItems
+					    iterations: param.iterations - 1]) {
+				for (size_t j = 1; j < param.iterations; j++) {
+					[param.HMAC reset];
+					[param.HMAC
+					    updateWithBuffer: digestItems
 						      length: digestSize];
-				[param.HMAC calculate];
-				memcpy(digestItems, param.HMAC.digest,
-				    digestSize);
-
-				for (size_t k = 0; k < digestSize; k++)
-					bufferItems[k] ^= digestItems[k];
+					[param.HMAC calculate];
+					memcpy(digestItems, param.HMAC.digest,
+					    digestSize);
+
+					for (size_t k = 0; k < digestSize; k++)
+						bufferItems[k] ^=
+						    digestItems[k];
+				}
 			}
 
 			length = digestSize;
@@ -26,7 +26,12 @@
 #import "OFObject.h"
 #import "OFPlainMutex.h"
 
-#if defined(OF_HAVE_PTHREADS)
+#if defined(OF_HAVE_FUTEXES)
+typedef struct {
+	volatile int sequence;
+	volatile int waitersCount;
+} OFPlainCondition;
+#elif defined(OF_HAVE_PTHREADS)
 # include <pthread.h>
 typedef pthread_cond_t OFPlainCondition;
 #elif defined(OF_WINDOWS)
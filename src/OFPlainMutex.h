@@ -26,7 +26,13 @@
 
 #import "macros.h"
 
-#if defined(OF_HAVE_PTHREADS)
+#if defined(OF_HAVE_FUTEXES)
+# include <pthread.h>
+typedef struct {
+	volatile int state;
+	volatile int spins;
+} OFPlainMutex;
+#elif defined(OF_HAVE_PTHREADS)
 # include <pthread.h>
 typedef pthread_mutex_t OFPlainMutex;
 #elif defined(OF_WINDOWS)
@@ -50,7 +56,13 @@ typedef OFPlainMutex OFSpinlock;
 # include <sched.h>
 #endif
 
-#if defined(OF_HAVE_RECURSIVE_PTHREAD_MUTEXES) || defined(OF_WINDOWS) || \
+#if defined(OF_HAVE_FUTEXES)
+typedef struct {
+	OFPlainMutex mutex;
+	volatile pthread_t owner;
+	unsigned int count;
+} OFPlainRecursiveMutex;
+#elif defined(OF_HAVE_RECURSIVE_PTHREAD_MUTEXES) || defined(OF_WINDOWS) || \
     defined(OF_AMIGAOS)
 # define OFPlainRecursiveMutex OFPlainMutex
 #else
@@ -17,7 +17,9 @@
 
 #include "platform.h"
 
-#if defined(OF_HAVE_PTHREADS)
+#if defined(OF_HAVE_FUTEXES)
+# include "platform/Linux/OFPlainMutex.m"
+#elif defined(OF_HAVE_PTHREADS)
 # include "platform/POSIX/OFPlainMutex.m"
 #elif defined(OF_WINDOWS)
 # include "platform/Windows/OFPlainMutex.m"
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#import "OFObject.h"
+#import "OFLocking.h"
+#import "OFPlainCondition.h"
+#import "OFPlainMutex.h"
+
+OF_ASSUME_NONNULL_BEGIN
+
+/**
+ * @class OFReadWriteLock OFReadWriteLock.h ObjFW/OFReadWriteLock.h
+ *
+ * @brief A lock that can be held by multiple readers or a single writer.
+ *
+ * The methods from @ref OFLocking acquire and release the lock for writing.
+ * Writers are preferred: Once a writer is waiting, new readers wait until it
+ * acquired and released the lock.
+ *
+ * @note The lock is not recursive. Acquiring it for reading again while already
+ *	 holding it for reading deadlocks if a writer is waiting.
+ */
+OF_SUBCLASSING_RESTRICTED
+@interface OFReadWriteLock: OFObject <OFLocking>
+{
+	OFPlainMutex _mutex;
+	OFPlainCondition _condition;
+	bool _mutexInitialized, _conditionInitialized;
+	volatile int _state;
+	volatile int _waitingReadersCount, _waitingWritersCount;
+	OFString *_Nullable _name;
+}
+
+/**
+ * @brief Creates a new read-write lock.
+ *
+ * @return A new, autoreleased read-write lock
+ */
++ (instancetype)readWriteLock;
+
+/**
+ * @brief Acquires the lock for reading.
+ *
+ * Multiple threads can hold the lock for reading at the same time.
+ */
+- (void)readLock;
+
+/**
+ * @brief Tries to acquire the lock for reading.
+ *
+ * @return Whether the lock could be acquired for reading
+ */
+- (bool)tryReadLock;
+
+/**
+ * @brief Acquires the lock for writing.
+ */
+- (void)lock;
+
+/**
+ * @brief Tries to acquire the lock for writing.
+ *
+ * @return Whether the lock could be acquired for writing
+ */
+- (bool)tryLock;
+
+/**
+ * @brief Releases the lock, no matter whether it was acquired for reading or
+ *	  writing.
+ */
+- (void)unlock;
+@end
+
+OF_ASSUME_NONNULL_END
@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+
+#import "OFReadWriteLock.h"
+#import "OFString.h"
+
+#import "OFInitializationFailedException.h"
+#import "OFLockFailedException.h"
+#import "OFStillLockedException.h"
+#import "OFUnlockFailedException.h"
+
+/*
+ * _state is the number of readers holding the lock, or writerState if a writer
+ * holds the lock. Without atomic operations, it is only changed with _mutex
+ * held.
+ */
+static const int writerState = 1 << 30;
+
+static OF_INLINE bool
+compareAndSwapState(volatile int *state, int oldState, int newState)
+{
+#ifdef OF_HAVE_ATOMIC_OPS
+	return OFAtomicIntCompareAndSwap(state, oldState, newState);
+#else
+	if (*state != oldState)
+		return false;
+
+	*state = newState;
+	return true;
+#endif
+}
+
+@implementation OFReadWriteLock
+@synthesize name = _name;
+
++ (instancetype)readWriteLock
+{
+	return [[[self alloc] init] autorelease];
+}
+
+- (instancetype)init
+{
+	self = [super init];
+
+	if (OFPlainMutexNew(&_mutex) != 0) {
+		Class c = self.class;
+		[self release];
+		@throw [OFInitializationFailedException exceptionWithClass: c];
+	}
+
+	_mutexInitialized = true;
+
+	if (OFPlainConditionNew(&_condition) != 0) {
+		Class c = self.class;
+		[self release];
+		@throw [OFInitializationFailedException exceptionWithClass: c];
+	}
+
+	_conditionInitialized = true;
+
+	return self;
+}
+
+- (void)dealloc
+{
+	if (_state != 0)
+		@throw [OFStillLockedException exceptionWithLock: self];
+
+	if (_conditionInitialized)
+		OFEnsure(OFPlainConditionFree(&_condition) == 0);
+
+	if (_mutexInitialized)
+		OFEnsure(OFPlainMutexFree(&_mutex) == 0);
+
+	[_name release];
+
+	[super dealloc];
+}
+
+- (void)of_lockMutex
+{
+	int error = OFPlainMutexLock(&_mutex);
+
+	if (error != 0)
+		@throw [OFLockFailedException exceptionWithLock: self
+							  errNo: error];
+}
+
+- (void)of_waitWhileLocking
+{
+	int error = OFPlainConditionWait(&_condition, &_mutex);
+
+	if (error != 0)
+		@throw [OFLockFailedException exceptionWithLock: self
+							  errNo: error];
+}
+
+- (void)readLock
+{
+	int state;
+
+#ifdef OF_HAVE_ATOMIC_OPS
+	state = _state;
+
+	/* Fast path: Neither does a writer hold the lock nor wait for it. */
+	while (!(state & writerState) && _waitingWritersCount == 0) {
+		if (OFAtomicIntCompareAndSwap(&_state, state, state + 1)) {
+			OFAcquireMemoryBarrier();
+			return;
+		}
+
+		state = _state;
+	}
+#endif
+
+	[self of_lockMutex];
+	_waitingReadersCount++;
+	@try {
+#ifdef OF_HAVE_ATOMIC_OPS
+		/* Pairs with the barrier in -[unlock]. */
+		OFMemoryBarrier();
+#endif
+
+		for (;;) {
+			state = _state;
+
+			if (!(state & writerState) &&
+			    _waitingWritersCount == 0) {
+				if (compareAndSwapState(&_state, state,
+				    state + 1))
+					break;
+
+				continue;
+			}
+
+			[self of_waitWhileLocking];
+		}
+	} @finally {
+		_waitingReadersCount--;
+		OFPlainMutexUnlock(&_mutex);
+	}
+
+#ifdef OF_HAVE_ATOMIC_OPS
+	OFAcquireMemoryBarrier();
+#endif
+}
+
+- (bool)tryReadLock
+{
+#ifdef OF_HAVE_ATOMIC_OPS
+	int state;
+
+	while (!((state = _state) & writerState)) {
+		if (OFAtomicIntCompareAndSwap(&_state, state, state + 1)) {
+			OFAcquireMemoryBarrier();
+			return true;
+		}
+	}
+
+	return false;
+#else
+	bool locked;
+
+	[self of_lockMutex];
+	locked = !(_state & writerState);
+	if (locked)
+		_state++;
+	OFPlainMutexUnlock(&_mutex);
+
+	return locked;
+#endif
+}
+
+- (void)lock
+{
+#ifdef OF_HAVE_ATOMIC_OPS
+	if (OFAtomicIntCompareAndSwap(&_state, 0, writerState)) {
+		OFAcquireMemoryBarrier();
+		return;
+	}
+#endif
+
+	[self of_lockMutex];
+	_waitingWritersCount++;
+	@try {
+#ifdef OF_HAVE_ATOMIC_OPS
+		/* Pairs with the barrier in -[unlock]. */
+		OFMemoryBarrier();
+#endif
+
+		while (!compareAndSwapState(&_state, 0, writerState))
+			[self of_waitWhileLocking];
+	} @finally {
+		/*
+		 * If waiting failed, readers that waited for us need to be
+		 * woken up, which does not hurt otherwise.
+		 */
+		if (--_waitingWritersCount == 0 && _waitingReadersCount > 0 &&
+		    !(_state & writerState))
+			OFPlainConditionBroadcast(&_condition);
+
+		OFPlainMutexUnlock(&_mutex);
+	}
+
+#ifdef OF_HAVE_ATOMIC_OPS
+	OFAcquireMemoryBarrier();
+#endif
+}
+
+- (bool)tryLock
+{
+#ifdef OF_HAVE_ATOMIC_OPS
+	if (!OFAtomicIntCompareAndSwap(&_state, 0, writerState))
+		return false;
+
+	OFAcquireMemoryBarrier();
+
+	return true;
+#else
+	bool locked;
+
+	[self of_lockMutex];
+	locked = compareAndSwapState(&_state, 0, writerState);
+	OFPlainMutexUnlock(&_mutex);
+
+	return locked;
+#endif
+}
+
+- (void)unlock
+{
+	int state, newState, error;
+
+#ifdef OF_HAVE_ATOMIC_OPS
+	OFReleaseMemoryBarrier();
+#else
+	[self of_lockMutex];
+#endif
+
+	do {
+		state = _state;
+
+		if (state == 0) {
+#ifndef OF_HAVE_ATOMIC_OPS
+			OFPlainMutexUnlock(&_mutex);
+#endif
+			@throw [OFUnlockFailedException
+			    exceptionWithLock: self
+					errNo: EPERM];
+		}
+
+		newState = (state == writerState ? 0 : state - 1);
+	} while (!compareAndSwapState(&_state, state, newState));
+
+#ifdef OF_HAVE_ATOMIC_OPS
+	/* Pairs with the barriers in -[readLock] and -[lock]. */
+	OFMemoryBarrier();
+
+	if (newState != 0 ||
+	    (_waitingReadersCount == 0 && _waitingWritersCount == 0))
+		return;
+
+	/*
+	 * Taking the mutex makes sure that waiters either see the new state or
+	 * are already waiting on the condition.
+	 */
+	[self of_lockMutex];
+#else
+	if (newState != 0 ||
+	    (_waitingReadersCount == 0 && _waitingWritersCount == 0)) {
+		OFPlainMutexUnlock(&_mutex);
+		return;
+	}
+#endif
+
+	error = OFPlainConditionBroadcast(&_condition);
+	OFPlainMutexUnlock(&_mutex);
+
+	if (error != 0)
+		@throw [OFUnlockFailedException exceptionWithLock: self
+							    errNo: error];
+}
+
+- (OFString *)description
+{
+	if (_name == nil)
+		return super.description;
+
+	return [OFString stringWithFormat: @"<%@: %@>", self.className, _name];
+}
+@end
@@ -123,6 +123,13 @@ OF_DIRECT_MEMBERS
 + (void)of_cancelAsyncRequestsForObject: (id)object mode: (OFRunLoopMode)mode;
 #endif
 - (void)of_removeTimer: (OFTimer *)timer forMode: (OFRunLoopMode)mode;
+#ifdef OF_HAVE_THREADS
+- (void)of_performSelector: (SEL)selector
+		    target: (id)target
+		   objects: (nullable id const *)objects
+		     count: (uint8_t)count
+	     waitUntilDone: (bool)waitUntilDone;
+#endif
 @end
 
 OF_ASSUME_NONNULL_END
@@ -28,6 +28,7 @@ OF_ASSUME_NONNULL_BEGIN
 #ifdef OF_HAVE_THREADS
 @class OFMutex;
 @class OFCondition;
+@class OFRunLoopMessage;
 #endif
 #ifdef OF_HAVE_SOCKETS
 @class OFKernelEventObserver;
@@ -63,6 +64,8 @@ OF_SUBCLASSING_RESTRICTED
 	OFMutableDictionary *_states;
 #ifdef OF_HAVE_THREADS
 	OFMutex *_statesMutex;
+	OFRunLoopMessage *_Nullable volatile _messages;
+	OFRunLoopMessage *_Nullable _pendingMessages;
 #endif
 	OFRunLoopMode _Nullable _currentMode;
 	volatile bool _stop;
@@ -36,6 +36,9 @@
 # import "OFMutex.h"
 # import "OFCondition.h"
 #endif
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_ATOMIC_OPS)
+# import "OFAtomic.h"
+#endif
 #import "OFSortedList.h"
 #import "OFTimer.h"
 #import "OFTimer+Private.h"
@@ -201,6 +204,24 @@ static OFRunLoop *mainRunLoop = nil;
 @end
 #endif
 
+#ifdef OF_HAVE_THREADS
+/* A message sent to the run loop from another thread. */
+@interface OFRunLoopMessage: OFObject
+{
+@public
+	OFRunLoopMessage *_next;
+	id _target;
+	SEL _selector;
+	id _objects[4];
+	uint8_t _objectsCount;
+	OFCondition *_condition;
+	bool _done;
+}
+
+- (void)perform;
+@end
+#endif
+
 @implementation OFRunLoopState
 - (instancetype)init
 {
@@ -1007,6 +1028,60 @@ static OFRunLoop *mainRunLoop = nil;
 @end
 #endif
 
+#ifdef OF_HAVE_THREADS
+@implementation OFRunLoopMessage
+- (void)dealloc
+{
+	[_target release];
+	for (uint8_t i = 0; i < _objectsCount; i++)
+		[_objects[i] release];
+	[_condition release];
+
+	[super dealloc];
+}
+
+- (void)perform
+{
+	@try {
+		switch (_objectsCount) {
+		case 0:
+			[_target performSelector: _selector];
+			break;
+		case 1:
+			[_target performSelector: _selector
+				      withObject: _objects[0]];
+			break;
+		case 2:
+			[_target performSelector: _selector
+				      withObject: _objects[0]
+				      withObject: _objects[1]];
+			break;
+		case 3:
+			[_target performSelector: _selector
+				      withObject: _objects[0]
+				      withObject: _objects[1]
+				      withObject: _objects[2]];
+			break;
+		case 4:
+			[_target performSelector: _selector
+				      withObject: _objects[0]
+				      withObject: _objects[1]
+				      withObject: _objects[2]
+				      withObject: _objects[3]];
+			break;
+		}
+	} @finally {
+		if (_condition != nil) {
+			[_condition lock];
+			_done = true;
+			[_condition signal];
+			[_condition unlock];
+		}
+	}
+}
+@end
+#endif
+
 @implementation OFRunLoop
 @synthesize currentMode = _currentMode;
 
@@ -1057,6 +1132,122 @@ stateForMode(OFRunLoop *self, OFRunLoopMode mode, bool create)
 	return state;
 }
 
+#ifdef OF_HAVE_THREADS
+/*
+ * Messages are pushed onto a lock-free stack by any number of threads and the
+ * run loop takes all of them at once. Returns whether the stack was empty, in
+ * which case the run loop needs to be woken up. Pushing onto a non-empty stack
+ * does not need a wake up, as the run loop has not taken the messages yet, so
+ * that there is only one wake up per batch of messages.
+ */
+static bool
+pushMessage(OFRunLoop *self, OFRunLoopMessage *message)
+{
+# ifdef OF_HAVE_ATOMIC_OPS
+	OFRunLoopMessage *head;
+
+	do {
+		head = self->_messages;
+		message->_next = head;
+
+		/* Make the message visible before publishing it. */
+		OFReleaseMemoryBarrier();
+	} while (!OFAtomicPointerCompareAndSwap(
+	    (void *volatile *)&self->_messages, head, message));
+
+	return (head == nil);
+# else
+	bool wasEmpty;
+
+	[self->_statesMutex lock];
+	wasEmpty = (self->_messages == nil);
+	message->_next = self->_messages;
+	self->_messages = message;
+	[self->_statesMutex unlock];
+
+	return wasEmpty;
+# endif
+}
+
+static OFRunLoopMessage *
+takeMessages(OFRunLoop *self)
+{
+	OFRunLoopMessage *messages, *reversed = nil;
+
+# ifdef OF_HAVE_ATOMIC_OPS
+	do {
+		messages = self->_messages;
+
+		if (messages == nil)
+			return nil;
+	} while (!OFAtomicPointerCompareAndSwap(
+	    (void *volatile *)&self->_messages, messages, nil));
+
+	OFAcquireMemoryBarrier();
+# else
+	[self->_statesMutex lock];
+	messages = self->_messages;
+	self->_messages = nil;
+	[self->_statesMutex unlock];
+# endif
+
+	/* The stack has the newest message first. */
+	while (messages != nil) {
+		OFRunLoopMessage *next = messages->_next;
+
+		messages->_next = reversed;
+		reversed = messages;
+		messages = next;
+	}
+
+	return reversed;
+}
+
+static void
+releaseMessages(OFRunLoopMessage *messages)
+{
+	while (messages != nil) {
+		OFRunLoopMessage *next = messages->_next;
+
+		[messages release];
+		messages = next;
+	}
+}
+
+/*
+ * Performs all messages that have been sent until now and returns whether
+ * there were any. If one of them throws, the others are kept for the next
+ * iteration of the run loop.
+ */
+static bool
+performMessages(OFRunLoop *self)
+{
+	OFRunLoopMessage *message;
+
+	if (self->_pendingMessages == nil)
+		self->_pendingMessages = takeMessages(self);
+
+	if (self->_pendingMessages == nil)
+		return false;
+
+	while ((message = self->_pendingMessages) != nil) {
+		void *pool = objc_autoreleasePoolPush();
+
+		self->_pendingMessages = message->_next;
+
+		@try {
+			[message perform];
+		} @finally {
+			[message release];
+		}
+
+		objc_autoreleasePoolPop(pool);
+	}
+
+	return true;
+}
+#endif
+
 #ifdef OF_HAVE_SOCKETS
 # define NEW_READ(type, object, mode)					\
 	void *pool = objc_autoreleasePoolPush();			\
@@ -1386,6 +1577,11 @@ stateForMode(OFRunLoop *self, OFRunLoopMode mode, bool create)
 
 - (void)dealloc
 {
+#ifdef OF_HAVE_THREADS
+	releaseMessages(_pendingMessages);
+	releaseMessages(takeMessages(self));
+#endif
+
 	[_states release];
 #ifdef OF_HAVE_THREADS
 	[_statesMutex release];
@@ -1450,6 +1646,62 @@ stateForMode(OFRunLoop *self, OFRunLoopMode mode, bool create)
 #endif
 }
 
+#ifdef OF_HAVE_THREADS
+- (void)of_performSelector: (SEL)selector
+		    target: (id)target
+		   objects: (id const *)objects
+		     count: (uint8_t)count
+	     waitUntilDone: (bool)waitUntilDone
+{
+	OFRunLoopMessage *message = [[OFRunLoopMessage alloc] init];
+	OFCondition *condition = nil;
+
+	OFEnsure(count <= 4);
+
+	message->_target = [target retain];
+	message->_selector = selector;
+	for (uint8_t i = 0; i < count; i++)
+		message->_objects[i] = [objects[i] retain];
+	message->_objectsCount = count;
+
+	if (waitUntilDone) {
+		@try {
+			condition = [[OFCondition alloc] init];
+		} @catch (id e) {
+			[message release];
+			@throw e;
+		}
+
+		message->_condition = condition;
+		[message retain];
+	}
+
+	if (pushMessage(self, message)) {
+		OFRunLoopState *state =
+		    stateForMode(self, OFDefaultRunLoopMode, true);
+
+# if defined(OF_HAVE_SOCKETS)
+		[state->_kernelEventObserver cancel];
+# else
+		[state->_condition lock];
+		[state->_condition signal];
+		[state->_condition unlock];
+# endif
+	}
+
+	if (waitUntilDone) {
+		[condition lock];
+		@try {
+			while (!message->_done)
+				[condition wait];
+		} @finally {
+			[condition unlock];
+			[message release];
+		}
+	}
+}
+#endif
+
 #ifdef OF_AMIGAOS
 - (void)addExecSignal: (ULONG)signal target: (id)target selector: (SEL)selector
 {
@@ -1582,10 +1834,20 @@ stateForMode(OFRunLoop *self, OFRunLoopMode mode, bool create)
 	_currentMode = mode;
 	@try {
 		OFDate *nextTimer;
+#ifdef OF_HAVE_THREADS
+		bool defaultMode = [mode isEqual: OFDefaultRunLoopMode];
+#endif
 #if defined(OF_AMIGAOS) && !defined(OF_HAVE_SOCKETS) && defined(OF_HAVE_THREADS)
 		ULONG signalMask;
 #endif
 
+#ifdef OF_HAVE_THREADS
+		if (defaultMode && performMessages(self)) {
+			objc_autoreleasePoolPop(pool);
+			return;
+		}
+#endif
+
 		for (;;) {
 			OFTimer *timer;
 
@@ -1657,15 +1919,21 @@ stateForMode(OFRunLoop *self, OFRunLoopMode mode, bool create)
 			}
 #elif defined(OF_HAVE_THREADS)
 			[state->_condition lock];
+			/* A message might have been sent before locking. */
+			if (!defaultMode || _messages == nil) {
 # ifdef OF_AMIGAOS
-			signalMask = state->_execSignalMask;
-			[state->_condition waitForTimeInterval: timeout
-						  orExecSignal: &signalMask];
-			if (signalMask != 0)
-				[state execSignalWasReceived: signalMask];
+				signalMask = state->_execSignalMask;
+				[state->_condition
+				    waitForTimeInterval: timeout
+					   orExecSignal: &signalMask];
+				if (signalMask != 0)
+					[state execSignalWasReceived:
+					    signalMask];
 # else
-			[state->_condition waitForTimeInterval: timeout];
+				[state->_condition
+				    waitForTimeInterval: timeout];
 # endif
+			}
 			[state->_condition unlock];
 #else
 			[OFThread sleepForTimeInterval: timeout];
@@ -1685,21 +1953,31 @@ stateForMode(OFRunLoop *self, OFRunLoopMode mode, bool create)
 			}
 #elif defined(OF_HAVE_THREADS)
 			[state->_condition lock];
+			/* A message might have been sent before locking. */
+			if (!defaultMode || _messages == nil) {
 # ifdef OF_AMIGAOS
-			signalMask = state->_execSignalMask;
-			[state->_condition
-			    waitForConditionOrExecSignal: &signalMask];
-			if (signalMask != 0)
-				[state execSignalWasReceived: signalMask];
+				signalMask = state->_execSignalMask;
+				[state->_condition
+				    waitForConditionOrExecSignal: &signalMask];
+				if (signalMask != 0)
+					[state execSignalWasReceived:
+					    signalMask];
 # else
-			[state->_condition wait];
+				[state->_condition wait];
 # endif
+			}
 			[state->_condition unlock];
 #else
 			[OFThread sleepForTimeInterval: 86400];
 #endif
 		}
 
+#ifdef OF_HAVE_THREADS
+		/* Deliver the messages that woke us up right away. */
+		if (defaultMode)
+			performMessages(self);
+#endif
+
 		objc_autoreleasePoolPop(pool);
 	} @finally {
 		_currentMode = previousMode;
@@ -17,8 +17,17 @@
 
 #include <string.h>
 
+#if defined(HAVE_SHA_INTRINSICS) || defined(HAVE_AVX2_INTRINSICS)
+# include <immintrin.h>
+#endif
+
 #import "OFSHA1Hash.h"
+#import "OFSHA1Hash+Private.h"
+#import "OFMultiBufferHash.h"
 #import "OFSecureData.h"
+#if defined(HAVE_SHA_INTRINSICS) || defined(HAVE_AVX2_INTRINSICS)
+# import "OFSystemInfo.h"
+#endif
 
 #import "OFHashAlreadyCalculatedException.h"
 #import "OFHashNotCalculatedException.h"
@@ -26,6 +35,9 @@
 
 static const size_t digestSize = 20;
 static const size_t blockSize = 64;
+static const uint32_t initialState[] = {
+	0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+};
 
 OF_DIRECT_MEMBERS
 @interface OFSHA1Hash ()
@@ -46,12 +58,104 @@ byteSwapVectorIfLE(uint32_t *vector, uint_fast8_t length)
 #endif
 }
 
+#ifdef HAVE_SHA_INTRINSICS
+static signed char SHASupported = -1;
+
+static OF_INLINE bool
+useSHA(void)
+{
+	if OF_UNLIKELY (SHASupported == -1)
+		SHASupported = ([OFSystemInfo supportsSHAExtensions] &&
+		    [OFSystemInfo supportsSSE41]);
+
+	return SHASupported;
+}
+
+/* Processes the specified number of blocks using the SHA extensions. */
+static __attribute__((__target__("sha,sse4.1"))) void
+processBlocksSHA(uint32_t *state, const unsigned char *bytes, size_t count)
+{
+	const __m128i byteSwap = _mm_set_epi64x(
+	    0x0001020304050607, 0x08090A0B0C0D0E0F);
+	__m128i ABCD, E0, E1;
+
+	ABCD = _mm_shuffle_epi32(_mm_loadu_si128(
+	    (const __m128i *)(const void *)state), 0x1B);
+	E0 = _mm_set_epi32((int)state[4], 0, 0, 0);
+
+	for (; count > 0; count--) {
+		__m128i savedABCD = ABCD, savedE0 = E0;
+		__m128i message[4];
+
+		for (uint_fast8_t i = 0; i < 4; i++)
+			message[i] = _mm_shuffle_epi8(_mm_loadu_si128(
+			    (const __m128i *)(const void *)(bytes + i * 16)),
+			    byteSwap);
+
+		/* Each iteration does 4 rounds, alternating E0 and E1. */
+		for (uint_fast8_t i = 0; i < 20; i++) {
+			__m128i *current = &message[i % 4];
+			__m128i *E = (i % 2 == 0 ? &E0 : &E1);
+			__m128i *nextE = (i % 2 == 0 ? &E1 : &E0);
+
+			if (i == 0)
+				*E = _mm_add_epi32(*E, *current);
+			else
+				*E = _mm_sha1nexte_epu32(*E, *current);
+
+			*nextE = ABCD;
+
+			switch (i / 5) {
+			case 0:
+				ABCD = _mm_sha1rnds4_epu32(ABCD, *E, 0);
+				break;
+			case 1:
+				ABCD = _mm_sha1rnds4_epu32(ABCD, *E, 1);
+				break;
+			case 2:
+				ABCD = _mm_sha1rnds4_epu32(ABCD, *E, 2);
+				break;
+			default:
+				ABCD = _mm_sha1rnds4_epu32(ABCD, *E, 3);
+				break;
+			}
+
+			if (i >= 3 && i <= 18)
+				message[(i + 1) % 4] = _mm_sha1msg2_epu32(
+				    message[(i + 1) % 4], *current);
+			if (i >= 2 && i <= 17)
+				message[(i + 2) % 4] = _mm_xor_si128(
+				    message[(i + 2) % 4], *current);
+			if (i >= 1 && i <= 16)
+				message[(i + 3) % 4] = _mm_sha1msg1_epu32(
+				    message[(i + 3) % 4], *current);
+		}
+
+		E0 = _mm_sha1nexte_epu32(E0, savedE0);
+		ABCD = _mm_add_epi32(ABCD, savedABCD);
+
+		bytes += 64;
+	}
+
+	_mm_storeu_si128((__m128i *)(void *)state,
+	    _mm_shuffle_epi32(ABCD, 0x1B));
+	state[4] = (uint32_t)_mm_extract_epi32(E0, 3);
+}
+#endif
+
 static void
 processBlock(uint32_t *state, uint32_t *buffer)
 {
 	uint32_t new[5];
 	uint_fast8_t i;
 
+#ifdef HAVE_SHA_INTRINSICS
+	if (useSHA()) {
+		processBlocksSHA(state, (const unsigned char *)buffer, 1);
+		return;
+	}
+#endif
+
 	new[0] = state[0];
 	new[1] = state[1];
 	new[2] = state[2];
@@ -96,6 +200,122 @@ processBlock(uint32_t *state, uint32_t *buffer)
 	state[4] += new[4];
 }
 
+static void
+hashMessage(uint32_t *state, const unsigned char *bytes, size_t length)
+{
+	size_t blocksCount = OFMultiBufferHashMessageBlocksCount(length), i = 0;
+	unsigned char padding[64];
+	uint32_t buffer[80];
+
+#ifdef HAVE_SHA_INTRINSICS
+	if (useSHA()) {
+		i = length / 64;
+		processBlocksSHA(state, bytes, i);
+	}
+#endif
+
+	for (; i < blocksCount; i++) {
+		memcpy(buffer, OFMultiBufferHashMessageBlock(bytes, length, i,
+		    padding, true), 64);
+		processBlock(state, buffer);
+	}
+
+	OFZeroMemory(padding, sizeof(padding));
+	OFZeroMemory(buffer, sizeof(buffer));
+}
+
+#ifdef HAVE_AVX2_INTRINSICS
+static signed char multiBufferSupported = -1;
+
+/*
+ * The SHA extensions are faster than 8 messages interleaved with AVX2, so they
+ * take precedence.
+ */
+static OF_INLINE bool
+useMultiBuffer(void)
+{
+	if OF_UNLIKELY (multiBufferSupported == -1) {
+		multiBufferSupported = [OFSystemInfo supportsAVX2];
+# ifdef HAVE_SHA_INTRINSICS
+		if (useSHA())
+			multiBufferSupported = false;
+# endif
+	}
+
+	return multiBufferSupported;
+}
+
+# define ROTL(x, n) \
+	_mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - (n)))
+
+/* The lane layout of processBlock for OFMultiBufferHashInLanes(). */
+static __attribute__((__target__("avx2"))) void
+processBlocksAVX2(uint32_t state[8][8], uint32_t words[16][8])
+{
+	__m256i a, b, c, d, e, schedule[16];
+
+	a = _mm256_loadu_si256((const __m256i *)(const void *)state[0]);
+	b = _mm256_loadu_si256((const __m256i *)(const void *)state[1]);
+	c = _mm256_loadu_si256((const __m256i *)(const void *)state[2]);
+	d = _mm256_loadu_si256((const __m256i *)(const void *)state[3]);
+	e = _mm256_loadu_si256((const __m256i *)(const void *)state[4]);
+
+	for (uint_fast8_t i = 0; i < 80; i++) {
+		__m256i f, k, tmp;
+
+		if (i < 16)
+			schedule[i] = _mm256_loadu_si256(
+			    (const __m256i *)(const void *)words[i]);
+		else {
+			tmp = _mm256_xor_si256(_mm256_xor_si256(
+			    schedule[(i - 3) % 16], schedule[(i - 8) % 16]),
+			    _mm256_xor_si256(schedule[(i - 14) % 16],
+			    schedule[i % 16]));
+			schedule[i % 16] = ROTL(tmp, 1);
+		}
+
+		if (i < 20) {
+			f = _mm256_xor_si256(d,
+			    _mm256_and_si256(b, _mm256_xor_si256(c, d)));
+			k = _mm256_set1_epi32(0x5A827999);
+		} else if (i < 40) {
+			f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+			k = _mm256_set1_epi32(0x6ED9EBA1);
+		} else if (i < 60) {
+			f = _mm256_or_si256(_mm256_and_si256(b, c),
+			    _mm256_and_si256(d, _mm256_or_si256(b, c)));
+			k = _mm256_set1_epi32((int)0x8F1BBCDC);
+		} else {
+			f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+			k = _mm256_set1_epi32((int)0xCA62C1D6);
+		}
+
+		tmp = _mm256_add_epi32(_mm256_add_epi32(ROTL(a, 5), f),
+		    _mm256_add_epi32(_mm256_add_epi32(e, k),
+		    schedule[i % 16]));
+
+		e = d;
+		d = c;
+		c = ROTL(b, 30);
+		b = a;
+		a = tmp;
+	}
+
+# define ADD_STATE(i, x)						\
+	_mm256_storeu_si256((__m256i *)(void *)state[i],		\
+	    _mm256_add_epi32(_mm256_loadu_si256(			\
+	    (const __m256i *)(const void *)state[i]), x));
+	ADD_STATE(0, a)
+	ADD_STATE(1, b)
+	ADD_STATE(2, c)
+	ADD_STATE(3, d)
+	ADD_STATE(4, e)
+# undef ADD_STATE
+}
+
+# undef ROTL
+#endif
+
 @implementation OFSHA1Hash
 @synthesize calculated = _calculated;
 @synthesize allowsSwappableMemory = _allowsSwappableMemory;
@@ -116,6 +336,57 @@ processBlock(uint32_t *state, uint32_t *buffer)
 	    allowsSwappableMemory] autorelease];
 }
 
++ (void)hashBuffers: (const void *const *)buffers
+	    lengths: (const size_t *)lengths
+	      count: (size_t)count
+	    digests: (unsigned char *)digests
+{
+	uint32_t state[5];
+
+	for (size_t i = 0; i < count; i++)
+		if (lengths[i] > SIZE_MAX / 8)
+			@throw [OFOutOfRangeException exception];
+
+#ifdef HAVE_AVX2_INTRINSICS
+	if (count > 1 && useMultiBuffer()) {
+		OFMultiBufferHashInLanes(processBlocksAVX2, initialState, 5,
+		    true, buffers, lengths, count, digests, digestSize);
+		return;
+	}
+#endif
+
+	for (size_t i = 0; i < count; i++) {
+		memcpy(state, initialState, sizeof(state));
+		hashMessage(state, buffers[i], lengths[i]);
+		OFMultiBufferHashStoreDigest(state, digests + i * digestSize,
+		    digestSize, true);
+	}
+
+	OFZeroMemory(state, sizeof(state));
+}
+
++ (bool)of_hashBuffersInAVX2Lanes: (const void *const *)buffers
+			  lengths: (const size_t *)lengths
+			    count: (size_t)count
+			  digests: (unsigned char *)digests
+{
+#ifdef HAVE_AVX2_INTRINSICS
+	if (![OFSystemInfo supportsAVX2])
+		return false;
+
+	for (size_t i = 0; i < count; i++)
+		if (lengths[i] > SIZE_MAX / 8)
+			@throw [OFOutOfRangeException exception];
+
+	OFMultiBufferHashInLanes(processBlocksAVX2, initialState, 5, true,
+	    buffers, lengths, count, digests, digestSize);
+
+	return true;
+#else
+	return false;
+#endif
+}
+
 - (instancetype)initWithAllowsSwappableMemory: (bool)allowsSwappableMemory
 {
 	self = [super init];
@@ -175,13 +446,60 @@ processBlock(uint32_t *state, uint32_t *buffer)
 	return copy;
 }
 
+- (void)of_PBKDF2IterateWithOuterHash: (OFSHA1Hash *)outerHash
+			       digest: (unsigned char *)digest
+			  accumulator: (unsigned char *)accumulator
+			   iterations: (size_t)iterations
+{
+	union {
+		unsigned char bytes[64];
+		uint32_t words[80];
+	} message, buffer;
+	uint32_t state[5], result[5];
+	uint64_t bits;
+
+	/*
+	 * The message is always the previous digest, following the key pad
+	 * block, so the padding is the same for every block.
+	 */
+	memset(message.bytes, 0, 64);
+	memcpy(message.bytes, digest, digestSize);
+	message.bytes[digestSize] = 0x80;
+	bits = OFToBigEndian64((uint64_t)(64 + digestSize) * 8);
+	memcpy(message.bytes + 56, &bits, 8);
+
+	memcpy(result, accumulator, digestSize);
+
+	for (size_t i = 0; i < iterations; i++) {
+		memcpy(state, _iVars->state, sizeof(state));
+		memcpy(buffer.bytes, message.bytes, 64);
+		processBlock(state, buffer.words);
+
+		for (size_t j = 0; j < digestSize / 4; j++)
+			message.words[j] = OFToBigEndian32(state[j]);
+
+		memcpy(state, outerHash->_iVars->state, sizeof(state));
+		memcpy(buffer.bytes, message.bytes, 64);
+		processBlock(state, buffer.words);
+
+		for (size_t j = 0; j < digestSize / 4; j++) {
+			message.words[j] = OFToBigEndian32(state[j]);
+			result[j] ^= message.words[j];
+		}
+	}
+
+	memcpy(digest, message.bytes, digestSize);
+	memcpy(accumulator, result, digestSize);
+
+	OFZeroMemory(&message, sizeof(message));
+	OFZeroMemory(&buffer, sizeof(buffer));
+	OFZeroMemory(state, sizeof(state));
+	OFZeroMemory(result, sizeof(result));
+}
+
 - (void)of_resetState
 {
-	_iVars->state[0] = 0x67452301;
-	_iVars->state[1] = 0xEFCDAB89;
-	_iVars->state[2] = 0x98BADCFE;
-	_iVars->state[3] = 0x10325476;
-	_iVars->state[4] = 0xC3D2E1F0;
+	memcpy(_iVars->state, initialState, sizeof(initialState));
 }
 
 - (void)updateWithBuffer: (const void *)buffer_ length: (size_t)length
@@ -198,8 +516,22 @@ processBlock(uint32_t *state, uint32_t *buffer)
 	_iVars->bits += (length * 8);
 
 	while (length > 0) {
-		size_t min = 64 - _iVars->bufferLength;
+		size_t min;
+
+#ifdef HAVE_SHA_INTRINSICS
+		/* Process whole blocks directly from the input. */
+		if (_iVars->bufferLength == 0 && length >= 64 && useSHA()) {
+			size_t count = length / 64;
+
+			processBlocksSHA(_iVars->state, buffer, count);
+
+			buffer += count * 64;
+			length -= count * 64;
+			continue;
+		}
+#endif
 
+		min = 64 - _iVars->bufferLength;
 		if (min > length)
 			min = length;
 
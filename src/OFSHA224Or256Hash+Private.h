@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#import "OFSHA224Or256Hash.h"
+
+OF_ASSUME_NONNULL_BEGIN
+
+@interface OFSHA224Or256Hash ()
+/*
+ * Runs PBKDF2 iterations directly on the compression function. The receiver
+ * and outerHash need to be the inner and outer hash of an HMAC right after the
+ * key pads have been added. For each iteration, digest is replaced by its HMAC
+ * and XORed into accumulator. Both are digestSize bytes.
+ */
+- (void)of_PBKDF2IterateWithOuterHash: (OFSHA224Or256Hash *)outerHash
+			       digest: (unsigned char *)digest
+			  accumulator: (unsigned char *)accumulator
+			   iterations: (size_t)iterations OF_DIRECT;
+
+/*
+ * Like +[hashBuffers:lengths:count:digests:], but always hashes in 8 AVX2
+ * lanes, even if the SHA extensions would be used otherwise. Returns false
+ * without hashing anything if AVX2 is not available.
+ */
++ (bool)of_hashBuffersInAVX2Lanes: (const void *const *)buffers
+			  lengths: (const size_t *)lengths
+			    count: (size_t)count
+			  digests: (unsigned char *)digests;
+@end
+
+OF_ASSUME_NONNULL_END
@@ -18,8 +18,17 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(HAVE_SHA_INTRINSICS) || defined(HAVE_AVX2_INTRINSICS)
+# include <immintrin.h>
+#endif
+
 #import "OFSHA224Or256Hash.h"
+#import "OFSHA224Or256Hash+Private.h"
+#import "OFMultiBufferHash.h"
 #import "OFSecureData.h"
+#if defined(HAVE_SHA_INTRINSICS) || defined(HAVE_AVX2_INTRINSICS)
+# import "OFSystemInfo.h"
+#endif
 
 #import "OFHashAlreadyCalculatedException.h"
 #import "OFHashNotCalculatedException.h"
@@ -28,6 +37,9 @@
 static const size_t blockSize = 64;
 
 @interface OFSHA224Or256Hash ()
++ (void)of_getInitialState: (uint32_t *)initialState
+		  lengths: (const size_t *)lengths
+		    count: (size_t)count OF_DIRECT;
 - (void)of_resetState;
 @end
 
@@ -59,12 +71,97 @@ byteSwapVectorIfLE(uint32_t *vector, uint_fast8_t length)
 #endif
 }
 
+#ifdef HAVE_SHA_INTRINSICS
+static signed char SHASupported = -1;
+
+static OF_INLINE bool
+useSHA(void)
+{
+	if OF_UNLIKELY (SHASupported == -1)
+		SHASupported = ([OFSystemInfo supportsSHAExtensions] &&
+		    [OFSystemInfo supportsSSE41]);
+
+	return SHASupported;
+}
+
+/*
+ * Processes the specified number of blocks using the SHA extensions. The
+ * state is kept in the ABEF/CDGH layout expected by sha256rnds2 across
+ * blocks.
+ */
+static __attribute__((__target__("sha,sse4.1"))) void
+processBlocksSHA(uint32_t *state, const unsigned char *bytes, size_t count)
+{
+	const __m128i byteSwap = _mm_set_epi64x(
+	    0x0C0D0E0F08090A0B, 0x0405060700010203);
+	__m128i tmp, state0, state1;
+
+	tmp = _mm_shuffle_epi32(_mm_loadu_si128(
+	    (const __m128i *)(const void *)state), 0xB1);
+	state1 = _mm_shuffle_epi32(_mm_loadu_si128(
+	    (const __m128i *)(const void *)(state + 4)), 0x1B);
+	state0 = _mm_alignr_epi8(tmp, state1, 8);
+	state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+	for (; count > 0; count--) {
+		__m128i savedState0 = state0, savedState1 = state1;
+		__m128i message[4];
+
+		for (uint_fast8_t i = 0; i < 4; i++)
+			message[i] = _mm_shuffle_epi8(_mm_loadu_si128(
+			    (const __m128i *)(const void *)(bytes + i * 16)),
+			    byteSwap);
+
+		for (uint_fast8_t i = 0; i < 16; i++) {
+			__m128i *current = &message[i % 4];
+			__m128i *next = &message[(i + 1) % 4];
+			__m128i *previous = &message[(i + 3) % 4];
+
+			tmp = _mm_add_epi32(*current, _mm_loadu_si128(
+			    (const __m128i *)(const void *)(table + i * 4)));
+			state1 = _mm_sha256rnds2_epu32(state1, state0, tmp);
+			tmp = _mm_shuffle_epi32(tmp, 0x0E);
+			state0 = _mm_sha256rnds2_epu32(state0, state1, tmp);
+
+			if (i >= 3 && i <= 14) {
+				*next = _mm_add_epi32(*next,
+				    _mm_alignr_epi8(*current, *previous, 4));
+				*next = _mm_sha256msg2_epu32(*next, *current);
+			}
+
+			if (i >= 1 && i <= 12)
+				*previous = _mm_sha256msg1_epu32(*previous,
+				    *current);
+		}
+
+		state0 = _mm_add_epi32(state0, savedState0);
+		state1 = _mm_add_epi32(state1, savedState1);
+
+		bytes += 64;
+	}
+
+	tmp = _mm_shuffle_epi32(state0, 0x1B);
+	state1 = _mm_shuffle_epi32(state1, 0xB1);
+	_mm_storeu_si128((__m128i *)(void *)state,
+	    _mm_blend_epi16(tmp, state1, 0xF0));
+	_mm_storeu_si128((__m128i *)(void *)(state + 4),
+	    _mm_alignr_epi8(state1, tmp, 8));
+}
+#endif
+
 static void
 processBlock(uint32_t *state, uint32_t *buffer)
 {
 	uint32_t new[8];
 	uint_fast8_t i;
 
+#ifdef HAVE_SHA_INTRINSICS
+	if (useSHA()) {
+		processBlocksSHA(state, (const unsigned char *)buffer, 1);
+		return;
+	}
+#endif
+
 	new[0] = state[0];
 	new[1] = state[1];
 	new[2] = state[2];
@@ -116,6 +213,133 @@ processBlock(uint32_t *state, uint32_t *buffer)
 	state[7] += new[7];
 }
 
+static void
+hashMessage(uint32_t *state, const unsigned char *bytes, size_t length)
+{
+	size_t blocksCount = OFMultiBufferHashMessageBlocksCount(length), i = 0;
+	unsigned char padding[64];
+	uint32_t buffer[64];
+
+#ifdef HAVE_SHA_INTRINSICS
+	if (useSHA()) {
+		i = length / 64;
+		processBlocksSHA(state, bytes, i);
+	}
+#endif
+
+	for (; i < blocksCount; i++) {
+		memcpy(buffer, OFMultiBufferHashMessageBlock(bytes, length, i,
+		    padding, true), 64);
+		processBlock(state, buffer);
+	}
+
+	OFZeroMemory(padding, sizeof(padding));
+	OFZeroMemory(buffer, sizeof(buffer));
+}
+
+#ifdef HAVE_AVX2_INTRINSICS
+static signed char multiBufferSupported = -1;
+
+/*
+ * The SHA extensions are faster than 8 messages interleaved with AVX2, so they
+ * take precedence.
+ */
+static OF_INLINE bool
+useMultiBuffer(void)
+{
+	if OF_UNLIKELY (multiBufferSupported == -1) {
+		multiBufferSupported = [OFSystemInfo supportsAVX2];
+# ifdef HAVE_SHA_INTRINSICS
+		if (useSHA())
+			multiBufferSupported = false;
+# endif
+	}
+
+	return multiBufferSupported;
+}
+
+# define ROTR(x, n) \
+	_mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+
+/*
+ * Processes one block for each of 8 messages at once. Both the state and the
+ * words of the blocks are interleaved, with the lane as the inner index.
+ */
+static __attribute__((__target__("avx2"))) void
+processBlocksAVX2(uint32_t state[8][8], uint32_t words[16][8])
+{
+	__m256i a, b, c, d, e, f, g, h, schedule[16];
+
+	a = _mm256_loadu_si256((const __m256i *)(const void *)state[0]);
+	b = _mm256_loadu_si256((const __m256i *)(const void *)state[1]);
+	c = _mm256_loadu_si256((const __m256i *)(const void *)state[2]);
+	d = _mm256_loadu_si256((const __m256i *)(const void *)state[3]);
+	e = _mm256_loadu_si256((const __m256i *)(const void *)state[4]);
+	f = _mm256_loadu_si256((const __m256i *)(const void *)state[5]);
+	g = _mm256_loadu_si256((const __m256i *)(const void *)state[6]);
+	h = _mm256_loadu_si256((const __m256i *)(const void *)state[7]);
+
+	for (uint_fast8_t i = 0; i < 64; i++) {
+		__m256i tmp1, tmp2;
+
+		if (i < 16)
+			schedule[i] = _mm256_loadu_si256(
+			    (const __m256i *)(const void *)words[i]);
+		else {
+			__m256i w2 = schedule[(i - 2) % 16];
+			__m256i w15 = schedule[(i - 15) % 16];
+
+			tmp1 = _mm256_xor_si256(_mm256_xor_si256(
+			    ROTR(w2, 17), ROTR(w2, 19)),
+			    _mm256_srli_epi32(w2, 10));
+			tmp2 = _mm256_xor_si256(_mm256_xor_si256(
+			    ROTR(w15, 7), ROTR(w15, 18)),
+			    _mm256_srli_epi32(w15, 3));
+			schedule[i % 16] = _mm256_add_epi32(
+			    _mm256_add_epi32(schedule[i % 16], tmp1),
+			    _mm256_add_epi32(schedule[(i - 7) % 16], tmp2));
+		}
+
+		tmp1 = _mm256_add_epi32(_mm256_add_epi32(h,
+		    _mm256_xor_si256(_mm256_xor_si256(ROTR(e, 6),
+		    ROTR(e, 11)), ROTR(e, 25))), _mm256_add_epi32(
+		    _mm256_xor_si256(_mm256_and_si256(e,
+		    _mm256_xor_si256(f, g)), g), _mm256_add_epi32(
+		    _mm256_set1_epi32((int)table[i]), schedule[i % 16])));
+		tmp2 = _mm256_add_epi32(_mm256_xor_si256(_mm256_xor_si256(
+		    ROTR(a, 2), ROTR(a, 13)), ROTR(a, 22)), _mm256_or_si256(
+		    _mm256_and_si256(a, _mm256_or_si256(b, c)),
+		    _mm256_and_si256(b, c)));
+
+		h = g;
+		g = f;
+		f = e;
+		e = _mm256_add_epi32(d, tmp1);
+		d = c;
+		c = b;
+		b = a;
+		a = _mm256_add_epi32(tmp1, tmp2);
+	}
+
+# define ADD_STATE(i, x)						\
+	_mm256_storeu_si256((__m256i *)(void *)state[i],		\
+	    _mm256_add_epi32(_mm256_loadu_si256(			\
+	    (const __m256i *)(const void *)state[i]), x));
+	ADD_STATE(0, a)
+	ADD_STATE(1, b)
+	ADD_STATE(2, c)
+	ADD_STATE(3, d)
+	ADD_STATE(4, e)
+	ADD_STATE(5, f)
+	ADD_STATE(6, g)
+	ADD_STATE(7, h)
+# undef ADD_STATE
+}
+
+# undef ROTR
+
+#endif
+
 @implementation OFSHA224Or256Hash
 @synthesize calculated = _calculated;
 @synthesize allowsSwappableMemory = _allowsSwappableMemory;
@@ -136,6 +360,70 @@ processBlock(uint32_t *state, uint32_t *buffer)
 	    allowsSwappableMemory] autorelease];
 }
 
++ (void)of_getInitialState: (uint32_t *)initialState
+		  lengths: (const size_t *)lengths
+		    count: (size_t)count
+{
+	OFSHA224Or256Hash *hash;
+
+	for (size_t i = 0; i < count; i++)
+		if (lengths[i] > SIZE_MAX / 8)
+			@throw [OFOutOfRangeException exception];
+
+	hash = [[self alloc] initWithAllowsSwappableMemory: true];
+	memcpy(initialState, hash->_iVars->state, 8 * sizeof(uint32_t));
+	[hash release];
+}
+
++ (void)hashBuffers: (const void *const *)buffers
+	    lengths: (const size_t *)lengths
+	      count: (size_t)count
+	    digests: (unsigned char *)digests
+{
+	size_t digestSize = [self digestSize];
+	uint32_t initialState[8], state[8];
+
+	[self of_getInitialState: initialState lengths: lengths count: count];
+
+#ifdef HAVE_AVX2_INTRINSICS
+	if (count > 1 && useMultiBuffer()) {
+		OFMultiBufferHashInLanes(processBlocksAVX2, initialState, 8,
+		    true, buffers, lengths, count, digests, digestSize);
+		return;
+	}
+#endif
+
+	for (size_t i = 0; i < count; i++) {
+		memcpy(state, initialState, sizeof(state));
+		hashMessage(state, buffers[i], lengths[i]);
+		OFMultiBufferHashStoreDigest(state, digests + i * digestSize,
+		    digestSize, true);
+	}
+
+	OFZeroMemory(state, sizeof(state));
+}
+
++ (bool)of_hashBuffersInAVX2Lanes: (const void *const *)buffers
+			  lengths: (const size_t *)lengths
+			    count: (size_t)count
+			  digests: (unsigned char *)digests
+{
+#ifdef HAVE_AVX2_INTRINSICS
+	uint32_t initialState[8];
+
+	if (![OFSystemInfo supportsAVX2])
+		return false;
+
+	[self of_getInitialState: initialState lengths: lengths count: count];
+	OFMultiBufferHashInLanes(processBlocksAVX2, initialState, 8, true,
+	    buffers, lengths, count, digests, [self digestSize]);
+
+	return true;
+#else
+	return false;
+#endif
+}
+
 - (instancetype)initWithAllowsSwappableMemory: (bool)allowsSwappableMemory
 {
 	self = [super init];
@@ -214,8 +502,22 @@ processBlock(uint32_t *state, uint32_t *buffer)
 	_iVars->bits += (length * 8);
 
 	while (length > 0) {
-		size_t min = 64 - _iVars->bufferLength;
+		size_t min;
+
+#ifdef HAVE_SHA_INTRINSICS
+		/* Process whole blocks directly from the input. */
+		if (_iVars->bufferLength == 0 && length >= 64 && useSHA()) {
+			size_t count = length / 64;
+
+			processBlocksSHA(_iVars->state, buffer, count);
 
+			buffer += count * 64;
+			length -= count * 64;
+			continue;
+		}
+#endif
+
+		min = 64 - _iVars->bufferLength;
 		if (min > length)
 			min = length;
 
@@ -276,6 +578,58 @@ processBlock(uint32_t *state, uint32_t *buffer)
 	_calculated = false;
 }
 
+- (void)of_PBKDF2IterateWithOuterHash: (OFSHA224Or256Hash *)outerHash
+			       digest: (unsigned char *)digest
+			  accumulator: (unsigned char *)accumulator
+			   iterations: (size_t)iterations
+{
+	size_t digestSize = self.digestSize;
+	union {
+		unsigned char bytes[64];
+		uint32_t words[64];
+	} message, buffer;
+	uint32_t state[8], result[8];
+	uint64_t bits;
+
+	/*
+	 * The message is always the previous digest, following the key pad
+	 * block, so the padding is the same for every block.
+	 */
+	memset(message.bytes, 0, 64);
+	memcpy(message.bytes, digest, digestSize);
+	message.bytes[digestSize] = 0x80;
+	bits = OFToBigEndian64((uint64_t)(64 + digestSize) * 8);
+	memcpy(message.bytes + 56, &bits, 8);
+
+	memcpy(result, accumulator, digestSize);
+
+	for (size_t i = 0; i < iterations; i++) {
+		memcpy(state, _iVars->state, sizeof(state));
+		memcpy(buffer.bytes, message.bytes, 64);
+		processBlock(state, buffer.words);
+
+		for (size_t j = 0; j < digestSize / 4; j++)
+			message.words[j] = OFToBigEndian32(state[j]);
+
+		memcpy(state, outerHash->_iVars->state, sizeof(state));
+		memcpy(buffer.bytes, message.bytes, 64);
+		processBlock(state, buffer.words);
+
+		for (size_t j = 0; j < digestSize / 4; j++) {
+			message.words[j] = OFToBigEndian32(state[j]);
+			result[j] ^= message.words[j];
+		}
+	}
+
+	memcpy(digest, message.bytes, digestSize);
+	memcpy(accumulator, result, digestSize);
+
+	OFZeroMemory(&message, sizeof(message));
+	OFZeroMemory(&buffer, sizeof(buffer));
+	OFZeroMemory(state, sizeof(state));
+	OFZeroMemory(result, sizeof(result));
+}
+
 - (void)of_resetState
 {
 	OF_UNRECOGNIZED_SELECTOR
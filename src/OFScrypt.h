@@ -27,6 +27,7 @@ OF_ASSUME_NONNULL_BEGIN
 /** @file */
 
 @class OFHMAC;
+@class OFThreadPool;
 
 /**
  * @brief The parameters for @ref OFScrypt.
@@ -56,6 +57,19 @@ typedef struct {
 	size_t keyLength;
 	/** @brief Whether data may be stored in swappable memory. */
 	bool allowsSwappableMemory;
+	/**
+	 * @brief The thread pool on which to run the parallel lanes, or `nil`
+	 *	  to run them one after another.
+	 *
+	 * Each lane that runs concurrently needs its own
+	 * `128 * costFactor * blockSize` bytes of temporary memory.
+	 *
+	 * The calling thread runs lanes as well, so this may also be the
+	 * thread pool of the job that calls @ref OFScrypt.
+	 *
+	 * This is ignored if ObjFW was built without thread support.
+	 */
+	OFThreadPool *_Nullable threadPool;
 } OFScryptParameters;
 
 #ifdef __cplusplus
@@ -15,9 +15,17 @@
 
 #include "config.h"
 
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
 #import "OFHMAC.h"
 #import "OFSHA256Hash.h"
 #import "OFSecureData.h"
+#ifdef OF_HAVE_THREADS
+# import "OFCondition.h"
+# import "OFThreadPool.h"
+#endif
 
 #import "OFInvalidArgumentException.h"
 #import "OFOutOfMemoryException.h"
@@ -26,6 +34,30 @@
 #import "OFScrypt.h"
 #import "OFPBKDF2.h"
 
+#ifdef OF_HAVE_THREADS
+/*
+ * Runs the lanes of scrypt on a thread pool. Each worker processes every n-th
+ * lane using its own temporary memory.
+ */
+@interface OFScryptLanes: OFObject
+{
+	uint32_t *_buffer, *_tmp;
+	size_t _blockSize, _costFactor, _parallelization, _workersCount;
+	OFCondition *_condition;
+	size_t _nextWorker, _nextLane, _doneLanes;
+}
+
+- (instancetype)initWithBuffer: (uint32_t *)buffer
+			   tmp: (uint32_t *)tmp
+		     blockSize: (size_t)blockSize
+		    costFactor: (size_t)costFactor
+	       parallelization: (size_t)parallelization
+		  workersCount: (size_t)workersCount;
+- (void)runOnThreadPool: (OFThreadPool *)threadPool;
+- (void)runWorker: (nullable id)object;
+@end
+#endif
+
 void
 OFSalsa20_8Core(uint32_t buffer[16])
 {
@@ -105,6 +137,131 @@ OFScryptBlockMix(uint32_t *output, const uint32_t *input, size_t blockSize)
 	OFZeroMemory(tmp, sizeof(tmp));
 }
 
+#ifdef __SSE2__
+/*
+ * The SSE2 code works on blocks in which the words are stored diagonally, so
+ * that each vector holds one diagonal of the 4x4 Salsa20 matrix. This turns
+ * the column and row rounds into operations on whole vectors.
+ */
+static void
+shuffleBlocks(uint32_t *output, const uint32_t *input, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		for (uint_fast8_t j = 0; j < 16; j++)
+			output[i * 16 + j] = input[i * 16 + (j * 5) % 16];
+}
+
+static void
+unshuffleBlocks(uint32_t *output, const uint32_t *input, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		for (uint_fast8_t j = 0; j < 16; j++)
+			output[i * 16 + (j * 5) % 16] = input[i * 16 + j];
+}
+
+# define ROTL(x, n) \
+	_mm_xor_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - (n)))
+
+static OF_INLINE void
+salsa20_8CoreSSE2(__m128i *X0, __m128i *X1, __m128i *X2, __m128i *X3)
+{
+	__m128i x0 = *X0, x1 = *X1, x2 = *X2, x3 = *X3;
+
+	for (uint_fast8_t i = 0; i < 8; i += 2) {
+		/* Column round */
+		x1 = _mm_xor_si128(x1, ROTL(_mm_add_epi32(x0, x3), 7));
+		x2 = _mm_xor_si128(x2, ROTL(_mm_add_epi32(x1, x0), 9));
+		x3 = _mm_xor_si128(x3, ROTL(_mm_add_epi32(x2, x1), 13));
+		x0 = _mm_xor_si128(x0, ROTL(_mm_add_epi32(x3, x2), 18));
+
+		x1 = _mm_shuffle_epi32(x1, 0x93);
+		x2 = _mm_shuffle_epi32(x2, 0x4E);
+		x3 = _mm_shuffle_epi32(x3, 0x39);
+
+		/* Row round */
+		x3 = _mm_xor_si128(x3, ROTL(_mm_add_epi32(x0, x1), 7));
+		x2 = _mm_xor_si128(x2, ROTL(_mm_add_epi32(x3, x0), 9));
+		x1 = _mm_xor_si128(x1, ROTL(_mm_add_epi32(x2, x3), 13));
+		x0 = _mm_xor_si128(x0, ROTL(_mm_add_epi32(x1, x2), 18));
+
+		x1 = _mm_shuffle_epi32(x1, 0x39);
+		x2 = _mm_shuffle_epi32(x2, 0x4E);
+		x3 = _mm_shuffle_epi32(x3, 0x93);
+	}
+
+	*X0 = _mm_add_epi32(*X0, x0);
+	*X1 = _mm_add_epi32(*X1, x1);
+	*X2 = _mm_add_epi32(*X2, x2);
+	*X3 = _mm_add_epi32(*X3, x3);
+}
+
+# undef ROTL
+
+/* Like OFScryptBlockMix(), but for shuffled blocks. */
+static void
+blockMixSSE2(uint32_t *output, const uint32_t *input, size_t blockSize)
+{
+	const __m128i *in = (const __m128i *)(const void *)input;
+	__m128i *out = (__m128i *)(void *)output;
+	__m128i X0, X1, X2, X3;
+
+	X0 = _mm_loadu_si128(in + (2 * blockSize - 1) * 4);
+	X1 = _mm_loadu_si128(in + (2 * blockSize - 1) * 4 + 1);
+	X2 = _mm_loadu_si128(in + (2 * blockSize - 1) * 4 + 2);
+	X3 = _mm_loadu_si128(in + (2 * blockSize - 1) * 4 + 3);
+
+	for (size_t i = 0; i < 2 * blockSize; i++) {
+		size_t j = ((i / 2) + (i & 1) * blockSize) * 4;
+
+		X0 = _mm_xor_si128(X0, _mm_loadu_si128(in + i * 4));
+		X1 = _mm_xor_si128(X1, _mm_loadu_si128(in + i * 4 + 1));
+		X2 = _mm_xor_si128(X2, _mm_loadu_si128(in + i * 4 + 2));
+		X3 = _mm_xor_si128(X3, _mm_loadu_si128(in + i * 4 + 3));
+
+		salsa20_8CoreSSE2(&X0, &X1, &X2, &X3);
+
+		_mm_storeu_si128(out + j, X0);
+		_mm_storeu_si128(out + j + 1, X1);
+		_mm_storeu_si128(out + j + 2, X2);
+		_mm_storeu_si128(out + j + 3, X3);
+	}
+}
+
+static void
+ROMixSSE2(uint32_t *buffer, size_t blockSize, size_t costFactor,
+    uint32_t *tmp)
+{
+	uint32_t *tmp2 = tmp + 32 * blockSize;
+
+	shuffleBlocks(tmp, buffer, 2 * blockSize);
+
+	for (size_t i = 0; i < costFactor; i++) {
+		memcpy(tmp2 + i * 32 * blockSize, tmp, 128 * blockSize);
+		blockMixSSE2(tmp, tmp2 + i * 32 * blockSize, blockSize);
+	}
+
+	for (size_t i = 0; i < costFactor; i++) {
+		/* The first word of a block stays in place when shuffling. */
+		uint32_t j = tmp[(2 * blockSize - 1) * 16] & (costFactor - 1);
+		const __m128i *V =
+		    (const __m128i *)(const void *)(tmp2 + j * 32 * blockSize);
+		__m128i *X = (__m128i *)(void *)tmp;
+
+		for (size_t k = 0; k < 8 * blockSize; k++)
+			_mm_storeu_si128(X + k, _mm_xor_si128(
+			    _mm_loadu_si128(X + k), _mm_loadu_si128(V + k)));
+
+		blockMixSSE2(buffer, tmp, blockSize);
+
+		if (i < costFactor - 1)
+			memcpy(tmp, buffer, 128 * blockSize);
+	}
+
+	memcpy(tmp, buffer, 128 * blockSize);
+	unshuffleBlocks(buffer, tmp, 2 * blockSize);
+}
+#endif
+
 void
 OFScryptROMix(uint32_t *buffer, size_t blockSize, size_t costFactor,
     uint32_t *tmp)
@@ -114,6 +271,10 @@ OFScryptROMix(uint32_t *buffer, size_t blockSize, size_t costFactor,
 	if (param.blockSize > SIZE_MAX / 128 / param.costFactor)	\
 		@throw [OFOutOfRangeException exception];
 
+#ifdef __SSE2__
+	/* SSE2 implies x86, where the little endian words can be used as is. */
+	ROMixSSE2(buffer, blockSize, costFactor, tmp);
+#else
 	uint32_t *tmp2 = tmp + 32 * blockSize;
 
 	memcpy(tmp, buffer, 128 * blockSize);
@@ -135,13 +296,114 @@ OFScryptROMix(uint32_t *buffer, size_t blockSize, size_t costFactor,
 		if (i < costFactor - 1)
 			memcpy(tmp, buffer, 128 * blockSize);
 	}
+#endif
+}
+
+#ifdef OF_HAVE_THREADS
+@implementation OFScryptLanes
+- (instancetype)initWithBuffer: (uint32_t *)buffer
+			   tmp: (uint32_t *)tmp
+		     blockSize: (size_t)blockSize
+		    costFactor: (size_t)costFactor
+	       parallelization: (size_t)parallelization
+		  workersCount: (size_t)workersCount
+{
+	self = [super init];
+
+	@try {
+		_buffer = buffer;
+		_tmp = tmp;
+		_blockSize = blockSize;
+		_costFactor = costFactor;
+		_parallelization = parallelization;
+		_workersCount = workersCount;
+		_condition = [[OFCondition alloc] init];
+	} @catch (id e) {
+		[self release];
+		@throw e;
+	}
+
+	return self;
 }
 
+- (void)dealloc
+{
+	[_condition release];
+
+	[super dealloc];
+}
+
+/*
+ * The calling thread runs lanes as well and only waits for the lanes that are
+ * already being run by others. This way, no lane depends on a job that is
+ * still queued, so that this also works from within a job of the same thread
+ * pool when all of its threads are busy.
+ */
+- (void)runOnThreadPool: (OFThreadPool *)threadPool
+{
+	@try {
+		for (size_t i = 1; i < _workersCount; i++)
+			[threadPool dispatchWithTarget: self
+					      selector: @selector(runWorker:)
+						object: nil];
+	} @finally {
+		/* Even if dispatching failed, all lanes need to be run. */
+		[self runWorker: nil];
+
+		[_condition lock];
+		@try {
+			while (_doneLanes < _parallelization)
+				[_condition wait];
+		} @finally {
+			[_condition unlock];
+		}
+	}
+}
+
+- (void)runWorker: (id)object
+{
+	uint32_t *tmp;
+
+	[_condition lock];
+	if (_nextLane >= _parallelization) {
+		/* Started too late, all lanes are already taken. */
+		[_condition unlock];
+		return;
+	}
+	/* At most _workersCount workers get here, one per tmp area. */
+	tmp = _tmp + _nextWorker++ * (_costFactor + 1) * 32 * _blockSize;
+	[_condition unlock];
+
+	for (;;) {
+		size_t lane;
+
+		[_condition lock];
+		lane = _nextLane;
+		if (lane < _parallelization)
+			_nextLane++;
+		[_condition unlock];
+
+		if (lane >= _parallelization)
+			return;
+
+		OFScryptROMix(_buffer + lane * 32 * _blockSize, _blockSize,
+		    _costFactor, tmp);
+
+		[_condition lock];
+		if (++_doneLanes == _parallelization)
+			[_condition signal];
+		[_condition unlock];
+	}
+}
+@end
+#endif
+
 void
 OFScrypt(OFScryptParameters param)
 {
 	OFSecureData *tmp = nil, *buffer = nil;
 	OFHMAC *HMAC = nil;
+	size_t workersCount = 1;
 
 	if (param.blockSize == 0 || param.costFactor <= 1 ||
 	    (param.costFactor & (param.costFactor - 1)) != 0 ||
@@ -156,15 +418,25 @@ OFScrypt(OFScryptParameters param)
 	OVERFLOW_CHECK_1
 	OVERFLOW_CHECK_2
 
+#ifdef OF_HAVE_THREADS
+	if (param.threadPool != nil) {
+		workersCount = param.threadPool.size;
+
+		if (workersCount > param.parallelization)
+			workersCount = param.parallelization;
+	}
+#endif
+
 	@try {
 		uint32_t *tmpItems, *bufferItems;
 
 		if (param.costFactor > SIZE_MAX - 1 ||
-		    (param.costFactor + 1) > SIZE_MAX / 128)
+		    (param.costFactor + 1) > SIZE_MAX / 128 / workersCount)
 			@throw [OFOutOfRangeException exception];
 
 		tmp = [[OFSecureData alloc]
-			    initWithCount: (param.costFactor + 1) * 128
+			    initWithCount: (param.costFactor + 1) * 128 *
+					   workersCount
 				 itemSize: param.blockSize
 		    allowsSwappableMemory: param.allowsSwappableMemory];
 		tmpItems = tmp.mutableItems;
@@ -195,9 +467,28 @@ OFScrypt(OFScryptParameters param)
 			.allowsSwappableMemory = param.allowsSwappableMemory
 		});
 
-		for (size_t i = 0; i < param.parallelization; i++)
-			OFScryptROMix(bufferItems + i * 32 * param.blockSize,
-			    param.blockSize, param.costFactor, tmpItems);
+#ifdef OF_HAVE_THREADS
+		if (workersCount > 1) {
+			OFScryptLanes *lanes = [[OFScryptLanes alloc]
+			    initWithBuffer: bufferItems
+				       tmp: tmpItems
+				 blockSize: param.blockSize
+				costFactor: param.costFactor
+			   parallelization: param.parallelization
+			      workersCount: workersCount];
+
+			@try {
+				[lanes runOnThreadPool: param.threadPool];
+			} @finally {
+				[lanes release];
+			}
+		} else
+#endif
+			for (size_t i = 0; i < param.parallelization; i++)
+				OFScryptROMix(
+				    bufferItems + i * 32 * param.blockSize,
+				    param.blockSize, param.costFactor,
+				    tmpItems);
 
 		OFPBKDF2((OFPBKDF2Parameters){
 			.HMAC                  = HMAC,
@@ -190,6 +190,7 @@ OF_SUBCLASSING_RESTRICTED
 - (void)writeToURL: (OFURL *)URL OF_UNAVAILABLE;
 - (OFXMLElement *)XMLElementBySerializing OF_UNAVAILABLE;
 - (OFData *)messagePackRepresentation OF_UNAVAILABLE;
+- (void)writeMessagePackToStream: (OFStream *)stream OF_UNAVAILABLE;
 @end
 
 OF_ASSUME_NONNULL_END
@@ -645,4 +645,9 @@ freeMemory(struct Page *page, void *pointer, size_t bytes)
 {
 	OF_UNRECOGNIZED_SELECTOR
 }
+
+- (void)writeMessagePackToStream: (OFStream *)stream
+{
+	OF_UNRECOGNIZED_SELECTOR
+}
 @end
@@ -137,6 +137,8 @@ typedef void (^OFStringLineEnumerationBlock)(OFString *line, bool *stop);
 #ifdef __OBJC__
 @class OFArray OF_GENERIC(ObjectType);
 @class OFCharacterSet;
+@class OFStream;
+@class OFStringSearch;
 @class OFURL;
 
 /**
@@ -965,6 +967,33 @@ typedef void (^OFStringLineEnumerationBlock)(OFString *line, bool *stop);
 		 options: (OFStringSearchOptions)options
 		   range: (OFRange)range;
 
+/**
+ * @brief Returns the range of the string prepared by the specified search.
+ *
+ * This is faster than @ref rangeOfString:options: when searching for the same
+ * string repeatedly.
+ *
+ * @param search The search for the string to search
+ * @return The range of the first occurrence of the string or a range with
+ *	   `OFNotFound` as start position if it was not found
+ */
+- (OFRange)rangeOfStringSearch: (OFStringSearch *)search;
+
+/**
+ * @brief Returns the range of the string prepared by the specified search in
+ *	  the specified range.
+ *
+ * This is faster than @ref rangeOfString:options:range: when searching for
+ * the same string repeatedly.
+ *
+ * @param search The search for the string to search
+ * @param range The range in which to search
+ * @return The range of the first occurrence of the string or a range with
+ *	   `OFNotFound` as start position if it was not found
+ */
+- (OFRange)rangeOfStringSearch: (OFStringSearch *)search
+			 range: (OFRange)range;
+
 /**
  * @brief Returns the index of the first character from the set.
  *
@@ -1258,6 +1287,31 @@ typedef void (^OFStringLineEnumerationBlock)(OFString *line, bool *stop);
  */
 - (void)writeToURL: (OFURL *)URL encoding: (OFStringEncoding)encoding;
 
+/**
+ * @brief Writes the JSON representation of the string to the specified
+ *	  stream.
+ *
+ * This produces the same output as @ref JSONRepresentationWithOptions:, but
+ * escapes the string directly into the stream without creating an
+ * intermediate string.
+ *
+ * @param stream The stream to write the JSON representation to
+ * @param options The options to use when creating the JSON representation
+ */
+- (void)writeJSONToStream: (OFStream *)stream
+		  options: (OFJSONRepresentationOptions)options;
+
+/**
+ * @brief Writes the MessagePack representation of the string to the specified
+ *	  stream.
+ *
+ * This produces the same output as @ref messagePackRepresentation without
+ * creating an intermediate OFData.
+ *
+ * @param stream The stream to write the MessagePack representation to
+ */
+- (void)writeMessagePackToStream: (OFStream *)stream;
+
 # ifdef OF_HAVE_BLOCKS
 /**
  * Enumerates all lines in the receiver using the specified block.
@@ -40,7 +40,9 @@
 # import "OFFileManager.h"
 #endif
 #import "OFLocale.h"
+#import "OFMessagePackWriting.h"
 #import "OFStream.h"
+#import "OFStringSearch.h"
 #import "OFSystemInfo.h"
 #import "OFURL.h"
 #import "OFURLHandler.h"
@@ -96,6 +98,9 @@ static locale_t cLocale;
 - (OFString *)
     of_JSONRepresentationWithOptions: (OFJSONRepresentationOptions)options
 			       depth: (size_t)depth;
+- (void)of_writeJSONToStream: (OFStream *)stream
+		     options: (OFJSONRepresentationOptions)options
+		       depth: (size_t)depth;
 @end
 
 @interface OFStringPlaceholder: OFString
@@ -1771,47 +1776,106 @@ decomposedString(OFString *self, const char *const *const *table, size_t size)
 	return JSON;
 }
 
+- (void)of_writeJSONToStream: (OFStream *)stream
+		     options: (OFJSONRepresentationOptions)options
+		       depth: (size_t)depth
+{
+	void *pool = objc_autoreleasePoolPush();
+	const char *cString = self.UTF8String;
+	size_t length = self.UTF8StringLength, last = 0;
+	bool quote = true;
+
+	if ((options & OFJSONRepresentationOptionJSON5) &&
+	    (options & OFJSONRepresentationOptionIsIdentifier))
+		quote = ((!OFASCIIIsAlpha(cString[0]) &&
+		    cString[0] != '_' && cString[0] != '$') ||
+		    strpbrk(cString, " \n\r\t\b\f\\\"'") != NULL);
+
+	if (quote)
+		[stream writeBuffer: "\"" length: 1];
+
+	for (size_t i = 0; i < length; i++) {
+		const char *escape;
+
+		switch (cString[i]) {
+		case '\\':
+			escape = "\\\\";
+			break;
+		case '"':
+			escape = "\\\"";
+			break;
+		case '\b':
+			escape = "\\b";
+			break;
+		case '\f':
+			escape = "\\f";
+			break;
+		case '\r':
+			escape = "\\r";
+			break;
+		case '\t':
+			escape = "\\t";
+			break;
+		case '\n':
+			if (options & OFJSONRepresentationOptionJSON5)
+				escape = "\\\n";
+			else
+				escape = "\\n";
+			break;
+		default:
+			continue;
+		}
+
+		[stream writeBuffer: cString + last length: i - last];
+		[stream writeBuffer: escape length: 2];
+		last = i + 1;
+	}
+
+	[stream writeBuffer: cString + last length: length - last];
+
+	if (quote)
+		[stream writeBuffer: "\"" length: 1];
+
+	objc_autoreleasePoolPop(pool);
+}
+
+- (void)writeJSONToStream: (OFStream *)stream
+		  options: (OFJSONRepresentationOptions)options
+{
+	[self of_writeJSONToStream: stream options: options depth: 0];
+}
+
 - (OFData *)messagePackRepresentation
 {
 	OFMutableData *data;
-	size_t length;
+	size_t length, headerLength;
+	uint8_t header[5];
 
 	length = self.UTF8StringLength;
+	headerLength = OFMessagePackStringHeader(length, header);
 
-	if (length <= 31) {
-		uint8_t tmp = 0xA0 | ((uint8_t)length & 0x1F);
-
-		data = [OFMutableData dataWithCapacity: length + 1];
-		[data addItem: &tmp];
-	} else if (length <= UINT8_MAX) {
-		uint8_t type = 0xD9;
-		uint8_t tmp = (uint8_t)length;
-
-		data = [OFMutableData dataWithCapacity: length + 2];
-		[data addItem: &type];
-		[data addItem: &tmp];
-	} else if (length <= UINT16_MAX) {
-		uint8_t type = 0xDA;
-		uint16_t tmp = OFToBigEndian16((uint16_t)length);
-
-		data = [OFMutableData dataWithCapacity: length + 3];
-		[data addItem: &type];
-		[data addItems: &tmp count: sizeof(tmp)];
-	} else if (length <= UINT32_MAX) {
-		uint8_t type = 0xDB;
-		uint32_t tmp = OFToBigEndian32((uint32_t)length);
-
-		data = [OFMutableData dataWithCapacity: length + 5];
-		[data addItem: &type];
-		[data addItems: &tmp count: sizeof(tmp)];
-	} else
-		@throw [OFOutOfRangeException exception];
-
+	data = [OFMutableData dataWithCapacity: headerLength + length];
+	[data addItems: header count: headerLength];
 	[data addItems: self.UTF8String count: length];
 
 	return data;
 }
 
+- (void)writeMessagePackToStream: (OFStream *)stream
+{
+	void *pool = objc_autoreleasePoolPush();
+	size_t length, headerLength;
+	uint8_t header[5];
+
+	length = self.UTF8StringLength;
+	headerLength = OFMessagePackStringHeader(length, header);
+
+	[stream writeBuffer: header length: headerLength];
+	[stream writeBuffer: self.UTF8String length: length];
+
+	objc_autoreleasePoolPop(pool);
+}
+
 - (OFRange)rangeOfString: (OFString *)string
 {
 	return [self rangeOfString: string
@@ -1886,6 +1950,20 @@ decomposedString(OFString *self, const char *const *const *table, size_t size)
 	return OFRangeMake(OFNotFound, 0);
 }
 
+- (OFRange)rangeOfStringSearch: (OFStringSearch *)search
+{
+	return [self rangeOfStringSearch: search
+				   range: OFRangeMake(0, self.length)];
+}
+
+- (OFRange)rangeOfStringSearch: (OFStringSearch *)search
+			 range: (OFRange)range
+{
+	return [self rangeOfString: search.string
+			   options: search.options
+			     range: range];
+}
+
 - (size_t)indexOfCharacterFromSet: (OFCharacterSet *)characterSet
 {
 	return [self indexOfCharacterFromSet: characterSet
@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#import "OFStringSearch.h"
+#import "OFSubstringSearch.h"
+
+OF_ASSUME_NONNULL_BEGIN
+
+@interface OFStringSearch ()
+/*
+ * The UTF-8 representation of the string, prepared for
+ * OFSubstringSearchFind().
+ */
+- (const OFSubstringSearch *)of_substringSearch OF_DIRECT;
+@end
+
+OF_ASSUME_NONNULL_END
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#import "OFObject.h"
+#import "OFString.h"
+
+OF_ASSUME_NONNULL_BEGIN
+
+struct OFSubstringSearch;
+
+/**
+ * @class OFStringSearch OFStringSearch.h ObjFW/OFStringSearch.h
+ *
+ * @brief A string prepared for being searched for repeatedly.
+ *
+ * Preparing the string once avoids doing so on every search when searching
+ * for the same string in many strings, which makes searching for long strings
+ * considerably faster.
+ *
+ * @ref OFString#rangeOfStringSearch:range: searches for it.
+ */
+OF_SUBCLASSING_RESTRICTED
+@interface OFStringSearch: OFObject
+{
+	OFString *_string;
+	OFStringSearchOptions _options;
+	struct OFSubstringSearch *_search;
+	OF_RESERVE_IVARS(OFStringSearch, 4)
+}
+
+/**
+ * @brief The string to search for.
+ */
+@property (readonly, nonatomic) OFString *string;
+
+/**
+ * @brief The options modifying the search behavior.
+ */
+@property (readonly, nonatomic) OFStringSearchOptions options;
+
+/**
+ * @brief Creates a new search for the specified string.
+ *
+ * @param string The string to search for
+ * @param options Options modifying the search behavior
+ * @return A new, autoreleased OFStringSearch
+ */
++ (instancetype)searchWithString: (OFString *)string
+			 options: (OFStringSearchOptions)options;
+
+/**
+ * @brief Initializes an already allocated search for the specified string.
+ *
+ * @param string The string to search for
+ * @param options Options modifying the search behavior
+ * @return An initialized OFStringSearch
+ */
+- (instancetype)initWithString: (OFString *)string
+		       options: (OFStringSearchOptions)options
+    OF_DESIGNATED_INITIALIZER;
+
+- (instancetype)init OF_UNAVAILABLE;
+@end
+
+OF_ASSUME_NONNULL_END
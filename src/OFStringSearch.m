@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#import "OFStringSearch.h"
+#import "OFStringSearch+Private.h"
+
+@implementation OFStringSearch
+@synthesize string = _string, options = _options;
+
++ (instancetype)searchWithString: (OFString *)string
+			 options: (OFStringSearchOptions)options
+{
+	return [[[self alloc] initWithString: string
+				     options: options] autorelease];
+}
+
+- (instancetype)init
+{
+	OF_INVALID_INIT_METHOD
+}
+
+- (instancetype)initWithString: (OFString *)string
+		       options: (OFStringSearchOptions)options
+{
+	self = [super init];
+
+	@try {
+		void *pool = objc_autoreleasePoolPush();
+		size_t length = string.UTF8StringLength;
+		unsigned char *needle;
+
+		_string = [string copy];
+		_options = options;
+
+		/* The needle is stored right after the search it belongs to. */
+		_search = OFAllocMemory(1, sizeof(*_search) + length);
+		needle = (unsigned char *)(_search + 1);
+		memcpy(needle, string.UTF8String, length);
+
+		OFSubstringSearchInit(_search, needle, length,
+		    (options & OFStringSearchBackwards));
+
+		objc_autoreleasePoolPop(pool);
+	} @catch (id e) {
+		[self release];
+		@throw e;
+	}
+
+	return self;
+}
+
+- (void)dealloc
+{
+	[_string release];
+	OFFreeMemory(_search);
+
+	[super dealloc];
+}
+
+- (const OFSubstringSearch *)of_substringSearch
+{
+	return _search;
+}
+
+- (OFString *)description
+{
+	return [OFString stringWithFormat: @"<%@: %@>",
+					   self.className, _string];
+}
+@end
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#import "macros.h"
+
+OF_ASSUME_NONNULL_BEGIN
+
+/*
+ * A needle that has been preprocessed for the Two-Way string matching
+ * algorithm, which finds it in linear time and without allocating memory.
+ *
+ * The needle is not copied and needs to stay valid while the search is used.
+ */
+typedef struct OFSubstringSearch {
+	const unsigned char *needle;
+	size_t length, criticalPosition, period, memory;
+	bool backwards;
+	/* Distance of the last occurrence of each byte to the needle's end */
+	size_t shift[256];
+} OFSubstringSearch;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern void OFSubstringSearchInit(OFSubstringSearch *_Nonnull search,
+    const void *_Nonnull needle, size_t length, bool backwards);
+extern size_t OFSubstringSearchFind(const OFSubstringSearch *_Nonnull search,
+    const void *_Nonnull haystack, size_t length);
+extern size_t OFSubstringFind(const void *_Nonnull haystack,
+    size_t haystackLength, const void *_Nonnull needle, size_t needleLength,
+    bool backwards);
+#ifdef __cplusplus
+}
+#endif
+
+OF_ASSUME_NONNULL_END
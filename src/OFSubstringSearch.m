@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#import "OFSubstringSearch.h"
+#import "OFObject.h"
+
+/*
+ * Haystacks shorter than this are searched by comparing at every position, as
+ * preprocessing the needle would take longer than that.
+ */
+static const size_t twoWayMinHaystackLength = 256;
+
+/*
+ * A backwards search is a forwards search in the reversed haystack for the
+ * reversed needle. All indices below are relative to the direction of the
+ * search.
+ */
+#define NEEDLE(i) (backwards ? needle[length - 1 - (i)] : needle[i])
+#define HAYSTACK(i) \
+	(backwards ? haystack[haystackLength - 1 - (i)] : haystack[i])
+
+static OF_INLINE size_t
+maximalSuffix(const unsigned char *needle, size_t length, bool backwards,
+    bool reversedOrder, size_t *period)
+{
+	size_t i = SIZE_MAX, j = 0, k = 1, p = 1;
+
+	while (j + k < length) {
+		unsigned char a = NEEDLE(i + k), b = NEEDLE(j + k);
+
+		if (a == b) {
+			if (k == p) {
+				j += p;
+				k = 1;
+			} else
+				k++;
+		} else if (reversedOrder ? a < b : a > b) {
+			j += k;
+			k = 1;
+			p = j - i;
+		} else {
+			i = j++;
+			k = p = 1;
+		}
+	}
+
+	*period = p;
+	return i;
+}
+
+void
+OFSubstringSearchInit(OFSubstringSearch *search, const void *needle_,
+    size_t length, bool backwards)
+{
+	const unsigned char *needle = needle_;
+	size_t criticalPosition, period, reversedPosition, reversedPeriod;
+	bool periodic;
+
+	search->needle = needle;
+	search->length = length;
+	search->backwards = backwards;
+
+	for (size_t i = 0; i < 256; i++)
+		search->shift[i] = length;
+	for (size_t i = 0; i < length; i++)
+		search->shift[NEEDLE(i)] = length - 1 - i;
+
+	/*
+	 * The critical factorization is the later of the maximal suffixes for
+	 * both orderings of the alphabet. Positions are off by one, as
+	 * SIZE_MAX is used for -1.
+	 */
+	criticalPosition = maximalSuffix(needle, length, backwards, false,
+	    &period);
+	reversedPosition = maximalSuffix(needle, length, backwards, true,
+	    &reversedPeriod);
+	if (reversedPosition + 1 > criticalPosition + 1) {
+		criticalPosition = reversedPosition;
+		period = reversedPeriod;
+	}
+
+	periodic = true;
+	for (size_t i = 0; i < criticalPosition + 1; i++) {
+		if (NEEDLE(i) != NEEDLE(i + period)) {
+			periodic = false;
+			break;
+		}
+	}
+
+	search->criticalPosition = criticalPosition;
+
+	if (periodic) {
+		search->period = period;
+		search->memory = length - period;
+	} else {
+		size_t left = criticalPosition + 1;
+		size_t right = length - criticalPosition - 1;
+
+		search->period = (left > right ? left : right) + 1;
+		search->memory = 0;
+	}
+}
+
+static OF_INLINE size_t
+twoWayFind(const OFSubstringSearch *search, const unsigned char *haystack,
+    size_t haystackLength, bool backwards)
+{
+	const unsigned char *needle = search->needle;
+	size_t length = search->length;
+	size_t criticalPosition = search->criticalPosition;
+	size_t position = 0, memory = 0;
+
+	while (haystackLength - position >= length) {
+		size_t k;
+
+		/* Check the last byte first and skip ahead on a mismatch. */
+		k = search->shift[HAYSTACK(position + length - 1)];
+		if (k > 0) {
+			if (k < memory)
+				k = memory;
+
+			position += k;
+			memory = 0;
+			continue;
+		}
+
+		/* Compare the right half. */
+		k = (criticalPosition + 1 > memory
+		    ? criticalPosition + 1 : memory);
+		while (k < length && NEEDLE(k) == HAYSTACK(position + k))
+			k++;
+
+		if (k < length) {
+			position += k - criticalPosition;
+			memory = 0;
+			continue;
+		}
+
+		/* Compare the left half. */
+		k = criticalPosition + 1;
+		while (k > memory &&
+		    NEEDLE(k - 1) == HAYSTACK(position + k - 1))
+			k--;
+
+		if (k <= memory)
+			return (backwards
+			    ? haystackLength - position - length : position);
+
+		position += search->period;
+		memory = search->memory;
+	}
+
+	return OFNotFound;
+}
+
+static size_t
+findByte(const unsigned char *haystack, size_t haystackLength,
+    unsigned char byte, bool backwards)
+{
+	if (backwards) {
+		for (size_t i = haystackLength; i > 0; i--)
+			if (haystack[i - 1] == byte)
+				return i - 1;
+
+		return OFNotFound;
+	} else {
+		const unsigned char *found = memchr(haystack, byte,
+		    haystackLength);
+
+		if (found == NULL)
+			return OFNotFound;
+
+		return (size_t)(found - haystack);
+	}
+}
+
+size_t
+OFSubstringSearchFind(const OFSubstringSearch *search, const void *haystack,
+    size_t haystackLength)
+{
+	if (search->length == 0)
+		return 0;
+
+	if (search->length > haystackLength)
+		return OFNotFound;
+
+	if (search->length == 1)
+		return findByte(haystack, haystackLength, search->needle[0],
+		    search->backwards);
+
+	if (search->backwards)
+		return twoWayFind(search, haystack, haystackLength, true);
+	else
+		return twoWayFind(search, haystack, haystackLength, false);
+}
+
+size_t
+OFSubstringFind(const void *haystack_, size_t haystackLength,
+    const void *needle_, size_t needleLength, bool backwards)
+{
+	const unsigned char *haystack = haystack_, *needle = needle_;
+	OFSubstringSearch search;
+
+	if (needleLength == 0)
+		return 0;
+
+	if (needleLength > haystackLength)
+		return OFNotFound;
+
+	if (needleLength == 1)
+		return findByte(haystack, haystackLength, needle[0], backwards);
+
+	if (haystackLength < twoWayMinHaystackLength) {
+		size_t last = haystackLength - needleLength;
+
+		for (size_t i = 0; i <= last; i++) {
+			size_t j = (backwards ? last - i : i);
+
+			if (haystack[j] == needle[0] &&
+			    haystack[j + needleLength - 1] ==
+			    needle[needleLength - 1] &&
+			    memcmp(haystack + j, needle, needleLength) == 0)
+				return j;
+		}
+
+		return OFNotFound;
+	}
+
+	OFSubstringSearchInit(&search, needle, needleLength, backwards);
+
+	return OFSubstringSearchFind(&search, haystack, haystackLength);
+}
@@ -51,6 +51,7 @@ OF_SUBCLASSING_RESTRICTED
 @property (class, readonly, nonatomic) bool supportsAVX;
 @property (class, readonly, nonatomic) bool supportsAVX2;
 @property (class, readonly, nonatomic) bool supportsAESNI;
+@property (class, readonly, nonatomic) bool supportsPCLMULQDQ;
 @property (class, readonly, nonatomic) bool supportsSHAExtensions;
 # endif
 # if defined(OF_POWERPC) || defined(OF_POWERPC64) || defined(DOXYGEN)
@@ -287,6 +288,16 @@ OF_SUBCLASSING_RESTRICTED
  */
 + (bool)supportsAESNI;
 
+/**
+ * @brief Returns whether the CPU supports carry-less multiplication
+ *	  (PCLMULQDQ).
+ *
+ * @note This method is only available on x86 and x86_64.
+ *
+ * @return Whether the CPU supports PCLMULQDQ
+ */
++ (bool)supportsPCLMULQDQ;
+
 /**
  * @brief Returns whether the CPU supports Intel SHA Extensions.
  *
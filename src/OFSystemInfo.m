@@ -704,6 +704,11 @@ x86CPUID(uint32_t eax, uint32_t ecx)
 	return (x86CPUID(1, 0).ecx & (1u << 25));
 }
 
++ (bool)supportsPCLMULQDQ
+{
+	return (x86CPUID(1, 0).ecx & (1u << 1));
+}
+
 + (bool)supportsSHAExtensions
 {
 	return (x86CPUID(7, 0).ebx & (1u << 29));
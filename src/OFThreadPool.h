@@ -26,16 +26,19 @@ OF_ASSUME_NONNULL_BEGIN
 typedef void (^OFThreadPoolBlock)(void);
 #endif
 
-@class OFCondition;
-@class OFList OF_GENERIC(ObjectType);
-@class OFMutableArray OF_GENERIC(ObjectType);
-@class OFThreadPoolJob;
+@class OFThreadPoolScheduler;
 
 /**
  * @class OFThreadPool OFThreadPool.h ObjFW/OFThreadPool.h
  *
  * @brief A class providing a pool of reusable threads.
  *
+ * Each thread of the pool has its own queue of jobs. Jobs that are dispatched
+ * from within a job are put into the queue of the thread running that job,
+ * while jobs that are dispatched from other threads are put into a queue
+ * shared by all threads. Threads that run out of jobs steal jobs from the
+ * other threads.
+ *
  * @note When the thread pool is released, all threads will terminate after
  *	 they finish the job they are currently processing.
  */
@@ -43,15 +46,7 @@ OF_SUBCLASSING_RESTRICTED
 @interface OFThreadPool: OFObject
 {
 	size_t _size;
-	OFMutableArray *_threads;
-	volatile int _count;
-#ifdef OF_THREAD_POOL_M
-@public
-#endif
-	OFList *_queue;
-	OFCondition *_queueCondition;
-	volatile int _doneCount;
-	OFCondition *_countCondition;
+	OFThreadPoolScheduler *_scheduler;
 }
 
 /**
@@ -90,6 +85,8 @@ OF_SUBCLASSING_RESTRICTED
  * @brief Execute the specified selector on the specified target with the
  *	  specified object as soon as a thread is ready.
  *
+ * This can also be called from within a job of the thread pool.
+ *
  * @param target The target on which to perform the selector
  * @param selector The selector to perform on the target
  * @param object The object with which the selector is performed on the target
@@ -102,6 +99,8 @@ OF_SUBCLASSING_RESTRICTED
 /**
  * @brief Executes the specified block as soon as a thread is ready.
  *
+ * This can also be called from within a job of the thread pool.
+ *
  * @param block The block to execute
  */
 - (void)dispatchWithBlock: (OFThreadPoolBlock)block;
@@ -109,6 +108,9 @@ OF_SUBCLASSING_RESTRICTED
 
 /**
  * @brief Waits until all jobs are done.
+ *
+ * @warning This must not be called from within a job of the thread pool, as
+ *	    that job would wait for itself.
  */
 - (void)waitUntilDone;
 @end
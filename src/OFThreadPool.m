@@ -15,14 +15,18 @@
 
 #include "config.h"
 
-#define OF_THREAD_POOL_M
-
 #import "OFThreadPool.h"
 #import "OFArray.h"
 #import "OFList.h"
 #import "OFThread.h"
 #import "OFCondition.h"
 #import "OFSystemInfo.h"
+#ifdef OF_HAVE_ATOMIC_OPS
+# import "OFAtomic.h"
+#endif
+
+/* The number of jobs each thread can queue itself, must be a power of 2. */
+#define dequeSize 1024
 
 OF_DIRECT_MEMBERS
 @interface OFThreadPoolJob: OFObject
@@ -101,36 +105,161 @@ OF_DIRECT_MEMBERS
 }
 @end
 
+#ifdef OF_HAVE_ATOMIC_OPS
+/*
+ * A Chase-Lev work-stealing deque of a fixed size. Only the thread owning it
+ * pushes and takes jobs at the bottom, while other threads steal jobs from the
+ * top. The indices wrap around and are only ever compared by their distance.
+ *
+ * The deque holds a reference to each job in it, which is passed on to
+ * whoever takes or steals the job.
+ */
+struct OFThreadPoolDeque {
+	volatile int top, bottom;
+	OFThreadPoolJob *volatile jobs[dequeSize];
+};
+
+static bool
+dequePush(struct OFThreadPoolDeque *deque, OFThreadPoolJob *job)
+{
+	unsigned int bottom = (unsigned int)deque->bottom;
+	unsigned int top = (unsigned int)deque->top;
+
+	OFAcquireMemoryBarrier();
+
+	if (bottom - top >= dequeSize)
+		return false;
+
+	deque->jobs[bottom & (dequeSize - 1)] = job;
+	OFReleaseMemoryBarrier();
+	deque->bottom = (int)(bottom + 1);
+
+	return true;
+}
+
+static OFThreadPoolJob *
+dequeTake(struct OFThreadPoolDeque *deque)
+{
+	unsigned int bottom = (unsigned int)deque->bottom - 1, top;
+	OFThreadPoolJob *job;
+
+	deque->bottom = (int)bottom;
+	OFMemoryBarrier();
+	top = (unsigned int)deque->top;
+
+	if ((int)(bottom - top) < 0) {
+		deque->bottom = (int)(bottom + 1);
+		return nil;
+	}
+
+	job = deque->jobs[bottom & (dequeSize - 1)];
+
+	/* The last job might be stolen at the same time. */
+	if (bottom == top) {
+		if (!OFAtomicIntCompareAndSwap(&deque->top, (int)top,
+		    (int)(top + 1)))
+			job = nil;
+
+		deque->bottom = (int)(bottom + 1);
+	}
+
+	return job;
+}
+
+static OFThreadPoolJob *
+dequeSteal(struct OFThreadPoolDeque *deque)
+{
+	unsigned int top = (unsigned int)deque->top, bottom;
+	OFThreadPoolJob *job;
+
+	OFMemoryBarrier();
+	bottom = (unsigned int)deque->bottom;
+	OFAcquireMemoryBarrier();
+
+	if ((int)(bottom - top) <= 0)
+		return nil;
+
+	job = deque->jobs[top & (dequeSize - 1)];
+
+	/* The job must be read before the slot can be reused. */
+	OFMemoryBarrier();
+
+	if (!OFAtomicIntCompareAndSwap(&deque->top, (int)top, (int)(top + 1)))
+		return nil;
+
+	return job;
+}
+#endif
+
+@class OFThreadPoolThread;
+
 OF_DIRECT_MEMBERS
-@interface OFThreadPoolThread: OFThread
+@interface OFThreadPoolScheduler: OFObject
 {
-	OFList *_queue;
-	OFCondition *_queueCondition, *_countCondition;
 @public
+	OFMutableArray OF_GENERIC(OFThreadPoolThread *) *_threads;
+	OFThreadPoolThread **_workers;
+	size_t _workersCount;
+	/* Jobs dispatched from outside the pool or that did not fit a deque */
+	OFList OF_GENERIC(OFThreadPoolJob *) *_queue;
+	OFCondition *_queueCondition;
+	volatile int _sleepingCount;
 	volatile bool _terminate;
-	volatile int *_doneCount;
+	volatile int _pendingCount;
+	OFCondition *_countCondition;
 }
 
-+ (instancetype)threadWithThreadPool: (OFThreadPool *)threadPool;
-- (instancetype)initWithThreadPool: (OFThreadPool *)threadPool;
+- (instancetype)initWithSize: (size_t)size;
+- (void)enqueueJob: (OFThreadPoolJob *)job;
+- (OFThreadPoolJob *)dequeueJob;
+- (void)increasePendingCount;
+- (void)decreasePendingCount;
 @end
 
-@implementation OFThreadPoolThread
-+ (instancetype)threadWithThreadPool: (OFThreadPool *)threadPool
+OF_DIRECT_MEMBERS
+@interface OFThreadPoolThread: OFThread
 {
-	return [[(OFThreadPoolThread *)[self alloc]
-	    initWithThreadPool: threadPool] autorelease];
+@public
+	OFThreadPoolScheduler *_scheduler;
+	uint32_t _seed;
+#ifdef OF_HAVE_ATOMIC_OPS
+	struct OFThreadPoolDeque _deque;
+#endif
 }
 
-- (instancetype)initWithThreadPool: (OFThreadPool *)threadPool
+- (instancetype)initWithScheduler: (OFThreadPoolScheduler *)scheduler
+			     seed: (uint32_t)seed;
+- (OFThreadPoolJob *)nextJob;
+#ifdef OF_HAVE_ATOMIC_OPS
+- (OFThreadPoolJob *)stealJob;
+#endif
+@end
+
+@implementation OFThreadPoolScheduler
+- (instancetype)initWithSize: (size_t)size
 {
 	self = [super init];
 
 	@try {
-		_queue = [threadPool->_queue retain];
-		_queueCondition = [threadPool->_queueCondition retain];
-		_countCondition = [threadPool->_countCondition retain];
-		_doneCount = &threadPool->_doneCount;
+		_threads = [[OFMutableArray alloc] initWithCapacity: size];
+		_workers = OFAllocMemory(size, sizeof(*_workers));
+		_queue = [[OFList alloc] init];
+		_queueCondition = [[OFCondition alloc] init];
+		_countCondition = [[OFCondition alloc] init];
+
+		for (size_t i = 0; i < size; i++) {
+			OFThreadPoolThread *thread = [[OFThreadPoolThread alloc]
+			    initWithScheduler: self
+					 seed: (uint32_t)i + 1];
+
+			@try {
+				[_threads addObject: thread];
+			} @finally {
+				[thread release];
+			}
+
+			_workers[_workersCount++] = thread;
+		}
 	} @catch (id e) {
 		[self release];
 		@throw e;
@@ -141,6 +270,8 @@ OF_DIRECT_MEMBERS
 
 - (void)dealloc
 {
+	[_threads release];
+	OFFreeMemory(_workers);
 	[_queue release];
 	[_queueCondition release];
 	[_countCondition release];
@@ -148,75 +279,191 @@ OF_DIRECT_MEMBERS
 	[super dealloc];
 }
 
-- (id)main
+- (void)enqueueJob: (OFThreadPoolJob *)job
+{
+	[_queueCondition lock];
+	@try {
+		[_queue appendObject: job];
+		[_queueCondition signal];
+	} @finally {
+		[_queueCondition unlock];
+	}
+}
+
+/* Needs to be called with _queueCondition locked. */
+- (OFThreadPoolJob *)dequeueJob
 {
-	void *pool;
+	OFListItem listItem = _queue.firstListItem;
+	OFThreadPoolJob *job;
 
-	if (_terminate)
+	if (listItem == NULL)
 		return nil;
 
-	pool = objc_autoreleasePoolPush();
+	job = [OFListItemObject(listItem) retain];
+	[_queue removeListItem: listItem];
+
+	return job;
+}
+
+- (void)increasePendingCount
+{
+#ifdef OF_HAVE_ATOMIC_OPS
+	OFAtomicIntIncrease(&_pendingCount);
+#else
+	[_countCondition lock];
+	_pendingCount++;
+	[_countCondition unlock];
+#endif
+}
+
+- (void)decreasePendingCount
+{
+#ifdef OF_HAVE_ATOMIC_OPS
+	if (OFAtomicIntDecrease(&_pendingCount) > 0)
+		return;
+
+	[_countCondition lock];
+	@try {
+		[_countCondition broadcast];
+	} @finally {
+		[_countCondition unlock];
+	}
+#else
+	[_countCondition lock];
+	@try {
+		if (--_pendingCount == 0)
+			[_countCondition broadcast];
+	} @finally {
+		[_countCondition unlock];
+	}
+#endif
+}
+@end
+
+@implementation OFThreadPoolThread
+- (instancetype)initWithScheduler: (OFThreadPoolScheduler *)scheduler
+			     seed: (uint32_t)seed
+{
+	self = [super init];
+
+	/* Retained while running, see -[OFThreadPool initWithSize:]. */
+	_scheduler = scheduler;
+	_seed = seed;
 
-	for (;;) {
+	return self;
+}
+
+- (void)dealloc
+{
+#ifdef OF_HAVE_ATOMIC_OPS
+	OFThreadPoolJob *job;
+
+	while ((job = dequeTake(&_deque)) != nil)
+		[job release];
+#endif
+
+	[super dealloc];
+}
+
+#ifdef OF_HAVE_ATOMIC_OPS
+- (OFThreadPoolJob *)stealJob
+{
+	size_t count = _scheduler->_workersCount, start;
+
+	/* Start at a random thread so that not all steal from the same. */
+	_seed ^= _seed << 13;
+	_seed ^= _seed >> 17;
+	_seed ^= _seed << 5;
+	start = _seed % count;
+
+	for (size_t i = 0; i < count; i++) {
+		OFThreadPoolThread *thread =
+		    _scheduler->_workers[(start + i) % count];
 		OFThreadPoolJob *job;
 
-		[_queueCondition lock];
-		@try {
-			OFListItem listItem;
+		if (thread == self)
+			continue;
 
-			if (_terminate) {
-				objc_autoreleasePoolPop(pool);
-				return nil;
-			}
+		if ((job = dequeSteal(&thread->_deque)) != nil)
+			return job;
+	}
 
-			listItem = _queue.firstListItem;
+	return nil;
+}
+#endif
 
-			while (listItem == NULL) {
-				[_queueCondition wait];
+- (OFThreadPoolJob *)nextJob
+{
+	OFCondition *queueCondition = _scheduler->_queueCondition;
+	OFThreadPoolJob *job;
 
-				if (_terminate) {
-					objc_autoreleasePoolPop(pool);
-					return nil;
-				}
+	if (_scheduler->_terminate)
+		return nil;
 
-				listItem = _queue.firstListItem;
-			}
+#ifdef OF_HAVE_ATOMIC_OPS
+	if ((job = dequeTake(&_deque)) != nil)
+		return job;
 
-			job = [[OFListItemObject(listItem) retain] autorelease];
-			[_queue removeListItem: listItem];
-		} @finally {
-			[_queueCondition unlock];
-		}
+	if ((job = [self stealJob]) != nil)
+		return job;
+#endif
+
+	[queueCondition lock];
+#ifdef OF_HAVE_ATOMIC_OPS
+	/*
+	 * Threads pushing to their own deque only signal the condition if
+	 * another thread is sleeping. Announcing that we are about to sleep
+	 * before checking the deques again makes sure no push is missed.
+	 */
+	OFAtomicIntIncrease(&_scheduler->_sleepingCount);
+	OFMemoryBarrier();
+#endif
+	@try {
+		for (;;) {
+			if (_scheduler->_terminate)
+				return nil;
 
-		if (_terminate) {
-			objc_autoreleasePoolPop(pool);
-			return nil;
+			if ((job = [_scheduler dequeueJob]) != nil)
+				return job;
+
+#ifdef OF_HAVE_ATOMIC_OPS
+			if ((job = [self stealJob]) != nil)
+				return job;
+#endif
+
+			[queueCondition wait];
 		}
+	} @finally {
+#ifdef OF_HAVE_ATOMIC_OPS
+		OFAtomicIntDecrease(&_scheduler->_sleepingCount);
+#endif
+		[queueCondition unlock];
+	}
+}
 
-		[job perform];
+- (id)main
+{
+	void *pool = objc_autoreleasePoolPush();
+	OFThreadPoolJob *job;
 
-		if (_terminate) {
-			objc_autoreleasePoolPop(pool);
-			return nil;
+	while ((job = [self nextJob]) != nil) {
+		@try {
+			[job perform];
+		} @finally {
+			[job release];
 		}
 
 		objc_autoreleasePoolPop(pool);
 		pool = objc_autoreleasePoolPush();
 
-		[_countCondition lock];
-		@try {
-			if (_terminate) {
-				objc_autoreleasePoolPop(pool);
-				return nil;
-			}
+		[_scheduler decreasePendingCount];
+	}
 
-			(*_doneCount)++;
+	objc_autoreleasePoolPop(pool);
 
-			[_countCondition signal];
-		} @finally {
-			[_countCondition unlock];
-		}
-	}
+	[_scheduler release];
+
+	return nil;
 }
 @end
 
@@ -242,28 +489,25 @@ OF_DIRECT_MEMBERS
 
 	@try {
 		_size = size;
-		_threads = [[OFMutableArray alloc] init];
-		_queue = [[OFList alloc] init];
-		_queueCondition = [[OFCondition alloc] init];
-		_countCondition = [[OFCondition alloc] init];
+		_scheduler = [[OFThreadPoolScheduler alloc]
+		    initWithSize: size];
 
+		/*
+		 * Each running thread retains the scheduler, which keeps all
+		 * threads alive so that their jobs can still be stolen. The
+		 * threads release it once they terminate, which breaks the
+		 * retain cycle.
+		 */
 		for (size_t i = 0; i < size; i++) {
-			void *pool = objc_autoreleasePoolPush();
+			[_scheduler retain];
 
-			OFThreadPoolThread *thread =
-			    [OFThreadPoolThread threadWithThreadPool: self];
-
-			[_threads addObject: thread];
-
-			objc_autoreleasePoolPop(pool);
+			@try {
+				[_scheduler->_workers[i] start];
+			} @catch (id e) {
+				[_scheduler release];
+				@throw e;
+			}
 		}
-
-		/*
-		 * We need to start the threads in a separate loop to make sure
-		 * _threads is not modified anymore to prevent a race condition.
-		 */
-		for (size_t i = 0; i < size; i++)
-			[[_threads objectAtIndex: i] start];
 	} @catch (id e) {
 		[self release];
 		@throw e;
@@ -274,56 +518,71 @@ OF_DIRECT_MEMBERS
 
 - (void)dealloc
 {
-	[_queueCondition lock];
-	@try {
-		[_countCondition lock];
+	if (_scheduler != nil) {
+		OFCondition *queueCondition = _scheduler->_queueCondition;
+
+		[queueCondition lock];
 		@try {
-			for (OFThreadPoolThread *thread in _threads)
-				thread->_terminate = true;
+			_scheduler->_terminate = true;
+			[queueCondition broadcast];
 		} @finally {
-			[_countCondition unlock];
+			[queueCondition unlock];
 		}
-
-		[_queueCondition broadcast];
-	} @finally {
-		[_queueCondition unlock];
 	}
 
-	[_threads release];
-	[_queue release];
-	[_queueCondition release];
-	[_countCondition release];
+	[_scheduler release];
 
 	[super dealloc];
 }
 
 - (void)of_dispatchJob: (OFThreadPoolJob *)job OF_DIRECT
 {
-	[_countCondition lock];
-	_count++;
-	[_countCondition unlock];
+#ifdef OF_HAVE_ATOMIC_OPS
+	OFThreadPoolThread *thread;
+#endif
 
-	[_queueCondition lock];
-	@try {
-		[_queue appendObject: job];
-		[_queueCondition signal];
-	} @finally {
-		[_queueCondition unlock];
+	[_scheduler increasePendingCount];
+
+#ifdef OF_HAVE_ATOMIC_OPS
+	thread = (OFThreadPoolThread *)[OFThread currentThread];
+
+	/* Jobs dispatched from within a job go to that thread's deque. */
+	if ([thread isKindOfClass: [OFThreadPoolThread class]] &&
+	    thread->_scheduler == _scheduler) {
+		[job retain];
+
+		if (dequePush(&thread->_deque, job)) {
+			OFMemoryBarrier();
+
+			if (_scheduler->_sleepingCount > 0) {
+				OFCondition *queueCondition =
+				    _scheduler->_queueCondition;
+
+				[queueCondition lock];
+				[queueCondition signal];
+				[queueCondition unlock];
+			}
+
+			return;
+		}
+
+		[job release];
 	}
+#endif
+
+	[_scheduler enqueueJob: job];
 }
 
 - (void)waitUntilDone
 {
-	for (;;) {
-		[_countCondition lock];
-		@try {
-			if (_doneCount == _count)
-				return;
+	OFCondition *countCondition = _scheduler->_countCondition;
 
-			[_countCondition wait];
-		} @finally {
-			[_countCondition unlock];
-		}
+	[countCondition lock];
+	@try {
+		while (_scheduler->_pendingCount > 0)
+			[countCondition wait];
+	} @finally {
+		[countCondition unlock];
 	}
 }
 
@@ -17,6 +17,8 @@
 
 OF_ASSUME_NONNULL_BEGIN
 
+struct OFUTF8StringIndexCheckpoints;
+
 @interface OFUTF8String: OFString
 {
 	/*
@@ -34,6 +36,18 @@ OF_ASSUME_NONNULL_BEGIN
 		bool          hasHash;
 		unsigned long hash;
 		bool          freeWhenDone;
+		/*
+		 * Number of bytes allocated for cString by a mutable string,
+		 * or 0 if it is exactly cStringLength + 1.
+		 */
+		size_t        capacity;
+		/*
+		 * Lazily created table of the byte positions of every n-th
+		 * character, used to avoid scanning from the beginning of
+		 * long non-ASCII strings when looking up an index.
+		 */
+		struct OFUTF8StringIndexCheckpoints *_Nullable
+		    indexCheckpoints;
 	} *restrict _s;
 	struct OFUTF8StringIvars _storage;
 }
@@ -44,6 +58,10 @@ extern "C" {
 #endif
 extern int OFUTF8StringCheck(const char *, size_t, size_t *);
 extern size_t OFUTF8StringIndexToPosition(const char *, size_t, size_t);
+extern size_t OFUTF8StringIvarsIndexToPosition(struct OFUTF8StringIvars *,
+    size_t);
+extern void OFUTF8StringIvarsDiscardIndexCheckpoints(
+    struct OFUTF8StringIvars *);
 #ifdef __cplusplus
 }
 #endif
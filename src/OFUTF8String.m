@@ -23,12 +23,26 @@
 # include <sys/types.h>
 #endif
 
+#ifdef __SSE2__
+# include <emmintrin.h>
+# ifdef HAVE_AVX2_INTRINSICS
+#  include <immintrin.h>
+# endif
+#endif
+
 #import "OFUTF8String.h"
 #import "OFUTF8String+Private.h"
 #import "OFASPrintF.h"
 #import "OFArray.h"
 #import "OFData.h"
 #import "OFMutableUTF8String.h"
+#import "OFStringSearch.h"
+#import "OFStringSearch+Private.h"
+#import "OFSubstringSearch.h"
+#import "OFSystemInfo.h"
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_ATOMIC_OPS)
+# import "OFAtomic.h"
+#endif
 
 #import "OFInitializationFailedException.h"
 #import "OFInvalidArgumentException.h"
@@ -81,6 +95,159 @@ memcasecmp(const char *first, const char *second, size_t length)
 	return OFOrderedSame;
 }
 
+#if defined(__SSE2__) && defined(HAVE_AVX2_INTRINSICS)
+static signed char AVX2Supported = -1;
+
+static OF_INLINE bool
+useAVX2(void)
+{
+	if OF_UNLIKELY (AVX2Supported == -1)
+		AVX2Supported = [OFSystemInfo supportsAVX2];
+
+	return AVX2Supported;
+}
+
+static __attribute__((__target__("avx2"))) size_t
+skipASCIIBlocksAVX2(const char *string, size_t length, size_t i)
+{
+	for (; i + 32 <= length; i += 32) {
+		__m256i block = _mm256_loadu_si256(
+		    (const __m256i *)(const void *)(string + i));
+
+		if (_mm256_movemask_epi8(block) != 0)
+			break;
+	}
+
+	return i;
+}
+
+static __attribute__((__target__("avx2"))) size_t
+countContinuationBytesAVX2(const char *string, size_t length, size_t *i)
+{
+	const __m256i threshold = _mm256_set1_epi8(-64);
+	size_t count = 0;
+
+	for (; *i + 32 <= length; *i += 32) {
+		__m256i block = _mm256_loadu_si256(
+		    (const __m256i *)(const void *)(string + *i));
+
+		count += __builtin_popcount((unsigned int)_mm256_movemask_epi8(
+		    _mm256_cmpgt_epi8(threshold, block)));
+	}
+
+	return count;
+}
+
+static __attribute__((__target__("avx2"))) size_t
+skipCharacterBlocksAVX2(const char *string, size_t length, size_t *idx)
+{
+	const __m256i threshold = _mm256_set1_epi8(-64);
+	size_t i;
+
+	for (i = 0; i + 32 <= length; i += 32) {
+		__m256i block = _mm256_loadu_si256(
+		    (const __m256i *)(const void *)(string + i));
+		size_t starts = 32 - __builtin_popcount((unsigned int)
+		    _mm256_movemask_epi8(_mm256_cmpgt_epi8(threshold, block)));
+
+		if (starts > *idx)
+			break;
+
+		*idx -= starts;
+	}
+
+	return i;
+}
+#endif
+
+#ifdef __SSE2__
+/*
+ * Returns the position of the first 16 byte block starting at i that contains
+ * a non-ASCII character, or the position at which less than a full block is
+ * left.
+ */
+static size_t
+skipASCIIBlocks(const char *string, size_t length, size_t i)
+{
+# ifdef HAVE_AVX2_INTRINSICS
+	if (useAVX2())
+		i = skipASCIIBlocksAVX2(string, length, i);
+# endif
+
+	for (; i + 16 <= length; i += 16) {
+		__m128i block = _mm_loadu_si128(
+		    (const __m128i *)(const void *)(string + i));
+
+		if (_mm_movemask_epi8(block) != 0)
+			break;
+	}
+
+	return i;
+}
+#endif
+
+static size_t
+countContinuationBytes(const char *string, size_t length)
+{
+	size_t i = 0, count = 0;
+#ifdef __SSE2__
+	/* Continuation bytes are the only ones < -64 when signed. */
+	const __m128i threshold = _mm_set1_epi8(-64);
+
+# ifdef HAVE_AVX2_INTRINSICS
+	if (useAVX2())
+		count += countContinuationBytesAVX2(string, length, &i);
+# endif
+
+	for (; i + 16 <= length; i += 16) {
+		__m128i block = _mm_loadu_si128(
+		    (const __m128i *)(const void *)(string + i));
+
+		count += __builtin_popcount((unsigned int)_mm_movemask_epi8(
+		    _mm_cmplt_epi8(block, threshold)));
+	}
+#endif
+
+	for (; i < length; i++)
+		if OF_UNLIKELY ((string[i] & 0xC0) == 0x80)
+			count++;
+
+	return count;
+}
+
+#ifdef __SSE2__
+/*
+ * Skips all complete blocks that end before the character with the specified
+ * index, subtracting the number of characters that were skipped from idx.
+ * Returns the position of the first block that was not skipped.
+ */
+static size_t
+skipCharacterBlocks(const char *string, size_t length, size_t *idx)
+{
+	const __m128i threshold = _mm_set1_epi8(-64);
+	size_t i = 0;
+
+# ifdef HAVE_AVX2_INTRINSICS
+	if (useAVX2())
+		i = skipCharacterBlocksAVX2(string, length, idx);
+# endif
+
+	for (; i + 16 <= length; i += 16) {
+		__m128i block = _mm_loadu_si128(
+		    (const __m128i *)(const void *)(string + i));
+		size_t starts = 16 - __builtin_popcount((unsigned int)
+		    _mm_movemask_epi8(_mm_cmplt_epi8(block, threshold)));
+
+		if (starts > *idx)
+			break;
+
+		*idx -= starts;
+	}
+
+	return i;
+}
+#endif
+
 int
 OFUTF8StringCheck(const char *UTF8String, size_t UTF8Length, size_t *length)
 {
@@ -89,8 +256,23 @@ OFUTF8StringCheck(const char *UTF8String, size_t UTF8Length, size_t *length)
 
 	for (size_t i = 0; i < UTF8Length; i++) {
 		/* No sign of UTF-8 here */
-		if OF_LIKELY (!(UTF8String[i] & 0x80))
+		if OF_LIKELY (!(UTF8String[i] & 0x80)) {
+#ifdef __SSE2__
+			/*
+			 * Only try to skip whole blocks of ASCII when at a
+			 * block boundary, so that mostly non-ASCII strings
+			 * don't pay for it on every character.
+			 */
+			if ((i & 15) == 0) {
+				size_t end = skipASCIIBlocks(UTF8String,
+				    UTF8Length, i);
+
+				if (end > i)
+					i = end - 1;
+			}
+#endif
 			continue;
+		}
 
 		isUTF8 = 1;
 
@@ -151,24 +333,132 @@ OFUTF8StringCheck(const char *UTF8String, size_t UTF8Length, size_t *length)
 size_t
 positionToIndex(const char *string, size_t position)
 {
-	size_t idx = position;
-
-	for (size_t i = 0; i < position; i++)
-		if OF_UNLIKELY ((string[i] & 0xC0) == 0x80)
-			idx--;
-
-	return idx;
+	return position - countContinuationBytes(string, position);
 }
 
 size_t
 OFUTF8StringIndexToPosition(const char *string, size_t idx, size_t length)
 {
+	size_t position = 0;
+
+#ifdef __SSE2__
+	position = skipCharacterBlocks(string, length, &idx);
+	string += position;
+	length -= position;
+#endif
+
 	for (size_t i = 0; i <= idx; i++)
 		if OF_UNLIKELY ((string[i] & 0xC0) == 0x80)
 			if (++idx > length)
 				@throw [OFInvalidFormatException exception];
 
-	return idx;
+	return position + idx;
+}
+
+#if !defined(OF_HAVE_THREADS) || defined(OF_HAVE_ATOMIC_OPS)
+# define USE_INDEX_CHECKPOINTS
+
+/* Number of characters between two checkpoints */
+static const size_t checkpointInterval = 64;
+/* Strings shorter than this are always scanned */
+static const size_t checkpointsMinLength = 256;
+
+struct OFUTF8StringIndexCheckpoints {
+	size_t count;
+	size_t positions[];
+};
+
+static struct OFUTF8StringIndexCheckpoints *
+createIndexCheckpoints(struct OFUTF8StringIvars *ivars)
+{
+	struct OFUTF8StringIndexCheckpoints *checkpoints;
+	size_t count = ivars->length / checkpointInterval + 1;
+
+	checkpoints = OFAllocMemory(1, sizeof(*checkpoints) +
+	    count * sizeof(size_t));
+	checkpoints->count = count;
+	checkpoints->positions[0] = 0;
+
+	@try {
+		for (size_t i = 1; i < count; i++) {
+			size_t position = checkpoints->positions[i - 1];
+
+			checkpoints->positions[i] = position +
+			    OFUTF8StringIndexToPosition(
+			    ivars->cString + position, checkpointInterval,
+			    ivars->cStringLength - position);
+		}
+	} @catch (id e) {
+		OFFreeMemory(checkpoints);
+		@throw e;
+	}
+
+# ifdef OF_HAVE_THREADS
+	/* Immutable strings can be shared, so another thread might race us. */
+	OFReleaseMemoryBarrier();
+	if (!OFAtomicPointerCompareAndSwap(
+	    (void *volatile *)&ivars->indexCheckpoints, NULL, checkpoints)) {
+		OFFreeMemory(checkpoints);
+		checkpoints = ivars->indexCheckpoints;
+		OFAcquireMemoryBarrier();
+	}
+# else
+	ivars->indexCheckpoints = checkpoints;
+# endif
+
+	return checkpoints;
+}
+#endif
+
+size_t
+OFUTF8StringIvarsIndexToPosition(struct OFUTF8StringIvars *ivars, size_t idx)
+{
+#ifdef USE_INDEX_CHECKPOINTS
+	struct OFUTF8StringIndexCheckpoints *checkpoints;
+	size_t checkpoint, position;
+#endif
+
+	if (!ivars->isUTF8)
+		return idx;
+
+#ifdef USE_INDEX_CHECKPOINTS
+	if (ivars->cStringLength < checkpointsMinLength ||
+	    idx < checkpointInterval)
+		return OFUTF8StringIndexToPosition(ivars->cString, idx,
+		    ivars->cStringLength);
+
+	checkpoints = ivars->indexCheckpoints;
+	if (checkpoints == NULL)
+		checkpoints = createIndexCheckpoints(ivars);
+# ifdef OF_HAVE_THREADS
+	else
+		OFAcquireMemoryBarrier();
+# endif
+
+	/*
+	 * Appending to a mutable string keeps the checkpoints, so they might
+	 * not cover the entire string.
+	 */
+	checkpoint = idx / checkpointInterval;
+	if (checkpoint >= checkpoints->count)
+		checkpoint = checkpoints->count - 1;
+
+	position = checkpoints->positions[checkpoint];
+
+	return position + OFUTF8StringIndexToPosition(ivars->cString + position,
+	    idx - checkpoint * checkpointInterval,
+	    ivars->cStringLength - position);
+#else
+	return OFUTF8StringIndexToPosition(ivars->cString, idx,
+	    ivars->cStringLength);
+#endif
+}
+
+void
+OFUTF8StringIvarsDiscardIndexCheckpoints(struct OFUTF8StringIvars *ivars)
+{
+	OFFreeMemory(ivars->indexCheckpoints);
+	ivars->indexCheckpoints = NULL;
 }
 
 @implementation OFUTF8String
@@ -706,6 +996,8 @@ OFUTF8StringIndexToPosition(const char *string, size_t idx, size_t length)
 {
 	if (_s != NULL && _s->freeWhenDone)
 		OFFreeMemory(_s->cString);
+	if (_s != NULL)
+		OFFreeMemory(_s->indexCheckpoints);
 
 	[super dealloc];
 }
@@ -957,7 +1249,7 @@ OFUTF8StringIndexToPosition(const char *string, size_t idx, size_t length)
 	if (!_s->isUTF8)
 		return _s->cString[idx];
 
-	idx = OFUTF8StringIndexToPosition(_s->cString, idx, _s->cStringLength);
+	idx = OFUTF8StringIvarsIndexToPosition(_s, idx);
 
 	if (OFUTF8StringDecode(_s->cString + idx, _s->cStringLength - idx,
 	    &character) <= 0)
@@ -982,28 +1274,39 @@ OFUTF8StringIndexToPosition(const char *string, size_t idx, size_t length)
 	objc_autoreleasePoolPop(pool);
 }
 
-- (OFRange)rangeOfString: (OFString *)string
-		 options: (OFStringSearchOptions)options
-		   range: (OFRange)range
+/*
+ * Converts the range of characters to a range of bytes in the C string. Throws
+ * if the range is out of range.
+ */
+static void
+getPositionRange(OFUTF8String *self, OFRange range, size_t *location,
+    size_t *length)
 {
-	const char *cString = string.UTF8String;
-	size_t cStringLength = string.UTF8StringLength;
-	size_t rangeLocation, rangeLength;
+	struct OFUTF8StringIvars *s = self->_s;
 
 	if (range.length > SIZE_MAX - range.location ||
-	    range.location + range.length > _s->length)
+	    range.location + range.length > s->length)
 		@throw [OFOutOfRangeException exception];
 
-	if (_s->isUTF8) {
-		rangeLocation = OFUTF8StringIndexToPosition(
-		    _s->cString, range.location, _s->cStringLength);
-		rangeLength = OFUTF8StringIndexToPosition(
-		    _s->cString + rangeLocation, range.length,
-		    _s->cStringLength - rangeLocation);
+	if (s->isUTF8) {
+		*location = OFUTF8StringIvarsIndexToPosition(s, range.location);
+		*length = OFUTF8StringIndexToPosition(s->cString + *location,
+		    range.length, s->cStringLength - *location);
 	} else {
-		rangeLocation = range.location;
-		rangeLength = range.length;
+		*location = range.location;
+		*length = range.length;
 	}
+}
+
+- (OFRange)rangeOfString: (OFString *)string
+		 options: (OFStringSearchOptions)options
+		   range: (OFRange)range
+{
+	const char *cString = string.UTF8String;
+	size_t cStringLength = string.UTF8StringLength;
+	size_t rangeLocation, rangeLength, position;
+
+	getPositionRange(self, range, &rangeLocation, &rangeLength);
 
 	if (cStringLength == 0)
 		return OFRangeMake(0, 0);
@@ -1011,53 +1314,45 @@ OFUTF8StringIndexToPosition(const char *string, size_t idx, size_t length)
 	if (cStringLength > rangeLength)
 		return OFRangeMake(OFNotFound, 0);
 
-	if (options & OFStringSearchBackwards) {
-		for (size_t i = rangeLength - cStringLength;; i--) {
-			if (memcmp(_s->cString + rangeLocation + i, cString,
-			    cStringLength) == 0) {
-				range.location += positionToIndex(
-				    _s->cString + rangeLocation, i);
-				range.length = string.length;
-
-				return range;
-			}
+	position = OFSubstringFind(_s->cString + rangeLocation, rangeLength,
+	    cString, cStringLength, (options & OFStringSearchBackwards));
+	if (position == OFNotFound)
+		return OFRangeMake(OFNotFound, 0);
 
-			/* Did not match and we're at the last char */
-			if (i == 0)
-				return OFRangeMake(OFNotFound, 0);
-		}
-	} else {
-		for (size_t i = 0; i <= rangeLength - cStringLength; i++) {
-			if (memcmp(_s->cString + rangeLocation + i, cString,
-			    cStringLength) == 0) {
-				range.location += positionToIndex(
-				    _s->cString + rangeLocation, i);
-				range.length = string.length;
-
-				return range;
-			}
-		}
-	}
+	range.location += positionToIndex(_s->cString + rangeLocation,
+	    position);
+	range.length = string.length;
 
-	return OFRangeMake(OFNotFound, 0);
+	return range;
 }
 
-- (bool)containsString: (OFString *)string
+- (OFRange)rangeOfStringSearch: (OFStringSearch *)search
+			 range: (OFRange)range
 {
-	const char *cString = string.UTF8String;
-	size_t cStringLength = string.UTF8StringLength;
+	const OFSubstringSearch *substringSearch = [search of_substringSearch];
+	size_t rangeLocation, rangeLength, position;
 
-	if (cStringLength == 0)
-		return true;
+	getPositionRange(self, range, &rangeLocation, &rangeLength);
 
-	if (cStringLength > _s->cStringLength)
-		return false;
+	if (substringSearch->length == 0)
+		return OFRangeMake(0, 0);
 
-	for (size_t i = 0; i <= _s->cStringLength - cStringLength; i++)
-		if (memcmp(_s->cString + i, cString, cStringLength) == 0)
-			return true;
+	position = OFSubstringSearchFind(substringSearch,
+	    _s->cString + rangeLocation, rangeLength);
+	if (position == OFNotFound)
+		return OFRangeMake(OFNotFound, 0);
+
+	range.location += positionToIndex(_s->cString + rangeLocation,
+	    position);
+	range.length = search.string.length;
 
-	return false;
+	return range;
+}
+
+- (bool)containsString: (OFString *)string
+{
+	return (OFSubstringFind(_s->cString, _s->cStringLength,
+	    string.UTF8String, string.UTF8StringLength, false) != OFNotFound);
 }
 
 - (OFString *)substringWithRange: (OFRange)range
@@ -1069,10 +1364,8 @@ OFUTF8StringIndexToPosition(const char *string, size_t idx, size_t length)
 		@throw [OFOutOfRangeException exception];
 
 	if (_s->isUTF8) {
-		start = OFUTF8StringIndexToPosition(_s->cString, start,
-		    _s->cStringLength);
-		end = OFUTF8StringIndexToPosition(_s->cString, end,
-		    _s->cStringLength);
+		start = OFUTF8StringIvarsIndexToPosition(_s, start);
+		end = OFUTF8StringIvarsIndexToPosition(_s, end);
 	}
 
 	return [OFString stringWithUTF8String: _s->cString + start
@@ -1105,10 +1398,10 @@ OFUTF8StringIndexToPosition(const char *string, size_t idx, size_t length)
 {
 	void *pool;
 	OFMutableArray *array;
-	const char *cString;
 	size_t cStringLength;
 	bool skipEmpty = (options & OFStringSkipEmptyComponents);
-	size_t last;
+	OFSubstringSearch search;
+	size_t last, position;
 	OFString *component;
 
 	if (delimiter == nil)
@@ -1119,7 +1412,6 @@ OFUTF8StringIndexToPosition(const char *string, size_t idx, size_t length)
 
 	array = [OFMutableArray array];
 	pool = objc_autoreleasePoolPush();
-	cString = delimiter.UTF8String;
 	cStringLength = delimiter.UTF8StringLength;
 
 	if (cStringLength > _s->cStringLength) {
@@ -1129,18 +1421,18 @@ OFUTF8StringIndexToPosition(const char *string, size_t idx, size_t length)
 		return array;
 	}
 
-	last = 0;
-	for (size_t i = 0; i <= _s->cStringLength - cStringLength; i++) {
-		if (memcmp(_s->cString + i, cString, cStringLength) != 0)
-			continue;
+	OFSubstringSearchInit(&search, delimiter.UTF8String, cStringLength,
+	    false);
 
+	last = 0;
+	while ((position = OFSubstringSearchFind(&search, _s->cString + last,
+	    _s->cStringLength - last)) != OFNotFound) {
 		component = [OFString stringWithUTF8String: _s->cString + last
-						    length: i - last];
+						    length: position];
 		if (!skipEmpty || component.length > 0)
 			[array addObject: component];
 
-		i += cStringLength - 1;
-		last = i + 1;
+		last += position + cStringLength;
 	}
 	component = [OFString stringWithUTF8String: _s->cString + last];
 	if (!skipEmpty || component.length > 0)
@@ -43,7 +43,11 @@ OF_SUBCLASSING_RESTRICTED
 	OFMutableArray OF_GENERIC(OFZIPArchiveEntry *) *_entries;
 	OFMutableDictionary OF_GENERIC(OFString *, OFZIPArchiveEntry *)
 	    *_pathToEntryMap;
+	struct _OFZIPArchiveIndex *_Nullable _index;
 	OFStream *_Nullable _lastReturnedStream;
+#ifdef OF_HAVE_FILES
+	OFString *_Nullable _path;
+#endif
 }
 
 /**
@@ -136,6 +140,25 @@ OF_SUBCLASSING_RESTRICTED
  */
 - (OFStream *)streamForReadingFile: (OFString *)path;
 
+#ifdef OF_HAVE_FILES
+/**
+ * @brief Returns a stream for reading the specified file from the archive
+ *	  that is independent of all other streams.
+ *
+ * The returned stream reads from its own file handle. It does not invalidate
+ * any other streams and is not invalidated by them, so that several files can
+ * be read at the same time. This method can be called from several threads
+ * at once, and each returned stream can be read on a different thread.
+ *
+ * @note This method is only available in read mode and for archives that were
+ *	 created with a path.
+ *
+ * @param path The path to the file inside the archive
+ * @return A stream for reading the specified file form the archive
+ */
+- (OFStream *)independentStreamForReadingFile: (OFString *)path;
+#endif
+
 /**
  * @brief Returns a stream for writing the specified entry to the archive.
  *
@@ -158,6 +181,10 @@ OF_SUBCLASSING_RESTRICTED
  *		  * The uncompressed size.
  *		  * The CRC32.
  *		  * Bit 3 and 11 of the general purpose bit flag.
+ *		Only entries with the compression method
+ *		@ref OFZIPArchiveEntryCompressionMethodNone or
+ *		@ref OFZIPArchiveEntryCompressionMethodDeflate can be
+ *		written.
  * @return A stream for writing the specified entry to the archive
  */
 - (OFStream *)streamForWritingEntry: (OFZIPArchiveEntry *)entry;
@@ -16,6 +16,7 @@
 #include "config.h"
 
 #include <errno.h>
+#include <string.h>
 
 #import "OFZIPArchive.h"
 #import "OFZIPArchiveEntry.h"
@@ -29,8 +30,12 @@
 #ifdef OF_HAVE_FILES
 # import "OFFile.h"
 #endif
+#import "OFDeflateStream.h"
 #import "OFInflateStream.h"
 #import "OFInflate64Stream.h"
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_ATOMIC_OPS)
+# import "OFAtomic.h"
+#endif
 
 #import "OFChecksumMismatchException.h"
 #import "OFInvalidArgumentException.h"
@@ -56,11 +61,32 @@ enum {
 	modeAppend
 };
 
+/*
+ * The central directory of an archive opened for reading is read in one go
+ * and only indexed by file name. The entries are created from it when they
+ * are first needed, so that opening large archives is fast.
+ */
+struct _OFZIPArchiveIndex {
+	unsigned char *centralDirectory;
+	size_t centralDirectorySize;
+	size_t count;
+	/* The offsets of the records in the central directory */
+	size_t *offsets;
+	/* The entries that have already been created, or nil */
+	OFZIPArchiveEntry **entries;
+	/* Open addressing hash table of entry index + 1, 0 for free buckets */
+	size_t *buckets;
+	size_t bucketsCount;
+};
+
 OF_DIRECT_MEMBERS
 @interface OFZIPArchive ()
 - (void)of_readZIPInfo;
 - (void)of_readEntries;
+- (OFZIPArchiveEntry *)of_entryForPath: (OFString *)path;
 - (void)of_closeLastReturnedStream;
+- (OFStream *)of_streamForReadingFile: (OFString *)path
+			   fromStream: (OFStream *)stream;
 - (void)of_writeCentralDirectory;
 @end
 
@@ -94,11 +120,25 @@ OF_DIRECT_MEMBERS
 			    entry: (OFZIPArchiveEntry *)entry;
 @end
 
+OF_DIRECT_MEMBERS
+@interface OFZIPArchiveCountingStream: OFStream
+{
+	OFStream *_stream;
+@public
+	int64_t _bytesWritten;
+}
+
+- (instancetype)initWithStream: (OFStream *)stream;
+@end
+
 OF_DIRECT_MEMBERS
 @interface OFZIPArchiveFileWriteStream: OFStream
 {
 	OFStream *_stream;
+	OFZIPArchiveCountingStream *_Nullable _countingStream;
+	OFDeflateStream *_Nullable _deflateStream;
 	uint32_t _CRC32;
+	int64_t _uncompressedSize;
 @public
 	int64_t _bytesWritten;
 	OFMutableZIPArchiveEntry *_entry;
@@ -142,6 +182,133 @@ OFZIPArchiveReadField64(const uint8_t **data, uint16_t *size)
 	return field;
 }
 
+static void
+freeIndex(struct _OFZIPArchiveIndex *index)
+{
+	if (index == NULL)
+		return;
+
+	if (index->entries != NULL)
+		for (size_t i = 0; i < index->count; i++)
+			[index->entries[i] release];
+
+	OFFreeMemory(index->centralDirectory);
+	OFFreeMemory(index->offsets);
+	OFFreeMemory(index->entries);
+	OFFreeMemory(index->buckets);
+	OFFreeMemory(index);
+}
+
+static OFZIPArchiveEntry *
+indexEntry(struct _OFZIPArchiveIndex *index, size_t i)
+{
+	OFZIPArchiveEntry *entry = index->entries[i];
+
+	if (entry != nil) {
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_ATOMIC_OPS)
+		OFAcquireMemoryBarrier();
+#endif
+		return entry;
+	}
+
+	entry = [[OFZIPArchiveEntry alloc]
+	    of_initWithCentralDirectoryRecord: index->centralDirectory +
+					       index->offsets[i]
+				       length: index->centralDirectorySize -
+					       index->offsets[i]];
+
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_ATOMIC_OPS)
+	/* Independent streams can be created on several threads at once. */
+	OFReleaseMemoryBarrier();
+	if (!OFAtomicPointerCompareAndSwap(
+	    (void *volatile *)&index->entries[i], NULL, entry)) {
+		[entry release];
+		entry = index->entries[i];
+		OFAcquireMemoryBarrier();
+	}
+#else
+	index->entries[i] = entry;
+#endif
+
+	return entry;
+}
+
+/*
+ * Returns the file name of the entry as UTF-8, which is what is hashed and
+ * compared. Only names in codepage 437 that are not pure ASCII need to be
+ * converted, which requires creating the entry.
+ */
+static const char *
+indexEntryName(struct _OFZIPArchiveIndex *index, size_t i, size_t *length)
+{
+	const unsigned char *record = index->centralDirectory +
+	    index->offsets[i];
+	const unsigned char *name =
+	    record + OFZIPArchiveEntryCentralDirectoryRecordSize;
+	uint16_t nameLength = OFZIPArchiveEntryRead16(record + 28);
+
+	if (!(OFZIPArchiveEntryRead16(record + 8) & (1u << 11))) {
+		for (uint16_t j = 0; j < nameLength; j++) {
+			if (name[j] & 0x80) {
+				OFString *fileName =
+				    indexEntry(index, i).fileName;
+
+				*length = fileName.UTF8StringLength;
+				return fileName.UTF8String;
+			}
+		}
+	}
+
+	*length = nameLength;
+	return (const char *)name;
+}
+
+static unsigned long
+hashName(const char *name, size_t length)
+{
+	unsigned long hash;
+
+	OFHashInit(&hash);
+
+	for (size_t i = 0; i < length; i++)
+		OFHashAdd(&hash, name[i]);
+
+	OFHashFinalize(&hash);
+
+	return hash;
+}
+
+/*
+ * Looks up the entry with the specified name. If insertIndex is not
+ * OFNotFound, the entry with that index is inserted if there is no entry with
+ * the name yet.
+ */
+static size_t
+indexLookup(struct _OFZIPArchiveIndex *index, const char *name, size_t length,
+    size_t insertIndex)
+{
+	size_t mask = index->bucketsCount - 1;
+
+	for (size_t i = hashName(name, length) & mask;; i = (i + 1) & mask) {
+		size_t entryIndex = index->buckets[i], entryNameLength;
+		const char *entryName;
+
+		if (entryIndex == 0) {
+			if (insertIndex != OFNotFound)
+				index->buckets[i] = insertIndex + 1;
+
+			return OFNotFound;
+		}
+
+		entryName = indexEntryName(index, entryIndex - 1,
+		    &entryNameLength);
+
+		if (entryNameLength == length &&
+		    memcmp(entryName, name, length) == 0)
+			return entryIndex - 1;
+	}
+}
+
 static void
 seekOrThrowInvalidFormat(OFSeekableStream *stream,
     OFFileOffset offset, int whence)
@@ -239,6 +406,14 @@ seekOrThrowInvalidFormat(OFSeekableStream *stream,
 		[file release];
 	}
 
+	@try {
+		if (_mode == modeRead)
+			_path = [path copy];
+	} @catch (id e) {
+		[self release];
+		@throw e;
+	}
+
 	return self;
 }
 #endif
@@ -252,7 +427,11 @@ seekOrThrowInvalidFormat(OFSeekableStream *stream,
 	[_archiveComment release];
 	[_entries release];
 	[_pathToEntryMap release];
+	freeIndex(_index);
 	[_lastReturnedStream release];
+#ifdef OF_HAVE_FILES
+	[_path release];
+#endif
 
 	[super dealloc];
 }
@@ -351,31 +530,115 @@ seekOrThrowInvalidFormat(OFSeekableStream *stream,
 - (void)of_readEntries
 {
 	void *pool = objc_autoreleasePoolPush();
+	struct _OFZIPArchiveIndex *index;
+	size_t offset = 0;
 
 	if (_centralDirectoryOffset < 0 ||
 	    (OFFileOffset)_centralDirectoryOffset != _centralDirectoryOffset)
 		@throw [OFOutOfRangeException exception];
 
+	if (_centralDirectorySize > SIZE_MAX ||
+	    _centralDirectoryEntries > SIZE_MAX / 4)
+		@throw [OFOutOfRangeException exception];
+
+	if (_centralDirectoryEntries > _centralDirectorySize /
+	    OFZIPArchiveEntryCentralDirectoryRecordSize)
+		@throw [OFInvalidFormatException exception];
+
 	seekOrThrowInvalidFormat((OFSeekableStream *)_stream,
 	    (OFFileOffset)_centralDirectoryOffset, SEEK_SET);
 
-	for (size_t i = 0; i < _centralDirectoryEntries; i++) {
-		OFZIPArchiveEntry *entry = [[[OFZIPArchiveEntry alloc]
-		    of_initWithStream: _stream] autorelease];
+	_index = index = OFAllocZeroedMemory(1, sizeof(*index));
+	index->centralDirectorySize = (size_t)_centralDirectorySize;
+	index->count = (size_t)_centralDirectoryEntries;
+
+	index->centralDirectory = OFAllocMemory(1, index->centralDirectorySize);
+	[_stream readIntoBuffer: index->centralDirectory
+		    exactLength: index->centralDirectorySize];
+
+	index->offsets = OFAllocMemory(index->count, sizeof(size_t));
+	index->entries = OFAllocZeroedMemory(index->count,
+	    sizeof(OFZIPArchiveEntry *));
+
+	/* Keep the load factor at or below 0.5. */
+	index->bucketsCount = 16;
+	while (index->bucketsCount < index->count * 2)
+		index->bucketsCount <<= 1;
+	index->buckets = OFAllocZeroedMemory(index->bucketsCount,
+	    sizeof(size_t));
+
+	for (size_t i = 0; i < index->count; i++) {
+		const unsigned char *record = index->centralDirectory + offset;
+		size_t recordLength, nameLength;
+		const char *name;
+
+		if (index->centralDirectorySize - offset <
+		    OFZIPArchiveEntryCentralDirectoryRecordSize ||
+		    OFZIPArchiveEntryRead32(record) != 0x02014B50)
+			@throw [OFInvalidFormatException exception];
 
-		if ([_pathToEntryMap objectForKey: entry.fileName] != nil)
+		recordLength = OFZIPArchiveEntryCentralDirectoryRecordSize +
+		    OFZIPArchiveEntryRead16(record + 28) +
+		    OFZIPArchiveEntryRead16(record + 30) +
+		    OFZIPArchiveEntryRead16(record + 32);
+		if (index->centralDirectorySize - offset < recordLength)
 			@throw [OFInvalidFormatException exception];
 
-		[_entries addObject: entry];
-		[_pathToEntryMap setObject: entry forKey: entry.fileName];
+		index->offsets[i] = offset;
+		offset += recordLength;
+
+		name = indexEntryName(index, i, &nameLength);
+		if (indexLookup(index, name, nameLength, i) != OFNotFound)
+			@throw [OFInvalidFormatException exception];
+	}
+
+	/* Appending needs all entries to write the new central directory. */
+	if (_mode == modeAppend) {
+		for (size_t i = 0; i < index->count; i++) {
+			OFZIPArchiveEntry *entry = indexEntry(index, i);
+
+			[_entries addObject: entry];
+			[_pathToEntryMap setObject: entry
+					    forKey: entry.fileName];
+		}
+
+		freeIndex(_index);
+		_index = NULL;
 	}
 
 	objc_autoreleasePoolPop(pool);
 }
 
+- (OFZIPArchiveEntry *)of_entryForPath: (OFString *)path
+{
+	size_t i;
+
+	if (_index == NULL)
+		return [_pathToEntryMap objectForKey: path];
+
+	i = indexLookup(_index, path.UTF8String, path.UTF8StringLength,
+	    OFNotFound);
+	if (i == OFNotFound)
+		return nil;
+
+	return indexEntry(_index, i);
+}
+
 - (OFArray *)entries
 {
-	return [[_entries copy] autorelease];
+	OFMutableArray *entries;
+
+	if (_index == NULL)
+		return [[_entries copy] autorelease];
+
+	entries = [OFMutableArray arrayWithCapacity: _index->count];
+
+	for (size_t i = 0; i < _index->count; i++)
+		[entries addObject: indexEntry(_index, i)];
+
+	[entries makeImmutable];
+
+	return entries;
 }
 
 - (OFString *)archiveComment
@@ -428,34 +691,26 @@ seekOrThrowInvalidFormat(OFSeekableStream *stream,
 	_lastReturnedStream = nil;
 }
 
-- (OFStream *)streamForReadingFile: (OFString *)path
+- (OFStream *)of_streamForReadingFile: (OFString *)path
+			   fromStream: (OFStream *)stream
 {
-	void *pool = objc_autoreleasePoolPush();
 	OFZIPArchiveEntry *entry;
 	OFZIPArchiveLocalFileHeader *localFileHeader;
 	int64_t offset64;
 
-	if (_stream == nil)
-		@throw [OFNotOpenException exceptionWithObject: self];
-
-	if (_mode != modeRead)
-		@throw [OFInvalidArgumentException exception];
-
-	if ((entry = [_pathToEntryMap objectForKey: path]) == nil)
+	if ((entry = [self of_entryForPath: path]) == nil)
 		@throw [OFOpenItemFailedException exceptionWithPath: path
 							       mode: @"r"
 							      errNo: ENOENT];
 
-	[self of_closeLastReturnedStream];
-
 	offset64 = entry.of_localFileHeaderOffset;
 	if (offset64 < 0 || (OFFileOffset)offset64 != offset64)
 		@throw [OFOutOfRangeException exception];
 
-	seekOrThrowInvalidFormat((OFSeekableStream *)_stream,
+	seekOrThrowInvalidFormat((OFSeekableStream *)stream,
 	    (OFFileOffset)offset64, SEEK_SET);
 	localFileHeader = [[[OFZIPArchiveLocalFileHeader alloc]
-	    initWithStream: _stream] autorelease];
+	    initWithStream: stream] autorelease];
 
 	if (![localFileHeader matchesEntry: entry])
 		@throw [OFInvalidFormatException exception];
@@ -469,15 +724,59 @@ seekOrThrowInvalidFormat(OFSeekableStream *stream,
 		    exceptionWithVersion: version];
 	}
 
-	_lastReturnedStream = [[OFZIPArchiveFileReadStream alloc]
-	     of_initWithStream: _stream
-			 entry: entry];
+	return [[[OFZIPArchiveFileReadStream alloc]
+	    of_initWithStream: stream
+			entry: entry] autorelease];
+}
+
+- (OFStream *)streamForReadingFile: (OFString *)path
+{
+	void *pool = objc_autoreleasePoolPush();
+
+	if (_stream == nil)
+		@throw [OFNotOpenException exceptionWithObject: self];
+
+	if (_mode != modeRead)
+		@throw [OFInvalidArgumentException exception];
+
+	if ([self of_entryForPath: path] == nil)
+		@throw [OFOpenItemFailedException exceptionWithPath: path
+							       mode: @"r"
+							      errNo: ENOENT];
+
+	[self of_closeLastReturnedStream];
+
+	_lastReturnedStream = [[self of_streamForReadingFile: path
+						  fromStream: _stream] retain];
 
 	objc_autoreleasePoolPop(pool);
 
 	return [[_lastReturnedStream retain] autorelease];
 }
 
+#ifdef OF_HAVE_FILES
+- (OFStream *)independentStreamForReadingFile: (OFString *)path
+{
+	void *pool = objc_autoreleasePoolPush();
+	OFStream *stream;
+
+	if (_stream == nil)
+		@throw [OFNotOpenException exceptionWithObject: self];
+
+	if (_mode != modeRead || _path == nil)
+		@throw [OFInvalidArgumentException exception];
+
+	stream = [[self of_streamForReadingFile: path
+				     fromStream: [OFFile fileWithPath: _path
+								 mode: @"r"]]
+	    retain];
+
+	objc_autoreleasePoolPop(pool);
+
+	return [stream autorelease];
+}
+#endif
+
 - (OFStream *)streamForWritingEntry: (OFZIPArchiveEntry *)entry_
 {
 	/* TODO: Avoid data descriptor when _stream is an OFSeekableStream */
@@ -503,7 +802,9 @@ seekOrThrowInvalidFormat(OFSeekableStream *stream,
 				 mode: @"w"
 				errNo: EEXIST];
 
-	if (entry.compressionMethod != OFZIPArchiveEntryCompressionMethodNone)
+	if (entry.compressionMethod != OFZIPArchiveEntryCompressionMethodNone &&
+	    entry.compressionMethod !=
+	    OFZIPArchiveEntryCompressionMethodDeflate)
 		@throw [OFNotImplementedException exceptionWithSelector: _cmd
 								 object: self];
 
@@ -858,15 +1159,62 @@ seekOrThrowInvalidFormat(OFSeekableStream *stream,
 }
 @end
 
+@implementation OFZIPArchiveCountingStream
+- (instancetype)initWithStream: (OFStream *)stream
+{
+	self = [super init];
+
+	_stream = [stream retain];
+
+	return self;
+}
+
+- (void)dealloc
+{
+	[_stream release];
+
+	[super dealloc];
+}
+
+- (size_t)lowlevelWriteBuffer: (const void *)buffer length: (size_t)length
+{
+#if SIZE_MAX >= INT64_MAX
+	if (length > INT64_MAX)
+		@throw [OFOutOfRangeException exception];
+#endif
+
+	if (INT64_MAX - _bytesWritten < (int64_t)length)
+		@throw [OFOutOfRangeException exception];
+
+	[_stream writeBuffer: buffer length: length];
+	_bytesWritten += (int64_t)length;
+
+	return length;
+}
+@end
+
 @implementation OFZIPArchiveFileWriteStream
 - (instancetype)initWithStream: (OFStream *)stream
 			 entry: (OFMutableZIPArchiveEntry *)entry
 {
 	self = [super init];
 
-	_stream = [stream retain];
-	_entry = [entry retain];
-	_CRC32 = ~0;
+	@try {
+		_stream = [stream retain];
+		_entry = [entry retain];
+		_CRC32 = ~0;
+
+		if (entry.compressionMethod ==
+		    OFZIPArchiveEntryCompressionMethodDeflate) {
+			_countingStream = [[OFZIPArchiveCountingStream alloc]
+			    initWithStream: stream];
+			_deflateStream = [[OFDeflateStream alloc]
+			    initWithStream: _countingStream];
+		}
+	} @catch (id e) {
+		[self release];
+		@throw e;
+	}
 
 	return self;
 }
@@ -877,6 +1225,8 @@ seekOrThrowInvalidFormat(OFSeekableStream *stream,
 		[self close];
 
 	[_entry release];
+	[_deflateStream release];
+	[_countingStream release];
 
 	[super dealloc];
 }
@@ -888,6 +1238,17 @@ seekOrThrowInvalidFormat(OFSeekableStream *stream,
 		@throw [OFOutOfRangeException exception];
 #endif
 
+	if (_deflateStream != nil) {
+		if (INT64_MAX - _uncompressedSize < (int64_t)length)
+			@throw [OFOutOfRangeException exception];
+
+		[_deflateStream writeBuffer: buffer length: length];
+		_uncompressedSize += (int64_t)length;
+		_CRC32 = OFCRC32(_CRC32, buffer, length);
+
+		return length;
+	}
+
 	if (INT64_MAX - _bytesWritten < (int64_t)length)
 		@throw [OFOutOfRangeException exception];
 
@@ -897,6 +1258,7 @@ seekOrThrowInvalidFormat(OFSeekableStream *stream,
 		OFEnsure(e.bytesWritten <= length);
 
 		_bytesWritten += (int64_t)e.bytesWritten;
+		_uncompressedSize += (int64_t)e.bytesWritten;
 		_CRC32 = OFCRC32(_CRC32, buffer, e.bytesWritten);
 
 		if (e.errNo == EWOULDBLOCK || e.errNo == EAGAIN)
@@ -906,6 +1268,7 @@ seekOrThrowInvalidFormat(OFSeekableStream *stream,
 	}
 
 	_bytesWritten += (int64_t)length;
+	_uncompressedSize += (int64_t)length;
 	_CRC32 = OFCRC32(_CRC32, buffer, length);
 
 	return length;
@@ -916,17 +1279,22 @@ seekOrThrowInvalidFormat(OFSeekableStream *stream,
 	if (_stream == nil)
 		@throw [OFNotOpenException exceptionWithObject: self];
 
+	if (_deflateStream != nil) {
+		[_deflateStream close];
+		_bytesWritten = _countingStream->_bytesWritten;
+	}
+
 	[_stream writeLittleEndianInt32: 0x08074B50];
-	[_stream writeLittleEndianInt32: _CRC32];
-	[_stream writeLittleEndianInt64: _bytesWritten];
+	[_stream writeLittleEndianInt32: ~_CRC32];
 	[_stream writeLittleEndianInt64: _bytesWritten];
+	[_stream writeLittleEndianInt64: _uncompressedSize];
 
 	[_stream release];
 	_stream = nil;
 
 	_entry.CRC32 = ~_CRC32;
 	_entry.compressedSize = _bytesWritten;
-	_entry.uncompressedSize = _bytesWritten;
+	_entry.uncompressedSize = _uncompressedSize;
 	[_entry makeImmutable];
 
 	_bytesWritten += (2 * 4 + 2 * 8);
@@ -17,12 +17,30 @@
 
 OF_ASSUME_NONNULL_BEGIN
 
+/* The size of a central directory record without the variable length fields */
+#define OFZIPArchiveEntryCentralDirectoryRecordSize 46
+
+static OF_INLINE uint16_t
+OFZIPArchiveEntryRead16(const unsigned char *bytes)
+{
+	return bytes[0] | (bytes[1] << 8);
+}
+
+static OF_INLINE uint32_t
+OFZIPArchiveEntryRead32(const unsigned char *bytes)
+{
+	return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) |
+	    ((uint32_t)bytes[3] << 24);
+}
+
 @interface OFZIPArchiveEntry ()
 @property (readonly, nonatomic)
     uint16_t of_lastModifiedFileTime, of_lastModifiedFileDate;
 @property (readonly, nonatomic) int64_t of_localFileHeaderOffset;
 
-- (instancetype)of_initWithStream: (OFStream *)stream
+- (instancetype)
+    of_initWithCentralDirectoryRecord: (const unsigned char *)record
+				length: (size_t)length
     OF_METHOD_FAMILY(init) OF_DIRECT;
 - (uint64_t)of_writeToStream: (OFStream *)stream OF_DIRECT;
 @end
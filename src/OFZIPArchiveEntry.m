@@ -203,7 +203,9 @@ OFZIPArchiveEntryExtraFieldFind(OFData *extraField,
 	return self;
 }
 
-- (instancetype)of_initWithStream: (OFStream *)stream
+- (instancetype)
+    of_initWithCentralDirectoryRecord: (const unsigned char *)record
+				length: (size_t)length
 {
 	self = [super init];
 
@@ -215,38 +217,55 @@ OFZIPArchiveEntryExtraFieldFind(OFData *extraField,
 		size_t ZIP64Index;
 		uint16_t ZIP64Size;
 
-		if ([stream readLittleEndianInt32] != 0x02014B50)
+		if (length < OFZIPArchiveEntryCentralDirectoryRecordSize ||
+		    OFZIPArchiveEntryRead32(record) != 0x02014B50)
 			@throw [OFInvalidFormatException exception];
 
-		_versionMadeBy = [stream readLittleEndianInt16];
-		_minVersionNeeded = [stream readLittleEndianInt16];
-		_generalPurposeBitFlag = [stream readLittleEndianInt16];
-		_compressionMethod = [stream readLittleEndianInt16];
-		_lastModifiedFileTime = [stream readLittleEndianInt16];
-		_lastModifiedFileDate = [stream readLittleEndianInt16];
-		_CRC32 = [stream readLittleEndianInt32];
-		_compressedSize = [stream readLittleEndianInt32];
-		_uncompressedSize = [stream readLittleEndianInt32];
-		fileNameLength = [stream readLittleEndianInt16];
-		extraFieldLength = [stream readLittleEndianInt16];
-		fileCommentLength = [stream readLittleEndianInt16];
-		_startDiskNumber = [stream readLittleEndianInt16];
-		_internalAttributes = [stream readLittleEndianInt16];
-		_versionSpecificAttributes = [stream readLittleEndianInt32];
-		_localFileHeaderOffset = [stream readLittleEndianInt32];
+		_versionMadeBy = OFZIPArchiveEntryRead16(record + 4);
+		_minVersionNeeded = OFZIPArchiveEntryRead16(record + 6);
+		_generalPurposeBitFlag = OFZIPArchiveEntryRead16(record + 8);
+		_compressionMethod = OFZIPArchiveEntryRead16(record + 10);
+		_lastModifiedFileTime = OFZIPArchiveEntryRead16(record + 12);
+		_lastModifiedFileDate = OFZIPArchiveEntryRead16(record + 14);
+		_CRC32 = OFZIPArchiveEntryRead32(record + 16);
+		_compressedSize = OFZIPArchiveEntryRead32(record + 20);
+		_uncompressedSize = OFZIPArchiveEntryRead32(record + 24);
+		fileNameLength = OFZIPArchiveEntryRead16(record + 28);
+		extraFieldLength = OFZIPArchiveEntryRead16(record + 30);
+		fileCommentLength = OFZIPArchiveEntryRead16(record + 32);
+		_startDiskNumber = OFZIPArchiveEntryRead16(record + 34);
+		_internalAttributes = OFZIPArchiveEntryRead16(record + 36);
+		_versionSpecificAttributes =
+		    OFZIPArchiveEntryRead32(record + 38);
+		_localFileHeaderOffset = OFZIPArchiveEntryRead32(record + 42);
+
+		if (length - OFZIPArchiveEntryCentralDirectoryRecordSize <
+		    (size_t)fileNameLength + extraFieldLength +
+		    fileCommentLength)
+			@throw [OFInvalidFormatException exception];
+
+		record += OFZIPArchiveEntryCentralDirectoryRecordSize;
 
 		encoding = (_generalPurposeBitFlag & (1u << 11)
 		    ? OFStringEncodingUTF8 : OFStringEncodingCodepage437);
 
-		_fileName = [[stream readStringWithLength: fileNameLength
-						 encoding: encoding] copy];
+		_fileName = [[OFString alloc]
+		    initWithCString: (const char *)record
+			   encoding: encoding
+			     length: fileNameLength];
+		record += fileNameLength;
+
 		if (extraFieldLength > 0)
-			extraField = [[[stream readDataWithCount:
-			    extraFieldLength] mutableCopy] autorelease];
+			extraField = [OFMutableData
+			    dataWithItems: record
+				    count: extraFieldLength];
+		record += extraFieldLength;
+
 		if (fileCommentLength > 0)
-			_fileComment = [[stream
-			    readStringWithLength: fileCommentLength
-					encoding: encoding] copy];
+			_fileComment = [[OFString alloc]
+			    initWithCString: (const char *)record
+				   encoding: encoding
+				     length: fileCommentLength];
 
 		ZIP64Index = OFZIPArchiveEntryExtraFieldFind(extraField,
 		    OFZIPArchiveEntryExtraFieldTagZIP64, &ZIP64Size);
@@ -17,6 +17,7 @@
 #import "OFBlock.h"
 
 #import "OFString.h"
+#import "OFStringSearch.h"
 #import "OFCharacterSet.h"
 
 #import "OFData.h"
@@ -55,6 +56,7 @@
 
 #import "OFStream.h"
 #import "OFStdIOStream.h"
+#import "OFDeflateStream.h"
 #import "OFInflateStream.h"
 #import "OFInflate64Stream.h"
 #import "OFGZIPStream.h"
@@ -255,11 +257,15 @@
 #import "OFOnce.h"
 #import "OFThread.h"
 #ifdef OF_HAVE_THREADS
+# import "OFChannel.h"
+# import "OFConcurrentDictionary.h"
+# import "OFConcurrentMapTable.h"
 # import "OFCondition.h"
 # import "OFMutex.h"
 # import "OFPlainCondition.h"
 # import "OFPlainMutex.h"
 # import "OFPlainThread.h"
+# import "OFReadWriteLock.h"
 # import "OFRecursiveMutex.h"
 # import "OFTLSKey.h"
 # import "OFThreadPool.h"
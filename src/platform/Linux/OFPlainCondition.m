@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#import "OFPlainCondition.h"
+
+int
+OFPlainConditionNew(OFPlainCondition *condition)
+{
+	condition->sequence = 0;
+	condition->waitersCount = 0;
+
+	return 0;
+}
+
+static int
+wakeUp(OFPlainCondition *condition, int count)
+{
+	OFAtomicIntIncrease(&condition->sequence);
+	/* Pairs with the barrier in waitOnCondition(). */
+	OFMemoryBarrier();
+
+	/* Avoid the system call if nobody is waiting. */
+	if (condition->waitersCount > 0)
+		syscall(SYS_futex, (int *)&condition->sequence,
+		    FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+
+	return 0;
+}
+
+int
+OFPlainConditionSignal(OFPlainCondition *condition)
+{
+	return wakeUp(condition, 1);
+}
+
+int
+OFPlainConditionBroadcast(OFPlainCondition *condition)
+{
+	return wakeUp(condition, INT_MAX);
+}
+
+static int
+waitOnCondition(OFPlainCondition *condition, OFPlainMutex *mutex,
+    const struct timespec *timeout)
+{
+	int sequence, error, lockError;
+
+	OFAtomicIntIncrease(&condition->waitersCount);
+	OFMemoryBarrier();
+
+	/*
+	 * If the condition is signaled after this, the sequence changes and
+	 * the futex does not wait.
+	 */
+	sequence = condition->sequence;
+
+	if ((error = OFPlainMutexUnlock(mutex)) != 0) {
+		OFAtomicIntDecrease(&condition->waitersCount);
+		return error;
+	}
+
+	if (syscall(SYS_futex, (int *)&condition->sequence, FUTEX_WAIT_PRIVATE,
+	    sequence, timeout, NULL, 0) != 0 && errno == ETIMEDOUT)
+		error = ETIMEDOUT;
+
+	OFAtomicIntDecrease(&condition->waitersCount);
+
+	if ((lockError = OFPlainMutexLock(mutex)) != 0)
+		return lockError;
+
+	return error;
+}
+
+int
+OFPlainConditionWait(OFPlainCondition *condition, OFPlainMutex *mutex)
+{
+	return waitOnCondition(condition, mutex, NULL);
+}
+
+int
+OFPlainConditionTimedWait(OFPlainCondition *condition, OFPlainMutex *mutex,
+    OFTimeInterval timeout)
+{
+	struct timespec ts;
+
+	if (timeout < 0)
+		timeout = 0;
+
+	/* FUTEX_WAIT takes a relative timeout. */
+	ts.tv_sec = (time_t)timeout;
+	ts.tv_nsec = (long)((timeout - ts.tv_sec) * 1000000000);
+
+	return waitOnCondition(condition, mutex, &ts);
+}
+
+int
+OFPlainConditionFree(OFPlainCondition *condition)
+{
+	if (condition->waitersCount > 0)
+		return EBUSY;
+
+	return 0;
+}
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#import "OFPlainMutex.h"
+
+/*
+ * The state is stateContended if there might be threads waiting on the futex,
+ * in which case unlocking needs to wake one of them up.
+ */
+enum {
+	stateUnlocked,
+	stateLocked,
+	stateContended
+};
+
+/* The maximum number of times to spin before waiting on the futex. */
+static const int maxSpins = 100;
+
+static OF_INLINE void
+relax(void)
+{
+#if (defined(OF_X86_64) || defined(OF_X86)) && defined(__GNUC__)
+	__asm__ __volatile__ ("pause");
+#elif defined(OF_ARM64) && defined(__GNUC__)
+	__asm__ __volatile__ ("yield");
+#endif
+}
+
+static OF_INLINE void
+futexWait(volatile int *address, int value)
+{
+	syscall(SYS_futex, (int *)address, FUTEX_WAIT_PRIVATE, value, NULL,
+	    NULL, 0);
+}
+
+static OF_INLINE void
+futexWake(volatile int *address, int count)
+{
+	syscall(SYS_futex, (int *)address, FUTEX_WAKE_PRIVATE, count, NULL,
+	    NULL, 0);
+}
+
+int
+OFPlainMutexNew(OFPlainMutex *mutex)
+{
+	mutex->state = stateUnlocked;
+	mutex->spins = 0;
+
+	return 0;
+}
+
+int
+OFPlainMutexLock(OFPlainMutex *mutex)
+{
+	int limit;
+
+	if OF_LIKELY (OFAtomicIntCompareAndSwap(&mutex->state, stateUnlocked,
+	    stateLocked)) {
+		OFAcquireMemoryBarrier();
+		return 0;
+	}
+
+	/*
+	 * The owner is likely to release the mutex soon, so spin for a while
+	 * before sleeping in the kernel. The number of spins adapts to how
+	 * many spins the previous acquisitions needed.
+	 */
+	limit = mutex->spins * 2 + 10;
+	if (limit > maxSpins)
+		limit = maxSpins;
+
+	for (int i = 0; i < limit; i++) {
+		relax();
+
+		if (mutex->state == stateUnlocked &&
+		    OFAtomicIntCompareAndSwap(&mutex->state, stateUnlocked,
+		    stateLocked)) {
+			mutex->spins += (i - mutex->spins) / 8;
+			OFAcquireMemoryBarrier();
+			return 0;
+		}
+	}
+
+	mutex->spins += (limit - mutex->spins) / 8;
+
+	/*
+	 * Mark the mutex as contended before waiting, so that the owner knows
+	 * it needs to wake us up. As we cannot know whether there are other
+	 * waiters, the mutex also stays contended once we acquired it.
+	 */
+	while (!OFAtomicIntCompareAndSwap(&mutex->state, stateUnlocked,
+	    stateContended))
+		if (mutex->state == stateContended ||
+		    OFAtomicIntCompareAndSwap(&mutex->state, stateLocked,
+		    stateContended))
+			futexWait(&mutex->state, stateContended);
+
+	OFAcquireMemoryBarrier();
+
+	return 0;
+}
+
+int
+OFPlainMutexTryLock(OFPlainMutex *mutex)
+{
+	if (!OFAtomicIntCompareAndSwap(&mutex->state, stateUnlocked,
+	    stateLocked))
+		return EBUSY;
+
+	OFAcquireMemoryBarrier();
+
+	return 0;
+}
+
+int
+OFPlainMutexUnlock(OFPlainMutex *mutex)
+{
+	if (mutex->state == stateUnlocked)
+		return EPERM;
+
+	OFReleaseMemoryBarrier();
+
+	if OF_UNLIKELY (OFAtomicIntDecrease(&mutex->state) != stateUnlocked) {
+		mutex->state = stateUnlocked;
+		futexWake(&mutex->state, 1);
+	}
+
+	return 0;
+}
+
+int
+OFPlainMutexFree(OFPlainMutex *mutex)
+{
+	if (mutex->state != stateUnlocked)
+		return EBUSY;
+
+	return 0;
+}
+
+int
+OFPlainRecursiveMutexNew(OFPlainRecursiveMutex *rmutex)
+{
+	rmutex->owner = (pthread_t)0;
+	rmutex->count = 0;
+
+	return OFPlainMutexNew(&rmutex->mutex);
+}
+
+int
+OFPlainRecursiveMutexLock(OFPlainRecursiveMutex *rmutex)
+{
+	pthread_t thread = pthread_self();
+	int error;
+
+	/*
+	 * The owner is reset before unlocking, so this can only be true if we
+	 * are the owner.
+	 */
+	if (pthread_equal(rmutex->owner, thread)) {
+		rmutex->count++;
+		return 0;
+	}
+
+	if ((error = OFPlainMutexLock(&rmutex->mutex)) != 0)
+		return error;
+
+	rmutex->owner = thread;
+	rmutex->count = 1;
+
+	return 0;
+}
+
+int
+OFPlainRecursiveMutexTryLock(OFPlainRecursiveMutex *rmutex)
+{
+	pthread_t thread = pthread_self();
+	int error;
+
+	if (pthread_equal(rmutex->owner, thread)) {
+		rmutex->count++;
+		return 0;
+	}
+
+	if ((error = OFPlainMutexTryLock(&rmutex->mutex)) != 0)
+		return error;
+
+	rmutex->owner = thread;
+	rmutex->count = 1;
+
+	return 0;
+}
+
+int
+OFPlainRecursiveMutexUnlock(OFPlainRecursiveMutex *rmutex)
+{
+	if (!pthread_equal(rmutex->owner, pthread_self()))
+		return EPERM;
+
+	if (--rmutex->count > 0)
+		return 0;
+
+	rmutex->owner = (pthread_t)0;
+
+	return OFPlainMutexUnlock(&rmutex->mutex);
+}
+
+int
+OFPlainRecursiveMutexFree(OFPlainRecursiveMutex *rmutex)
+{
+	return OFPlainMutexFree(&rmutex->mutex);
+}
@@ -47,7 +47,7 @@ static void
 registerCategory(struct objc_category *category)
 {
 	struct objc_category **categories;
-	Class class = objc_classnameToClass(category->className, false);
+	Class class = objc_classnameToClass(category->className);
 
 	if (categoriesMap == NULL)
 		categoriesMap = objc_hashtable_new(
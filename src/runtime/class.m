@@ -32,8 +32,8 @@ static unsigned classesCount = 0;
 static Class *loadQueue = NULL;
 static size_t loadQueueCount = 0;
 static struct objc_dtable *emptyDTable = NULL;
-static unsigned lookupsUntilFastPath = 128;
-static struct objc_sparsearray *fastPath = NULL;
+/* Mirrors classes without the alias tags, for lookups without the lock. */
+static struct objc_concurrent_hashtable *volatile classNames = NULL;
 
 static void
 registerClass(Class class)
@@ -41,8 +41,11 @@ registerClass(Class class)
 	if (classes == NULL)
 		classes = objc_hashtable_new(
 		    objc_string_hash, objc_string_equal, 2);
+	if (classNames == NULL)
+		classNames = objc_concurrent_hashtable_new(2, true);
 
 	objc_hashtable_set(classes, class->name, class);
+	objc_concurrent_hashtable_set(classNames, class->name, class);
 
 	if (emptyDTable == NULL)
 		emptyDTable = objc_dtable_new();
@@ -66,6 +69,7 @@ class_registerAlias_np(Class class, const char *name)
 	}
 
 	objc_hashtable_set(classes, name, (Class)((uintptr_t)class | 1));
+	objc_concurrent_hashtable_set(classNames, name, class);
 
 	objc_globalMutex_unlock();
 
@@ -84,50 +88,34 @@ registerSelectors(Class class)
 }
 
 Class
-objc_classnameToClass(const char *name, bool cache)
+objc_classnameToClass(const char *name)
 {
 	Class class;
-
-	if (classes == NULL)
-		return Nil;
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_ATOMIC_OPS)
+	struct objc_concurrent_hashtable *classNames_ = classNames;
 
 	/*
 	 * Fast path
 	 *
-	 * Instead of looking up the string in a dictionary, which needs
-	 * locking, we use a sparse array to look up the pointer. If
-	 * objc_classname_to_class() gets called a lot, it is most likely that
-	 * the GCC ABI is used, which always calls into objc_lookup_class(), or
-	 * that it is used in a loop by the user. In both cases, it is very
-	 * likely that the same string pointer is passed again and again.
-	 *
-	 * This is not used before objc_classname_to_class() has been called a
-	 * certain amount of times, so that no memory is wasted if it is only
-	 * used rarely, for example if the ObjFW ABI is used and the user does
-	 * not call it in a loop.
-	 *
-	 * Runtime internal usage does not use the fast path and does not count
-	 * as a call into objc_classname_to_class(). The reason for this is
-	 * that if the runtime calls into objc_classname_to_class(), it already
-	 * has the lock and thus the performance gain would be small, but it
-	 * would waste memory.
+	 * Existing classes are looked up without taking the lock, as classes
+	 * are often looked up by name from many threads, for example when the
+	 * GCC ABI is used, which always calls into objc_lookup_class(). If the
+	 * class is not found, it might be in the process of being registered,
+	 * so look again with the lock held.
 	 */
-	if (cache && fastPath != NULL) {
-		class = objc_sparsearray_get(fastPath, (uintptr_t)name);
-
-		if (class != Nil)
-			return class;
-	}
+	if (classNames_ != NULL &&
+	    (class = objc_concurrent_hashtable_get(classNames_, name)) != Nil)
+		return class;
+#endif
 
 	objc_globalMutex_lock();
 
-	class = (Class)((uintptr_t)objc_hashtable_get(classes, name) & ~1);
-
-	if (cache && fastPath == NULL && --lookupsUntilFastPath == 0)
-		fastPath = objc_sparsearray_new(sizeof(uintptr_t));
+	if (classes == NULL) {
+		objc_globalMutex_unlock();
+		return Nil;
+	}
 
-	if (cache && fastPath != NULL)
-		objc_sparsearray_set(fastPath, (uintptr_t)name, class);
+	class = (Class)((uintptr_t)objc_hashtable_get(classes, name) & ~1);
 
 	objc_globalMutex_unlock();
 
@@ -295,7 +283,7 @@ setUpClass(Class class)
 
 	superclassName = (const char *)class->superclass;
 	if (superclassName != NULL) {
-		Class super = objc_classnameToClass(superclassName, false);
+		Class super = objc_classnameToClass(superclassName);
 		Class rootClass;
 
 		if (super == Nil)
@@ -539,7 +527,7 @@ objc_lookUpClass(const char *name)
 {
 	Class class;
 
-	if ((class = objc_classnameToClass(name, true)) == NULL)
+	if ((class = objc_classnameToClass(name)) == NULL)
 		return Nil;
 
 	if (class->info & OBJC_CLASS_INFO_SETUP)
@@ -950,6 +938,7 @@ objc_unregisterClass(Class class)
 		callSelector(class, unloadSel);
 
 	objc_hashtable_delete(classes, class->name);
+	objc_concurrent_hashtable_set(classNames, class->name, NULL);
 
 	if (strcmp(class_getName(class), "Protocol") != 0)
 		classesCount--;
@@ -996,8 +985,8 @@ objc_unregisterAllClasses(void)
 		emptyDTable = NULL;
 	}
 
-	objc_sparsearray_free(fastPath);
-	fastPath = NULL;
+	objc_concurrent_hashtable_free(classNames);
+	classNames = NULL;
 
 	objc_hashtable_free(classes);
 	classes = NULL;
@@ -28,6 +28,10 @@
 #import "ObjFWRT.h"
 #import "private.h"
 
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_ATOMIC_OPS)
+# import "OFAtomic.h"
+#endif
+
 struct objc_hashtable_bucket objc_deletedBucket;
 
 uint32_t
@@ -245,3 +249,207 @@ objc_hashtable_free(struct objc_hashtable *table)
 	free(table->data);
 	free(table);
 }
+
+static struct objc_concurrent_hashtable_data *
+newConcurrentData(uint32_t size)
+{
+	struct objc_concurrent_hashtable_data *data;
+
+	if (size > (SIZE_MAX - sizeof(*data)) / sizeof(*data->buckets))
+		OBJC_ERROR("Integer overflow!");
+
+	if ((data = calloc(1, sizeof(*data) +
+	    size * sizeof(*data->buckets))) == NULL)
+		OBJC_ERROR("Not enough memory to allocate hash table!");
+
+	data->size = size;
+
+	return data;
+}
+
+static void
+insertConcurrentBucket(struct objc_concurrent_hashtable_data *data,
+    struct objc_concurrent_hashtable_bucket *bucket)
+{
+	uint32_t mask = data->size - 1;
+	uint32_t i;
+
+	for (i = bucket->hash & mask; data->buckets[i] != NULL;
+	    i = (i + 1) & mask);
+
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_ATOMIC_OPS)
+	/* Make the bucket visible before publishing it. */
+	OFReleaseMemoryBarrier();
+#endif
+
+	data->buckets[i] = bucket;
+}
+
+struct objc_concurrent_hashtable *
+objc_concurrent_hashtable_new(uint32_t size, bool copiesKeys)
+{
+	struct objc_concurrent_hashtable *table;
+
+	/* The size needs to be a power of 2. */
+	if (size < 2 || (size & (size - 1)) != 0)
+		OBJC_ERROR("Invalid hash table size!");
+
+	if ((table = malloc(sizeof(*table))) == NULL)
+		OBJC_ERROR("Not enough memory to allocate hash table!");
+
+	table->data = newConcurrentData(size);
+	table->count = 0;
+	table->copiesKeys = copiesKeys;
+
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_ATOMIC_OPS)
+	/* Make the table visible before it is published. */
+	OFReleaseMemoryBarrier();
+#endif
+
+	return table;
+}
+
+static struct objc_concurrent_hashtable_bucket *
+concurrentBucketForKey(struct objc_concurrent_hashtable_data *data,
+    const char *key, uint32_t hash)
+{
+	uint32_t mask = data->size - 1;
+
+	/* As the table is never full, there is always an empty bucket. */
+	for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+		struct objc_concurrent_hashtable_bucket *bucket =
+		    data->buckets[i];
+
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_ATOMIC_OPS)
+		OFAcquireMemoryBarrier();
+#endif
+
+		if (bucket == NULL)
+			return NULL;
+
+		if (bucket->hash == hash && strcmp(bucket->key, key) == 0)
+			return bucket;
+	}
+}
+
+/*
+ * Needs to be called with the global mutex held. Setting the object to NULL
+ * removes it, but keeps the bucket for readers that might still use it.
+ */
+void
+objc_concurrent_hashtable_set(struct objc_concurrent_hashtable *table,
+    const char *key, const void *object)
+{
+	struct objc_concurrent_hashtable_data *data = table->data;
+	uint32_t hash = objc_string_hash(key);
+	struct objc_concurrent_hashtable_bucket *bucket;
+
+	if ((bucket = concurrentBucketForKey(data, key, hash)) != NULL) {
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_ATOMIC_OPS)
+		OFReleaseMemoryBarrier();
+#endif
+		bucket->object = object;
+		return;
+	}
+
+	if (object == NULL)
+		return;
+
+	if ((table->count + 1) > data->size / 4 * 3) {
+		struct objc_concurrent_hashtable_data *newData;
+
+		if (data->size > UINT32_MAX / 2)
+			OBJC_ERROR("Integer overflow!");
+
+		newData = newConcurrentData(data->size * 2);
+
+		for (uint32_t i = 0; i < data->size; i++)
+			if (data->buckets[i] != NULL)
+				insertConcurrentBucket(newData,
+				    data->buckets[i]);
+
+		/*
+		 * Readers might still use the old data, so it is only freed
+		 * together with the table.
+		 */
+		newData->previous = data;
+
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_ATOMIC_OPS)
+		OFReleaseMemoryBarrier();
+#endif
+
+		table->data = data = newData;
+	}
+
+	if ((bucket = malloc(sizeof(*bucket))) == NULL)
+		OBJC_ERROR("Not enough memory to allocate hash table bucket!");
+
+	if (table->copiesKeys) {
+		if ((bucket->key = objc_strdup(key)) == NULL)
+			OBJC_ERROR("Not enough memory to allocate hash table "
+			    "bucket!");
+	} else
+		bucket->key = key;
+
+	bucket->hash = hash;
+	bucket->object = object;
+
+	insertConcurrentBucket(data, bucket);
+	table->count++;
+}
+
+/*
+ * Can be called without holding the global mutex if there are atomic
+ * operations. A lookup that runs concurrently with inserting the same key
+ * might not find it.
+ */
+void *
+objc_concurrent_hashtable_get(struct objc_concurrent_hashtable *table,
+    const char *key)
+{
+	struct objc_concurrent_hashtable_data *data = table->data;
+	struct objc_concurrent_hashtable_bucket *bucket;
+	const void *object;
+
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_ATOMIC_OPS)
+	OFAcquireMemoryBarrier();
+#endif
+
+	if ((bucket = concurrentBucketForKey(data, key,
+	    objc_string_hash(key))) == NULL)
+		return NULL;
+
+	object = bucket->object;
+
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_ATOMIC_OPS)
+	OFAcquireMemoryBarrier();
+#endif
+
+	return (void *)object;
+}
+
+void
+objc_concurrent_hashtable_free(struct objc_concurrent_hashtable *table)
+{
+	struct objc_concurrent_hashtable_data *data = table->data;
+
+	for (uint32_t i = 0; i < data->size; i++) {
+		if (data->buckets[i] == NULL)
+			continue;
+
+		if (table->copiesKeys)
+			free((char *)data->buckets[i]->key);
+
+		free(data->buckets[i]);
+	}
+
+	while (data != NULL) {
+		struct objc_concurrent_hashtable_data *previous =
+		    data->previous;
+
+		free(data);
+		data = previous;
+	}
+
+	free(table);
+}
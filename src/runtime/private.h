@@ -197,6 +197,25 @@ struct objc_hashtable {
 	struct objc_hashtable_bucket *_Nonnull *_Nullable data;
 };
 
+/*
+ * A hash table from strings to objects that can be read without holding the
+ * global mutex. Buckets are never removed and replaced data is only freed
+ * together with the table.
+ */
+struct objc_concurrent_hashtable {
+	struct objc_concurrent_hashtable_data {
+		struct objc_concurrent_hashtable_data *_Nullable previous;
+		uint32_t size;
+		struct objc_concurrent_hashtable_bucket {
+			const char *_Nonnull key;
+			const void *_Nullable volatile object;
+			uint32_t hash;
+		} *_Nullable volatile buckets[];
+	} *volatile _Nonnull data;
+	uint32_t count;
+	bool copiesKeys;
+};
+
 struct objc_sparsearray {
 	struct objc_sparsearray_data {
 		void *_Nullable next[256];
@@ -288,7 +307,7 @@ extern void objc_unregisterAllCategories(void);
 extern void objc_initializeClass(Class _Nonnull);
 extern void objc_updateDTable(Class _Nonnull);
 extern void objc_registerAllClasses(struct objc_symtab *_Nonnull);
-extern Class _Nullable objc_classnameToClass(const char *_Nonnull, bool);
+extern Class _Nullable objc_classnameToClass(const char *_Nonnull);
 extern void objc_unregisterClass(Class _Nonnull);
 extern void objc_unregisterAllClasses(void);
 extern uint32_t objc_string_hash(const void *_Nonnull);
@@ -303,6 +322,15 @@ extern void *_Nullable objc_hashtable_get(struct objc_hashtable *_Nonnull,
 extern void objc_hashtable_delete(struct objc_hashtable *_Nonnull,
     const void *_Nonnull);
 extern void objc_hashtable_free(struct objc_hashtable *_Nonnull);
+extern struct objc_concurrent_hashtable *_Nonnull
+    objc_concurrent_hashtable_new(uint32_t, bool);
+extern void objc_concurrent_hashtable_set(
+    struct objc_concurrent_hashtable *_Nonnull, const char *_Nonnull,
+    const void *_Nullable);
+extern void *_Nullable objc_concurrent_hashtable_get(
+    struct objc_concurrent_hashtable *_Nonnull, const char *_Nonnull);
+extern void objc_concurrent_hashtable_free(
+    struct objc_concurrent_hashtable *_Nonnull);
 extern void objc_registerSelector(struct objc_selector *_Nonnull);
 extern void objc_registerAllSelectors(struct objc_symtab *_Nonnull);
 extern void objc_unregisterAllSelectors(void);
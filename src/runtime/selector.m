@@ -36,7 +36,7 @@ static const uint32_t maxSel = 0xFFFF;
 static const uint8_t selLevels = 2;
 #endif
 
-static struct objc_hashtable *selectors = NULL;
+static struct objc_concurrent_hashtable *volatile selectors = NULL;
 static uint32_t selectorsCount = 0;
 static struct objc_sparsearray *selectorNames = NULL;
 static void **freeList = NULL;
@@ -52,9 +52,8 @@ objc_registerSelector(struct objc_selector *selector)
 		OBJC_ERROR("Out of selector slots!");
 
 	if (selectors == NULL)
-		selectors = objc_hashtable_new(
-		    objc_string_hash, objc_string_equal, 2);
-	else if ((existingSelector = objc_hashtable_get(selectors,
+		selectors = objc_concurrent_hashtable_new(2, false);
+	else if ((existingSelector = objc_concurrent_hashtable_get(selectors,
 	    (const char *)selector->UID)) != NULL) {
 		selector->UID = existingSelector->UID;
 		return;
@@ -66,7 +65,7 @@ objc_registerSelector(struct objc_selector *selector)
 	name = (const char *)selector->UID;
 	selector->UID = selectorsCount++;
 
-	objc_hashtable_set(selectors, name, selector);
+	objc_concurrent_hashtable_set(selectors, name, selector);
 	objc_sparsearray_set(selectorNames, (uint32_t)selector->UID,
 	    (void *)name);
 }
@@ -76,10 +75,24 @@ sel_registerName(const char *name)
 {
 	struct objc_selector *selector;
 
+#if defined(OF_HAVE_THREADS) && defined(OF_HAVE_ATOMIC_OPS)
+	struct objc_concurrent_hashtable *selectors_ = selectors;
+
+	/*
+	 * Selectors are never removed while the runtime is in use, so an
+	 * existing selector can be looked up without taking the lock.
+	 */
+	if (selectors_ != NULL &&
+	    (selector = objc_concurrent_hashtable_get(selectors_,
+	    name)) != NULL)
+		return (SEL)selector;
+#endif
+
 	objc_globalMutex_lock();
 
 	if (selectors != NULL &&
-	    (selector = objc_hashtable_get(selectors, name)) != NULL) {
+	    (selector = objc_concurrent_hashtable_get(selectors,
+	    name)) != NULL) {
 		objc_globalMutex_unlock();
 		return (SEL)selector;
 	}
@@ -136,7 +149,7 @@ sel_isEqual(SEL selector1, SEL selector2)
 void
 objc_unregisterAllSelectors(void)
 {
-	objc_hashtable_free(selectors);
+	objc_concurrent_hashtable_free(selectors);
 	objc_sparsearray_free(selectorNames);
 
 	if (freeList != NULL) {
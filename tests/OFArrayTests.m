@@ -255,6 +255,46 @@ static OFString *const cArray[] = {
 	    isEqual: [arrayClass arrayWithObjects:
 	    @"z", @"Foo", @"Baz", @"Bar", @"0", nil]])
 
+	{
+		OFMutableArray *numbers = [mutableArrayClass array];
+		OFMutableArray *ascending = [OFMutableArray array];
+		OFMutableArray *descending = [OFMutableArray array];
+		OFMutableArray *strings = [mutableArrayClass array];
+		OFMutableArray *stable = [OFMutableArray array];
+
+		/* 7919 is prime, so this is a permutation of 0 to 999. */
+		for (int i = 0; i < 1000; i++) {
+			[numbers addObject:
+			    [OFNumber numberWithInt: (i * 7919) % 1000]];
+			[ascending addObject: [OFNumber numberWithInt: i]];
+			[descending addObject:
+			    [OFNumber numberWithInt: 999 - i]];
+		}
+
+		/* Strings that only differ in case compare equal. */
+		for (int i = 0; i < 100; i++)
+			[strings addObject: [OFString stringWithFormat:
+			    @"%c", (i / 5 % 2 ? 'A' : 'a') + i % 5]];
+
+		for (int i = 0; i < 5; i++)
+			for (int j = i; j < 100; j += 5)
+				[stable addObject: [strings objectAtIndex: j]];
+
+		TEST(@"-[sortUsingSelector:options:] with many objects",
+		    R([numbers sort]) && [numbers isEqual: ascending] &&
+		    R([numbers sort]) && [numbers isEqual: ascending] &&
+		    R([numbers sortUsingSelector: @selector(compare:)
+					 options: OFArraySortDescending]) &&
+		    [numbers isEqual: descending] &&
+		    R([numbers sort]) && [numbers isEqual: ascending])
+
+		TEST(@"-[sortUsingSelector:options:] with OFArraySortStable",
+		    R([strings sortUsingSelector:
+		    @selector(caseInsensitiveCompare:)
+					 options: OFArraySortStable]) &&
+		    [strings isEqual: stable])
+	}
+
 	EXPECT_EXCEPTION(@"Detect out of range in -[objectAtIndex:]",
 	    OFOutOfRangeException, [array1 objectAtIndex: array1.count])
 
@@ -418,6 +458,80 @@ static OFString *const cArray[] = {
 		    [left appendString: right];
 		    return left;
 	    }])
+
+# ifdef OF_HAVE_THREADS
+	{
+		OFThreadPool *threadPool = [OFThreadPool threadPoolWithSize: 3];
+		OFMutableArray *numbers = [OFMutableArray array];
+		OFArray *numbersArray;
+		__block bool blockOK = true;
+		bool *seen;
+		OFArrayMapBlock doubleBlock = ^ id (id object_, size_t idx) {
+			return [OFNumber numberWithInt: [object_ intValue] * 2];
+		};
+		OFArrayFilterBlock multipleOf3Block =
+		    ^ bool (id object_, size_t idx) {
+			return ([object_ intValue] % 3 == 0);
+		};
+
+		for (int i = 0; i < 1000; i++)
+			[numbers addObject: [OFNumber numberWithInt: i]];
+
+		numbersArray = [arrayClass arrayWithObjects: numbers.objects
+						      count: numbers.count];
+
+		seen = OFAllocZeroedMemory(1000, sizeof(bool));
+		@try {
+			[numbersArray enumerateObjectsConcurrentlyOnThreadPool:
+			    threadPool usingBlock:
+			    ^ (id object_, size_t idx, bool *stop) {
+				if ([object_ intValue] != (int)idx)
+					blockOK = false;
+
+				seen[idx] = true;
+			}];
+
+			for (size_t i = 0; i < 1000; i++)
+				if (!seen[i])
+					blockOK = false;
+		} @finally {
+			OFFreeMemory(seen);
+		}
+
+		TEST(@"-[enumerateObjectsConcurrentlyOnThreadPool:usingBlock:]",
+		    blockOK)
+
+		TEST(@"-[mappedArrayConcurrentlyOnThreadPool:usingBlock:]",
+		    [[numbersArray mappedArrayConcurrentlyOnThreadPool:
+		    threadPool usingBlock: doubleBlock] isEqual:
+		    [numbersArray mappedArrayUsingBlock: doubleBlock]])
+
+		TEST(@"-[filteredArrayConcurrentlyOnThreadPool:usingBlock:]",
+		    [[numbersArray filteredArrayConcurrentlyOnThreadPool:
+		    threadPool usingBlock: multipleOf3Block] isEqual:
+		    [numbersArray filteredArrayUsingBlock: multipleOf3Block]])
+
+		TEST(@"-[foldConcurrentlyOnThreadPool:usingBlock:]",
+		    [[numbersArray foldConcurrentlyOnThreadPool: threadPool
+						     usingBlock:
+		    ^ id (id left, id right) {
+			    return [OFNumber numberWithInt:
+				[left intValue] + [right intValue]];
+		    }] isEqual: [OFNumber numberWithInt: 499500]])
+
+		numbers = [[numbersArray.reversedArray mutableCopy]
+		    autorelease];
+		for (int i = 0; i < 20000; i++)
+			[numbers addObject: [OFNumber numberWithInt: i % 1000]];
+		numbersArray = [numbers sortedArray];
+
+		TEST(@"-[sortConcurrentlyOnThreadPool:usingSelector:options:]",
+		    R([numbers sortConcurrentlyOnThreadPool: threadPool
+					      usingSelector: @selector(compare:)
+						    options: 0]) &&
+		    [numbers isEqual: numbersArray])
+	}
+# endif
 #endif
 
 	TEST(@"-[valueForKey:]",
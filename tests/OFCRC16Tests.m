@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#include "config.h"
+
+#import "TestsAppDelegate.h"
+
+#import "OFCRC16.h"
+
+static OFString *const module = @"OFCRC16";
+
+static const size_t lengths[] = {
+	0, 1, 7, 8, 9, 15, 16, 17, 100, 1000, 4099
+};
+
+static uint16_t
+bytewiseCRC16(const unsigned char *bytes, size_t length)
+{
+	uint16_t CRC = 0;
+
+	for (size_t i = 0; i < length; i++)
+		CRC = OFCRC16(CRC, bytes + i, 1);
+
+	return CRC;
+}
+
+static bool
+combines(const unsigned char *bytes, size_t length)
+{
+	uint16_t CRC = OFCRC16(0, bytes, length);
+
+	if (CRC != bytewiseCRC16(bytes, length))
+		return false;
+
+	for (size_t split = 0; split <= length; split += length / 7 + 1) {
+		uint16_t CRC1 = OFCRC16(0, bytes, split);
+		uint16_t CRC2 = OFCRC16(0, bytes + split, length - split);
+
+		if (OFCRC16Combine(CRC1, CRC2, length - split) != CRC)
+			return false;
+	}
+
+	return (OFCRC16Combine(CRC, 0, 0) == CRC);
+}
+
+@implementation TestsAppDelegate (OFCRC16Tests)
+- (void)CRC16Tests
+{
+	void *pool = objc_autoreleasePoolPush();
+	unsigned char bytes[4099];
+	uint32_t state = 1;
+	bool ok;
+
+	for (size_t i = 0; i < sizeof(bytes); i++) {
+		state = state * 1103515245 + 12345;
+		bytes[i] = (unsigned char)(state >> 16);
+	}
+
+	TEST(@"OFCRC16()", OFCRC16(0, "123456789", 9) == 0xBB3D &&
+	    OFCRC16(0, "", 0) == 0 &&
+	    OFCRC16(OFCRC16(0, "1234", 4), "56789", 5) == 0xBB3D)
+
+	TEST(@"OFCRC16Combine()", OFCRC16Combine(0x14BA, 0x90E1, 5) == 0xBB3D)
+
+	ok = true;
+	for (size_t i = 0; i < sizeof(lengths) / sizeof(*lengths); i++)
+		if (!combines(bytes, lengths[i]))
+			ok = false;
+
+	TEST(@"OFCRC16Combine() with various lengths", ok)
+
+	objc_autoreleasePoolPop(pool);
+}
+@end
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#include "config.h"
+
+#import "TestsAppDelegate.h"
+
+#import "OFCRC32.h"
+
+static OFString *const module = @"OFCRC32";
+
+static const size_t lengths[] = {
+	0, 1, 15, 16, 17, 63, 64, 65, 100, 1000, 4099
+};
+
+/*
+ * Feeds the data byte by byte, which always uses the table, while larger
+ * buffers use PCLMULQDQ if it is supported.
+ */
+static uint32_t
+bytewiseCRC32(const unsigned char *bytes, size_t length)
+{
+	uint32_t CRC = ~0;
+
+	for (size_t i = 0; i < length; i++)
+		CRC = OFCRC32(CRC, bytes + i, 1);
+
+	return ~CRC;
+}
+
+static bool
+combines(const unsigned char *bytes, size_t length)
+{
+	uint32_t CRC = ~OFCRC32(~0, bytes, length);
+
+	for (size_t split = 0; split <= length; split += length / 7 + 1) {
+		uint32_t CRC1 = ~OFCRC32(~0, bytes, split);
+		uint32_t CRC2 = ~OFCRC32(~0, bytes + split, length - split);
+
+		if (OFCRC32Combine(CRC1, CRC2, length - split) != CRC)
+			return false;
+	}
+
+	return (OFCRC32Combine(CRC, 0, 0) == CRC);
+}
+
+@implementation TestsAppDelegate (OFCRC32Tests)
+- (void)CRC32Tests
+{
+	void *pool = objc_autoreleasePoolPush();
+	unsigned char bytes[4099];
+	uint32_t state = 1;
+	bool ok;
+
+	for (size_t i = 0; i < sizeof(bytes); i++) {
+		state = state * 1103515245 + 12345;
+		bytes[i] = (unsigned char)(state >> 16);
+	}
+
+	TEST(@"OFCRC32()", ~OFCRC32(~0, "123456789", 9) == 0xCBF43926 &&
+	    ~OFCRC32(~0, "", 0) == 0 &&
+	    ~OFCRC32(OFCRC32(~0, "1234", 4), "56789", 5) == 0xCBF43926)
+
+	ok = true;
+	for (size_t i = 0; i < sizeof(lengths) / sizeof(*lengths); i++)
+		if (~OFCRC32(~0, bytes, lengths[i]) !=
+		    bytewiseCRC32(bytes, lengths[i]))
+			ok = false;
+
+	/* Misaligned start and lengths that are no multiple of 16 */
+	for (size_t i = 1; i < 16; i++)
+		if (~OFCRC32(~0, bytes + i, sizeof(bytes) - 2 * i) !=
+		    bytewiseCRC32(bytes + i, sizeof(bytes) - 2 * i))
+			ok = false;
+
+	TEST(@"OFCRC32() with large buffers matches the table", ok)
+
+	TEST(@"OFCRC32Combine()",
+	    OFCRC32Combine(0x9BE3E0A3, 0x131DA070, 5) == 0xCBF43926)
+
+	ok = true;
+	for (size_t i = 0; i < sizeof(lengths) / sizeof(*lengths); i++)
+		if (!combines(bytes, lengths[i]))
+			ok = false;
+
+	TEST(@"OFCRC32Combine() with various lengths", ok)
+
+	objc_autoreleasePoolPop(pool);
+}
+@end
@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#include "config.h"
+
+#import "TestsAppDelegate.h"
+
+static OFString *const module = @"OFChannel";
+
+@interface ChannelProducerThread: OFThread
+{
+@public
+	OFChannel *_channel;
+}
+@end
+
+@interface ChannelClosingProducerThread: OFThread
+{
+@public
+	OFChannel *_channel;
+	unsigned long _sum;
+}
+@end
+
+@interface ChannelConsumerThread: OFThread
+{
+@public
+	OFChannel *_channel;
+	unsigned long _sum;
+}
+@end
+
+#ifdef OF_HAVE_BLOCKS
+@interface ChannelAsyncReceiveThread: OFThread
+{
+@public
+	OFChannel *_channel;
+	OFMutableArray *_numbers;
+}
+@end
+#endif
+
+@implementation ChannelProducerThread
+- (id)main
+{
+	for (int i = 1; i <= 1000; i++) {
+		void *pool = objc_autoreleasePoolPush();
+
+		[_channel sendObject: [OFNumber numberWithInt: i]];
+
+		objc_autoreleasePoolPop(pool);
+	}
+
+	return nil;
+}
+@end
+
+@implementation ChannelClosingProducerThread
+- (id)main
+{
+	for (unsigned long i = 1;; i++) {
+		void *pool = objc_autoreleasePoolPush();
+
+		@try {
+			[_channel sendObject:
+			    [OFNumber numberWithUnsignedLong: i]];
+		} @catch (OFNotOpenException *e) {
+			objc_autoreleasePoolPop(pool);
+			break;
+		}
+
+		_sum += i;
+
+		objc_autoreleasePoolPop(pool);
+	}
+
+	return nil;
+}
+@end
+
+@implementation ChannelConsumerThread
+- (id)main
+{
+	for (;;) {
+		void *pool = objc_autoreleasePoolPush();
+		OFNumber *number = [_channel receiveObject];
+
+		if (number == nil) {
+			objc_autoreleasePoolPop(pool);
+			break;
+		}
+
+		_sum += number.unsignedLongValue;
+
+		objc_autoreleasePoolPop(pool);
+	}
+
+	return nil;
+}
+@end
+
+#ifdef OF_HAVE_BLOCKS
+@implementation ChannelAsyncReceiveThread
+- (id)main
+{
+	[_channel asyncReceiveWithBlock: ^ (id object) {
+		if (object == nil) {
+			[[OFRunLoop currentRunLoop] stop];
+			return false;
+		}
+
+		[_numbers addObject: object];
+		return true;
+	}];
+
+	[[OFRunLoop currentRunLoop] run];
+
+	return nil;
+}
+@end
+#endif
+
+@implementation TestsAppDelegate (OFChannelTests)
+- (void)channelTests
+{
+	void *pool = objc_autoreleasePoolPush();
+	OFChannel *channel;
+	ChannelProducerThread *producers[4];
+	ChannelClosingProducerThread *closingProducers[4];
+	ChannelConsumerThread *consumers[2];
+	unsigned long sum, sentSum;
+#ifdef OF_HAVE_BLOCKS
+	ChannelAsyncReceiveThread *asyncReceiveThread;
+	bool inOrder;
+#endif
+
+	TEST(@"+[channelWithCapacity:]",
+	    (channel = [OFChannel channelWithCapacity: 3]) &&
+	    channel.capacity == 4)
+
+	TEST(@"-[trySendObject:]",
+	    [channel trySendObject: @"a"] && [channel trySendObject: @"b"] &&
+	    [channel trySendObject: @"c"] && [channel trySendObject: @"d"] &&
+	    ![channel trySendObject: @"e"] && channel.count == 4)
+
+	TEST(@"-[sendObject:beforeDate:]",
+	    ![channel sendObject: @"e"
+		      beforeDate: [OFDate dateWithTimeIntervalSinceNow: 0.01]])
+
+	TEST(@"-[tryReceiveObject]",
+	    [[channel tryReceiveObject] isEqual: @"a"] &&
+	    [[channel tryReceiveObject] isEqual: @"b"] &&
+	    [[channel tryReceiveObject] isEqual: @"c"] &&
+	    [[channel tryReceiveObject] isEqual: @"d"] &&
+	    [channel tryReceiveObject] == nil && channel.count == 0)
+
+	TEST(@"-[receiveObjectBeforeDate:]",
+	    [channel receiveObjectBeforeDate:
+	    [OFDate dateWithTimeIntervalSinceNow: 0.01]] == nil)
+
+	TEST(@"-[close]", R([channel trySendObject: @"a"]) &&
+	    R([channel close]) && channel.closed &&
+	    [[channel receiveObject] isEqual: @"a"] &&
+	    [channel receiveObject] == nil)
+
+	EXPECT_EXCEPTION(@"Detection of sending to closed channel",
+	    OFNotOpenException, [channel sendObject: @"a"])
+
+	channel = [OFChannel channelWithCapacity: 16];
+
+	for (size_t i = 0; i < 2; i++) {
+		consumers[i] = [ChannelConsumerThread thread];
+		consumers[i]->_channel = channel;
+		[consumers[i] start];
+	}
+
+	for (size_t i = 0; i < 4; i++) {
+		producers[i] = [ChannelProducerThread thread];
+		producers[i]->_channel = channel;
+		[producers[i] start];
+	}
+
+	for (size_t i = 0; i < 4; i++)
+		[producers[i] join];
+
+	[channel close];
+
+	sum = 0;
+	for (size_t i = 0; i < 2; i++) {
+		[consumers[i] join];
+		sum += consumers[i]->_sum;
+	}
+
+	TEST(@"Multiple senders and receivers", sum == 4 * 500500)
+
+	channel = [OFChannel channelWithCapacity: 16];
+
+	for (size_t i = 0; i < 2; i++) {
+		consumers[i] = [ChannelConsumerThread thread];
+		consumers[i]->_channel = channel;
+		[consumers[i] start];
+	}
+
+	for (size_t i = 0; i < 4; i++) {
+		closingProducers[i] = [ChannelClosingProducerThread thread];
+		closingProducers[i]->_channel = channel;
+		[closingProducers[i] start];
+	}
+
+	[OFThread sleepForTimeInterval: 0.05];
+	[channel close];
+
+	sentSum = 0;
+	for (size_t i = 0; i < 4; i++) {
+		[closingProducers[i] join];
+		sentSum += closingProducers[i]->_sum;
+	}
+
+	sum = 0;
+	for (size_t i = 0; i < 2; i++) {
+		[consumers[i] join];
+		sum += consumers[i]->_sum;
+	}
+
+	TEST(@"-[close] while sending", sum == sentSum)
+
+#ifdef OF_HAVE_BLOCKS
+	channel = [OFChannel channelWithCapacity: 16];
+
+	asyncReceiveThread = [ChannelAsyncReceiveThread thread];
+	asyncReceiveThread->_channel = channel;
+	asyncReceiveThread->_numbers = [OFMutableArray array];
+	[asyncReceiveThread start];
+
+	for (int i = 0; i < 1000; i++)
+		[channel sendObject: [OFNumber numberWithInt: i]];
+
+	[channel close];
+	[asyncReceiveThread join];
+
+	inOrder = (asyncReceiveThread->_numbers.count == 1000);
+	for (size_t i = 0; inOrder && i < 1000; i++)
+		if ([[asyncReceiveThread->_numbers objectAtIndex: i]
+		    unsignedLongValue] != i)
+			inOrder = false;
+
+	TEST(@"-[asyncReceiveWithBlock:]", inOrder)
+#endif
+
+	objc_autoreleasePoolPop(pool);
+}
+@end
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#include "config.h"
+
+#import "TestsAppDelegate.h"
+
+static OFString *const module = @"OFConcurrentDictionary";
+
+@interface ConcurrentDictionaryTestThread: OFThread
+{
+@public
+	OFConcurrentDictionary *_dictionary;
+	int _offset;
+}
+@end
+
+@implementation ConcurrentDictionaryTestThread
+- (id)main
+{
+	for (int i = 0; i < 1000; i++) {
+		void *pool = objc_autoreleasePoolPush();
+		OFNumber *key = [OFNumber numberWithInt: i % 100];
+		OFNumber *object = [OFNumber numberWithInt: _offset + i];
+
+		OFEnsure([_dictionary objectForKey: key
+				       orSetObject: object] != nil);
+		[_dictionary setObject: object
+				forKey: [OFNumber numberWithInt: _offset + i]];
+
+		objc_autoreleasePoolPop(pool);
+	}
+
+	return nil;
+}
+@end
+
+@implementation TestsAppDelegate (OFConcurrentDictionaryTests)
+- (void)concurrentDictionaryTests
+{
+	void *pool = objc_autoreleasePoolPush();
+	OFConcurrentDictionary *dict;
+	ConcurrentDictionaryTestThread *threads[4];
+	OFEnumerator *enumerator;
+	size_t i;
+	bool ok;
+
+	TEST(@"+[dictionary]", (dict = [OFConcurrentDictionary dictionary]))
+
+	TEST(@"-[setObject:forKey:]",
+	    R([dict setObject: @"value1" forKey: @"key1"]) &&
+	    R([dict setObject: @"value2" forKey: @"key2"]))
+
+	TEST(@"-[objectForKey:]",
+	    [[dict objectForKey: @"key1"] isEqual: @"value1"] &&
+	    [[dict objectForKey: @"key2"] isEqual: @"value2"] &&
+	    [dict objectForKey: @"key3"] == nil)
+
+	TEST(@"-[objectForKey:orSetObject:]",
+	    [[dict objectForKey: @"key1" orSetObject: @"other"]
+	    isEqual: @"value1"] &&
+	    [[dict objectForKey: @"key3" orSetObject: @"value3"]
+	    isEqual: @"value3"] &&
+	    [[dict objectForKey: @"key3"] isEqual: @"value3"])
+
+#ifdef OF_HAVE_BLOCKS
+	TEST(@"-[objectForKey:orSetObjectUsingBlock:]",
+	    [[dict objectForKey: @"key2" orSetObjectUsingBlock: ^ (id key) {
+		return @"other";
+	    }] isEqual: @"value2"] &&
+	    [[dict objectForKey: @"key4" orSetObjectUsingBlock: ^ (id key) {
+		return [key stringByAppendingString: @"!"];
+	    }] isEqual: @"key4!"])
+#else
+	[dict setObject: @"key4!" forKey: @"key4"];
+#endif
+
+	TEST(@"-[count]", dict.count == 4)
+
+	TEST(@"-[removeObjectForKey:]",
+	    R([dict removeObjectForKey: @"key4"]) && dict.count == 3 &&
+	    [dict objectForKey: @"key4"] == nil)
+
+	TEST(@"-[allKeys]", [[dict.allKeys sortedArray] isEqual:
+	    [OFArray arrayWithObjects: @"key1", @"key2", @"key3", nil]])
+
+	TEST(@"-[isEqual:]", [dict isEqual: [OFDictionary
+	    dictionaryWithKeysAndObjects: @"key1", @"value1", @"key2",
+	    @"value2", @"key3", @"value3", nil]])
+
+	enumerator = [dict keyEnumerator];
+	ok = true;
+	i = 0;
+	@try {
+		for (OFString *key in enumerator) {
+			[dict setObject: @"value" forKey: [key
+			    stringByAppendingString: @"'"]];
+			i++;
+		}
+	} @catch (OFEnumerationMutationException *e) {
+		ok = false;
+	}
+	TEST(@"Mutation during enumeration", ok && i == 3 && dict.count == 6)
+
+	TEST(@"-[removeAllObjects]",
+	    R([dict removeAllObjects]) && dict.count == 0)
+
+	for (i = 0; i < 4; i++) {
+		threads[i] = [ConcurrentDictionaryTestThread thread];
+		threads[i]->_dictionary = dict;
+		threads[i]->_offset = 1000 * (int)(i + 1);
+		[threads[i] start];
+	}
+	for (i = 0; i < 4; i++)
+		[threads[i] join];
+
+	ok = (dict.count == 4100);
+	for (int j = 0; j < 100; j++) {
+		int value = [[dict objectForKey:
+		    [OFNumber numberWithInt: j]] intValue];
+
+		if (value < 1000 || value % 1000 % 100 != j)
+			ok = false;
+	}
+	TEST(@"Concurrent -[objectForKey:orSetObject:]", ok)
+
+	objc_autoreleasePoolPop(pool);
+}
+@end
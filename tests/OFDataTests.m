@@ -84,6 +84,20 @@ static OFString *const module = @"OFData";
 	    mutableData.count == 5 &&
 	    memcmp(mutableData.items, "abcde", 5) == 0)
 
+	TEST(@"-[reserveCapacity:]",
+	    R([mutableData reserveCapacity: 100]) &&
+	    R([mutableData addItems: "fghij" count: 5]) &&
+	    mutableData.count == 10 &&
+	    memcmp(mutableData.items, "abcdefghij", 10) == 0)
+
+	for (size_t i = 0; i < 1000; i++)
+		[mutableData addItem: "k"];
+	TEST(@"Repeated -[addItem:]", mutableData.count == 1010 &&
+	    *(const char *)[mutableData itemAtIndex: 1009] == 'k' &&
+	    R([mutableData removeItemsInRange: OFRangeMake(5, 1005)]) &&
+	    mutableData.count == 5 &&
+	    memcmp(mutableData.items, "abcde", 5) == 0)
+
 	data = [OFData dataWithItems: "aaabaccdacaabb" count: 7 itemSize: 2];
 
 	range = [data rangeOfData: [OFData dataWithItems: "aa"
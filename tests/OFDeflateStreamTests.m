@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <string.h>
+
+#import "TestsAppDelegate.h"
+
+static OFString *const module = @"OFDeflateStream";
+
+@interface DeflateTestStream: OFSeekableStream
+{
+@public
+	OFMutableData *_data;
+	size_t _position;
+}
+@end
+
+@implementation DeflateTestStream
+- (instancetype)init
+{
+	self = [super init];
+
+	@try {
+		_data = [[OFMutableData alloc] init];
+	} @catch (id e) {
+		[self release];
+		@throw e;
+	}
+
+	return self;
+}
+
+- (void)dealloc
+{
+	[_data release];
+
+	[super dealloc];
+}
+
+- (bool)lowlevelIsAtEndOfStream
+{
+	return (_position >= _data.count);
+}
+
+- (size_t)lowlevelReadIntoBuffer: (void *)buffer length: (size_t)length
+{
+	if (_position >= _data.count)
+		return 0;
+
+	if (length > _data.count - _position)
+		length = _data.count - _position;
+
+	memcpy(buffer, (char *)_data.items + _position, length);
+	_position += length;
+
+	return length;
+}
+
+- (size_t)lowlevelWriteBuffer: (const void *)buffer length: (size_t)length
+{
+	size_t overwritten = 0;
+
+	if (_position < _data.count) {
+		overwritten = _data.count - _position;
+		if (overwritten > length)
+			overwritten = length;
+
+		memcpy((char *)_data.mutableItems + _position, buffer,
+		    overwritten);
+	}
+
+	[_data addItems: (const char *)buffer + overwritten
+		  count: length - overwritten];
+	_position += length;
+
+	return length;
+}
+
+- (OFFileOffset)lowlevelSeekToOffset: (OFFileOffset)offset whence: (int)whence
+{
+	switch (whence) {
+	case SEEK_SET:
+		break;
+	case SEEK_CUR:
+		offset += (OFFileOffset)_position;
+		break;
+	case SEEK_END:
+		offset += (OFFileOffset)_data.count;
+		break;
+	default:
+		offset = -1;
+		break;
+	}
+
+	if (offset < 0 || (unsigned long long)offset > _data.count)
+		@throw [OFSeekFailedException exceptionWithStream: self
+							   offset: offset
+							   whence: whence
+							    errNo: EINVAL];
+
+	_position = (size_t)offset;
+
+	return offset;
+}
+@end
+
+static OFData *
+testData(bool compressible)
+{
+	static const char *words[] = { "ObjFW ", "Deflate ", "stream ", "\n" };
+	OFMutableData *data = [OFMutableData data];
+	uint32_t state = 1;
+
+	while (data.count < 100000) {
+		state = state * 1103515245 + 12345;
+
+		if (compressible) {
+			const char *word = words[(state >> 16) % 4];
+
+			[data addItems: word count: strlen(word)];
+		} else {
+			unsigned char byte = (unsigned char)(state >> 16);
+
+			[data addItem: &byte];
+		}
+	}
+
+	return data;
+}
+
+static OFData *
+deflate(OFData *data, unsigned int compressionLevel)
+{
+	DeflateTestStream *stream = [[[DeflateTestStream alloc] init]
+	    autorelease];
+	OFDeflateStream *deflateStream = [OFDeflateStream
+	    streamWithStream: stream
+	    compressionLevel: compressionLevel];
+
+	/* Write in uneven pieces to cross the internal buffers. */
+	for (size_t i = 0; i < data.count; i += 1000) {
+		size_t length = data.count - i;
+
+		if (length > 1000)
+			length = 1000;
+
+		[deflateStream writeBuffer: (const char *)data.items + i
+				    length: length];
+	}
+
+	[deflateStream close];
+
+	return stream->_data;
+}
+
+static OFData *
+inflate(OFData *data)
+{
+	DeflateTestStream *stream = [[[DeflateTestStream alloc] init]
+	    autorelease];
+
+	[stream->_data addItems: data.items count: data.count];
+
+	return [[OFInflateStream streamWithStream: stream]
+	    readDataUntilEndOfStream];
+}
+
+static bool
+roundTrips(OFData *data, unsigned int compressionLevel)
+{
+	return [inflate(deflate(data, compressionLevel)) isEqual: data];
+}
+
+#ifdef OF_HAVE_THREADS
+static bool
+GZIPRoundTripsOnThreadPool(OFData *data, OFThreadPool *threadPool)
+{
+	DeflateTestStream *stream = [[[DeflateTestStream alloc] init]
+	    autorelease];
+	OFGZIPStream *GZIPStream = [OFGZIPStream streamWithStream: stream
+							     mode: @"w"];
+
+	GZIPStream.threadPool = threadPool;
+
+	/* Write in uneven pieces so that blocks end within a write. */
+	for (size_t i = 0; i < data.count; i += 1000) {
+		size_t length = data.count - i;
+
+		if (length > 1000)
+			length = 1000;
+
+		[GZIPStream writeBuffer: (const char *)data.items + i
+				 length: length];
+	}
+
+	[GZIPStream close];
+
+	[stream seekToOffset: 0 whence: SEEK_SET];
+	GZIPStream = [OFGZIPStream streamWithStream: stream mode: @"r"];
+
+	return [[GZIPStream readDataUntilEndOfStream] isEqual: data];
+}
+#endif
+
+@implementation TestsAppDelegate (OFDeflateStreamTests)
+- (void)deflateStreamTests
+{
+	void *pool = objc_autoreleasePoolPush();
+	OFData *compressibleData = testData(true);
+	OFData *randomData = testData(false);
+	DeflateTestStream *stream;
+	OFGZIPStream *GZIPStream;
+	OFZIPArchive *archive;
+	OFMutableZIPArchiveEntry *entry;
+	OFStream *entryStream;
+#ifdef OF_HAVE_THREADS
+	OFThreadPool *threadPool;
+	OFMutableData *largeData;
+#endif
+
+	TEST(@"Compressible data with level 0", roundTrips(compressibleData, 0))
+	TEST(@"Compressible data with level 1", roundTrips(compressibleData, 1))
+	TEST(@"Compressible data with level 6", roundTrips(compressibleData, 6))
+	TEST(@"Compressible data with level 9", roundTrips(compressibleData, 9))
+
+	TEST(@"Random data with level 0", roundTrips(randomData, 0))
+	TEST(@"Random data with level 1", roundTrips(randomData, 1))
+	TEST(@"Random data with level 6", roundTrips(randomData, 6))
+	TEST(@"Random data with level 9", roundTrips(randomData, 9))
+
+	TEST(@"Compression of compressible data",
+	    deflate(compressibleData, 6).count < compressibleData.count / 4)
+
+	TEST(@"Empty data", roundTrips([OFData data], 6))
+
+	stream = [[[DeflateTestStream alloc] init] autorelease];
+	GZIPStream = [OFGZIPStream streamWithStream: stream mode: @"w9"];
+	[GZIPStream writeData: compressibleData];
+	[GZIPStream close];
+
+	[stream seekToOffset: 0 whence: SEEK_SET];
+	GZIPStream = [OFGZIPStream streamWithStream: stream mode: @"r"];
+
+	TEST(@"-[OFGZIPStream writeData:]",
+	    [[GZIPStream readDataUntilEndOfStream] isEqual: compressibleData])
+
+#ifdef OF_HAVE_THREADS
+	threadPool = [OFThreadPool threadPoolWithSize: 4];
+
+	/* More than 128 KiB, ending with a partial block */
+	largeData = [OFMutableData data];
+	for (int i = 0; i < 3; i++) {
+		[largeData addItems: compressibleData.items
+			      count: compressibleData.count];
+		[largeData addItems: randomData.items count: randomData.count];
+	}
+
+	TEST(@"-[OFGZIPStream setThreadPool:]",
+	    GZIPRoundTripsOnThreadPool(largeData, threadPool))
+
+	/* Exactly two blocks of 128 KiB, so that the final block is empty */
+	[largeData removeItemsInRange: OFMakeRange(2 * 128 * 1024,
+	    largeData.count - 2 * 128 * 1024)];
+
+	TEST(@"-[OFGZIPStream setThreadPool:] with whole blocks",
+	    GZIPRoundTripsOnThreadPool(largeData, threadPool))
+#endif
+
+	stream = [[[DeflateTestStream alloc] init] autorelease];
+	archive = [OFZIPArchive archiveWithStream: stream mode: @"w"];
+	entry = [OFMutableZIPArchiveEntry entryWithFileName: @"test.txt"];
+	entry.compressionMethod = OFZIPArchiveEntryCompressionMethodDeflate;
+	entryStream = [archive streamForWritingEntry: entry];
+	[entryStream writeData: compressibleData];
+	[entryStream close];
+	[archive close];
+
+	[stream seekToOffset: 0 whence: SEEK_SET];
+	archive = [OFZIPArchive archiveWithStream: stream mode: @"r"];
+
+	TEST(@"Writing a Deflate ZIP entry",
+	    archive.entries.count == 1 &&
+	    [[archive.entries.firstObject fileName] isEqual: @"test.txt"] &&
+	    [archive.entries.firstObject compressionMethod] ==
+	    OFZIPArchiveEntryCompressionMethodDeflate &&
+	    [archive.entries.firstObject compressedSize] <
+	    compressibleData.count / 4 &&
+	    [[[archive streamForReadingFile: @"test.txt"]
+	    readDataUntilEndOfStream] isEqual: compressibleData])
+
+	objc_autoreleasePoolPop(pool);
+}
+@end
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#include "config.h"
+
+#include <inttypes.h>
+
+#import "TestsAppDelegate.h"
+
+static OFString *const module = @"OFHTTPServer";
+
+@interface TestsAppDelegate (HTTPServerTests) <OFHTTPServerDelegate>
+@end
+
+@interface HTTPServerTestsClient: OFThread
+{
+@public
+	uint16_t _port;
+	OFDictionary *_GZIPHeaders, *_identityHeaders;
+	OFString *_GZIPBody, *_identityBody;
+}
+@end
+
+static OFString *
+responseText(void)
+{
+	OFMutableString *text = [OFMutableString string];
+
+	for (int i = 0; i < 1000; i++)
+		[text appendFormat: @"Line %d of a compressible response\n",
+				    i % 10];
+
+	return text;
+}
+
+@implementation HTTPServerTestsClient
+- (void)dealloc
+{
+	[_GZIPHeaders release];
+	[_identityHeaders release];
+	[_GZIPBody release];
+	[_identityBody release];
+
+	[super dealloc];
+}
+
+- (id)main
+{
+	OFURL *URL = [OFURL URLWithString:
+	    [OFString stringWithFormat: @"http://127.0.0.1:%" @PRIu16 "/",
+					_port]];
+	OFHTTPClient *client = [OFHTTPClient client];
+	OFHTTPRequest *request;
+	OFHTTPResponse *response;
+	OFGZIPStream *GZIPStream;
+
+	request = [OFHTTPRequest requestWithURL: URL];
+	request.headers = [OFDictionary
+	    dictionaryWithObject: @"deflate, gzip;q=0.5"
+			  forKey: @"Accept-Encoding"];
+	response = [client performRequest: request];
+	_GZIPHeaders = [response.headers copy];
+	GZIPStream = [OFGZIPStream streamWithStream: response mode: @"r"];
+	_GZIPBody = [[OFString alloc]
+	    initWithData: [GZIPStream readDataUntilEndOfStream]
+		encoding: OFStringEncodingUTF8];
+
+	request = [OFHTTPRequest requestWithURL: URL];
+	request.headers = [OFDictionary
+	    dictionaryWithObject: @"gzip; q=0.000"
+			  forKey: @"Accept-Encoding"];
+	response = [client performRequest: request];
+	_identityHeaders = [response.headers copy];
+	_identityBody = [[OFString alloc]
+	    initWithData: [response readDataUntilEndOfStream]
+		encoding: OFStringEncodingUTF8];
+
+	[[OFRunLoop mainRunLoop] performSelector: @selector(stop)
+					onThread: [OFThread mainThread]
+				   waitUntilDone: false];
+
+	return nil;
+}
+@end
+
+@implementation TestsAppDelegate (OFHTTPServerTests)
+-      (void)server: (OFHTTPServer *)server
+  didReceiveRequest: (OFHTTPRequest *)request
+	requestBody: (OFStream *)requestBody
+	   response: (OFHTTPResponse *)response
+{
+	OFString *text = responseText();
+
+	response.statusCode = 200;
+	response.headers = [OFDictionary dictionaryWithKeysAndObjects:
+	    @"Content-Length",
+	    [OFString stringWithFormat: @"%zu", text.UTF8StringLength],
+	    @"Vary", @"Cookie", nil];
+	[response writeString: text];
+	[response close];
+}
+
+- (void)HTTPServerTests
+{
+	void *pool = objc_autoreleasePoolPush();
+	OFString *text = responseText();
+	OFHTTPServer *server;
+	HTTPServerTestsClient *client;
+
+	server = [OFHTTPServer server];
+	server.host = @"127.0.0.1";
+	server.port = 0;
+	server.delegate = self;
+	server.compressesResponses = true;
+	[server start];
+
+	client = [[[HTTPServerTestsClient alloc] init] autorelease];
+	client->_port = server.port;
+	client.supportsSockets = true;
+	[client start];
+
+	[[OFRunLoop mainRunLoop] runUntilDate:
+	    [OFDate dateWithTimeIntervalSinceNow: 10]];
+	[client join];
+	[server stop];
+
+	TEST(@"-[compressesResponses] with gzip accepted",
+	    [[client->_GZIPHeaders objectForKey: @"Content-Encoding"]
+	    isEqual: @"gzip"] &&
+	    [[client->_GZIPHeaders objectForKey: @"Vary"]
+	    isEqual: @"Cookie, Accept-Encoding"] &&
+	    [client->_GZIPHeaders objectForKey: @"Content-Length"] == nil &&
+	    [client->_GZIPBody isEqual: text])
+
+	TEST(@"-[compressesResponses] with gzip refused by q=0",
+	    [client->_identityHeaders objectForKey: @"Content-Encoding"] ==
+	    nil &&
+	    [[client->_identityHeaders objectForKey: @"Vary"]
+	    isEqual: @"Cookie"] &&
+	    [client->_identityBody isEqual: text])
+
+	objc_autoreleasePoolPop(pool);
+}
+@end
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#import "TestsAppDelegate.h"
+
+static OFString *const module = @"OFInflateStream";
+
+/* A single final stored block */
+static const unsigned char storedBlock[] = {
+	0x01, 0x22, 0x00, 0xDD, 0xFF, 0x53, 0x74, 0x6F, 0x72, 0x65, 0x64, 0x20,
+	0x62, 0x6C, 0x6F, 0x63, 0x6B, 0x73, 0x20, 0x61, 0x72, 0x65, 0x20, 0x63,
+	0x6F, 0x70, 0x69, 0x65, 0x64, 0x20, 0x76, 0x65, 0x72, 0x62, 0x61, 0x74,
+	0x69, 0x6D, 0x2E
+};
+static const char *storedBlockText = "Stored blocks are copied verbatim.";
+
+/* A single final block using the fixed Huffman codes, followed by "XYZ" */
+static const unsigned char fixedBlock[] = {
+	0x73, 0xCB, 0xAC, 0x48, 0x4D, 0x51, 0xF0, 0x28, 0x4D, 0x4B, 0xCB, 0x4D,
+	0xCC, 0x53, 0x48, 0xCE, 0x4F, 0x49, 0x2D, 0xD6, 0x51, 0x48, 0xC3, 0x14,
+	0x54, 0x04, 0x00, 'X', 'Y', 'Z'
+};
+static const char *fixedBlockText = "Fixed Huffman codes, fixed Huffman codes!";
+
+/* A single final block using dynamic Huffman codes */
+static const unsigned char dynamicBlock[] = {
+	0xD5, 0x8F, 0xCB, 0x11, 0x02, 0x21, 0x10, 0x05, 0x53, 0x79, 0x26, 0x60,
+	0x1C, 0x1E, 0x3D, 0x6C, 0x02, 0xE0, 0x0E, 0x2C, 0xCA, 0x32, 0x2E, 0xDF,
+	0x85, 0xE8, 0x9D, 0xB2, 0x4C, 0x80, 0xA3, 0xE7, 0xEE, 0x57, 0xD5, 0x6F,
+	0xD9, 0x08, 0x47, 0x71, 0x8F, 0x17, 0x74, 0xE4, 0x16, 0x60, 0xF8, 0xC4,
+	0xB3, 0xEC, 0xEF, 0x04, 0xAE, 0x14, 0x91, 0x05, 0x7B, 0x35, 0x3A, 0x56,
+	0xB6, 0x57, 0x2C, 0x33, 0xF2, 0x5D, 0x89, 0xB7, 0x77, 0x68, 0x91, 0x9A,
+	0xCB, 0x1B, 0x8C, 0xAB, 0x24, 0x68, 0x50, 0x80, 0x77, 0x47, 0xE1, 0x28,
+	0x5B, 0x9B, 0x26, 0xC4, 0x1B, 0x37, 0x54, 0x3A, 0x5D, 0xB0, 0xBE, 0xFF,
+	0x3A, 0x56, 0x65, 0x32, 0x06, 0xE9, 0xA8, 0xD2, 0xB7, 0xE4, 0x32, 0xD7,
+	0xF8, 0x0F, 0x87, 0x3E
+};
+static const char *dynamicBlockText =
+    "The quick brown fox jumps over the lazy dog. "
+    "The quick brown fox jumps over the lazy dog. "
+    "Pack my box with five dozen liquor jugs. "
+    "Pack my box with five dozen liquor jugs. "
+    "How vexingly quick daft zebras jump! "
+    "The quick brown fox jumps over the lazy dog. "
+    "The quick brown fox jumps over the lazy dog. "
+    "Pack my box with five dozen liquor jugs. "
+    "Pack my box with five dozen liquor jugs. "
+    "How vexingly quick daft zebras jump! ";
+
+@interface InflateTestStream: OFStream
+{
+	const unsigned char *_bytes;
+	size_t _length, _position, _chunkSize;
+}
+
+- (instancetype)initWithBytes: (const unsigned char *)bytes
+		       length: (size_t)length
+		    chunkSize: (size_t)chunkSize;
+@end
+
+@implementation InflateTestStream
+- (instancetype)initWithBytes: (const unsigned char *)bytes
+		       length: (size_t)length
+		    chunkSize: (size_t)chunkSize
+{
+	self = [super init];
+
+	_bytes = bytes;
+	_length = length;
+	_chunkSize = chunkSize;
+
+	return self;
+}
+
+- (bool)lowlevelIsAtEndOfStream
+{
+	return (_position == _length);
+}
+
+- (size_t)lowlevelReadIntoBuffer: (void *)buffer length: (size_t)length
+{
+	if (length > _chunkSize)
+		length = _chunkSize;
+	if (length > _length - _position)
+		length = _length - _position;
+
+	memcpy(buffer, _bytes + _position, length);
+	_position += length;
+
+	return length;
+}
+@end
+
+static OFData *
+inflate(const unsigned char *bytes, size_t length, size_t chunkSize)
+{
+	InflateTestStream *stream = [[[InflateTestStream alloc]
+	    initWithBytes: bytes
+		   length: length
+		chunkSize: chunkSize] autorelease];
+
+	return [[OFInflateStream streamWithStream: stream]
+	    readDataUntilEndOfStream];
+}
+
+static bool
+dataEqualsString(OFData *data, const char *string)
+{
+	return (data.count == strlen(string) &&
+	    memcmp(data.items, string, data.count) == 0);
+}
+
+@implementation TestsAppDelegate (OFInflateStreamTests)
+- (void)inflateStreamTests
+{
+	void *pool = objc_autoreleasePoolPush();
+	InflateTestStream *stream;
+	OFInflateStream *inflateStream;
+	char trailer[4];
+
+	TEST(@"Stored block", dataEqualsString(
+	    inflate(storedBlock, sizeof(storedBlock), SIZE_MAX),
+	    storedBlockText) && dataEqualsString(
+	    inflate(storedBlock, sizeof(storedBlock), 1), storedBlockText))
+
+	TEST(@"Fixed Huffman block", dataEqualsString(
+	    inflate(fixedBlock, sizeof(fixedBlock) - 3, SIZE_MAX),
+	    fixedBlockText) && dataEqualsString(
+	    inflate(fixedBlock, sizeof(fixedBlock) - 3, 1), fixedBlockText))
+
+	TEST(@"Dynamic Huffman block", dataEqualsString(
+	    inflate(dynamicBlock, sizeof(dynamicBlock), SIZE_MAX),
+	    dynamicBlockText) && dataEqualsString(
+	    inflate(dynamicBlock, sizeof(dynamicBlock), 1), dynamicBlockText))
+
+	stream = [[[InflateTestStream alloc]
+	    initWithBytes: fixedBlock
+		   length: sizeof(fixedBlock)
+		chunkSize: SIZE_MAX] autorelease];
+	inflateStream = [OFInflateStream streamWithStream: stream];
+	memset(trailer, 0, sizeof(trailer));
+
+	TEST(@"Giving back data after the last block",
+	    dataEqualsString([inflateStream readDataUntilEndOfStream],
+	    fixedBlockText) &&
+	    [stream readIntoBuffer: trailer length: 4] == 3 &&
+	    memcmp(trailer, "XYZ", 3) == 0)
+
+	EXPECT_EXCEPTION(@"Detection of truncated stored block",
+	    OFTruncatedDataException,
+	    inflate(storedBlock, sizeof(storedBlock) - 5, SIZE_MAX))
+
+	EXPECT_EXCEPTION(@"Detection of truncated Huffman block",
+	    OFTruncatedDataException,
+	    inflate(dynamicBlock, sizeof(dynamicBlock) / 2, 1))
+
+	objc_autoreleasePoolPop(pool);
+}
+@end
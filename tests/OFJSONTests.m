@@ -19,6 +19,52 @@
 
 static OFString *const module = @"OFJSON";
 
+@interface JSONTestsStream: OFStream
+{
+@public
+	OFMutableData *_data;
+}
+@end
+
+@implementation JSONTestsStream
+- (instancetype)init
+{
+	self = [super init];
+
+	@try {
+		_data = [[OFMutableData alloc] init];
+	} @catch (id e) {
+		[self release];
+		@throw e;
+	}
+
+	return self;
+}
+
+- (void)dealloc
+{
+	[_data release];
+
+	[super dealloc];
+}
+
+- (bool)lowlevelIsAtEndOfStream
+{
+	return true;
+}
+
+- (size_t)lowlevelReadIntoBuffer: (void *)buffer length: (size_t)length
+{
+	return 0;
+}
+
+- (size_t)lowlevelWriteBuffer: (const void *)buffer length: (size_t)length
+{
+	[_data addItems: buffer count: length];
+	return length;
+}
+@end
+
 @implementation TestsAppDelegate (JSONTests)
 - (void)JSONTests
 {
@@ -35,6 +81,7 @@ static OFString *const module = @"OFJSON";
 		[OFNumber numberWithBool: false],
 		nil],
 	    nil];
+	JSONTestsStream *stream;
 
 	TEST(@"-[objectByParsingJSON] #1",
 	    [string.objectByParsingJSON isEqual: dict])
@@ -54,6 +101,37 @@ static OFString *const module = @"OFJSON";
 	    OFJSONRepresentationOptionJSON5] isEqual:
 	    @"{x:[0.5,15,null,\"foo\",false],foo:\"b\\\na\\r\"}"])
 
+	stream = [[[JSONTestsStream alloc] init] autorelease];
+	TEST(@"-[writeJSONToStream:options:]",
+	    R([dict writeJSONToStream: stream options: 0]) &&
+	    [[OFString stringWithUTF8String: stream->_data.items
+				     length: stream->_data.count] isEqual:
+	    @"{\"x\":[0.5,15,null,\"foo\",false],\"foo\":\"b\\na\\r\"}"])
+
+	stream = [[[JSONTestsStream alloc] init] autorelease];
+	TEST(@"-[writeJSONToStream:options:] with "
+	    @"OFJSONRepresentationOptionPretty",
+	    R([dict writeJSONToStream: stream
+			      options: OFJSONRepresentationOptionPretty]) &&
+	    [[OFString stringWithUTF8String: stream->_data.items
+				     length: stream->_data.count] isEqual:
+	    [dict JSONRepresentationWithOptions:
+	    OFJSONRepresentationOptionPretty]])
+
+	stream = [[[JSONTestsStream alloc] init] autorelease];
+	TEST(@"-[writeJSONToStream:options:] with "
+	    @"OFJSONRepresentationOptionJSON5",
+	    R([dict writeJSONToStream: stream
+			      options: OFJSONRepresentationOptionJSON5]) &&
+	    [[OFString stringWithUTF8String: stream->_data.items
+				     length: stream->_data.count] isEqual:
+	    @"{x:[0.5,15,null,\"foo\",false],foo:\"b\\\na\\r\"}"])
+
+	stream = [[[JSONTestsStream alloc] init] autorelease];
+	TEST(@"-[writeMessagePackToStream:]",
+	    R([dict writeMessagePackToStream: stream]) &&
+	    [stream->_data isEqual: dict.messagePackRepresentation])
+
 	EXPECT_EXCEPTION(@"-[objectByParsingJSON] #2", OFInvalidJSONException,
 	    [@"{" objectByParsingJSON])
 	EXPECT_EXCEPTION(@"-[objectByParsingJSON] #3", OFInvalidJSONException,
@@ -53,6 +53,62 @@ const uint8_t testFileMD5[16] =
 	    @"-[updateWithBuffer:length]", OFHashAlreadyCalculatedException,
 	    [MD5 updateWithBuffer: "" length: 1])
 
+	{
+		const void *buffers[20];
+		size_t lengths[20];
+		unsigned char data[300], expected[20 * 16], digests[20 * 16];
+		static const char *const messages[] = {
+			"", "abc",
+			"abcdbcdecdefdefgefghfghighijhijkijkljklmklmn"
+			    "lmnomnopnopq"
+		};
+		static const uint8_t knownDigests[3 * 16] =
+		    "\xD4\x1D\x8C\xD9\x8F\x00\xB2\x04\xE9\x80\x09\x98"
+		    "\xEC\xF8\x42\x7E"
+		    "\x90\x01\x50\x98\x3C\xD2\x4F\xB0\xD6\x96\x3F\x7D"
+		    "\x28\xE1\x7F\x72"
+		    "\x82\x15\xEF\x07\x96\xA2\x0B\xCA\xAA\xE1\x16\xD3"
+		    "\x87\x6C\x66\x4A";
+
+		for (size_t i = 0; i < 3; i++) {
+			buffers[i] = messages[i];
+			lengths[i] = strlen(messages[i]);
+		}
+
+		TEST(@"+[hashBuffers:lengths:count:digests:] known answers",
+		    R([OFMD5Hash hashBuffers: buffers
+				     lengths: lengths
+				       count: 3
+				     digests: digests]) &&
+		    memcmp(digests, knownDigests, sizeof(knownDigests)) == 0)
+
+		for (size_t i = 0; i < 300; i++)
+			data[i] = (unsigned char)i;
+
+		/*
+		 * Messages of 1 to 5 blocks, so that lanes finish at different
+		 * times and are refilled.
+		 */
+		for (size_t i = 0; i < 20; i++) {
+			OFMD5Hash *hash =
+			    [OFMD5Hash hashWithAllowsSwappableMemory: true];
+
+			buffers[i] = data + i;
+			lengths[i] = i * 13;
+
+			[hash updateWithBuffer: buffers[i] length: lengths[i]];
+			[hash calculate];
+			memcpy(expected + i * 16, hash.digest, 16);
+		}
+
+		TEST(@"+[hashBuffers:lengths:count:digests:]",
+		    R([OFMD5Hash hashBuffers: buffers
+				     lengths: lengths
+				       count: 20
+				     digests: digests]) &&
+		    memcmp(digests, expected, sizeof(expected)) == 0)
+	}
+
 	objc_autoreleasePoolPop(pool);
 }
 @end
@@ -49,7 +49,7 @@ static const OFNotificationName otherNotificationName =
 {
 	void *pool = objc_autoreleasePoolPush();
 	OFNotificationCenter *center = [OFNotificationCenter defaultCenter];
-	OFNotificationCenterTest *test1, *test2, *test3, *test4;
+	OFNotificationCenterTest *test1, *test2, *test3, *test4, *test5;
 	OFNotification *notification;
 
 	test1 =
@@ -154,6 +154,29 @@ static const OFNotificationName otherNotificationName =
 	    test1->_received == 1 && test2->_received == 3 &&
 	    test3->_received == 0 && test4->_received == 0)
 
+	TEST(@"-[postNotificationName:object:] with no observers",
+	    R([center postNotificationName: notificationName object: self]) &&
+	    test1->_received == 1 && test2->_received == 3)
+
+	test5 = [[[OFNotificationCenterTest alloc] init] autorelease];
+	test5->_expectedObject = self;
+	[center addObserver: test5
+		   selector: @selector(handleNotification:)
+		       name: notificationName
+		     object: self];
+
+	TEST(@"-[postNotificationName:object:]",
+	    R([center postNotificationName: notificationName object: self]) &&
+	    R([center postNotificationName: notificationName
+				     object: @"foo"]) &&
+	    test5->_received == 1 && test1->_received == 1 &&
+	    test2->_received == 3)
+
+	[center removeObserver: test5
+		      selector: @selector(handleNotification:)
+			  name: notificationName
+			object: self];
+
 	objc_autoreleasePoolPop(pool);
 }
 @end
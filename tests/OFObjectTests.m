@@ -81,12 +81,25 @@ static OFString *const module = @"OFObject";
 }
 @end
 
+@interface MyObjectSubclass: MyObject
+@end
+
+@implementation MyObjectSubclass
+@end
+
+static id
+replacedObjectValue(id self, SEL _cmd)
+{
+	return @"Replaced";
+}
+
 @implementation TestsAppDelegate (OFObjectTests)
 - (void)objectTests
 {
 	void *pool = objc_autoreleasePoolPush();
 	OFObject *object;
 	MyObject *myObject;
+	MyObjectSubclass *subclassObject;
 
 	TEST(@"+[description]",
 	    [[OFObject description] isEqual: @"OFObject"] &&
@@ -106,6 +119,15 @@ static OFString *const module = @"OFObject";
 	    [[myObject valueForKey: @"classValue"] isEqual: myObject.class] &&
 	    [[myObject valueForKey: @"class"] isEqual: myObject.class])
 
+	subclassObject = [[[MyObjectSubclass alloc] init] autorelease];
+	subclassObject.objectValue = @"Hello";
+	TEST(@"-[valueForKey:] after adding a method",
+	    [[subclassObject valueForKey: @"objectValue"] isEqual: @"Hello"] &&
+	    class_addMethod([MyObjectSubclass class],
+	    @selector(objectValue), (IMP)replacedObjectValue, "@@:") &&
+	    [[subclassObject valueForKey: @"objectValue"]
+	    isEqual: @"Replaced"])
+
 	EXPECT_EXCEPTION(@"-[valueForKey:] with undefined key",
 	    OFUndefinedKeyException, [myObject valueForKey: @"undefined"])
 
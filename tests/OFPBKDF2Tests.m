@@ -27,7 +27,7 @@ static OFString *const module = @"OFPBKDF2";
 	void *pool = objc_autoreleasePoolPush();
 	OFHMAC *HMAC = [OFHMAC HMACWithHashClass: [OFSHA1Hash class]
 			   allowsSwappableMemory: true];
-	unsigned char key[25];
+	unsigned char key[64];
 
 	/* Test vectors from RFC 6070 */
 
@@ -120,6 +120,96 @@ static OFString *const module = @"OFPBKDF2";
 	    })) && memcmp(key, "\x56\xFA\x6A\xA7\x55\x48\x09\x9D\xCC\x37\xD7"
 	        "\xF0\x34\x25\xE0\xC3", 16) == 0)
 
+	/* Test vectors from RFC 7914 and the RFC 6070 inputs with SHA-256 */
+
+	HMAC = [OFHMAC HMACWithHashClass: [OFSHA256Hash class]
+		   allowsSwappableMemory: true];
+
+	TEST(@"PBKDF2-SHA256, 1 iteration",
+	    R(OFPBKDF2((OFPBKDF2Parameters){
+		.HMAC                  = HMAC,
+		.iterations            = 1,
+		.salt                  = (unsigned char *)"salt",
+		.saltLength            = 4,
+		.password              = "password",
+		.passwordLength        = 8,
+		.key                   = key,
+		.keyLength             = 32,
+		.allowsSwappableMemory = true
+	    })) &&
+	    memcmp(key, "\x12\x0F\xB6\xCF\xFC\xF8\xB3\x2C\x43\xE7\x22"
+	        "\x52\x56\xC4\xF8\x37\xA8\x65\x48\xC9\x2C\xCC"
+	        "\x35\x48\x08\x05\x98\x7C\xB7\x0B\xE1\x7B", 32) == 0)
+
+	TEST(@"PBKDF2-SHA256, 2 iterations",
+	    R(OFPBKDF2((OFPBKDF2Parameters){
+		.HMAC                  = HMAC,
+		.iterations            = 2,
+		.salt                  = (unsigned char *)"salt",
+		.saltLength            = 4,
+		.password              = "password",
+		.passwordLength        = 8,
+		.key                   = key,
+		.keyLength             = 32,
+		.allowsSwappableMemory = true
+	    })) &&
+	    memcmp(key, "\xAE\x4D\x0C\x95\xAF\x6B\x46\xD3\x2D\x0A\xDF"
+	        "\xF9\x28\xF0\x6D\xD0\x2A\x30\x3F\x8E\xF3\xC2"
+	        "\x51\xDF\xD6\xE2\xD8\x5A\x95\x47\x4C\x43", 32) == 0)
+
+	TEST(@"PBKDF2-SHA256, 4096 iterations",
+	    R(OFPBKDF2((OFPBKDF2Parameters){
+		.HMAC                  = HMAC,
+		.iterations            = 4096,
+		.salt                  = (unsigned char *)"salt",
+		.saltLength            = 4,
+		.password              = "password",
+		.passwordLength        = 8,
+		.key                   = key,
+		.keyLength             = 32,
+		.allowsSwappableMemory = true
+	    })) &&
+	    memcmp(key, "\xC5\xE4\x78\xD5\x92\x88\xC8\x41\xAA\x53\x0D"
+	        "\xB6\x84\x5C\x4C\x8D\x96\x28\x93\xA0\x01\xCE"
+	        "\x4E\x11\xA4\x96\x38\x73\xAA\x98\x13\x4A", 32) == 0)
+
+	TEST(@"PBKDF2-SHA256, 4096 iterations, key > 1 block",
+	    R(OFPBKDF2((OFPBKDF2Parameters){
+		.HMAC                  = HMAC,
+		.iterations            = 4096,
+		.salt                  = (unsigned char *)"saltSALTsaltSALTsalt"
+		                         "SALTsaltSALTsalt",
+		.saltLength            = 36,
+		.password              = "passwordPASSWORDpassword",
+		.passwordLength        = 24,
+		.key                   = key,
+		.keyLength             = 40,
+		.allowsSwappableMemory = true
+	    })) &&
+	    memcmp(key, "\x34\x8C\x89\xDB\xCB\xD3\x2B\x2F\x32\xD8\x14"
+	        "\xB8\x11\x6E\x84\xCF\x2B\x17\x34\x7E\xBC\x18"
+	        "\x00\x18\x1C\x4E\x2A\x1F\xB8\xDD\x53\xE1\xC6"
+	        "\x35\x51\x8C\x7D\xAC\x47\xE9", 40) == 0)
+
+	TEST(@"PBKDF2-SHA256, 1 iteration, key of 2 blocks",
+	    R(OFPBKDF2((OFPBKDF2Parameters){
+		.HMAC                  = HMAC,
+		.iterations            = 1,
+		.salt                  = (unsigned char *)"salt",
+		.saltLength            = 4,
+		.password              = "passwd",
+		.passwordLength        = 6,
+		.key                   = key,
+		.keyLength             = 64,
+		.allowsSwappableMemory = true
+	    })) &&
+	    memcmp(key, "\x55\xAC\x04\x6E\x56\xE3\x08\x9F\xEC\x16\x91"
+	        "\xC2\x25\x44\xB6\x05\xF9\x41\x85\x21\x6D\xDE"
+	        "\x04\x65\xE6\x8B\x9D\x57\xC2\x0D\xAC\xBC\x49"
+	        "\xCA\x9C\xCC\xF1\x79\xB6\x45\x99\x16\x64\xB3"
+	        "\x9D\x77\xEF\x31\x7C\x71\xB8\x45\xB1\xE3\x0B"
+	        "\xD5\x09\x11\x20\x41\xD3\xA1\x97\x83", 64) == 0)
+
 	objc_autoreleasePoolPop(pool);
 }
 @end
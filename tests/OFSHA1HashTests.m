@@ -19,6 +19,8 @@
 
 #import "TestsAppDelegate.h"
 
+#import "OFSHA1Hash+Private.h"
+
 static OFString *const module = @"OFSHA1Hash";
 
 const uint8_t testFileSHA1[20] =
@@ -54,6 +56,71 @@ const uint8_t testFileSHA1[20] =
 	    @"-[updateWithBuffer:length:]", OFHashAlreadyCalculatedException,
 	    [SHA1 updateWithBuffer: "" length: 1])
 
+	{
+		const void *buffers[20];
+		size_t lengths[20];
+		unsigned char data[300], expected[20 * 20], digests[20 * 20];
+		static const char *const messages[] = {
+			"", "abc",
+			"abcdbcdecdefdefgefghfghighijhijkijkljklmklmn"
+			    "lmnomnopnopq"
+		};
+		static const uint8_t knownDigests[3 * 20] =
+		    "\xDA\x39\xA3\xEE\x5E\x6B\x4B\x0D\x32\x55\xBF\xEF"
+		    "\x95\x60\x18\x90\xAF\xD8\x07\x09"
+		    "\xA9\x99\x3E\x36\x47\x06\x81\x6A\xBA\x3E\x25\x71"
+		    "\x78\x50\xC2\x6C\x9C\xD0\xD8\x9D"
+		    "\x84\x98\x3E\x44\x1C\x3B\xD2\x6E\xBA\xAE\x4A\xA1"
+		    "\xF9\x51\x29\xE5\xE5\x46\x70\xF1";
+
+		for (size_t i = 0; i < 3; i++) {
+			buffers[i] = messages[i];
+			lengths[i] = strlen(messages[i]);
+		}
+
+		TEST(@"+[hashBuffers:lengths:count:digests:] known answers",
+		    R([OFSHA1Hash hashBuffers: buffers
+				      lengths: lengths
+					count: 3
+				      digests: digests]) &&
+		    memcmp(digests, knownDigests, sizeof(knownDigests)) == 0)
+
+		for (size_t i = 0; i < 300; i++)
+			data[i] = (unsigned char)i;
+
+		/*
+		 * Messages of 1 to 5 blocks, so that lanes finish at different
+		 * times and are refilled.
+		 */
+		for (size_t i = 0; i < 20; i++) {
+			OFSHA1Hash *hash =
+			    [OFSHA1Hash hashWithAllowsSwappableMemory: true];
+
+			buffers[i] = data + i;
+			lengths[i] = i * 13;
+
+			[hash updateWithBuffer: buffers[i] length: lengths[i]];
+			[hash calculate];
+			memcpy(expected + i * 20, hash.digest, 20);
+		}
+
+		TEST(@"+[hashBuffers:lengths:count:digests:]",
+		    R([OFSHA1Hash hashBuffers: buffers
+				      lengths: lengths
+					count: 20
+				      digests: digests]) &&
+		    memcmp(digests, expected, sizeof(expected)) == 0)
+
+		/* Also test the AVX2 lanes on CPUs with the SHA extensions. */
+		memset(digests, 0, sizeof(digests));
+		if ([OFSHA1Hash of_hashBuffersInAVX2Lanes: buffers
+						  lengths: lengths
+						    count: 20
+						  digests: digests])
+			TEST(@"+[hashBuffers:lengths:count:digests:] with AVX2",
+			    memcmp(digests, expected, sizeof(expected)) == 0)
+	}
+
 	objc_autoreleasePoolPop(pool);
 }
 @end
@@ -19,6 +19,8 @@
 
 #import "TestsAppDelegate.h"
 
+#import "OFSHA224Or256Hash+Private.h"
+
 static OFString *const module = @"OFSHA256Hash";
 
 const uint8_t testFileSHA256[32] =
@@ -55,6 +57,47 @@ const uint8_t testFileSHA256[32] =
 	    @"-[updateWithBuffer:length:]", OFHashAlreadyCalculatedException,
 	    [SHA256 updateWithBuffer: "" length: 1])
 
+	{
+		const void *buffers[20];
+		size_t lengths[20];
+		unsigned char data[300], expected[20 * 32], digests[20 * 32];
+
+		for (size_t i = 0; i < 300; i++)
+			data[i] = (unsigned char)i;
+
+		/*
+		 * Messages of 1 to 5 blocks, so that lanes finish at different
+		 * times and are refilled.
+		 */
+		for (size_t i = 0; i < 20; i++) {
+			OFSHA256Hash *hash =
+			    [OFSHA256Hash hashWithAllowsSwappableMemory: true];
+
+			buffers[i] = data + i;
+			lengths[i] = i * 13;
+
+			[hash updateWithBuffer: buffers[i] length: lengths[i]];
+			[hash calculate];
+			memcpy(expected + i * 32, hash.digest, 32);
+		}
+
+		TEST(@"+[hashBuffers:lengths:count:digests:]",
+		    R([OFSHA256Hash hashBuffers: buffers
+					lengths: lengths
+					  count: 20
+					digests: digests]) &&
+		    memcmp(digests, expected, sizeof(expected)) == 0)
+
+		/* Also test the AVX2 lanes on CPUs with the SHA extensions. */
+		memset(digests, 0, sizeof(digests));
+		if ([OFSHA256Hash of_hashBuffersInAVX2Lanes: buffers
+						    lengths: lengths
+						      count: 20
+						    digests: digests])
+			TEST(@"+[hashBuffers:lengths:count:digests:] with AVX2",
+			    memcmp(digests, expected, sizeof(expected)) == 0)
+	}
+
 	objc_autoreleasePoolPop(pool);
 }
 @end
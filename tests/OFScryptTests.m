@@ -133,6 +133,38 @@ static const unsigned char testVector4[64] = {
 };
 #endif
 
+#ifdef OF_HAVE_THREADS
+/* Runs scrypt from within a job on the thread pool that scrypt uses. */
+@interface ScryptTestJob: OFObject
+{
+@public
+	OFThreadPool *_threadPool;
+	unsigned char _output[64];
+}
+
+- (void)run: (id)object;
+@end
+
+@implementation ScryptTestJob
+- (void)run: (id)object
+{
+	OFScrypt((OFScryptParameters){
+		.blockSize             = 8,
+		.costFactor            = 1024,
+		.parallelization       = 16,
+		.salt                  = (unsigned char *)"NaCl",
+		.saltLength            = 4,
+		.password              = "password",
+		.passwordLength        = 8,
+		.key                   = _output,
+		.keyLength             = 64,
+		.allowsSwappableMemory = true,
+		.threadPool            = _threadPool
+	});
+}
+@end
+#endif
+
 @implementation TestsAppDelegate (OFScryptTests)
 - (void)scryptTests
 {
@@ -141,6 +173,10 @@ static const unsigned char testVector4[64] = {
 	uint32_t blockMixBuffer[32];
 	uint32_t ROMixBuffer[32], ROMixTmp[17 * 32];
 	unsigned char output[64];
+#ifdef OF_HAVE_THREADS
+	OFThreadPool *threadPool;
+	ScryptTestJob *jobs[2];
+#endif
 
 	TEST(@"Salsa20/8 Core",
 	    R(memcpy(salsa20Buffer, salsa20Input, 64)) &&
@@ -184,6 +220,40 @@ static const unsigned char testVector4[64] = {
 		.allowsSwappableMemory = true
 	    })) && memcmp(output, testVector2, 64) == 0)
 
+#ifdef OF_HAVE_THREADS
+	TEST(@"scrypt test vector #2 with thread pool",
+	    R(OFScrypt((OFScryptParameters){
+		.blockSize             = 8,
+		.costFactor            = 1024,
+		.parallelization       = 16,
+		.salt                  = (unsigned char *)"NaCl",
+		.saltLength            = 4,
+		.password              = "password",
+		.passwordLength        = 8,
+		.key                   = output,
+		.keyLength             = 64,
+		.allowsSwappableMemory = true,
+		.threadPool            = [OFThreadPool threadPoolWithSize: 4]
+	    })) && memcmp(output, testVector2, 64) == 0)
+
+	/*
+	 * Both threads of the pool run a job that calls scrypt, so the lanes
+	 * scrypt dispatches can only run once that job is done.
+	 */
+	threadPool = [OFThreadPool threadPoolWithSize: 2];
+	for (size_t i = 0; i < 2; i++) {
+		jobs[i] = [[[ScryptTestJob alloc] init] autorelease];
+		jobs[i]->_threadPool = threadPool;
+		[threadPool dispatchWithTarget: jobs[i]
+				      selector: @selector(run:)
+					object: nil];
+	}
+
+	TEST(@"scrypt from within a job on a busy thread pool",
+	    R([threadPool waitUntilDone]) &&
+	    memcmp(jobs[0]->_output, testVector2, 64) == 0 &&
+	    memcmp(jobs[1]->_output, testVector2, 64) == 0)
+#endif
 	/* The third test vector is too expensive for m68k. */
 #ifndef OF_M68K
 	TEST(@"scrypt test vector #3",
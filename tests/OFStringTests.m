@@ -220,6 +220,7 @@ static const OFChar16 swappedChar16String[] = {
 	const OFUnichar *characters;
 	const uint16_t *UTF16Characters;
 	OFCharacterSet *characterSet;
+	OFStringSearch *search, *backwardsSearch;
 	EntityHandler *entityHandler;
 #ifdef OF_HAVE_BLOCKS
 	__block int j;
@@ -294,6 +295,32 @@ static const OFChar16 swappedChar16String[] = {
 	EXPECT_EXCEPTION(@"Detect out of range in -[characterAtIndex:]",
 	    OFOutOfRangeException, [mutableString1 characterAtIndex: 7])
 
+	string = [stringClass stringWithUTF8String:
+	    "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"
+	    "täs€0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUV"
+	    "ä€𝄞ä€𝄞ä€𝄞ä€𝄞ä€𝄞ä€𝄞ä€𝄞ä€𝄞ä€𝄞ä€𝄞ä€𝄞ä€𝄞ä€𝄞ä€𝄞ä€𝄞ä€𝄞xyz"];
+	TEST(@"-[length] and -[characterAtIndex:] on long strings",
+	    string.length == 175 && string.UTF8StringLength == 274 &&
+	    [string characterAtIndex: 61] == 'Z' &&
+	    [string characterAtIndex: 63] == 0xE4 &&
+	    [string characterAtIndex: 65] == 0x20AC &&
+	    [string characterAtIndex: 124] == 0xE4 &&
+	    [string characterAtIndex: 126] == 0x1D11E &&
+	    [string characterAtIndex: 174] == 'z' &&
+	    [string rangeOfString: @"xyz"
+			  options: 0
+			    range: OFRangeMake(100, 75)].location == 172)
+
+	mutableString2 = [mutableStringClass stringWithString: string];
+	TEST(@"-[characterAtIndex:] on long strings after mutation",
+	    [mutableString2 characterAtIndex: 126] == 0x1D11E &&
+	    R([mutableString2 deleteCharactersInRange: OFRangeMake(0, 1)]) &&
+	    [mutableString2 characterAtIndex: 125] == 0x1D11E &&
+	    [mutableString2 characterAtIndex: 123] == 0xE4 &&
+	    R([mutableString2 appendString: @"ä"]) &&
+	    [mutableString2 characterAtIndex: 173] == 'z' &&
+	    [mutableString2 characterAtIndex: 174] == 0xE4)
+
 	TEST(@"-[reverse]",
 	    R([mutableString1 reverse]) && [mutableString1 isEqual: @"3𝄞1€sät"])
 
@@ -492,6 +519,19 @@ static const OFChar16 swappedChar16String[] = {
 	    R(([mutableString1 appendFormat: @"%02X", 15])) &&
 	    [mutableString1 isEqual: @"test:1230F"])
 
+	mutableString2 = [mutableStringClass string];
+	[mutableString2 reserveCapacity: 16];
+	for (size_t i = 0; i < 1000; i++)
+		[mutableString2 appendFormat: @"%u€", (unsigned int)(i % 10)];
+	TEST(@"Repeated -[appendFormat:] and -[makeImmutable]",
+	    mutableString2.length == 2000 &&
+	    mutableString2.UTF8StringLength == 4000 &&
+	    [mutableString2 characterAtIndex: 1998] == '9' &&
+	    [mutableString2 characterAtIndex: 1999] == 0x20AC &&
+	    R([mutableString2 deleteCharactersInRange: OFRangeMake(4, 1994)]) &&
+	    R([mutableString2 makeImmutable]) &&
+	    [mutableString2 isEqual: @"0€1€9€"])
+
 	TEST(@"-[rangeOfString:]",
 	    [C(@"𝄞öö") rangeOfString: @"öö"].location == 1 &&
 	    [C(@"𝄞öö") rangeOfString: @"ö"].location == 1 &&
@@ -511,6 +551,43 @@ static const OFChar16 swappedChar16String[] = {
 	    OFOutOfRangeException,
 	    [C(@"𝄞öö") rangeOfString: @"ö" options: 0 range: OFRangeMake(3, 1)])
 
+	search = [OFStringSearch searchWithString: @"öö" options: 0];
+	backwardsSearch = [OFStringSearch
+	    searchWithString: @"ö"
+		     options: OFStringSearchBackwards];
+	TEST(@"-[rangeOfStringSearch:]",
+	    [C(@"𝄞öö") rangeOfStringSearch: search].location == 1 &&
+	    [C(@"𝄞öö") rangeOfStringSearch: search].length == 2 &&
+	    [C(@"𝄞ö") rangeOfStringSearch: search].location == OFNotFound &&
+	    [C(@"𝄞öö") rangeOfStringSearch: backwardsSearch].location == 2 &&
+	    [C(@"𝄞") rangeOfStringSearch: backwardsSearch].location ==
+	    OFNotFound)
+
+	TEST(@"-[rangeOfStringSearch:range:]",
+	    [C(@"𝄞öö") rangeOfStringSearch: backwardsSearch
+				     range: OFRangeMake(0, 2)].location == 1 &&
+	    [C(@"𝄞öö") rangeOfStringSearch: search
+				     range: OFRangeMake(2, 1)].location ==
+	    OFNotFound)
+
+	mutableString3 = [OFMutableString string];
+	for (i = 0; i < 300; i++)
+		[mutableString3 appendString: @"aöb"];
+	[mutableString3 appendString: @"aöc"];
+	search = [OFStringSearch searchWithString: @"aöbaöc" options: 0];
+	backwardsSearch = [OFStringSearch
+	    searchWithString: @"öbaö"
+		     options: OFStringSearchBackwards];
+	TEST(@"-[rangeOfStringSearch:] with long strings",
+	    [C(mutableString3) rangeOfStringSearch: search].location == 897 &&
+	    [C(mutableString3) rangeOfStringSearch: backwardsSearch].location ==
+	    898)
+
+	EXPECT_EXCEPTION(
+	    @"Detect out of range in -[rangeOfStringSearch:range:]",
+	    OFOutOfRangeException,
+	    [C(@"𝄞öö") rangeOfStringSearch: search range: OFRangeMake(3, 1)])
+
 	characterSet =
 	    [OFCharacterSet characterSetWithCharactersInString: @"cđ"];
 	TEST(@"-[indexOfCharacterFromSet:]",
@@ -627,6 +704,28 @@ static const OFChar16 swappedChar16String[] = {
 	    [[array objectAtIndex: i++] isEqual: @"baz"] &&
 	    array.count == i)
 
+	mutableString2 = [mutableStringClass string];
+	for (i = 0; i < 100; i++)
+		[mutableString2 appendString: @"abcabd"];
+	[mutableString2 appendString: @"abcabe"];
+	TEST(@"Searching long strings",
+	    [mutableString2 rangeOfString: @"abcabe"].location == 600 &&
+	    [mutableString2 rangeOfString: @"abdabc"].location == 3 &&
+	    [mutableString2 rangeOfString: @"abcabd"
+				  options: OFStringSearchBackwards].location ==
+	    594 &&
+	    [mutableString2 rangeOfString: @"abcabd"
+				  options: OFStringSearchBackwards
+				    range: OFRangeMake(0, 400)].location ==
+	    390 &&
+	    [mutableString2 rangeOfString: @"abeabc"].location == OFNotFound &&
+	    [mutableString2 containsString: @"dabcabe"] &&
+	    ![mutableString2 containsString: @"abdabe"] &&
+	    (array = [mutableString2 componentsSeparatedByString: @"abd"]) &&
+	    array.count == 101 &&
+	    [[array objectAtIndex: 0] isEqual: @"abc"] &&
+	    [array.lastObject isEqual: @"abcabe"])
+
 	characterSet =
 	    [OFCharacterSet characterSetWithCharactersInString: @"XYZ"];
 
@@ -104,6 +104,9 @@
 	[OFStdOut writeFormat: @"[OFSystemInfo] Supports AES-NI: %d\n",
 	    [OFSystemInfo supportsAESNI]];
 
+	[OFStdOut writeFormat: @"[OFSystemInfo] Supports PCLMULQDQ: %d\n",
+	    [OFSystemInfo supportsPCLMULQDQ]];
+
 	[OFStdOut writeFormat: @"[OFSystemInfo] Supports SHA extensions: %d\n",
 	    [OFSystemInfo supportsSHAExtensions]];
 #endif
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#include "config.h"
+
+#import "TestsAppDelegate.h"
+
+static OFString *const module = @"OFThreadPool";
+
+@interface ThreadPoolTestJobs: OFObject
+{
+@public
+	OFThreadPool *_threadPool;
+	OFMutex *_mutex;
+	size_t _count;
+}
+
+- (void)increase;
+- (void)nestedJobWithDepth: (OFNumber *)depth;
+@end
+
+@implementation ThreadPoolTestJobs
+- (instancetype)init
+{
+	self = [super init];
+
+	@try {
+		_mutex = [[OFMutex alloc] init];
+	} @catch (id e) {
+		[self release];
+		@throw e;
+	}
+
+	return self;
+}
+
+- (void)dealloc
+{
+	[_threadPool release];
+	[_mutex release];
+
+	[super dealloc];
+}
+
+- (void)increase
+{
+	[_mutex lock];
+	_count++;
+	[_mutex unlock];
+}
+
+- (void)nestedJobWithDepth: (OFNumber *)depth
+{
+	OFNumber *nextDepth;
+
+	[self increase];
+
+	if (depth.unsignedIntValue == 0)
+		return;
+
+	nextDepth = [OFNumber numberWithUnsignedInt:
+	    depth.unsignedIntValue - 1];
+	for (int i = 0; i < 4; i++)
+		[_threadPool dispatchWithTarget: self
+				       selector: @selector(nestedJobWithDepth:)
+					 object: nextDepth];
+}
+@end
+
+@implementation TestsAppDelegate (OFThreadPoolTests)
+- (void)threadPoolTests
+{
+	void *pool = objc_autoreleasePoolPush();
+	OFThreadPool *threadPool;
+	ThreadPoolTestJobs *jobs;
+
+	TEST(@"+[threadPoolWithSize:]",
+	    (threadPool = [OFThreadPool threadPoolWithSize: 4]) &&
+	    threadPool.size == 4)
+
+	jobs = [[[ThreadPoolTestJobs alloc] init] autorelease];
+	jobs->_threadPool = [threadPool retain];
+
+	for (int i = 0; i < 10000; i++)
+		[threadPool dispatchWithTarget: jobs
+				      selector: @selector(increase)
+					object: nil];
+
+	TEST(@"Many more jobs than threads",
+	    R([threadPool waitUntilDone]) && jobs->_count == 10000)
+
+	/* Each job with depth 4 results in 1 + 4 + 16 + 64 + 256 jobs. */
+	jobs->_count = 0;
+	for (int i = 0; i < 10; i++)
+		[threadPool dispatchWithTarget: jobs
+				      selector: @selector(nestedJobWithDepth:)
+					object: [OFNumber numberWithInt: 4]];
+
+	TEST(@"-[dispatchWithTarget:selector:object:] from within jobs",
+	    R([threadPool waitUntilDone]) && jobs->_count == 10 * 341)
+
+#ifdef OF_HAVE_BLOCKS
+	jobs->_count = 0;
+	for (int i = 0; i < 100; i++) {
+		[threadPool dispatchWithBlock: ^ {
+			for (int j = 0; j < 10; j++) {
+				[threadPool dispatchWithBlock: ^ {
+					[jobs increase];
+				}];
+			}
+
+			[jobs increase];
+		}];
+	}
+
+	TEST(@"-[dispatchWithBlock:] from within jobs",
+	    R([threadPool waitUntilDone]) && jobs->_count == 100 * 11)
+#endif
+
+	TEST(@"-[waitUntilDone] without jobs", R([threadPool waitUntilDone]))
+
+	objc_autoreleasePoolPop(pool);
+}
+@end
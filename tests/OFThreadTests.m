@@ -33,11 +33,111 @@ static OFString *const module = @"OFThread";
 }
 @end
 
+@interface MessageTestThread: OFThread
+{
+@public
+	OFMutableArray *_numbers;
+}
+@end
+
+@implementation MessageTestThread
+- (id)main
+{
+	[[OFRunLoop currentRunLoop] run];
+
+	return nil;
+}
+
+- (void)addNumber: (OFNumber *)number
+{
+	[_numbers addObject: number];
+}
+@end
+
+@interface RunLoopStepTestThread: OFThread
+{
+@public
+	volatile bool _done;
+}
+@end
+
+@implementation RunLoopStepTestThread
+- (id)main
+{
+	/*
+	 * A single iteration needs to perform the message that woke it up
+	 * instead of waiting until the deadline.
+	 */
+	[[OFRunLoop currentRunLoop]
+	    runMode: OFDefaultRunLoopMode
+	 beforeDate: [OFDate dateWithTimeIntervalSinceNow: 30]];
+
+	return [OFNumber numberWithBool: _done];
+}
+
+- (void)setDone
+{
+	_done = true;
+}
+@end
+
+@interface ReadWriteLockTestThread: OFThread
+{
+@public
+	OFReadWriteLock *_lock;
+	unsigned int *_counter;
+	volatile bool *_writing;
+	bool _overlapped;
+}
+@end
+
+@implementation ReadWriteLockTestThread
+- (id)main
+{
+	for (int i = 0; i < 1000; i++) {
+		[_lock lock];
+		if (*_writing)
+			_overlapped = true;
+		*_writing = true;
+		(*_counter)++;
+		[OFThread yield];
+		if (!*_writing)
+			_overlapped = true;
+		*_writing = false;
+		[_lock unlock];
+
+		/*
+		 * Readers may overlap with each other, but never with a
+		 * writer.
+		 */
+		[_lock readLock];
+		if (*_writing || *_counter == 0)
+			_overlapped = true;
+		[OFThread yield];
+		if (*_writing)
+			_overlapped = true;
+		[_lock unlock];
+	}
+
+	return nil;
+}
+@end
+
 @implementation TestsAppDelegate (OFThreadTests)
 - (void)threadTests
 {
 	void *pool = objc_autoreleasePoolPush();
 	TestThread *thread;
+	MessageTestThread *messageThread;
+	RunLoopStepTestThread *stepThread;
+	OFDate *before;
+	bool inOrder;
+	OFReadWriteLock *readWriteLock;
+	ReadWriteLockTestThread *lockThreads[4];
+	unsigned int counter = 0;
+	volatile bool writing = false;
+	bool overlapped;
+	OFMutex *mutex;
 
 	TEST(@"+[thread]", (thread = [TestThread thread]))
 
@@ -48,6 +148,89 @@ static OFString *const module = @"OFThread";
 	TEST(@"-[threadDictionary]",
 	    [[OFThread threadDictionary] objectForKey: @"foo"] == nil)
 
+	messageThread = [MessageTestThread thread];
+	messageThread->_numbers = [OFMutableArray array];
+	[messageThread start];
+
+	for (int i = 0; i < 1000; i++)
+		[messageThread performSelector: @selector(addNumber:)
+				      onThread: messageThread
+				    withObject: [OFNumber numberWithInt: i]
+				 waitUntilDone: false];
+
+	[messageThread performSelector: @selector(addNumber:)
+			      onThread: messageThread
+			    withObject: [OFNumber numberWithInt: 1000]
+			 waitUntilDone: true];
+
+	inOrder = (messageThread->_numbers.count == 1001);
+	for (size_t i = 0; inOrder && i < 1001; i++)
+		if ([[messageThread->_numbers objectAtIndex: i]
+		    unsignedLongValue] != i)
+			inOrder = false;
+
+	TEST(@"-[performSelector:onThread:withObject:waitUntilDone:]",
+	    inOrder)
+
+	[messageThread.runLoop performSelector: @selector(stop)
+				      onThread: messageThread
+				 waitUntilDone: false];
+	[messageThread join];
+
+	stepThread = [RunLoopStepTestThread thread];
+	[stepThread start];
+	[OFThread sleepForTimeInterval: 0.1];
+
+	before = [OFDate date];
+	[stepThread performSelector: @selector(setDone)
+			   onThread: stepThread
+		      waitUntilDone: false];
+
+	TEST(@"-[OFRunLoop runMode:beforeDate:] performs a message",
+	    [[stepThread join] boolValue] &&
+	    [[OFDate date] timeIntervalSinceDate: before] < 10)
+
+	readWriteLock = [OFReadWriteLock readWriteLock];
+
+	TEST(@"-[OFReadWriteLock readLock]",
+	    R([readWriteLock readLock]) && [readWriteLock tryReadLock] &&
+	    ![readWriteLock tryLock] && R([readWriteLock unlock]) &&
+	    R([readWriteLock unlock]))
+
+	TEST(@"-[OFReadWriteLock lock]",
+	    R([readWriteLock lock]) && ![readWriteLock tryReadLock] &&
+	    ![readWriteLock tryLock] && R([readWriteLock unlock]))
+
+	for (size_t i = 0; i < 4; i++) {
+		lockThreads[i] = [ReadWriteLockTestThread thread];
+		lockThreads[i]->_lock = readWriteLock;
+		lockThreads[i]->_counter = &counter;
+		lockThreads[i]->_writing = &writing;
+		[lockThreads[i] start];
+	}
+
+	overlapped = false;
+	for (size_t i = 0; i < 4; i++) {
+		[lockThreads[i] join];
+
+		if (lockThreads[i]->_overlapped)
+			overlapped = true;
+	}
+
+	TEST(@"OFReadWriteLock with multiple threads",
+	    counter == 4000 && !overlapped)
+
+	mutex = [OFMutex mutex];
+	mutex.keepsStatistics = true;
+
+	TEST(@"-[OFMutex keepsStatistics]",
+	    R([mutex lock]) && R([mutex unlock]) && [mutex tryLock] &&
+	    R([mutex unlock]) && mutex.acquisitionsCount == 2 &&
+	    mutex.contendedAcquisitionsCount == 0)
+
+	TEST(@"-[OFMutex resetStatistics]",
+	    R([mutex resetStatistics]) && mutex.acquisitionsCount == 0)
+
 	objc_autoreleasePoolPop(pool);
 }
 @end
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2008-2022 Jonathan Schleifer <js@nil.im>
+ *
+ * All rights reserved.
+ *
+ * This file is part of ObjFW. It may be distributed under the terms of the
+ * Q Public License 1.0, which can be found in the file LICENSE.QPL included in
+ * the packaging of this file.
+ *
+ * Alternatively, it may be distributed under the terms of the GNU General
+ * Public License, either version 2 or 3, which can be found in the file
+ * LICENSE.GPLv2 or LICENSE.GPLv3 respectively included in the packaging of this
+ * file.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#import "TestsAppDelegate.h"
+
+static OFString *const module = @"OFZIPArchive";
+static const size_t manyEntriesCount = 1000;
+
+static void
+writeArchive(OFString *path, OFArray OF_GENERIC(OFString *) *fileNames)
+{
+	OFZIPArchive *archive = [OFZIPArchive archiveWithPath: path
+							 mode: @"w"];
+
+	/* Each file contains its own name. */
+	for (OFString *fileName in fileNames) {
+		OFZIPArchiveEntry *entry =
+		    [OFZIPArchiveEntry entryWithFileName: fileName];
+
+		[[archive streamForWritingEntry: entry] writeString: fileName];
+	}
+
+	[archive close];
+}
+
+/*
+ * Finds the local file header and the central directory record for the file
+ * name in the raw archive data, which works as long as no file content looks
+ * like a header.
+ */
+static void
+patchArchive(OFMutableData *data, const char *fileName,
+    const char *newFileName, bool clearUTF8Flag)
+{
+	unsigned char *bytes = data.mutableItems;
+	size_t count = data.count, length = strlen(fileName);
+
+	for (size_t i = 0; i + 46 + length <= count; i++) {
+		size_t nameOffset, flagsOffset, nameLengthOffset;
+
+		if (memcmp(bytes + i, "PK\3\4", 4) == 0) {
+			nameOffset = 30;
+			flagsOffset = 6;
+			nameLengthOffset = 26;
+		} else if (memcmp(bytes + i, "PK\1\2", 4) == 0) {
+			nameOffset = 46;
+			flagsOffset = 8;
+			nameLengthOffset = 28;
+		} else
+			continue;
+
+		if (bytes[i + nameLengthOffset] != length ||
+		    bytes[i + nameLengthOffset + 1] != 0 ||
+		    memcmp(bytes + i + nameOffset, fileName, length) != 0)
+			continue;
+
+		/* The UTF-8 flag is bit 11 of the little endian field. */
+		if (clearUTF8Flag)
+			bytes[i + flagsOffset + 1] &= ~(1u << 3);
+
+		/* Only rename in the central directory. */
+		if (newFileName != NULL && nameOffset == 46)
+			memcpy(bytes + i + nameOffset, newFileName, length);
+	}
+}
+
+static OFString *
+readFile(OFZIPArchive *archive, OFString *path)
+{
+	OFData *data =
+	    [[archive streamForReadingFile: path] readDataUntilEndOfStream];
+
+	return [OFString stringWithData: data encoding: OFStringEncodingUTF8];
+}
+
+@implementation TestsAppDelegate (OFZIPArchiveTests)
+- (void)ZIPArchiveTests
+{
+	void *pool = objc_autoreleasePoolPush();
+	OFString *path = [[OFSystemInfo temporaryDirectoryPath]
+	    stringByAppendingPathComponent: @"objfw-tests.zip"];
+	OFMutableArray *fileNames = [OFMutableArray array];
+	OFMutableData *data;
+	OFZIPArchive *archive;
+	OFArray *entries;
+	bool ok;
+
+	for (size_t i = 0; i < manyEntriesCount; i++)
+		[fileNames addObject:
+		    [OFString stringWithFormat: @"dir/file%zu.txt", i]];
+	[fileNames addObject: @"ö.txt"];
+#ifdef HAVE_CODEPAGE_437
+	/* Both are changed to codepage 437 below. */
+	[fileNames addObject: @"ascii.txt"];
+	[fileNames addObject: @"é"];
+#endif
+
+	writeArchive(path, fileNames);
+#ifdef HAVE_CODEPAGE_437
+	data = [OFMutableData dataWithContentsOfFile: path];
+	patchArchive(data, "ascii.txt", NULL, true);
+	patchArchive(data, "\xC3\xA9", NULL, true);
+	[data writeToFile: path];
+#endif
+
+	TEST(@"+[archiveWithPath:mode:]",
+	    (archive = [OFZIPArchive archiveWithPath: path mode: @"r"]))
+
+	TEST(@"-[streamForReadingFile:] with many entries",
+	    [readFile(archive, @"dir/file0.txt") isEqual: @"dir/file0.txt"] &&
+	    [readFile(archive, @"dir/file999.txt")
+	    isEqual: @"dir/file999.txt"] &&
+	    [readFile(archive, @"dir/file500.txt")
+	    isEqual: @"dir/file500.txt"])
+
+	EXPECT_EXCEPTION(@"Detect missing file in -[streamForReadingFile:]",
+	    OFOpenItemFailedException,
+	    [archive streamForReadingFile: @"dir/file1000.txt"])
+
+	EXPECT_EXCEPTION(@"Detect missing prefix in -[streamForReadingFile:]",
+	    OFOpenItemFailedException,
+	    [archive streamForReadingFile: @"dir/file50"])
+
+	TEST(@"-[streamForReadingFile:] with UTF-8 file name",
+	    [readFile(archive, @"ö.txt") isEqual: @"ö.txt"])
+
+#ifdef HAVE_CODEPAGE_437
+	TEST(@"-[streamForReadingFile:] with codepage 437 file name",
+	    [readFile(archive, @"ascii.txt") isEqual: @"ascii.txt"] &&
+	    [readFile(archive, @"├⌐") isEqual: @"é"])
+
+	EXPECT_EXCEPTION(@"Detect codepage 437 file name read as UTF-8",
+	    OFOpenItemFailedException,
+	    [archive streamForReadingFile: @"é"])
+#endif
+
+	/* After the lookups, so that some entries already exist. */
+	entries = archive.entries;
+	ok = (entries.count == fileNames.count);
+	for (size_t i = 0; ok && i <= manyEntriesCount; i++)
+		ok = [[[entries objectAtIndex: i] fileName]
+		    isEqual: [fileNames objectAtIndex: i]];
+	TEST(@"-[entries] keeps the order of the central directory", ok)
+
+#ifdef HAVE_CODEPAGE_437
+	TEST(@"-[entries] with codepage 437 file names",
+	    [[[entries objectAtIndex: manyEntriesCount + 1] fileName]
+	    isEqual: @"ascii.txt"] &&
+	    [[[entries objectAtIndex: manyEntriesCount + 2] fileName]
+	    isEqual: @"├⌐"])
+#endif
+
+	[archive close];
+
+	writeArchive(path, [OFArray arrayWithObjects: @"dup1", @"dup2", nil]);
+	data = [OFMutableData dataWithContentsOfFile: path];
+	patchArchive(data, "dup2", "dup1", false);
+	[data writeToFile: path];
+
+	EXPECT_EXCEPTION(@"Detect duplicate file names",
+	    OFInvalidFormatException,
+	    [OFZIPArchive archiveWithPath: path mode: @"r"])
+
+	[[OFFileManager defaultManager] removeItemAtPath: path];
+
+	objc_autoreleasePoolPop(pool);
+}
+@end
@@ -34,6 +34,11 @@ static OFString *const module = @"Runtime";
 - (id)nilSuperTest;
 @end
 
+#if defined(OF_OBJFW_RUNTIME) && defined(OF_HAVE_THREADS)
+@interface RuntimeLookupThread: OFThread
+@end
+#endif
+
 @implementation RuntimeTest
 @synthesize foo = _foo;
 @synthesize bar = _bar;
@@ -59,6 +64,30 @@ static OFString *const module = @"Runtime";
 }
 @end
 
+#if defined(OF_OBJFW_RUNTIME) && defined(OF_HAVE_THREADS)
+@implementation RuntimeLookupThread
+- (id)main
+{
+	for (unsigned int i = 0; i < 1000; i++) {
+		char name[32];
+		SEL selector;
+
+		snprintf(name, sizeof(name), "runtimeLookupTest%u", i);
+		selector = sel_registerName(name);
+
+		if (selector != sel_registerName(name) ||
+		    strcmp(sel_getName(selector), name) != 0)
+			return nil;
+
+		if (objc_getClass("RuntimeTest") != [RuntimeTest class])
+			return nil;
+	}
+
+	return [OFNumber numberWithBool: true];
+}
+@end
+#endif
+
 @implementation TestsAppDelegate (RuntimeTests)
 - (void)runtimeTests
 {
@@ -70,6 +99,10 @@ static OFString *const module = @"Runtime";
 	uintmax_t value;
 	id object;
 #endif
+#if defined(OF_OBJFW_RUNTIME) && defined(OF_HAVE_THREADS)
+	RuntimeLookupThread *threads[4];
+	bool lookupsSucceeded;
+#endif
 
 	EXPECT_EXCEPTION(@"Calling a non-existent method via super",
 	    OFNotImplementedException, [test superTest])
@@ -108,6 +141,22 @@ static OFString *const module = @"Runtime";
 	    objc_createTaggedPointer(classID, (UINTPTR_MAX >> 4) + 1) == nil)
 #endif
 
+#if defined(OF_OBJFW_RUNTIME) && defined(OF_HAVE_THREADS)
+	for (size_t i = 0; i < 4; i++) {
+		threads[i] = [RuntimeLookupThread thread];
+		[threads[i] start];
+	}
+
+	lookupsSucceeded = true;
+	for (size_t i = 0; i < 4; i++)
+		if (![[threads[i] join] boolValue])
+			lookupsSucceeded = false;
+
+	TEST(@"Concurrent selector and class lookups", lookupsSucceeded &&
+	    sel_registerName("runtimeLookupTest999") ==
+	    sel_registerName("runtimeLookupTest999"))
+#endif
+
 	objc_autoreleasePoolPop(pool);
 }
 @end
@@ -67,10 +67,30 @@
 - (void)blockTests;
 @end
 
+@interface TestsAppDelegate (OFChannelTests)
+- (void)channelTests;
+@end
+
 @interface TestsAppDelegate (OFCharacterSetTests)
 - (void)characterSetTests;
 @end
 
+@interface TestsAppDelegate (OFCRC16Tests)
+- (void)CRC16Tests;
+@end
+
+@interface TestsAppDelegate (OFCRC32Tests)
+- (void)CRC32Tests;
+@end
+
+@interface TestsAppDelegate (OFConcurrentDictionaryTests)
+- (void)concurrentDictionaryTests;
+@end
+
+@interface TestsAppDelegate (OFDeflateStreamTests)
+- (void)deflateStreamTests;
+@end
+
 @interface TestsAppDelegate (OFDNSResolverTests)
 - (void)DNSResolverTests;
 @end
@@ -95,6 +115,10 @@
 - (void)HTTPClientTests;
 @end
 
+@interface TestsAppDelegate (OFHTTPServerTests)
+- (void)HTTPServerTests;
+@end
+
 @interface TestsAppDelegate (OFHTTPCookieTests)
 - (void)HTTPCookieTests;
 @end
@@ -111,6 +135,10 @@
 - (void)IPXSocketTests;
 @end
 
+@interface TestsAppDelegate (OFInflateStreamTests)
+- (void)inflateStreamTests;
+@end
+
 @interface TestsAppDelegate (OFInvocationTests)
 - (void)invocationTests;
 @end
@@ -243,6 +271,10 @@
 - (void)threadTests;
 @end
 
+@interface TestsAppDelegate (OFThreadPoolTests)
+- (void)threadPoolTests;
+@end
+
 @interface TestsAppDelegate (OFUDPSocketTests)
 - (void)UDPSocketTests;
 @end
@@ -279,3 +311,7 @@
     <OFXMLParserDelegate, OFXMLElementBuilderDelegate>
 - (void)XMLParserTests;
 @end
+
+@interface TestsAppDelegate (OFZIPArchiveTests)
+- (void)ZIPArchiveTests;
+@end
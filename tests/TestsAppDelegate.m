@@ -331,6 +331,10 @@ main(int argc, char *argv[])
 	[self valueTests];
 	[self numberTests];
 	[self streamTests];
+	[self inflateStreamTests];
+	[self deflateStreamTests];
+	[self CRC16Tests];
+	[self CRC32Tests];
 	[self notificationCenterTests];
 #ifdef OF_HAVE_FILES
 	[self MD5HashTests];
@@ -346,6 +350,10 @@ main(int argc, char *argv[])
 	[self scryptTests];
 #if defined(OF_HAVE_FILES) && defined(HAVE_CODEPAGE_437)
 	[self INIFileTests];
+#endif
+	/* FIXME: Find a way to write files on Nintendo DS */
+#if defined(OF_HAVE_FILES) && !defined(OF_NINTENDO_DS)
+	[self ZIPArchiveTests];
 #endif
 #ifdef OF_HAVE_SOCKETS
 	[self socketTests];
@@ -364,10 +372,14 @@ main(int argc, char *argv[])
 #endif
 #ifdef OF_HAVE_THREADS
 	[self threadTests];
+	[self threadPoolTests];
+	[self concurrentDictionaryTests];
+	[self channelTests];
 #endif
 	[self URLTests];
 #if defined(OF_HAVE_SOCKETS) && defined(OF_HAVE_THREADS)
 	[self HTTPClientTests];
+	[self HTTPServerTests];
 #endif
 #ifdef OF_HAVE_SOCKETS
 	[self HTTPCookieTests];
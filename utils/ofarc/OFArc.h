@@ -20,6 +20,8 @@
 
 OF_ASSUME_NONNULL_BEGIN
 
+@class OFReadOrWriteFailedException;
+
 #ifndef S_IRWXG
 # define S_IRWXG 0
 #endif
@@ -32,6 +34,7 @@ OF_ASSUME_NONNULL_BEGIN
 	int8_t _overwrite;
 @public
 	int8_t _outputLevel;
+	size_t _jobs;
 	OFString *_archivePath;
 	int _exitStatus;
 }
@@ -45,6 +48,8 @@ OF_ASSUME_NONNULL_BEGIN
 - (ssize_t)copyBlockFromStream: (OFStream *)input
 		      toStream: (OFStream *)output
 		      fileName: (OFString *)fileName;
+- (void)printReadOrWriteFailedException: (OFReadOrWriteFailedException *)e
+			       fileName: (OFString *)fileName;
 - (nullable OFString *)safeLocalPathForPath: (OFString *)path;
 @end
 
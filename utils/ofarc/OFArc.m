@@ -25,6 +25,10 @@
 #import "OFOptionsParser.h"
 #import "OFSandbox.h"
 #import "OFStdIOStream.h"
+#import "OFSystemInfo.h"
+#ifdef OF_HAVE_THREADS
+# import "OFThreadPool.h"
+#endif
 #import "OFURL.h"
 
 #import "OFArc.h"
@@ -39,6 +43,7 @@
 #import "OFNotImplementedException.h"
 #import "OFOpenItemFailedException.h"
 #import "OFReadFailedException.h"
+#import "OFReadOrWriteFailedException.h"
 #import "OFSeekFailedException.h"
 #import "OFWriteFailedException.h"
 
@@ -50,7 +55,7 @@ static void
 help(OFStream *stream, bool full, int status)
 {
 	[stream writeLine: OF_LOCALIZED(@"usage",
-	    @"Usage: %[prog] -[acCfhlnpqtvx] archive.zip [file1 file2 ...]",
+	    @"Usage: %[prog] -[acCfhjlnpqtvx] archive.zip [file1 file2 ...]",
 	    @"prog", [OFApplication programName])];
 
 	if (full) {
@@ -65,6 +70,8 @@ help(OFStream *stream, bool full, int status)
 		    "(only tar files)\n"
 		    @"    -f  --force       Force / overwrite files\n"
 		    @"    -h  --help        Show this help\n"
+		    @"    -j  --jobs        Number of files to extract in "
+		    @"parallel (only zip files)\n"
 		    @"    -l  --list        List all files in the archive\n"
 		    @"    -n  --no-clobber  Never overwrite files\n"
 		    @"    -p  --print       Print one or more files from the "
@@ -169,7 +176,7 @@ addFiles(id <Archive> archive, OFArray OF_GENERIC(OFString *) *files)
 @implementation OFArc
 - (void)applicationDidFinishLaunching
 {
-	OFString *outputDir, *encodingString, *type;
+	OFString *outputDir, *encodingString, *jobsString, *type;
 	const OFOptionsParserOption options[] = {
 		{ 'a', @"append", 0, NULL, NULL },
 		{ 'c', @"create", 0, NULL, NULL },
@@ -177,6 +184,7 @@ addFiles(id <Archive> archive, OFArray OF_GENERIC(OFString *) *files)
 		{ 'E', @"encoding", 1, NULL, &encodingString },
 		{ 'f', @"force", 0, NULL, NULL },
 		{ 'h', @"help", 0, NULL, NULL },
+		{ 'j', @"jobs", 1, NULL, &jobsString },
 		{ 'l', @"list", 0, NULL, NULL },
 		{ 'n', @"no-clobber", 0, NULL, NULL },
 		{ 'p', @"print", 0, NULL, NULL },
@@ -328,6 +336,25 @@ addFiles(id <Archive> archive, OFArray OF_GENERIC(OFString *) *files)
 		[OFApplication terminateWithStatus: 1];
 	}
 
+	@try {
+		if (jobsString != nil) {
+			long long jobs = jobsString.longLongValue;
+
+			if (jobs < 1 || (unsigned long long)jobs > SIZE_MAX)
+				@throw [OFInvalidFormatException exception];
+
+			_jobs = (size_t)jobs;
+		}
+	} @catch (OFInvalidFormatException *e) {
+		[OFStdErr writeLine: OF_LOCALIZED(
+		    @"invalid_jobs",
+		    @"%[prog]: Invalid number of jobs: %[jobs]",
+		    @"prog", [OFApplication programName],
+		    @"jobs", jobsString)];
+
+		[OFApplication terminateWithStatus: 1];
+	}
+
 	remainingArguments = optionsParser.remainingArguments;
 
 	switch (mode) {
@@ -578,9 +605,15 @@ addFiles(id <Archive> archive, OFArray OF_GENERIC(OFString *) *files)
 							   mode: modeString
 						       encoding: encoding];
 		else if ([type isEqual: @"tgz"]) {
-			OFStream *GZIPStream = [OFGZIPStream
+			OFGZIPStream *GZIPStream = [OFGZIPStream
 			    streamWithStream: file
 					mode: modeString];
+#ifdef OF_HAVE_THREADS
+			/* Compress on all cores when creating an archive. */
+			if (mode == 'c' && [OFSystemInfo numberOfCPUs] > 1)
+				GZIPStream.threadPool =
+				    [OFThreadPool threadPool];
+#endif
 			archive = [TarArchive archiveWithStream: GZIPStream
 							   mode: modeString
 						       encoding: encoding];
@@ -713,33 +746,32 @@ error:
 
 	@try {
 		length = [input readIntoBuffer: buffer length: bufferSize];
-	} @catch (OFReadFailedException *e) {
-		OFString *error = [OFString
-		    stringWithCString: strerror(e.errNo)
-			     encoding: [OFLocale encoding]];
+		[output writeBuffer: buffer length: length];
+	} @catch (OFReadOrWriteFailedException *e) {
 		[OFStdOut writeString: @"\r"];
-		[OFStdErr writeLine: OF_LOCALIZED(@"failed_to_read_file",
-		    @"Failed to read file %[file]: %[error]",
-		    @"file", fileName,
-		    @"error", error)];
+		[self printReadOrWriteFailedException: e fileName: fileName];
 		return -1;
 	}
 
-	@try {
-		[output writeBuffer: buffer length: length];
-	} @catch (OFWriteFailedException *e) {
-		OFString *error = [OFString
-		    stringWithCString: strerror(e.errNo)
-			     encoding: [OFLocale encoding]];
-		[OFStdOut writeString: @"\r"];
+	return length;
+}
+
+- (void)printReadOrWriteFailedException: (OFReadOrWriteFailedException *)e
+			       fileName: (OFString *)fileName
+{
+	OFString *error = [OFString stringWithCString: strerror(e.errNo)
+					     encoding: [OFLocale encoding]];
+
+	if ([e isKindOfClass: [OFWriteFailedException class]])
 		[OFStdErr writeLine: OF_LOCALIZED(@"failed_to_write_file",
 		    @"Failed to write file %[file]: %[error]",
 		    @"file", fileName,
 		    @"error", error)];
-		return -1;
-	}
-
-	return length;
+	else
+		[OFStdErr writeLine: OF_LOCALIZED(@"failed_to_read_file",
+		    @"Failed to read file %[file]: %[error]",
+		    @"file", fileName,
+		    @"error", error)];
 }
 
 - (OFString *)safeLocalPathForPath: (OFString *)path
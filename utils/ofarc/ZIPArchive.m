@@ -20,12 +20,17 @@
 #import "OFApplication.h"
 #import "OFData.h"
 #import "OFDate.h"
+#import "OFFile.h"
 #import "OFFileManager.h"
 #import "OFLocale.h"
 #import "OFNumber.h"
 #import "OFSet.h"
 #import "OFStdIOStream.h"
 #import "OFString.h"
+#ifdef OF_HAVE_THREADS
+# import "OFCondition.h"
+# import "OFThreadPool.h"
+#endif
 
 #import "ZIPArchive.h"
 #import "OFArc.h"
@@ -33,6 +38,9 @@
 #import "OFInvalidFormatException.h"
 #import "OFOpenItemFailedException.h"
 #import "OFOutOfRangeException.h"
+#import "OFReadOrWriteFailedException.h"
+
+#define bufferSize 4096
 
 static OFArc *app;
 
@@ -70,6 +78,156 @@ setModificationDate(OFString *path, OFZIPArchiveEntry *entry)
 					 ofItemAtPath: path];
 }
 
+#ifdef OF_HAVE_THREADS
+/* A file that is extracted on a thread pool. */
+@interface ZIPArchiveExtraction: OFObject
+{
+@public
+	OFZIPArchive *_archive;
+	OFZIPArchiveEntry *_entry;
+	OFString *_outFileName;
+	OFCondition *_condition;
+	bool _done;
+	id _exception;
+}
+
+- (instancetype)initWithArchive: (OFZIPArchive *)archive
+			  entry: (OFZIPArchiveEntry *)entry
+		    outFileName: (OFString *)outFileName;
+- (void)extract: (id)object;
+- (void)waitUntilDone;
+@end
+
+@implementation ZIPArchiveExtraction
+- (instancetype)initWithArchive: (OFZIPArchive *)archive
+			  entry: (OFZIPArchiveEntry *)entry
+		    outFileName: (OFString *)outFileName
+{
+	self = [super init];
+
+	@try {
+		_archive = [archive retain];
+		_entry = [entry retain];
+		_outFileName = [outFileName copy];
+		_condition = [[OFCondition alloc] init];
+	} @catch (id e) {
+		[self release];
+		@throw e;
+	}
+
+	return self;
+}
+
+- (void)dealloc
+{
+	[_archive release];
+	[_entry release];
+	[_outFileName release];
+	[_condition release];
+	[_exception release];
+
+	[super dealloc];
+}
+
+- (void)extract: (id)object
+{
+	void *pool = objc_autoreleasePoolPush();
+
+	@try {
+		OFStream *stream = [_archive
+		    independentStreamForReadingFile: _entry.fileName];
+		OFFile *output = [OFFile fileWithPath: _outFileName
+						 mode: @"w"];
+		char buffer[bufferSize];
+
+		setPermissions(_outFileName, _entry);
+
+		while (!stream.atEndOfStream) {
+			size_t length = [stream readIntoBuffer: buffer
+							length: bufferSize];
+
+			[output writeBuffer: buffer length: length];
+		}
+
+		[output close];
+		setModificationDate(_outFileName, _entry);
+	} @catch (id e) {
+		_exception = [e retain];
+	}
+
+	objc_autoreleasePoolPop(pool);
+
+	[_condition lock];
+	@try {
+		_done = true;
+		[_condition signal];
+	} @finally {
+		[_condition unlock];
+	}
+}
+
+- (void)waitUntilDone
+{
+	[_condition lock];
+	@try {
+		while (!_done)
+			[_condition wait];
+	} @finally {
+		[_condition unlock];
+	}
+}
+@end
+
+/*
+ * Reports the finished extractions in the order they were started. If wait is
+ * true, this waits until all extractions are finished, otherwise only for as
+ * many as are needed to keep the number of pending extractions bounded.
+ *
+ * Read and write errors are reported like when extracting without threads.
+ * Any other exception is rethrown, but only once all pending extractions are
+ * finished, so that none of them still writes files while unwinding.
+ */
+static void
+finishExtractions(OFMutableArray OF_GENERIC(ZIPArchiveExtraction *) *
+    extractions, bool wait)
+{
+	while (extractions.count > 0) {
+		ZIPArchiveExtraction *extraction = extractions.firstObject;
+		OFString *fileName = extraction->_entry.fileName;
+		id exception;
+		bool done;
+
+		[extraction->_condition lock];
+		done = extraction->_done;
+		[extraction->_condition unlock];
+
+		if (!done && !wait && extractions.count <= 2 * app->_jobs)
+			break;
+
+		[extraction waitUntilDone];
+		exception = extraction->_exception;
+
+		if ([exception isKindOfClass:
+		    [OFReadOrWriteFailedException class]]) {
+			[app printReadOrWriteFailedException: exception
+						    fileName: fileName];
+			app->_exitStatus = 1;
+		} else if (exception != nil) {
+			for (ZIPArchiveExtraction *pending in extractions)
+				[pending waitUntilDone];
+
+			@throw [[exception retain] autorelease];
+		} else if (app->_outputLevel >= 0)
+			[OFStdOut writeLine: OF_LOCALIZED(
+			    @"extracting_file_done",
+			    @"Extracting %[file]... done",
+			    @"file", fileName)];
+
+		[extractions removeObjectAtIndex: 0];
+	}
+}
+#endif
+
 @implementation ZIPArchive
 + (void)initialize
 {
@@ -93,8 +251,19 @@ setModificationDate(OFString *path, OFZIPArchiveEntry *entry)
 	self = [super init];
 
 	@try {
-		_archive = [[OFZIPArchive alloc] initWithStream: stream
-							   mode: mode];
+		/*
+		 * Parallel extraction needs to open the archive again for
+		 * every file, which requires it to be opened by path.
+		 */
+		if (app->_jobs > 1 && [mode isEqual: @"r"] &&
+		    [stream isKindOfClass: [OFFile class]] &&
+		    ![app->_archivePath isEqual: @"-"])
+			_archive = [[OFZIPArchive alloc]
+			    initWithPath: app->_archivePath
+				    mode: mode];
+		else
+			_archive = [[OFZIPArchive alloc] initWithStream: stream
+								   mode: mode];
 	} @catch (id e) {
 		[self release];
 		@throw e;
@@ -241,6 +410,15 @@ setModificationDate(OFString *path, OFZIPArchiveEntry *entry)
 	bool all = (files.count == 0);
 	OFMutableSet OF_GENERIC(OFString *) *missing =
 	    [OFMutableSet setWithArray: files];
+#ifdef OF_HAVE_THREADS
+	OFThreadPool *threadPool = nil;
+	OFMutableArray OF_GENERIC(ZIPArchiveExtraction *) *extractions = nil;
+
+	if (app->_jobs > 1) {
+		threadPool = [OFThreadPool threadPoolWithSize: app->_jobs];
+		extractions = [OFMutableArray array];
+	}
+#endif
 
 	for (OFZIPArchiveEntry *entry in _archive.entries) {
 		void *pool = objc_autoreleasePoolPush();
@@ -267,7 +445,11 @@ setModificationDate(OFString *path, OFZIPArchiveEntry *entry)
 			goto outer_loop_end;
 		}
 
-		if (app->_outputLevel >= 0)
+		if (app->_outputLevel >= 0
+#ifdef OF_HAVE_THREADS
+		    && threadPool == nil
+#endif
+		    )
 			[OFStdOut writeString: OF_LOCALIZED(@"extracting_file",
 			    @"Extracting %[file]...",
 			    @"file", fileName)];
@@ -297,6 +479,24 @@ setModificationDate(OFString *path, OFZIPArchiveEntry *entry)
 		if (![app shouldExtractFile: fileName outFileName: outFileName])
 			goto outer_loop_end;
 
+#ifdef OF_HAVE_THREADS
+		if (threadPool != nil) {
+			ZIPArchiveExtraction *extraction =
+			    [[[ZIPArchiveExtraction alloc]
+			    initWithArchive: _archive
+				      entry: entry
+				outFileName: outFileName] autorelease];
+
+			[extractions addObject: extraction];
+			[threadPool dispatchWithTarget: extraction
+					      selector: @selector(extract:)
+						object: nil];
+
+			finishExtractions(extractions, false);
+			goto outer_loop_end;
+		}
+#endif
+
 		stream = [_archive streamForReadingFile: fileName];
 		output = [OFFile fileWithPath: outFileName mode: @"w"];
 		setPermissions(outFileName, entry);
@@ -346,6 +546,11 @@ outer_loop_end:
 		objc_autoreleasePoolPop(pool);
 	}
 
+#ifdef OF_HAVE_THREADS
+	if (extractions != nil)
+		finishExtractions(extractions, true);
+#endif
+
 	if (missing.count > 0) {
 		for (OFString *file in missing)
 			[OFStdErr writeLine: OF_LOCALIZED(
@@ -445,8 +650,9 @@ outer_loop_end:
 		entry.compressedSize = (int64_t)size;
 		entry.uncompressedSize = (int64_t)size;
 
-		entry.compressionMethod =
-		    OFZIPArchiveEntryCompressionMethodNone;
+		entry.compressionMethod = (isDirectory
+		    ? OFZIPArchiveEntryCompressionMethodNone
+		    : OFZIPArchiveEntryCompressionMethodDeflate);
 		entry.modificationDate = attributes.fileModificationDate;
 
 		[entry makeImmutable];